@@ -5,9 +5,10 @@ layout(set = 0, binding = 0) uniform GlobalUniformBuffer
 	mat4 viewProjection;
 };
 
+// the rows of the affine transformation, its last row is 0, 0, 0, 1
 layout(set = 1, binding = 0) uniform EntityUniformBuffer 
 {
-	mat4 transformation;
+	mat3x4 transformation;
 };
 
 layout(location = 0) in vec3 position;
@@ -17,6 +18,8 @@ layout(location = 0) out vec3 outNormal;
 
 void main()
 {
-	gl_Position = viewProjection * transformation * vec4(position, 1.0);
-	outNormal = normalize((transformation * vec4(normal, 0.0)).xyz);
+	// a vector on the left of the matrix is dotted with its columns, the rows of the transformation
+	vec3 worldPosition = vec4(position, 1.0) * transformation;
+	gl_Position = viewProjection * vec4(worldPosition, 1.0);
+	outNormal = normalize(vec4(normal, 0.0) * transformation);
 }
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include <visor.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+struct MovingBox
+{
+public:
+	Visor::Vector3<Visor::f32> position;
+	Visor::Vector3<Visor::f32> velocity;
+	Visor::Vector3<Visor::f32> extent;
+};
+
+static Visor::AABB getAABB(const MovingBox& box)
+{
+	return Visor::AABB(box.position - box.extent, box.position + box.extent);
+}
+
+// boxes bouncing in a cube sized so every box overlaps about the same number of others whatever their count
+static void runBenchmark(Visor::ui32 boxCount, Visor::ui32 frameCount, Visor::b8 compareBruteForce)
+{
+	const Visor::f32 worldSize = std::cbrt((Visor::f32)boxCount) * 4.0f;
+
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<Visor::f32> distribution(0.0f, 1.0f);
+
+	std::vector<MovingBox> boxes(boxCount);
+	for(MovingBox& box : boxes)
+	{
+		box.position = {distribution(generator) * worldSize, distribution(generator) * worldSize, distribution(generator) * worldSize};
+		// up to a unit per second along each axis, at 60 updates per second
+		box.velocity = Visor::Vector3<Visor::f32>{distribution(generator) - 0.5f, distribution(generator) - 0.5f, distribution(generator) - 0.5f} * (2.0f / 60.0f);
+		box.extent = Visor::Vector3<Visor::f32>{distribution(generator), distribution(generator), distribution(generator)} * 0.5f + 0.25f;
+	}
+
+	Visor::Broadphase broadphase;
+	std::vector<Visor::ui32> proxies(boxCount);
+	for(Visor::ui32 boxIndex = 0; boxIndex < boxCount; ++boxIndex)
+	{
+		proxies[boxIndex] = broadphase.insert(getAABB(boxes[boxIndex]), boxIndex);
+	}
+
+	const auto insertStart = std::chrono::high_resolution_clock::now();
+	broadphase.update();
+	const auto insertEnd = std::chrono::high_resolution_clock::now();
+
+	double updateSeconds = 0.0;
+	Visor::ui64 swapCount = 0;
+	Visor::ui64 eventCount = 0;
+	for(Visor::ui32 frame = 0; frame < frameCount; ++frame)
+	{
+		for(Visor::ui32 boxIndex = 0; boxIndex < boxCount; ++boxIndex)
+		{
+			MovingBox& box = boxes[boxIndex];
+			box.position = box.position + box.velocity;
+			if(box.position.x < 0.0f || box.position.x > worldSize) { box.velocity.x = -box.velocity.x; }
+			if(box.position.y < 0.0f || box.position.y > worldSize) { box.velocity.y = -box.velocity.y; }
+			if(box.position.z < 0.0f || box.position.z > worldSize) { box.velocity.z = -box.velocity.z; }
+
+			broadphase.move(proxies[boxIndex], getAABB(box));
+		}
+
+		const auto updateStart = std::chrono::high_resolution_clock::now();
+		broadphase.update();
+		const auto updateEnd = std::chrono::high_resolution_clock::now();
+
+		updateSeconds += std::chrono::duration<double>(updateEnd - updateStart).count();
+		swapCount += broadphase.getSwapCount();
+		eventCount += broadphase.getAddedPairs().size() + broadphase.getRemovedPairs().size();
+	}
+
+	std::cout << boxCount << " boxes : first update " << std::chrono::duration<double, std::milli>(insertEnd - insertStart).count() << " ms, "
+		<< updateSeconds * 1000.0 / frameCount << " ms per update, "
+		<< boxCount * frameCount / updateSeconds / 1000000.0 << " M boxes/s, "
+		<< broadphase.getPairCount() << " pairs, "
+		<< swapCount / frameCount << " swaps and " << eventCount / frameCount << " pair changes per update\n";
+
+	if(compareBruteForce)
+	{
+		Visor::ui32 bruteForcePairCount = 0;
+		const auto bruteForceStart = std::chrono::high_resolution_clock::now();
+		for(Visor::ui32 boxIndexA = 0; boxIndexA < boxCount; ++boxIndexA)
+		{
+			const Visor::AABB aabbA = getAABB(boxes[boxIndexA]);
+			for(Visor::ui32 boxIndexB = boxIndexA + 1; boxIndexB < boxCount; ++boxIndexB)
+			{
+				const Visor::AABB aabbB = getAABB(boxes[boxIndexB]);
+				if(aabbA.minimum.x <= aabbB.maximum.x && aabbB.minimum.x <= aabbA.maximum.x
+					&& aabbA.minimum.y <= aabbB.maximum.y && aabbB.minimum.y <= aabbA.maximum.y
+					&& aabbA.minimum.z <= aabbB.maximum.z && aabbB.minimum.z <= aabbA.maximum.z)
+				{
+					bruteForcePairCount += 1;
+				}
+			}
+		}
+		const auto bruteForceEnd = std::chrono::high_resolution_clock::now();
+
+		std::cout << boxCount << " boxes : all pairs tested in " << std::chrono::duration<double, std::milli>(bruteForceEnd - bruteForceStart).count()
+			<< " ms, " << bruteForcePairCount << " pairs\n";
+	}
+}
+
+int main()
+{
+	runBenchmark(10000, 200, true);
+	runBenchmark(100000, 50, false);
+
+	return 0;
+}
@@ -0,0 +1,311 @@
+#include <visor.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// latitude longitude sphere of radius 1, 4 * segmentCount * segmentCount triangles
+static Visor::Mesh getSphereMesh(Visor::ui32 segmentCount)
+{
+	std::vector<Visor::Mesh::Vertex> vertices;
+	std::vector<Visor::ui32> indices;
+
+	const Visor::f32 pi = 3.14159265f;
+	for(Visor::ui32 ring = 0; ring <= segmentCount; ++ring)
+	{
+		for(Visor::ui32 segment = 0; segment <= segmentCount * 2; ++segment)
+		{
+			const Visor::f32 theta = pi * ring / segmentCount;
+			const Visor::f32 phi = pi * segment / segmentCount;
+			const Visor::Vector3<Visor::f32> position = {std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+			vertices.push_back({position, position});
+		}
+	}
+
+	const Visor::ui32 rowSize = segmentCount * 2 + 1;
+	for(Visor::ui32 ring = 0; ring < segmentCount; ++ring)
+	{
+		for(Visor::ui32 segment = 0; segment < segmentCount * 2; ++segment)
+		{
+			const Visor::ui32 index = ring * rowSize + segment;
+			indices.insert(indices.end(), {index, index + rowSize, index + 1, index + 1, index + rowSize, index + rowSize + 1});
+		}
+	}
+
+	return Visor::Mesh(vertices, indices, "", "");
+}
+
+// rays from a sphere around the mesh towards random points of its box, about half of them miss the triangles
+static std::vector<Visor::Ray> getRays(const Visor::Mesh& mesh, Visor::ui32 rayCount)
+{
+	const Visor::AABB& aabb = mesh.getAABB();
+	const Visor::Vector3<Visor::f32> center = (aabb.minimum + aabb.maximum) * 0.5f;
+	const Visor::Vector3<Visor::f32> size = aabb.maximum - aabb.minimum;
+	const Visor::f32 radius = size.getNorm();
+
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<Visor::f32> distribution(-1.0f, 1.0f);
+
+	std::vector<Visor::Ray> rays;
+	rays.reserve(rayCount);
+	for(Visor::ui32 rayIndex = 0; rayIndex < rayCount; ++rayIndex)
+	{
+		Visor::Vector3<Visor::f32> position = {distribution(generator), distribution(generator), distribution(generator)};
+		position.normalize();
+		position = center + position * radius;
+
+		const Visor::Vector3<Visor::f32> target = {
+			center.x + distribution(generator) * size.x * 0.5f,
+			center.y + distribution(generator) * size.y * 0.5f,
+			center.z + distribution(generator) * size.z * 0.5f};
+		Visor::Vector3<Visor::f32> direction = target - position;
+		direction.normalize();
+
+		rays.push_back(Visor::Ray(position, direction));
+	}
+
+	return rays;
+}
+
+static void runBenchmark(const std::string& name, Visor::Mesh& mesh)
+{
+	const auto buildStart = std::chrono::high_resolution_clock::now();
+	mesh.buildBVH();
+	const auto buildEnd = std::chrono::high_resolution_clock::now();
+
+	const std::vector<Visor::Ray> rays = getRays(mesh, 1000000);
+
+	Visor::ui32 hitCount = 0;
+	const auto castStart = std::chrono::high_resolution_clock::now();
+	for(const Visor::Ray& ray : rays)
+	{
+		Visor::RayHit hit = {};
+		hitCount += mesh.intersect(ray, 1000000.0f, hit) ? 1 : 0;
+	}
+	const auto castEnd = std::chrono::high_resolution_clock::now();
+
+	// the same rays sorted for coherence and spread over the job threads, the first query sizes the buffers of the next ones
+	Visor::RayQuery query;
+	std::vector<Visor::RayHit> hits(rays.size());
+	query.intersect(mesh, rays.data(), (Visor::ui32)rays.size(), 1000000.0f, hits.data());
+
+	const auto batchStart = std::chrono::high_resolution_clock::now();
+	query.intersect(mesh, rays.data(), (Visor::ui32)rays.size(), 1000000.0f, hits.data());
+	const auto batchEnd = std::chrono::high_resolution_clock::now();
+
+	Visor::ui32 batchHitCount = 0;
+	for(const Visor::RayHit& hit : hits)
+	{
+		batchHitCount += hit.distance >= 0.0f ? 1 : 0;
+	}
+
+	const double buildMilliseconds = std::chrono::duration<double, std::milli>(buildEnd - buildStart).count();
+	const double castSeconds = std::chrono::duration<double>(castEnd - castStart).count();
+	const double batchSeconds = std::chrono::duration<double>(batchEnd - batchStart).count();
+
+	std::cout << name << " : " << mesh.getIndices().size() / 3 << " triangles, "
+		<< mesh.getBVH().getNodes().size() << " nodes built in " << buildMilliseconds << " ms, "
+		<< rays.size() / castSeconds / 1000000.0 << " Mrays/s on one thread ("
+		<< hitCount * 100.0 / rays.size() << "% hits), "
+		<< rays.size() / batchSeconds / 1000000.0 << " Mrays/s batched on " << Visor::JobSystem::getInstance().getThreadCount() << " threads"
+		<< (batchHitCount == hitCount ? "" : " (hit count differs)") << "\n";
+}
+
+static Visor::AABB getBoxAABB(const Visor::Vector3<Visor::f32>& position, const Visor::Vector3<Visor::f32>& extent)
+{
+	return Visor::AABB(position - extent, position + extent);
+}
+
+static Visor::f64 getMicroseconds(std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point end, Visor::ui32 count)
+{
+	return std::chrono::duration<Visor::f64, std::micro>(end - start).count() / count;
+}
+
+// the entity tree workload on its own : boxes of entities spread in a cube, a tenth of them moving every frame,
+// then picking rays, line of sight segments, area and view queries. picking and line of sight are meant to stay under 1 ms
+static void runTreeBenchmark(Visor::ui32 boxCount, Visor::ui32 queryCount)
+{
+	const Visor::f32 worldSize = std::cbrt((Visor::f32)boxCount) * 4.0f;
+
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<Visor::f32> distribution(0.0f, 1.0f);
+	const auto getPoint = [&generator, &distribution, worldSize]()
+	{
+		return Visor::Vector3<Visor::f32>{distribution(generator) * worldSize, distribution(generator) * worldSize, distribution(generator) * worldSize};
+	};
+
+	std::vector<Visor::Vector3<Visor::f32>> positions(boxCount);
+	std::vector<Visor::Vector3<Visor::f32>> extents(boxCount);
+	for(Visor::ui32 boxIndex = 0; boxIndex < boxCount; ++boxIndex)
+	{
+		positions[boxIndex] = getPoint();
+		extents[boxIndex] = Visor::Vector3<Visor::f32>{distribution(generator), distribution(generator), distribution(generator)} * 0.5f + 0.25f;
+	}
+
+	Visor::AABBTree tree;
+	std::vector<Visor::ui32> leaves(boxCount);
+	const auto insertStart = std::chrono::high_resolution_clock::now();
+	for(Visor::ui32 boxIndex = 0; boxIndex < boxCount; ++boxIndex)
+	{
+		leaves[boxIndex] = tree.insert(getBoxAABB(positions[boxIndex], extents[boxIndex]), boxIndex);
+	}
+	const auto insertEnd = std::chrono::high_resolution_clock::now();
+
+	// up to a unit per frame, past the margin of the leaves for most of them
+	const Visor::ui32 frameCount = 20;
+	const auto moveStart = std::chrono::high_resolution_clock::now();
+	for(Visor::ui32 frame = 0; frame < frameCount; ++frame)
+	{
+		for(Visor::ui32 boxIndex = frame % 10; boxIndex < boxCount; boxIndex += 10)
+		{
+			positions[boxIndex] = positions[boxIndex] + Visor::Vector3<Visor::f32>{distribution(generator) - 0.5f, distribution(generator) - 0.5f, distribution(generator) - 0.5f} * 2.0f;
+			tree.move(leaves[boxIndex], getBoxAABB(positions[boxIndex], extents[boxIndex]));
+		}
+	}
+	const auto moveEnd = std::chrono::high_resolution_clock::now();
+	const Visor::ui32 reinsertionCount = tree.getReinsertionCount();
+	const Visor::ui32 movedHeight = tree.getHeight();
+
+	const auto rebuildStart = std::chrono::high_resolution_clock::now();
+	tree.rebuild();
+	const auto rebuildEnd = std::chrono::high_resolution_clock::now();
+
+	std::cout << boxCount << " boxes : inserted in " << std::chrono::duration<Visor::f64, std::milli>(insertEnd - insertStart).count() << " ms, "
+		<< std::chrono::duration<Visor::f64, std::milli>(moveEnd - moveStart).count() / frameCount << " ms to move a tenth of them ("
+		<< reinsertionCount / frameCount << " reinsertions per frame, height " << movedHeight << "), rebuilt in "
+		<< std::chrono::duration<Visor::f64, std::milli>(rebuildEnd - rebuildStart).count() << " ms (height " << tree.getHeight() << ")\n";
+
+	// picking : from a random point in a random direction, through the whole world
+	std::vector<Visor::Ray> rays;
+	rays.reserve(queryCount);
+	for(Visor::ui32 queryIndex = 0; queryIndex < queryCount; ++queryIndex)
+	{
+		Visor::Vector3<Visor::f32> direction = {distribution(generator) - 0.5f, distribution(generator) - 0.5f, distribution(generator) - 0.5f};
+		direction.normalize();
+		rays.push_back(Visor::Ray(getPoint(), direction));
+	}
+
+	Visor::ui32 rayHitCount = 0;
+	const auto rayStart = std::chrono::high_resolution_clock::now();
+	for(const Visor::Ray& ray : rays)
+	{
+		Visor::ui32 userData = 0;
+		Visor::f32 distance = 0.0f;
+		rayHitCount += tree.raycast(ray, worldSize * 2.0f, userData, distance) ? 1 : 0;
+	}
+	const auto rayEnd = std::chrono::high_resolution_clock::now();
+
+	// line of sight : between two random points, blocked when any box is hit before the second one
+	std::vector<Visor::Ray> segments;
+	std::vector<Visor::f32> segmentLengths;
+	segments.reserve(queryCount);
+	segmentLengths.reserve(queryCount);
+	for(Visor::ui32 queryIndex = 0; queryIndex < queryCount; ++queryIndex)
+	{
+		const Visor::Vector3<Visor::f32> start = getPoint();
+		Visor::Vector3<Visor::f32> direction = {distribution(generator) - 0.5f, distribution(generator) - 0.5f, distribution(generator) - 0.5f};
+		direction.normalize();
+		segmentLengths.push_back(distribution(generator) * 20.0f);
+		segments.push_back(Visor::Ray(start, direction));
+	}
+
+	Visor::ui32 blockedCount = 0;
+	const auto segmentStart = std::chrono::high_resolution_clock::now();
+	for(Visor::ui32 queryIndex = 0; queryIndex < queryCount; ++queryIndex)
+	{
+		Visor::ui32 userData = 0;
+		Visor::f32 distance = 0.0f;
+		blockedCount += tree.raycast(segments[queryIndex], segmentLengths[queryIndex], userData, distance) ? 1 : 0;
+	}
+	const auto segmentEnd = std::chrono::high_resolution_clock::now();
+
+	// area : boxes of 4 units around random points, checked against all the boxes for the first queries
+	std::vector<Visor::AABB> areas;
+	areas.reserve(queryCount);
+	for(Visor::ui32 queryIndex = 0; queryIndex < queryCount; ++queryIndex)
+	{
+		areas.push_back(getBoxAABB(getPoint(), Visor::Vector3<Visor::f32>{2.0f, 2.0f, 2.0f}));
+	}
+
+	std::vector<Visor::ui32> userDatas;
+	Visor::ui64 overlapCount = 0;
+	const auto overlapStart = std::chrono::high_resolution_clock::now();
+	for(const Visor::AABB& area : areas)
+	{
+		userDatas.clear();
+		tree.queryOverlaps(area, userDatas);
+		overlapCount += userDatas.size();
+	}
+	const auto overlapEnd = std::chrono::high_resolution_clock::now();
+
+	Visor::ui64 checkedOverlapCount = 0;
+	Visor::ui64 bruteForceOverlapCount = 0;
+	for(Visor::ui32 queryIndex = 0; queryIndex < 100 && queryIndex < queryCount; ++queryIndex)
+	{
+		const Visor::AABB& area = areas[queryIndex];
+		userDatas.clear();
+		tree.queryOverlaps(area, userDatas);
+		checkedOverlapCount += userDatas.size();
+
+		for(Visor::ui32 boxIndex = 0; boxIndex < boxCount; ++boxIndex)
+		{
+			const Visor::AABB aabb = getBoxAABB(positions[boxIndex], extents[boxIndex]);
+			if(aabb.minimum.x <= area.maximum.x && area.minimum.x <= aabb.maximum.x
+				&& aabb.minimum.y <= area.maximum.y && area.minimum.y <= aabb.maximum.y
+				&& aabb.minimum.z <= area.maximum.z && area.minimum.z <= aabb.maximum.z)
+			{
+				bruteForceOverlapCount += 1;
+			}
+		}
+	}
+
+	// view : from the center of the world along an axis, about a tenth of it in sight
+	const Visor::Vector3<Visor::f32> center = {worldSize * 0.5f, worldSize * 0.5f, worldSize * 0.5f};
+	Visor::Camera camera = {};
+	camera.fov = 1.2f;
+	camera.position = center;
+	camera.lookAt(center + Visor::Vector3<Visor::f32>{0.0f, 0.0f, 1.0f});
+	const Visor::Frustum frustum = Visor::Frustum::fromMatrix(
+		Visor::Matrix4<Visor::f32>::getProjection(camera.fov, 16.0f / 9.0f) * Visor::Matrix4<Visor::f32>::getView(camera.position, camera.orientation));
+
+	const Visor::ui32 frustumQueryCount = 100;
+	const auto frustumStart = std::chrono::high_resolution_clock::now();
+	for(Visor::ui32 queryIndex = 0; queryIndex < frustumQueryCount; ++queryIndex)
+	{
+		userDatas.clear();
+		tree.queryFrustum(frustum, userDatas);
+	}
+	const auto frustumEnd = std::chrono::high_resolution_clock::now();
+
+	std::cout << boxCount << " boxes : "
+		<< getMicroseconds(rayStart, rayEnd, queryCount) << " us per ray (" << rayHitCount * 100.0 / queryCount << "% hits), "
+		<< getMicroseconds(segmentStart, segmentEnd, queryCount) << " us per segment (" << blockedCount * 100.0 / queryCount << "% blocked), "
+		<< getMicroseconds(overlapStart, overlapEnd, queryCount) << " us per overlap query (" << (Visor::f64)overlapCount / queryCount << " boxes"
+		<< (checkedOverlapCount == bruteForceOverlapCount ? "" : ", box count differs") << "), "
+		<< getMicroseconds(frustumStart, frustumEnd, frustumQueryCount) << " us per frustum query (" << userDatas.size() << " boxes) on one thread\n";
+}
+
+int main(int argc, char** argv)
+{
+	Visor::JobSystem::start(std::max(std::thread::hardware_concurrency(), 1u));
+
+	{
+		const std::string meshPath = argc > 1 ? argv[1] : "../assets/models/teapot.obj";
+		Visor::Mesh mesh = Visor::AssetSystem::importMesh(meshPath, "", "");
+		runBenchmark(meshPath, mesh);
+
+		Visor::Mesh sphereMesh = getSphereMesh(512);
+		runBenchmark("sphere", sphereMesh);
+	}
+
+	runTreeBenchmark(100000, 10000);
+
+	Visor::JobSystem::terminate();
+
+	return 0;
+}
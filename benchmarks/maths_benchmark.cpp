@@ -0,0 +1,525 @@
+#include <visor.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// the generic templates, which the float specializations must match bit for bit
+static Visor::Matrix4<Visor::f32> multiplyScalar(const Visor::Matrix4<Visor::f32>& matrixA, const Visor::Matrix4<Visor::f32>& matrixB)
+{
+	Visor::Matrix4<Visor::f32> result = {};
+	for(Visor::ui32 row = 0; row < 4; ++row)
+	{
+		for(Visor::ui32 column = 0; column < 4; ++column)
+		{
+			for(Visor::ui32 index = 0; index < 4; ++index)
+			{
+				result.m[row][column] += matrixA.m[row][index] * matrixB.m[index][column];
+			}
+		}
+	}
+
+	return result;
+}
+
+static Visor::Vector4<Visor::f32> multiplyScalar(const Visor::Matrix4<Visor::f32>& matrix, const Visor::Vector4<Visor::f32>& vector)
+{
+	Visor::Vector4<Visor::f32> result;
+	result.x = matrix.m[0][0] * vector.x + matrix.m[0][1] * vector.y + matrix.m[0][2] * vector.z + matrix.m[0][3] * vector.w;
+	result.y = matrix.m[1][0] * vector.x + matrix.m[1][1] * vector.y + matrix.m[1][2] * vector.z + matrix.m[1][3] * vector.w;
+	result.z = matrix.m[2][0] * vector.x + matrix.m[2][1] * vector.y + matrix.m[2][2] * vector.z + matrix.m[2][3] * vector.w;
+	result.w = matrix.m[3][0] * vector.x + matrix.m[3][1] * vector.y + matrix.m[3][2] * vector.z + matrix.m[3][3] * vector.w;
+
+	return result;
+}
+
+// ns per call of the function over the whole arrays, best of a few runs
+template<typename Function>
+static double measure(Visor::ui32 callCount, Function function)
+{
+	double bestNanoseconds = 1e30;
+	for(Visor::ui32 run = 0; run < 5; ++run)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		function();
+		const auto end = std::chrono::high_resolution_clock::now();
+
+		const double nanoseconds = std::chrono::duration<double, std::nano>(end - start).count() / callCount;
+		bestNanoseconds = nanoseconds < bestNanoseconds ? nanoseconds : bestNanoseconds;
+	}
+
+	return bestNanoseconds;
+}
+
+// max absolute error of the approximations against the double precision function
+template<typename Function>
+static double getMaxError(const std::vector<Visor::f32>& values, const std::vector<Visor::f32>& results, Function function)
+{
+	double maxError = 0.0;
+	for(size_t index = 0; index < values.size(); ++index)
+	{
+		const double error = std::abs(results[index] - function((double)values[index]));
+		maxError = error > maxError ? error : maxError;
+	}
+
+	return maxError;
+}
+
+int main()
+{
+	Visor::JobSystem::start(std::max(std::thread::hardware_concurrency(), 1u));
+
+#if defined(VSR_MATHS_AVX)
+	std::cout << "maths : AVX\n";
+#elif defined(VSR_MATHS_SSE)
+	std::cout << "maths : SSE\n";
+#elif defined(VSR_MATHS_NEON)
+	std::cout << "maths : NEON\n";
+#else
+	std::cout << "maths : scalar\n";
+#endif
+
+	const Visor::ui32 matrixCount = 4096;
+	const Visor::ui32 repetitionCount = 256;
+
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<Visor::f32> distribution(-10.0f, 10.0f);
+
+	std::vector<Visor::Matrix4<Visor::f32>> matricesA(matrixCount);
+	std::vector<Visor::Matrix4<Visor::f32>> matricesB(matrixCount);
+	std::vector<Visor::Vector4<Visor::f32>> vectors(matrixCount);
+	for(Visor::ui32 matrixIndex = 0; matrixIndex < matrixCount; ++matrixIndex)
+	{
+		for(Visor::ui32 row = 0; row < 4; ++row)
+		{
+			for(Visor::ui32 column = 0; column < 4; ++column)
+			{
+				matricesA[matrixIndex].m[row][column] = distribution(generator);
+				matricesB[matrixIndex].m[row][column] = distribution(generator);
+			}
+		}
+		vectors[matrixIndex] = {distribution(generator), distribution(generator), distribution(generator), distribution(generator)};
+	}
+
+	Visor::ui32 mismatchCount = 0;
+	for(Visor::ui32 matrixIndex = 0; matrixIndex < matrixCount; ++matrixIndex)
+	{
+		const Visor::Matrix4<Visor::f32> product = matricesA[matrixIndex] * matricesB[matrixIndex];
+		const Visor::Matrix4<Visor::f32> expectedProduct = multiplyScalar(matricesA[matrixIndex], matricesB[matrixIndex]);
+		mismatchCount += std::memcmp(&product, &expectedProduct, sizeof(product)) != 0 ? 1 : 0;
+
+		const Visor::Vector4<Visor::f32> vector = matricesA[matrixIndex] * vectors[matrixIndex];
+		const Visor::Vector4<Visor::f32> expectedVector = multiplyScalar(matricesA[matrixIndex], vectors[matrixIndex]);
+		mismatchCount += std::memcmp(&vector, &expectedVector, sizeof(vector)) != 0 ? 1 : 0;
+	}
+	std::cout << mismatchCount << " results differing from the generic templates\n";
+
+	std::vector<Visor::Matrix4<Visor::f32>> products(matrixCount);
+	std::vector<Visor::Vector4<Visor::f32>> transformedVectors(matrixCount);
+	const Visor::ui32 callCount = matrixCount * repetitionCount;
+
+	// the right operand rotates every repetition so the products can not be hoisted out of the loop
+	const double matrixNanoseconds = measure(callCount, [&]()
+	{
+		for(Visor::ui32 repetition = 0; repetition < repetitionCount; ++repetition)
+		{
+			for(Visor::ui32 matrixIndex = 0; matrixIndex < matrixCount; ++matrixIndex)
+			{
+				products[matrixIndex] = matricesA[matrixIndex] * matricesB[(matrixIndex + repetition) % matrixCount];
+			}
+		}
+	});
+	const double matrixScalarNanoseconds = measure(callCount, [&]()
+	{
+		for(Visor::ui32 repetition = 0; repetition < repetitionCount; ++repetition)
+		{
+			for(Visor::ui32 matrixIndex = 0; matrixIndex < matrixCount; ++matrixIndex)
+			{
+				products[matrixIndex] = multiplyScalar(matricesA[matrixIndex], matricesB[(matrixIndex + repetition) % matrixCount]);
+			}
+		}
+	});
+
+	const double vectorNanoseconds = measure(callCount, [&]()
+	{
+		for(Visor::ui32 repetition = 0; repetition < repetitionCount; ++repetition)
+		{
+			for(Visor::ui32 matrixIndex = 0; matrixIndex < matrixCount; ++matrixIndex)
+			{
+				transformedVectors[matrixIndex] = matricesA[matrixIndex] * vectors[(matrixIndex + repetition) % matrixCount];
+			}
+		}
+	});
+	const double vectorScalarNanoseconds = measure(callCount, [&]()
+	{
+		for(Visor::ui32 repetition = 0; repetition < repetitionCount; ++repetition)
+		{
+			for(Visor::ui32 matrixIndex = 0; matrixIndex < matrixCount; ++matrixIndex)
+			{
+				transformedVectors[matrixIndex] = multiplyScalar(matricesA[matrixIndex], vectors[(matrixIndex + repetition) % matrixCount]);
+			}
+		}
+	});
+
+	std::cout << "Matrix4 * Matrix4 : " << matrixNanoseconds << " ns, generic " << matrixScalarNanoseconds << " ns, x" << matrixScalarNanoseconds / matrixNanoseconds << "\n";
+	std::cout << "Matrix4 * Vector4 : " << vectorNanoseconds << " ns, generic " << vectorScalarNanoseconds << " ns, x" << vectorScalarNanoseconds / vectorNanoseconds << "\n";
+
+	// the same products on the affine part only, as for the transforms of the entity hierarchy
+	std::vector<Visor::Matrix3x4<Visor::f32>> affinesA(matrixCount);
+	std::vector<Visor::Matrix3x4<Visor::f32>> affinesB(matrixCount);
+	std::vector<Visor::Matrix3x4<Visor::f32>> affineProducts(matrixCount);
+	for(Visor::ui32 matrixIndex = 0; matrixIndex < matrixCount; ++matrixIndex)
+	{
+		affinesA[matrixIndex] = Visor::Matrix3x4<Visor::f32>::getFromMatrix4(matricesA[matrixIndex]);
+		affinesB[matrixIndex] = Visor::Matrix3x4<Visor::f32>::getFromMatrix4(matricesB[matrixIndex]);
+	}
+	const double affineNanoseconds = measure(callCount, [&]()
+	{
+		for(Visor::ui32 repetition = 0; repetition < repetitionCount; ++repetition)
+		{
+			for(Visor::ui32 matrixIndex = 0; matrixIndex < matrixCount; ++matrixIndex)
+			{
+				affineProducts[matrixIndex] = affinesA[matrixIndex] * affinesB[(matrixIndex + repetition) % matrixCount];
+			}
+		}
+	});
+	std::cout << "Matrix3x4 * Matrix3x4 : " << affineNanoseconds << " ns, x" << matrixNanoseconds / affineNanoseconds << " over Matrix4\n";
+
+	// transforms of as many entities as a big scene, composed into their model matrices
+	const Visor::ui32 transformCount = 1000000;
+	std::vector<Visor::Vector3<Visor::f32>> positions(transformCount);
+	std::vector<Visor::Quaternion<Visor::f32>> orientations(transformCount);
+	std::vector<Visor::Vector3<Visor::f32>> scales(transformCount);
+	std::vector<Visor::f32> transformComponents[10];
+	for(std::vector<Visor::f32>& components : transformComponents)
+	{
+		components.resize(transformCount);
+	}
+	for(Visor::ui32 transformIndex = 0; transformIndex < transformCount; ++transformIndex)
+	{
+		positions[transformIndex] = {distribution(generator), distribution(generator), distribution(generator)};
+		orientations[transformIndex] = Visor::Quaternion<Visor::f32>::getFromAngles(distribution(generator), distribution(generator), distribution(generator));
+		scales[transformIndex] = {distribution(generator), distribution(generator), distribution(generator)};
+
+		const Visor::f32 components[10] = {
+			positions[transformIndex].x, positions[transformIndex].y, positions[transformIndex].z,
+			orientations[transformIndex].x, orientations[transformIndex].y, orientations[transformIndex].z, orientations[transformIndex].w,
+			scales[transformIndex].x, scales[transformIndex].y, scales[transformIndex].z};
+		for(Visor::ui32 componentIndex = 0; componentIndex < 10; ++componentIndex)
+		{
+			transformComponents[componentIndex][transformIndex] = components[componentIndex];
+		}
+	}
+	const Visor::TransformArrays transforms = {
+		transformComponents[0].data(), transformComponents[1].data(), transformComponents[2].data(),
+		transformComponents[3].data(), transformComponents[4].data(), transformComponents[5].data(), transformComponents[6].data(),
+		transformComponents[7].data(), transformComponents[8].data(), transformComponents[9].data()};
+
+	std::vector<Visor::Matrix4<Visor::f32>> transformationMatrices(transformCount);
+	const double composeNanoseconds = measure(transformCount, [&]()
+	{
+		Visor::composeTransformationMatrices(transforms, 0, transformCount, transformationMatrices.data());
+	});
+	const double composeParallelNanoseconds = measure(transformCount, [&]()
+	{
+		Visor::composeTransformationMatricesParallel(transforms, transformCount, transformationMatrices.data());
+	});
+	const double composeOneByOneNanoseconds = measure(transformCount, [&]()
+	{
+		for(Visor::ui32 transformIndex = 0; transformIndex < transformCount; ++transformIndex)
+		{
+			transformationMatrices[transformIndex] = Visor::Matrix4<Visor::f32>::getTransformation(positions[transformIndex], orientations[transformIndex], scales[transformIndex]);
+		}
+	});
+	const double composeProductsNanoseconds = measure(transformCount, [&]()
+	{
+		for(Visor::ui32 transformIndex = 0; transformIndex < transformCount; ++transformIndex)
+		{
+			transformationMatrices[transformIndex] = 
+				Visor::Matrix4<Visor::f32>::getTranslation(positions[transformIndex]) * 
+				Visor::Matrix4<Visor::f32>::getRotation(orientations[transformIndex]) * 
+				Visor::Matrix4<Visor::f32>::getScaling(scales[transformIndex].x, scales[transformIndex].y, scales[transformIndex].z);
+		}
+	});
+
+	std::cout << "transform composition : " << composeNanoseconds << " ns, " << composeParallelNanoseconds << " ns on " << Visor::JobSystem::getInstance().getThreadCount() 
+		<< " threads, one by one " << composeOneByOneNanoseconds << " ns, matrix products " << composeProductsNanoseconds << " ns, x" << composeProductsNanoseconds / composeNanoseconds << "\n";
+
+	// Vector3 operations on the positions and scales, batched against the templates one by one
+	const Visor::VectorArrays vectorsA = {transformComponents[0].data(), transformComponents[1].data(), transformComponents[2].data()};
+	const Visor::VectorArrays vectorsB = {transformComponents[7].data(), transformComponents[8].data(), transformComponents[9].data()};
+	const Visor::f32 vectorScale = 0.016f;
+	std::vector<Visor::f32> vectorComponents[4];
+	for(std::vector<Visor::f32>& components : vectorComponents)
+	{
+		components.resize(transformCount);
+	}
+	std::vector<Visor::Vector3<Visor::f32>> vectorResults(transformCount);
+	std::vector<Visor::f32> dotResults(transformCount);
+
+	// each result once as a batch and once as a template, every float compared
+	Visor::ui32 vectorMismatchCount = 0;
+	const auto countVectorMismatches = [&]()
+	{
+		for(Visor::ui32 vectorIndex = 0; vectorIndex < transformCount; ++vectorIndex)
+		{
+			const Visor::f32 components[3] = {vectorComponents[0][vectorIndex], vectorComponents[1][vectorIndex], vectorComponents[2][vectorIndex]};
+			vectorMismatchCount += std::memcmp(components, &vectorResults[vectorIndex], sizeof(components)) != 0 ? 1 : 0;
+		}
+	};
+
+	Visor::computeDots(vectorsA, vectorsB, transformCount, vectorComponents[3].data());
+	for(Visor::ui32 vectorIndex = 0; vectorIndex < transformCount; ++vectorIndex)
+	{
+		dotResults[vectorIndex] = positions[vectorIndex].dot(scales[vectorIndex]);
+	}
+	vectorMismatchCount += std::memcmp(vectorComponents[3].data(), dotResults.data(), transformCount * sizeof(Visor::f32)) != 0 ? 1 : 0;
+
+	Visor::computeCrosses(vectorsA, vectorsB, transformCount, vectorComponents[0].data(), vectorComponents[1].data(), vectorComponents[2].data());
+	for(Visor::ui32 vectorIndex = 0; vectorIndex < transformCount; ++vectorIndex)
+	{
+		vectorResults[vectorIndex] = positions[vectorIndex].cross(scales[vectorIndex]);
+	}
+	countVectorMismatches();
+
+	Visor::computeScaledSums(vectorsA, vectorsB, vectorScale, transformCount, vectorComponents[0].data(), vectorComponents[1].data(), vectorComponents[2].data());
+	for(Visor::ui32 vectorIndex = 0; vectorIndex < transformCount; ++vectorIndex)
+	{
+		vectorResults[vectorIndex] = positions[vectorIndex] + scales[vectorIndex] * vectorScale;
+	}
+	countVectorMismatches();
+
+	std::copy(transformComponents[0].begin(), transformComponents[0].end(), vectorComponents[0].begin());
+	std::copy(transformComponents[1].begin(), transformComponents[1].end(), vectorComponents[1].begin());
+	std::copy(transformComponents[2].begin(), transformComponents[2].end(), vectorComponents[2].begin());
+	Visor::normalizeVectors(vectorComponents[0].data(), vectorComponents[1].data(), vectorComponents[2].data(), transformCount);
+	for(Visor::ui32 vectorIndex = 0; vectorIndex < transformCount; ++vectorIndex)
+	{
+		vectorResults[vectorIndex] = positions[vectorIndex];
+		vectorResults[vectorIndex].normalize();
+	}
+	countVectorMismatches();
+	std::cout << vectorMismatchCount << " vector results differing from the Vector3 templates\n";
+
+	const double dotNanoseconds = measure(transformCount, [&]()
+	{
+		Visor::computeDots(vectorsA, vectorsB, transformCount, dotResults.data());
+	});
+	const double dotOneByOneNanoseconds = measure(transformCount, [&]()
+	{
+		for(Visor::ui32 vectorIndex = 0; vectorIndex < transformCount; ++vectorIndex)
+		{
+			dotResults[vectorIndex] = positions[vectorIndex].dot(scales[vectorIndex]);
+		}
+	});
+	const double crossNanoseconds = measure(transformCount, [&]()
+	{
+		Visor::computeCrosses(vectorsA, vectorsB, transformCount, vectorComponents[0].data(), vectorComponents[1].data(), vectorComponents[2].data());
+	});
+	const double crossOneByOneNanoseconds = measure(transformCount, [&]()
+	{
+		for(Visor::ui32 vectorIndex = 0; vectorIndex < transformCount; ++vectorIndex)
+		{
+			vectorResults[vectorIndex] = positions[vectorIndex].cross(scales[vectorIndex]);
+		}
+	});
+	const double scaledSumNanoseconds = measure(transformCount, [&]()
+	{
+		Visor::computeScaledSums(vectorsA, vectorsB, vectorScale, transformCount, vectorComponents[0].data(), vectorComponents[1].data(), vectorComponents[2].data());
+	});
+	const double scaledSumOneByOneNanoseconds = measure(transformCount, [&]()
+	{
+		for(Visor::ui32 vectorIndex = 0; vectorIndex < transformCount; ++vectorIndex)
+		{
+			vectorResults[vectorIndex] = positions[vectorIndex] + scales[vectorIndex] * vectorScale;
+		}
+	});
+	// normalized vectors stay normalized, the later runs do the same work
+	const double normalizeNanoseconds = measure(transformCount, [&]()
+	{
+		Visor::normalizeVectors(vectorComponents[0].data(), vectorComponents[1].data(), vectorComponents[2].data(), transformCount);
+	});
+	const double normalizeOneByOneNanoseconds = measure(transformCount, [&]()
+	{
+		for(Visor::ui32 vectorIndex = 0; vectorIndex < transformCount; ++vectorIndex)
+		{
+			vectorResults[vectorIndex].normalize();
+		}
+	});
+
+	std::cout << "Vector3 dot : " << dotNanoseconds << " ns, one by one " << dotOneByOneNanoseconds << " ns, x" << dotOneByOneNanoseconds / dotNanoseconds << "\n";
+	std::cout << "Vector3 cross : " << crossNanoseconds << " ns, one by one " << crossOneByOneNanoseconds << " ns, x" << crossOneByOneNanoseconds / crossNanoseconds << "\n";
+	std::cout << "Vector3 a + b * s : " << scaledSumNanoseconds << " ns, one by one " << scaledSumOneByOneNanoseconds << " ns, x" 
+		<< scaledSumOneByOneNanoseconds / scaledSumNanoseconds << "\n";
+	std::cout << "Vector3 normalize : " << normalizeNanoseconds << " ns, one by one " << normalizeOneByOneNanoseconds << " ns, x" 
+		<< normalizeOneByOneNanoseconds / normalizeNanoseconds << "\n";
+
+	// approximations against the standard library, on as many values as entities of a big scene
+	const Visor::ui32 valueCount = 1000000;
+	std::uniform_real_distribution<Visor::f32> angleDistribution(-3.2f, 3.2f);
+	std::uniform_real_distribution<Visor::f32> unitDistribution(-1.0f, 1.0f);
+	std::vector<Visor::f32> angles(valueCount);
+	std::vector<Visor::f32> unitValues(valueCount);
+	std::vector<Visor::f32> positiveValues(valueCount);
+	std::vector<Visor::f32> results(valueCount);
+	std::vector<Visor::f32> otherResults(valueCount);
+	for(Visor::ui32 valueIndex = 0; valueIndex < valueCount; ++valueIndex)
+	{
+		angles[valueIndex] = angleDistribution(generator);
+		unitValues[valueIndex] = unitDistribution(generator);
+		positiveValues[valueIndex] = std::abs(distribution(generator)) + 1e-3f;
+	}
+
+	Visor::computeSinCos(angles.data(), valueCount, results.data(), otherResults.data());
+	const double sinError = getMaxError(angles, results, [](double angle) { return std::sin(angle); });
+	const double cosError = getMaxError(angles, otherResults, [](double angle) { return std::cos(angle); });
+	const double sinCosNanoseconds = measure(valueCount, [&]()
+	{
+		Visor::computeSinCos(angles.data(), valueCount, results.data(), otherResults.data());
+	});
+	const double sinCosStandardNanoseconds = measure(valueCount, [&]()
+	{
+		for(Visor::ui32 valueIndex = 0; valueIndex < valueCount; ++valueIndex)
+		{
+			results[valueIndex] = std::sin(angles[valueIndex]);
+			otherResults[valueIndex] = std::cos(angles[valueIndex]);
+		}
+	});
+	std::cout << "sincos : " << sinCosNanoseconds << " ns, std " << sinCosStandardNanoseconds << " ns, x" << sinCosStandardNanoseconds / sinCosNanoseconds 
+		<< ", max error " << std::max(sinError, cosError) << "\n";
+
+	// points all around the origin, some far from the axes and some close
+	std::vector<Visor::f32> pointsX(valueCount);
+	std::vector<Visor::f32> pointsY(valueCount);
+	for(Visor::ui32 valueIndex = 0; valueIndex < valueCount; ++valueIndex)
+	{
+		pointsX[valueIndex] = unitValues[valueIndex] * 10.0f;
+		pointsY[valueIndex] = distribution(generator);
+	}
+	Visor::computeAtan2(pointsY.data(), pointsX.data(), valueCount, results.data());
+	double atan2Error = 0.0;
+	for(Visor::ui32 valueIndex = 0; valueIndex < valueCount; ++valueIndex)
+	{
+		atan2Error = std::max(atan2Error, std::abs(results[valueIndex] - std::atan2((double)pointsY[valueIndex], (double)pointsX[valueIndex])));
+	}
+	const double atan2Nanoseconds = measure(valueCount, [&]()
+	{
+		Visor::computeAtan2(pointsY.data(), pointsX.data(), valueCount, results.data());
+	});
+	const double atan2StandardNanoseconds = measure(valueCount, [&]()
+	{
+		for(Visor::ui32 valueIndex = 0; valueIndex < valueCount; ++valueIndex)
+		{
+			results[valueIndex] = std::atan2(pointsY[valueIndex], pointsX[valueIndex]);
+		}
+	});
+	std::cout << "atan2 : " << atan2Nanoseconds << " ns, std " << atan2StandardNanoseconds << " ns, x" << atan2StandardNanoseconds / atan2Nanoseconds 
+		<< ", max error " << atan2Error << "\n";
+
+	Visor::computeAsin(unitValues.data(), valueCount, results.data());
+	const double asinError = getMaxError(unitValues, results, [](double value) { return std::asin(value); });
+	const double asinNanoseconds = measure(valueCount, [&]()
+	{
+		Visor::computeAsin(unitValues.data(), valueCount, results.data());
+	});
+	const double asinStandardNanoseconds = measure(valueCount, [&]()
+	{
+		for(Visor::ui32 valueIndex = 0; valueIndex < valueCount; ++valueIndex)
+		{
+			results[valueIndex] = std::asin(unitValues[valueIndex]);
+		}
+	});
+	std::cout << "asin : " << asinNanoseconds << " ns, std " << asinStandardNanoseconds << " ns, x" << asinStandardNanoseconds / asinNanoseconds 
+		<< ", max error " << asinError << "\n";
+
+	Visor::computeReciprocalSquareRoot(positiveValues.data(), valueCount, results.data());
+	double reciprocalSquareRootError = 0.0;
+	for(Visor::ui32 valueIndex = 0; valueIndex < valueCount; ++valueIndex)
+	{
+		const double expected = 1.0 / std::sqrt((double)positiveValues[valueIndex]);
+		reciprocalSquareRootError = std::max(reciprocalSquareRootError, std::abs(results[valueIndex] - expected) / expected);
+	}
+	const double reciprocalSquareRootNanoseconds = measure(valueCount, [&]()
+	{
+		Visor::computeReciprocalSquareRoot(positiveValues.data(), valueCount, results.data());
+	});
+	const double reciprocalSquareRootStandardNanoseconds = measure(valueCount, [&]()
+	{
+		for(Visor::ui32 valueIndex = 0; valueIndex < valueCount; ++valueIndex)
+		{
+			results[valueIndex] = 1.0f / std::sqrt(positiveValues[valueIndex]);
+		}
+	});
+	std::cout << "rsqrt : " << reciprocalSquareRootNanoseconds << " ns, std " << reciprocalSquareRootStandardNanoseconds << " ns, x" 
+		<< reciprocalSquareRootStandardNanoseconds / reciprocalSquareRootNanoseconds << ", max relative error " << reciprocalSquareRootError << "\n";
+
+	// entities turned toward the player, as main does every frame
+	const Visor::ui32 lookAtCount = 100000;
+	const Visor::Vector3<Visor::f32> target = {1.0f, 2.0f, 3.0f};
+	std::vector<Visor::f32> lookAtComponents[7];
+	for(std::vector<Visor::f32>& components : lookAtComponents)
+	{
+		components.resize(lookAtCount);
+	}
+	for(Visor::ui32 entityIndex = 0; entityIndex < lookAtCount; ++entityIndex)
+	{
+		lookAtComponents[0][entityIndex] = positions[entityIndex].x;
+		lookAtComponents[1][entityIndex] = positions[entityIndex].y;
+		lookAtComponents[2][entityIndex] = positions[entityIndex].z;
+	}
+	const double lookAtNanoseconds = measure(lookAtCount, [&]()
+	{
+		Visor::computeLookAtOrientations(lookAtComponents[0].data(), lookAtComponents[1].data(), lookAtComponents[2].data(), target, lookAtCount, 
+			lookAtComponents[3].data(), lookAtComponents[4].data(), lookAtComponents[5].data(), lookAtComponents[6].data());
+	});
+	const double lookAtOneByOneNanoseconds = measure(lookAtCount, [&]()
+	{
+		for(Visor::ui32 entityIndex = 0; entityIndex < lookAtCount; ++entityIndex)
+		{
+			Visor::Vector3<Visor::f32> direction = target - positions[entityIndex];
+			direction.normalize();
+
+			Visor::f32 yaw = 0.0f;
+			Visor::f32 pitch = 0.0f;
+			Visor::f32 roll = 0.0f;
+			Visor::getAnglesFromDirection(direction, yaw, pitch, roll);
+			orientations[entityIndex] = Visor::Quaternion<Visor::f32>::getFromAngles(yaw, pitch, roll);
+		}
+	});
+
+	// angle between the forward axis of the orientations and the exact direction, in doubles
+	double lookAtError = 0.0;
+	for(Visor::ui32 entityIndex = 0; entityIndex < lookAtCount; ++entityIndex)
+	{
+		const double x = lookAtComponents[3][entityIndex];
+		const double y = lookAtComponents[4][entityIndex];
+		const double z = lookAtComponents[5][entityIndex];
+		const double w = lookAtComponents[6][entityIndex];
+		const double forward[3] = {2.0 * (x * z + w * y), 2.0 * (y * z - w * x), 1.0 - 2.0 * (x * x + y * y)};
+		const double direction[3] = {(double)target.x - positions[entityIndex].x, (double)target.y - positions[entityIndex].y, (double)target.z - positions[entityIndex].z};
+
+		const double cross[3] = {
+			forward[1] * direction[2] - forward[2] * direction[1],
+			forward[2] * direction[0] - forward[0] * direction[2],
+			forward[0] * direction[1] - forward[1] * direction[0]};
+		const double dot = forward[0] * direction[0] + forward[1] * direction[1] + forward[2] * direction[2];
+		lookAtError = std::max(lookAtError, std::atan2(std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]), dot));
+	}
+	std::cout << lookAtCount << " look at : " << lookAtNanoseconds << " ns, one by one " << lookAtOneByOneNanoseconds << " ns, x" << lookAtOneByOneNanoseconds / lookAtNanoseconds 
+		<< ", max angle " << lookAtError << " radians\n";
+
+	// keeps the products alive
+	volatile Visor::f32 sink = products[matrixCount / 2].m[1][2] + transformedVectors[matrixCount / 2].y + affineProducts[matrixCount / 2].m[2][3] + transformationMatrices[transformCount / 2].m[0][0]
+		+ results[valueCount / 2] + otherResults[valueCount / 2] + lookAtComponents[6][lookAtCount / 2] + orientations[lookAtCount / 2].w
+		+ dotResults[transformCount / 2] + vectorComponents[0][transformCount / 2] + vectorResults[transformCount / 2].z;
+	(void)sink;
+
+	Visor::JobSystem::terminate();
+
+	return 0;
+}
@@ -0,0 +1,556 @@
+#include <visor.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+micro benchmarks of the engine kernels, meant to be compared across commits.
+each benchmark runs until the warm-up time is spent, which also sizes the samples to about a millisecond,
+then times a fixed number of samples. results are in nanoseconds per operation.
+usage : visor_microbench [--format text|csv|json] [--filter substring] [--samples count] [--mesh path]
+*/
+
+struct Options
+{
+public:
+	std::string format;
+	std::string filter;
+	Visor::ui32 sampleCount;
+	Visor::f64 warmUpSeconds;
+	std::string meshPath;
+};
+
+struct Summary
+{
+public:
+	std::string name;
+	Visor::ui32 operationCount; // per call of the benchmarked function
+	Visor::ui32 callCount; // per sample
+	Visor::ui32 sampleCount;
+	// nanoseconds per operation
+	Visor::f64 minimum;
+	Visor::f64 median;
+	Visor::f64 mean;
+	Visor::f64 deviation;
+	Visor::f64 maximum;
+};
+
+// results are folded into this so the compiler can not drop the benchmarked work
+static volatile Visor::f32 sink = 0.0f;
+
+static const char* getInstructionSet()
+{
+#if defined(VSR_MATHS_AVX)
+	return "AVX";
+#elif defined(VSR_MATHS_SSE)
+	return "SSE";
+#elif defined(VSR_MATHS_NEON)
+	return "NEON";
+#else
+	return "scalar";
+#endif
+}
+
+static const char* getCompiler()
+{
+#if defined(__clang__)
+	return "clang " __clang_version__;
+#elif defined(__GNUC__)
+	return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+	return "msvc";
+#else
+	return "unknown";
+#endif
+}
+
+static const char* getBuildType()
+{
+#if defined(NDEBUG)
+	return "release";
+#else
+	return "debug";
+#endif
+}
+
+static Visor::f64 getSeconds(std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point end)
+{
+	return std::chrono::duration<Visor::f64>(end - start).count();
+}
+
+static Visor::b8 isSelected(const Options& options, const std::string& name)
+{
+	return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+// the function performs operationCount operations per call
+template<typename Function>
+static void runBenchmark(const Options& options, const std::string& name, Visor::ui32 operationCount, Function function, std::vector<Summary>& summaries)
+{
+	if(!isSelected(options, name))
+	{
+		return;
+	}
+
+	// warm-up : caches, branch predictors and clocks settle, and the duration of a call is known
+	Visor::ui32 warmUpCallCount = 0;
+	const auto warmUpStart = std::chrono::high_resolution_clock::now();
+	auto warmUpEnd = warmUpStart;
+	do
+	{
+		function();
+		++warmUpCallCount;
+		warmUpEnd = std::chrono::high_resolution_clock::now();
+	} while(getSeconds(warmUpStart, warmUpEnd) < options.warmUpSeconds);
+
+	// short calls are repeated so a sample lasts about a millisecond, far above the clock resolution
+	const Visor::f64 callSeconds = getSeconds(warmUpStart, warmUpEnd) / warmUpCallCount;
+	const Visor::ui32 callCount = (Visor::ui32)std::max(1.0, std::ceil(1e-3 / callSeconds));
+
+	std::vector<Visor::f64> samples(options.sampleCount);
+	for(Visor::f64& sample : samples)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		for(Visor::ui32 call = 0; call < callCount; ++call)
+		{
+			function();
+		}
+		const auto end = std::chrono::high_resolution_clock::now();
+
+		sample = getSeconds(start, end) * 1e9 / ((Visor::f64)callCount * operationCount);
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	Summary summary = {};
+	summary.name = name;
+	summary.operationCount = operationCount;
+	summary.callCount = callCount;
+	summary.sampleCount = options.sampleCount;
+	summary.minimum = samples.front();
+	summary.maximum = samples.back();
+	summary.median = samples.size() % 2 == 1 ? samples[samples.size() / 2] : (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) * 0.5;
+
+	for(Visor::f64 sample : samples)
+	{
+		summary.mean += sample;
+	}
+	summary.mean /= samples.size();
+
+	for(Visor::f64 sample : samples)
+	{
+		summary.deviation += (sample - summary.mean) * (sample - summary.mean);
+	}
+	summary.deviation = samples.size() > 1 ? std::sqrt(summary.deviation / (samples.size() - 1)) : 0.0;
+
+	summaries.push_back(summary);
+
+	// progress goes to the error stream, the output stays parsable
+	if(options.format != "text")
+	{
+		std::cerr << name << " done\n";
+	}
+	else
+	{
+		std::cout.precision(4);
+		std::cout << name << std::string(name.size() < 32 ? 32 - name.size() : 1, ' ')
+			<< "median " << summary.median << " ns, minimum " << summary.minimum << " ns, mean " << summary.mean
+			<< " ns +- " << (summary.mean > 0.0 ? summary.deviation * 100.0 / summary.mean : 0.0) << "%, "
+			<< 1e3 / summary.median << " Mop/s\n";
+	}
+}
+
+static void printCSV(const std::vector<Summary>& summaries)
+{
+	std::cout.precision(9);
+	std::cout << "name,operations,calls,samples,minimum_ns,median_ns,mean_ns,deviation_ns,maximum_ns,compiler,instruction_set,build\n";
+	for(const Summary& summary : summaries)
+	{
+		std::cout << summary.name << "," << summary.operationCount << "," << summary.callCount << "," << summary.sampleCount << ","
+			<< summary.minimum << "," << summary.median << "," << summary.mean << "," << summary.deviation << "," << summary.maximum << ","
+			<< getCompiler() << "," << getInstructionSet() << "," << getBuildType() << "\n";
+	}
+}
+
+static void printJSON(const std::vector<Summary>& summaries)
+{
+	std::cout.precision(9);
+	std::cout << "{\n";
+	std::cout << "\t\"compiler\": \"" << getCompiler() << "\",\n";
+	std::cout << "\t\"instruction_set\": \"" << getInstructionSet() << "\",\n";
+	std::cout << "\t\"build\": \"" << getBuildType() << "\",\n";
+	std::cout << "\t\"threads\": " << Visor::JobSystem::getInstance().getThreadCount() << ",\n";
+	std::cout << "\t\"benchmarks\": [\n";
+	for(size_t summaryIndex = 0; summaryIndex < summaries.size(); ++summaryIndex)
+	{
+		const Summary& summary = summaries[summaryIndex];
+		std::cout << "\t\t{\"name\": \"" << summary.name << "\", \"operations\": " << summary.operationCount << ", \"calls\": " << summary.callCount
+			<< ", \"samples\": " << summary.sampleCount << ", \"minimum_ns\": " << summary.minimum << ", \"median_ns\": " << summary.median
+			<< ", \"mean_ns\": " << summary.mean << ", \"deviation_ns\": " << summary.deviation << ", \"maximum_ns\": " << summary.maximum << "}"
+			<< (summaryIndex + 1 < summaries.size() ? ",\n" : "\n");
+	}
+	std::cout << "\t]\n";
+	std::cout << "}\n";
+}
+
+static Visor::b8 parseOptions(int argc, char** argv, Options& options)
+{
+	options.format = "text";
+	options.sampleCount = 25;
+	options.warmUpSeconds = 0.1;
+	options.meshPath = "../assets/models/teapot.obj";
+
+	for(int argumentIndex = 1; argumentIndex < argc; ++argumentIndex)
+	{
+		const std::string argument = argv[argumentIndex];
+		if(argumentIndex + 1 >= argc)
+		{
+			std::cerr << "missing value after " << argument << "\n";
+			return false;
+		}
+
+		const std::string value = argv[++argumentIndex];
+		if(argument == "--format" && (value == "text" || value == "csv" || value == "json"))
+		{
+			options.format = value;
+		}
+		else if(argument == "--filter")
+		{
+			options.filter = value;
+		}
+		else if(argument == "--samples" && std::atoi(value.c_str()) > 0)
+		{
+			options.sampleCount = (Visor::ui32)std::atoi(value.c_str());
+		}
+		else if(argument == "--mesh")
+		{
+			options.meshPath = value;
+		}
+		else
+		{
+			std::cerr << "invalid argument " << argument << " " << value << "\n";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	Options options = {};
+	if(!parseOptions(argc, argv, options))
+	{
+		std::cerr << "usage : visor_microbench [--format text|csv|json] [--filter substring] [--samples count] [--mesh path]\n";
+		return EXIT_FAILURE;
+	}
+
+	Visor::JobSystem::start(std::max(std::thread::hardware_concurrency(), 1u));
+
+	if(options.format == "text")
+	{
+		std::cout << getCompiler() << ", " << getInstructionSet() << ", " << getBuildType() << ", "
+			<< Visor::JobSystem::getInstance().getThreadCount() << " threads, " << options.sampleCount << " samples\n";
+	}
+
+	std::vector<Summary> summaries;
+
+	// fixed seed : every run and every commit benchmarks the same values
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<Visor::f32> distribution(-10.0f, 10.0f);
+
+	// small enough to stay in the caches, the kernels are measured and not the memory
+	const Visor::ui32 elementCount = 1024;
+
+	std::vector<Visor::Matrix4<Visor::f32>> matricesA(elementCount);
+	std::vector<Visor::Matrix4<Visor::f32>> matricesB(elementCount);
+	std::vector<Visor::Matrix4<Visor::f32>> matrices(elementCount);
+	std::vector<Visor::Matrix3x4<Visor::f32>> affinesA(elementCount);
+	std::vector<Visor::Matrix3x4<Visor::f32>> affinesB(elementCount);
+	std::vector<Visor::Matrix3x4<Visor::f32>> affines(elementCount);
+	std::vector<Visor::Vector4<Visor::f32>> vector4s(elementCount);
+	std::vector<Visor::Vector3<Visor::f32>> vectorsA(elementCount);
+	std::vector<Visor::Vector3<Visor::f32>> vectorsB(elementCount);
+	std::vector<Visor::Vector3<Visor::f32>> vectors(elementCount);
+	std::vector<Visor::f32> scalars(elementCount);
+	for(Visor::ui32 elementIndex = 0; elementIndex < elementCount; ++elementIndex)
+	{
+		for(Visor::ui32 row = 0; row < 4; ++row)
+		{
+			for(Visor::ui32 column = 0; column < 4; ++column)
+			{
+				matricesA[elementIndex].m[row][column] = distribution(generator);
+				matricesB[elementIndex].m[row][column] = distribution(generator);
+			}
+		}
+		affinesA[elementIndex] = Visor::Matrix3x4<Visor::f32>::getFromMatrix4(matricesA[elementIndex]);
+		affinesB[elementIndex] = Visor::Matrix3x4<Visor::f32>::getFromMatrix4(matricesB[elementIndex]);
+		vector4s[elementIndex] = {distribution(generator), distribution(generator), distribution(generator), distribution(generator)};
+		vectorsA[elementIndex] = {distribution(generator), distribution(generator), distribution(generator)};
+		vectorsB[elementIndex] = {distribution(generator), distribution(generator), distribution(generator)};
+	}
+
+	// ===== Maths =====
+	runBenchmark(options, "matrix4.multiply", elementCount, [&]()
+	{
+		for(Visor::ui32 elementIndex = 0; elementIndex < elementCount; ++elementIndex)
+		{
+			matrices[elementIndex] = matricesA[elementIndex] * matricesB[elementIndex];
+		}
+		sink = sink + matrices[elementCount / 2].m[1][2];
+	}, summaries);
+
+	runBenchmark(options, "matrix4.multiply_vector4", elementCount, [&]()
+	{
+		for(Visor::ui32 elementIndex = 0; elementIndex < elementCount; ++elementIndex)
+		{
+			const Visor::Vector4<Visor::f32> vector = matricesA[elementIndex] * vector4s[elementIndex];
+			vectors[elementIndex] = {vector.x, vector.y, vector.z};
+		}
+		sink = sink + vectors[elementCount / 2].y;
+	}, summaries);
+
+	runBenchmark(options, "matrix4.transpose", elementCount, [&]()
+	{
+		for(Visor::ui32 elementIndex = 0; elementIndex < elementCount; ++elementIndex)
+		{
+			matrices[elementIndex] = matricesA[elementIndex];
+			matrices[elementIndex].transpose();
+		}
+		sink = sink + matrices[elementCount / 2].m[1][2];
+	}, summaries);
+
+	runBenchmark(options, "matrix3x4.multiply", elementCount, [&]()
+	{
+		for(Visor::ui32 elementIndex = 0; elementIndex < elementCount; ++elementIndex)
+		{
+			affines[elementIndex] = affinesA[elementIndex] * affinesB[elementIndex];
+		}
+		sink = sink + affines[elementCount / 2].m[1][2];
+	}, summaries);
+
+	runBenchmark(options, "matrix3x4.inverse", elementCount, [&]()
+	{
+		for(Visor::ui32 elementIndex = 0; elementIndex < elementCount; ++elementIndex)
+		{
+			affinesA[elementIndex].getInverse(affines[elementIndex]);
+		}
+		sink = sink + affines[elementCount / 2].m[1][2];
+	}, summaries);
+
+	runBenchmark(options, "vector3.add_scale", elementCount, [&]()
+	{
+		for(Visor::ui32 elementIndex = 0; elementIndex < elementCount; ++elementIndex)
+		{
+			vectors[elementIndex] = vectorsA[elementIndex] + vectorsB[elementIndex] * 0.5f;
+		}
+		sink = sink + vectors[elementCount / 2].y;
+	}, summaries);
+
+	runBenchmark(options, "vector3.dot", elementCount, [&]()
+	{
+		for(Visor::ui32 elementIndex = 0; elementIndex < elementCount; ++elementIndex)
+		{
+			scalars[elementIndex] = vectorsA[elementIndex].dot(vectorsB[elementIndex]);
+		}
+		sink = sink + scalars[elementCount / 2];
+	}, summaries);
+
+	runBenchmark(options, "vector3.cross", elementCount, [&]()
+	{
+		for(Visor::ui32 elementIndex = 0; elementIndex < elementCount; ++elementIndex)
+		{
+			vectors[elementIndex] = vectorsA[elementIndex].cross(vectorsB[elementIndex]);
+		}
+		sink = sink + vectors[elementCount / 2].y;
+	}, summaries);
+
+	runBenchmark(options, "vector3.normalize", elementCount, [&]()
+	{
+		for(Visor::ui32 elementIndex = 0; elementIndex < elementCount; ++elementIndex)
+		{
+			vectors[elementIndex] = vectorsA[elementIndex];
+			vectors[elementIndex].normalize();
+		}
+		sink = sink + vectors[elementCount / 2].y;
+	}, summaries);
+
+	// ===== Intersections =====
+	// rays from a sphere around the origin towards random points of boxes near it, most of them hit
+	std::vector<Visor::Ray> rays;
+	std::vector<Visor::AABB> boxes;
+	std::vector<Visor::Vector3<Visor::f32>> intersections(elementCount);
+	rays.reserve(elementCount);
+	boxes.reserve(elementCount);
+	for(Visor::ui32 elementIndex = 0; elementIndex < elementCount; ++elementIndex)
+	{
+		Visor::Vector3<Visor::f32> position = vectorsA[elementIndex];
+		position.normalize();
+		position = position * 20.0f;
+
+		Visor::Vector3<Visor::f32> direction = vectorsB[elementIndex] * 0.2f - position;
+		direction.normalize();
+		rays.push_back(Visor::Ray(position, direction));
+
+		const Visor::Vector3<Visor::f32> extent = {std::abs(vectorsB[elementIndex].z) * 0.1f + 0.5f, 1.0f, 1.0f};
+		boxes.push_back(Visor::AABB(vectorsB[elementIndex] * 0.2f - extent, vectorsB[elementIndex] * 0.2f + extent));
+	}
+
+	runBenchmark(options, "ray.get_intersection", elementCount, [&]()
+	{
+		Visor::ui32 hitCount = 0;
+		for(Visor::ui32 elementIndex = 0; elementIndex < elementCount; ++elementIndex)
+		{
+			hitCount += rays[elementIndex].getIntersection(boxes[elementIndex], intersections[elementIndex]) ? 1 : 0;
+		}
+		sink = sink + (Visor::f32)hitCount + intersections[elementCount / 2].x;
+	}, summaries);
+
+	// the same rays and boxes in packets, one ray against the boxes that follow it and the rays that follow against its box
+	std::vector<Visor::f32> boxComponents[6];
+	std::vector<Visor::f32> rayComponents[6];
+	for(Visor::ui32 componentIndex = 0; componentIndex < 6; ++componentIndex)
+	{
+		boxComponents[componentIndex].resize(elementCount);
+		rayComponents[componentIndex].resize(elementCount);
+	}
+	for(Visor::ui32 elementIndex = 0; elementIndex < elementCount; ++elementIndex)
+	{
+		for(Visor::ui32 axis = 0; axis < 3; ++axis)
+		{
+			boxComponents[axis][elementIndex] = boxes[elementIndex].minimum[axis];
+			boxComponents[axis + 3][elementIndex] = boxes[elementIndex].maximum[axis];
+			rayComponents[axis][elementIndex] = rays[elementIndex].position[axis];
+			rayComponents[axis + 3][elementIndex] = rays[elementIndex].inverseDirection[axis];
+		}
+	}
+	const Visor::AABBArrays boxArrays = {
+		boxComponents[0].data(), boxComponents[1].data(), boxComponents[2].data(),
+		boxComponents[3].data(), boxComponents[4].data(), boxComponents[5].data()};
+	const Visor::RayArrays rayArrays = {
+		rayComponents[0].data(), rayComponents[1].data(), rayComponents[2].data(),
+		rayComponents[3].data(), rayComponents[4].data(), rayComponents[5].data()};
+	std::vector<Visor::f32> entries(elementCount);
+	std::vector<Visor::f32> exits(elementCount);
+
+	// one operation per ray box test
+	runBenchmark(options, "ray.intersect_boxes4", elementCount, [&]()
+	{
+		Visor::ui32 hitCount = 0;
+		for(Visor::ui32 elementIndex = 0; elementIndex < elementCount; elementIndex += 4)
+		{
+			hitCount += Visor::intersectBoxes4(rays[elementIndex], boxArrays, elementIndex, 1000.0f, &entries[elementIndex], &exits[elementIndex]) != 0 ? 1 : 0;
+		}
+		sink = sink + (Visor::f32)hitCount + entries[elementCount / 2];
+	}, summaries);
+
+	runBenchmark(options, "ray.intersect_boxes8", elementCount, [&]()
+	{
+		Visor::ui32 hitCount = 0;
+		for(Visor::ui32 elementIndex = 0; elementIndex < elementCount; elementIndex += 8)
+		{
+			hitCount += Visor::intersectBoxes8(rays[elementIndex], boxArrays, elementIndex, 1000.0f, &entries[elementIndex], &exits[elementIndex]) != 0 ? 1 : 0;
+		}
+		sink = sink + (Visor::f32)hitCount + entries[elementCount / 2];
+	}, summaries);
+
+	runBenchmark(options, "ray.intersect_rays4", elementCount, [&]()
+	{
+		Visor::ui32 hitCount = 0;
+		for(Visor::ui32 elementIndex = 0; elementIndex < elementCount; elementIndex += 4)
+		{
+			hitCount += Visor::intersectRays4(rayArrays, elementIndex, boxes[elementIndex], 1000.0f, &entries[elementIndex], &exits[elementIndex]) != 0 ? 1 : 0;
+		}
+		sink = sink + (Visor::f32)hitCount + entries[elementCount / 2];
+	}, summaries);
+
+	runBenchmark(options, "ray.intersect_rays8", elementCount, [&]()
+	{
+		Visor::ui32 hitCount = 0;
+		for(Visor::ui32 elementIndex = 0; elementIndex < elementCount; elementIndex += 8)
+		{
+			hitCount += Visor::intersectRays8(rayArrays, elementIndex, boxes[elementIndex], 1000.0f, &entries[elementIndex], &exits[elementIndex]) != 0 ? 1 : 0;
+		}
+		sink = sink + (Visor::f32)hitCount + entries[elementCount / 2];
+	}, summaries);
+
+	// ===== Transforms =====
+	// as many entities as a big scene, composed into their model matrices
+	const Visor::ui32 transformCount = 100000;
+	std::vector<Visor::f32> transformComponents[10];
+	for(std::vector<Visor::f32>& components : transformComponents)
+	{
+		components.resize(transformCount);
+	}
+	for(Visor::ui32 transformIndex = 0; transformIndex < transformCount; ++transformIndex)
+	{
+		const Visor::Quaternion<Visor::f32> orientation = Visor::Quaternion<Visor::f32>::getFromAngles(distribution(generator), distribution(generator), distribution(generator));
+		const Visor::f32 components[10] = {
+			distribution(generator), distribution(generator), distribution(generator),
+			orientation.x, orientation.y, orientation.z, orientation.w,
+			distribution(generator), distribution(generator), distribution(generator)};
+		for(Visor::ui32 componentIndex = 0; componentIndex < 10; ++componentIndex)
+		{
+			transformComponents[componentIndex][transformIndex] = components[componentIndex];
+		}
+	}
+	const Visor::TransformArrays transforms = {
+		transformComponents[0].data(), transformComponents[1].data(), transformComponents[2].data(),
+		transformComponents[3].data(), transformComponents[4].data(), transformComponents[5].data(), transformComponents[6].data(),
+		transformComponents[7].data(), transformComponents[8].data(), transformComponents[9].data()};
+	std::vector<Visor::Matrix4<Visor::f32>> transformationMatrices(transformCount);
+
+	runBenchmark(options, "transform.compose", transformCount, [&]()
+	{
+		Visor::composeTransformationMatrices(transforms, 0, transformCount, transformationMatrices.data());
+		sink = sink + transformationMatrices[transformCount / 2].m[0][0];
+	}, summaries);
+
+	runBenchmark(options, "transform.compose_parallel", transformCount, [&]()
+	{
+		Visor::composeTransformationMatricesParallel(transforms, transformCount, transformationMatrices.data());
+		sink = sink + transformationMatrices[transformCount / 2].m[0][0];
+	}, summaries);
+
+	// ===== Meshes =====
+	if(isSelected(options, "mesh.load"))
+	{
+		if(std::ifstream(options.meshPath).good())
+		{
+			// one operation per triangle, so meshes of any size compare
+			const Visor::Mesh mesh = Visor::AssetSystem::importMesh(options.meshPath, "", "");
+			const Visor::ui32 triangleCount = std::max((Visor::ui32)mesh.getIndices().size() / 3, 1u);
+
+			runBenchmark(options, "mesh.load", triangleCount, [&]()
+			{
+				const Visor::Mesh loadedMesh = Visor::AssetSystem::importMesh(options.meshPath, "", "");
+				sink = sink + (Visor::f32)loadedMesh.getIndices().size();
+			}, summaries);
+		}
+		else
+		{
+			std::cerr << "mesh.load skipped, " << options.meshPath << " not found\n";
+		}
+	}
+
+	if(options.format == "csv")
+	{
+		printCSV(summaries);
+	}
+	else if(options.format == "json")
+	{
+		printJSON(summaries);
+	}
+
+	Visor::JobSystem::terminate();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,109 @@
+#include <visor.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+/*
+frames of a grid of meshes rendered without window, by the backends which can (not vulkan), the camera circling the grid.
+the last frame is written next to the executable when the backend keeps its images (software), the null backend
+reports what would have been sent to the gpu instead. a last argument of 1 hands the frames to a render thread,
+the time of a frame then includes waiting for it.
+usage : visor_render_benchmark [mesh path] [entity count] [frame count] [render thread, 0 or 1]
+*/
+
+static const Visor::ui32 Width = 1280;
+static const Visor::ui32 Height = 720;
+
+int main(int argc, char** argv)
+{
+	const std::string meshPath = argc > 1 ? argv[1] : "../assets/models/teapot.obj";
+	const Visor::ui32 entityCount = argc > 2 ? (Visor::ui32)std::max(std::atoi(argv[2]), 1) : 1000;
+	const Visor::ui32 frameCount = argc > 3 ? (Visor::ui32)std::max(std::atoi(argv[3]), 1) : 100;
+	const Visor::b8 hasRenderThread = argc > 4 && std::atoi(argv[4]) > 0;
+
+	Visor::JobSystem::start(std::max(std::thread::hardware_concurrency(), 1u));
+	Visor::MeshRegistry::start();
+	Visor::AssetSystem::start("../assets/shaders/intermediate/vertex.spv", "../assets/shaders/intermediate/fragment.spv");
+	Visor::RenderSystem::startHeadless(Width, Height, hasRenderThread);
+
+	{
+		Visor::Mesh mesh = Visor::AssetSystem::importMesh(meshPath, "../assets/shaders/intermediate/vertex.spv", "../assets/shaders/intermediate/fragment.spv");
+		mesh.buildMeshlets(64, 124);
+		const Visor::MeshHandle meshHandle = Visor::MeshRegistry::getInstance().registerMesh(mesh);
+
+		// a cube of entities, spaced by about twice the size of the mesh
+		const Visor::AABB& aabb = mesh.getAABB();
+		const Visor::f32 spacing = (aabb.maximum - aabb.minimum).getNorm() * 1.2f;
+		const Visor::ui32 side = (Visor::ui32)std::ceil(std::cbrt((Visor::f32)entityCount));
+
+		Visor::EntityStore entities;
+		for(Visor::ui32 entityIndex = 0; entityIndex < entityCount; ++entityIndex)
+		{
+			const Visor::Vector3<Visor::f32> position = {
+				(entityIndex % side) * spacing,
+				(entityIndex / side % side) * spacing,
+				(entityIndex / (side * side)) * spacing};
+			entities.createEntity(position, 1.0f, 1.0f, 1.0f, entityIndex * 0.7f, 0.0f, 0.0f, meshHandle);
+		}
+
+		const Visor::f32 halfSize = (side - 1) * spacing * 0.5f;
+		const Visor::Vector3<Visor::f32> center = {halfSize, halfSize, halfSize};
+
+		Visor::Camera camera = {};
+		camera.fov = 1.2f;
+
+		Visor::f64 renderSeconds = 0.0;
+		Visor::f64 visibleEntityCount = 0.0;
+		Visor::f64 drawnTriangleCount = 0.0;
+		Visor::f64 drawCount = 0.0;
+		Visor::f64 uploadedByteCount = 0.0;
+		for(Visor::ui32 frame = 0; frame < frameCount; ++frame)
+		{
+			const Visor::f32 angle = frame * 0.02f;
+			camera.position = center + Visor::Vector3<Visor::f32>{std::sin(angle), 0.3f, -std::cos(angle)} * (halfSize * 2.5f + spacing * 2.0f);
+			camera.lookAt(center);
+
+			const auto start = std::chrono::high_resolution_clock::now();
+			Visor::RenderSystem::getInstance().render(camera, entities);
+			Visor::RenderSystem::getInstance().synchronize();
+			const auto end = std::chrono::high_resolution_clock::now();
+			renderSeconds += std::chrono::duration<Visor::f64>(end - start).count();
+
+			const Visor::CullingStatistics cullingStatistics = Visor::RenderSystem::getInstance().getCullingStatistics();
+			const Visor::MeshletCullingStatistics meshletStatistics = Visor::RenderSystem::getInstance().getMeshletCullingStatistics();
+			visibleEntityCount += cullingStatistics.entityCount - cullingStatistics.frustumCulledEntityCount - cullingStatistics.occlusionCulledEntityCount;
+			drawnTriangleCount += meshletStatistics.triangleCount - meshletStatistics.culledTriangleCount;
+
+			const Visor::DrawStatistics drawStatistics = Visor::RenderSystem::getInstance().getDrawStatistics();
+			drawCount += drawStatistics.drawCount;
+			uploadedByteCount += drawStatistics.uploadedByteCount;
+		}
+
+		std::cout << meshPath << " : " << entityCount << " entities at " << Width << "x" << Height << " on "
+			<< Visor::JobSystem::getInstance().getThreadCount() << " threads" << (hasRenderThread ? " and a render thread, " : ", ")
+			<< renderSeconds * 1000.0 / frameCount << " ms per frame, "
+			<< visibleEntityCount / frameCount << " visible entities and "
+			<< drawnTriangleCount / frameCount << " triangles after meshlet culling per frame\n";
+
+#if defined(VSR_GRAPHICS_API_SOFTWARE)
+		Visor::RenderSystem::getInstance().writeColorImage("render_benchmark.ppm");
+#elif defined(VSR_GRAPHICS_API_NULL)
+		std::cout << drawCount / frameCount << " draws and " << uploadedByteCount / frameCount / 1024.0 << " KiB uploaded per frame\n";
+#endif
+
+		entities.clear();
+		Visor::MeshRegistry::getInstance().release(meshHandle);
+	}
+
+	Visor::RenderSystem::terminate();
+	Visor::AssetSystem::terminate();
+	Visor::MeshRegistry::terminate();
+	Visor::JobSystem::terminate();
+
+	return 0;
+}
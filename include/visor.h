@@ -2,13 +2,28 @@
 
 #include "types.h"
 #include "maths.h"
+#include "job_system.h"
 #include "window_system.h"
 #include "input_system.h"
 #include "render_system.h"
+#include "mesh_registry.h"
+#include "asset_system.h"
 #include "entity.h"
 #include "camera.h"
 #include "ray.h"
 #include "AABB.h"
+#include "aabb_tree.h"
+#include "entity_tree.h"
+#include "ray_query.h"
+#include "broadphase.h"
+#include "triangle_bvh.h"
+#include "frustum.h"
+#include "culling.h"
+#include "occlusion.h"
+#include "meshlet.h"
+#include "frame_packet.h"
+#include "simulation_clock.h"
+#include "transform_history.h"
 
 namespace Visor
 {
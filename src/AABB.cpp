@@ -1,6 +1,7 @@
 #include "AABB.h"
 
 #include <cassert>
+#include <cmath>
 
 namespace Visor
 {
@@ -10,4 +11,21 @@ namespace Visor
 	{
 		assert(minimum.x <= maximum.x && minimum.y <= maximum.y && minimum.z <= maximum.z);
 	}
+
+	AABB AABB::getTransformed(const Matrix4<f32>& matrix) const
+	{
+		// each output extent gathers the contributions of the input extents along the rotated and scaled axes
+		const Vector3<f32> center = (minimum + maximum) * 0.5f;
+		const Vector3<f32> extent = (maximum - minimum) * 0.5f;
+
+		Vector3<f32> transformedCenter = {};
+		Vector3<f32> transformedExtent = {};
+		for (ui32 row = 0; row < 3; ++row)
+		{
+			transformedCenter[row] = matrix.m[row][0] * center.x + matrix.m[row][1] * center.y + matrix.m[row][2] * center.z + matrix.m[row][3];
+			transformedExtent[row] = std::abs(matrix.m[row][0]) * extent.x + std::abs(matrix.m[row][1]) * extent.y + std::abs(matrix.m[row][2]) * extent.z;
+		}
+
+		return AABB(transformedCenter - transformedExtent, transformedCenter + transformedExtent);
+	}
 }
@@ -10,6 +10,9 @@ namespace Visor
 	public:
 		AABB(const Vector3<f32>& minimum, const Vector3<f32>& maximum);
 
+		// box enclosing this one once transformed (Arvo)
+		AABB getTransformed(const Matrix4<f32>& matrix) const;
+
 	public:
 		Vector3<f32> minimum;
 		Vector3<f32> maximum;
@@ -0,0 +1,641 @@
+#include "aabb_tree.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace Visor
+{
+	const ui32 AABBTree::NullNode;
+
+	// leaves are enlarged by this much on every side
+	static const f32 AABBMargin = 0.1f;
+
+	// enough for any tree kept balanced, whose height stays below 1.44 log2(leaf count)
+	static const ui32 MaxStackSize = 128;
+
+	static Vector3<f32> getMinimum(const Vector3<f32>& a, const Vector3<f32>& b)
+	{
+		return Vector3<f32>{std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z)};
+	}
+
+	static Vector3<f32> getMaximum(const Vector3<f32>& a, const Vector3<f32>& b)
+	{
+		return Vector3<f32>{std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z)};
+	}
+
+	static f32 getSurfaceArea(const Vector3<f32>& minimum, const Vector3<f32>& maximum)
+	{
+		const Vector3<f32> size = maximum - minimum;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	static b8 contains(const Vector3<f32>& minimum, const Vector3<f32>& maximum, const Vector3<f32>& innerMinimum, const Vector3<f32>& innerMaximum)
+	{
+		return
+			minimum.x <= innerMinimum.x && minimum.y <= innerMinimum.y && minimum.z <= innerMinimum.z &&
+			innerMaximum.x <= maximum.x && innerMaximum.y <= maximum.y && innerMaximum.z <= maximum.z;
+	}
+
+	static b8 overlaps(const Vector3<f32>& minimumA, const Vector3<f32>& maximumA, const Vector3<f32>& minimumB, const Vector3<f32>& maximumB)
+	{
+		return
+			minimumA.x <= maximumB.x && minimumB.x <= maximumA.x &&
+			minimumA.y <= maximumB.y && minimumB.y <= maximumA.y &&
+			minimumA.z <= maximumB.z && minimumB.z <= maximumA.z;
+	}
+
+	// distance where the ray enters the box (0 if it starts inside), false if it misses it within maxDistance
+	static b8 intersectRay(const Vector3<f32>& position, const Vector3<f32>& inverseDirection, f32 maxDistance, const Vector3<f32>& minimum, const Vector3<f32>& maximum, f32& distance)
+	{
+		const f32 x0 = (minimum.x - position.x) * inverseDirection.x;
+		const f32 x1 = (maximum.x - position.x) * inverseDirection.x;
+		const f32 y0 = (minimum.y - position.y) * inverseDirection.y;
+		const f32 y1 = (maximum.y - position.y) * inverseDirection.y;
+		const f32 z0 = (minimum.z - position.z) * inverseDirection.z;
+		const f32 z1 = (maximum.z - position.z) * inverseDirection.z;
+
+		const f32 entry = std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::max(std::min(z0, z1), 0.0f));
+		const f32 exit = std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::min(std::max(z0, z1), maxDistance));
+
+		distance = entry;
+		return entry <= exit;
+	}
+
+	// 1 if the box is entirely inside the frustum, 0 if it crosses it, -1 if it is entirely outside
+	static i32 classify(const Frustum& frustum, const Vector3<f32>& minimum, const Vector3<f32>& maximum)
+	{
+		const Vector3<f32> center = (minimum + maximum) * 0.5f;
+		const Vector3<f32> extent = (maximum - minimum) * 0.5f;
+
+		i32 result = 1;
+		for (ui32 planeIndex = 0; planeIndex < 6; ++planeIndex)
+		{
+			const Plane& plane = frustum.planes[planeIndex];
+			const f32 distance = plane.getSignedDistance(center);
+			const f32 radius = std::abs(plane.normal.x) * extent.x + std::abs(plane.normal.y) * extent.y + std::abs(plane.normal.z) * extent.z;
+			if (distance + radius < 0.0f)
+			{
+				return -1;
+			}
+
+			if (distance - radius < 0.0f)
+			{
+				result = 0;
+			}
+		}
+
+		return result;
+	}
+
+	b8 AABBTree::Node::isLeaf() const
+	{
+		return height == 0;
+	}
+
+	AABBTree::AABBTree()
+		: _root(NullNode)
+		, _freeNode(NullNode)
+		, _leafCount(0)
+		, _reinsertionCount(0)
+	{
+	}
+
+	ui32 AABBTree::insert(const AABB& aabb, ui32 userData)
+	{
+		const ui32 leaf = allocateNode();
+		Node& node = _nodes[leaf];
+		const Vector3<f32> margin = {AABBMargin, AABBMargin, AABBMargin};
+		node.minimum = aabb.minimum - margin;
+		node.maximum = aabb.maximum + margin;
+		node.leafMinimum = aabb.minimum;
+		node.leafMaximum = aabb.maximum;
+		node.height = 0;
+		node.userData = userData;
+
+		insertLeaf(leaf);
+		_leafCount += 1;
+
+		return leaf;
+	}
+
+	void AABBTree::remove(ui32 leaf)
+	{
+		assert(leaf < _nodes.size() && _nodes[leaf].isLeaf());
+
+		removeLeaf(leaf);
+		freeNode(leaf);
+		_leafCount -= 1;
+	}
+
+	b8 AABBTree::move(ui32 leaf, const AABB& aabb)
+	{
+		assert(leaf < _nodes.size() && _nodes[leaf].isLeaf());
+
+		Node& node = _nodes[leaf];
+		node.leafMinimum = aabb.minimum;
+		node.leafMaximum = aabb.maximum;
+
+		// nothing to do while the box stays inside the enlarged one, unless that one became far too loose (the box shrank)
+		const Vector3<f32> margin = {AABBMargin, AABBMargin, AABBMargin};
+		const Vector3<f32> looseMargin = margin * 4.0f;
+		if (contains(node.minimum, node.maximum, aabb.minimum, aabb.maximum) &&
+			contains(aabb.minimum - looseMargin, aabb.maximum + looseMargin, node.minimum, node.maximum))
+		{
+			return false;
+		}
+
+		removeLeaf(leaf);
+		_nodes[leaf].minimum = aabb.minimum - margin;
+		_nodes[leaf].maximum = aabb.maximum + margin;
+		insertLeaf(leaf);
+		_reinsertionCount += 1;
+
+		return true;
+	}
+
+	void AABBTree::rebuild()
+	{
+		std::vector<BuildLeaf> leaves;
+		leaves.reserve(_leafCount);
+		for (ui32 nodeIndex = 0; nodeIndex < _nodes.size(); ++nodeIndex)
+		{
+			if (_nodes[nodeIndex].height == 0)
+			{
+				leaves.push_back(BuildLeaf{(_nodes[nodeIndex].minimum + _nodes[nodeIndex].maximum) * 0.5f, nodeIndex});
+			}
+			else if (_nodes[nodeIndex].height > 0)
+			{
+				freeNode(nodeIndex);
+			}
+		}
+
+		_root = leaves.empty() ? NullNode : buildTopDown(leaves.data(), (ui32)leaves.size());
+		if (_root != NullNode)
+		{
+			_nodes[_root].parent = NullNode;
+		}
+
+		_reinsertionCount = 0;
+	}
+
+	void AABBTree::clear()
+	{
+		_nodes.clear();
+		_root = NullNode;
+		_freeNode = NullNode;
+		_leafCount = 0;
+		_reinsertionCount = 0;
+	}
+
+	b8 AABBTree::raycast(const Ray& ray, f32 maxDistance, ui32& userData, f32& distance) const
+	{
+		return raycast(ray, maxDistance, [](ui32, f32 boxDistance) { return boxDistance; }, userData, distance);
+	}
+
+	b8 AABBTree::raycast(const Ray& ray, f32 maxDistance, const RaycastFunction& function, ui32& userData, f32& distance) const
+	{
+		if (_root == NullNode)
+		{
+			return false;
+		}
+
+		// an axis the ray is parallel to gives infinite slab distances, which the min and max absorb
+		const Vector3<f32>& inverseDirection = ray.inverseDirection;
+
+		// nodes along with the distance where the ray enters them, the nearest child is visited first
+		// so the closest hit found so far prunes most of the rest
+		ui32 stackNodes[MaxStackSize];
+		f32 stackDistances[MaxStackSize];
+		ui32 stackSize = 0;
+
+		b8 hit = false;
+		f32 closestDistance = maxDistance;
+
+		f32 rootDistance = 0.0f;
+		if (intersectRay(ray.position, inverseDirection, closestDistance, _nodes[_root].minimum, _nodes[_root].maximum, rootDistance))
+		{
+			stackNodes[stackSize] = _root;
+			stackDistances[stackSize] = rootDistance;
+			stackSize += 1;
+		}
+
+		while (stackSize > 0)
+		{
+			stackSize -= 1;
+			const Node& node = _nodes[stackNodes[stackSize]];
+			if (stackDistances[stackSize] > closestDistance)
+			{
+				continue;
+			}
+
+			if (node.isLeaf())
+			{
+				f32 leafDistance = 0.0f;
+				if (!intersectRay(ray.position, inverseDirection, closestDistance, node.leafMinimum, node.leafMaximum, leafDistance))
+				{
+					continue;
+				}
+
+				const f32 hitDistance = function(node.userData, leafDistance);
+				if (hitDistance >= 0.0f && hitDistance <= closestDistance)
+				{
+					hit = true;
+					closestDistance = hitDistance;
+					userData = node.userData;
+				}
+				continue;
+			}
+
+			f32 childDistances[2];
+			b8 childHits[2];
+			for (ui32 childIndex = 0; childIndex < 2; ++childIndex)
+			{
+				const Node& child = _nodes[node.children[childIndex]];
+				childHits[childIndex] = intersectRay(ray.position, inverseDirection, closestDistance, child.minimum, child.maximum, childDistances[childIndex]);
+			}
+
+			// the far child is pushed first so the near one pops first
+			const ui32 farIndex = (childHits[0] && childHits[1] && childDistances[1] < childDistances[0]) ? 0 : 1;
+			for (ui32 order = 0; order < 2; ++order)
+			{
+				const ui32 childIndex = order == 0 ? farIndex : 1 - farIndex;
+				if (childHits[childIndex])
+				{
+					assert(stackSize < MaxStackSize);
+					stackNodes[stackSize] = node.children[childIndex];
+					stackDistances[stackSize] = childDistances[childIndex];
+					stackSize += 1;
+				}
+			}
+		}
+
+		if (hit)
+		{
+			distance = closestDistance;
+		}
+
+		return hit;
+	}
+
+	void AABBTree::queryOverlaps(const AABB& aabb, std::vector<ui32>& userDatas) const
+	{
+		if (_root == NullNode)
+		{
+			return;
+		}
+
+		ui32 stack[MaxStackSize];
+		ui32 stackSize = 0;
+		stack[stackSize++] = _root;
+
+		while (stackSize > 0)
+		{
+			const Node& node = _nodes[stack[--stackSize]];
+			if (!overlaps(node.minimum, node.maximum, aabb.minimum, aabb.maximum))
+			{
+				continue;
+			}
+
+			if (node.isLeaf())
+			{
+				if (overlaps(node.leafMinimum, node.leafMaximum, aabb.minimum, aabb.maximum))
+				{
+					userDatas.push_back(node.userData);
+				}
+				continue;
+			}
+
+			assert(stackSize + 2 <= MaxStackSize);
+			stack[stackSize++] = node.children[0];
+			stack[stackSize++] = node.children[1];
+		}
+	}
+
+	void AABBTree::queryFrustum(const Frustum& frustum, std::vector<ui32>& userDatas) const
+	{
+		if (_root == NullNode)
+		{
+			return;
+		}
+
+		ui32 stack[MaxStackSize];
+		ui32 stackSize = 0;
+		stack[stackSize++] = _root;
+
+		while (stackSize > 0)
+		{
+			const ui32 nodeIndex = stack[--stackSize];
+			const Node& node = _nodes[nodeIndex];
+
+			const i32 classification = node.isLeaf() ?
+				classify(frustum, node.leafMinimum, node.leafMaximum) :
+				classify(frustum, node.minimum, node.maximum);
+			if (classification < 0)
+			{
+				continue;
+			}
+
+			// a subtree entirely inside needs no more test
+			if (classification > 0 || node.isLeaf())
+			{
+				collectLeaves(nodeIndex, userDatas);
+				continue;
+			}
+
+			assert(stackSize + 2 <= MaxStackSize);
+			stack[stackSize++] = node.children[0];
+			stack[stackSize++] = node.children[1];
+		}
+	}
+
+	ui32 AABBTree::getUserData(ui32 leaf) const
+	{
+		assert(leaf < _nodes.size() && _nodes[leaf].isLeaf());
+		return _nodes[leaf].userData;
+	}
+
+	ui32 AABBTree::getLeafCount() const
+	{
+		return _leafCount;
+	}
+
+	ui32 AABBTree::getHeight() const
+	{
+		return _root == NullNode ? 0 : (ui32)_nodes[_root].height;
+	}
+
+	ui32 AABBTree::getReinsertionCount() const
+	{
+		return _reinsertionCount;
+	}
+
+	ui32 AABBTree::allocateNode()
+	{
+		if (_freeNode == NullNode)
+		{
+			_nodes.push_back(Node{});
+			_nodes.back().parent = NullNode;
+			_nodes.back().children[0] = NullNode;
+			_nodes.back().children[1] = NullNode;
+			return (ui32)_nodes.size() - 1;
+		}
+
+		const ui32 node = _freeNode;
+		_freeNode = _nodes[node].parent;
+		_nodes[node].parent = NullNode;
+		_nodes[node].children[0] = NullNode;
+		_nodes[node].children[1] = NullNode;
+		return node;
+	}
+
+	void AABBTree::freeNode(ui32 node)
+	{
+		_nodes[node].height = -1;
+		_nodes[node].parent = _freeNode;
+		_freeNode = node;
+	}
+
+	void AABBTree::insertLeaf(ui32 leaf)
+	{
+		if (_root == NullNode)
+		{
+			_root = leaf;
+			_nodes[leaf].parent = NullNode;
+			return;
+		}
+
+		// walks down to the sibling whose union with the leaf adds the least surface area to the tree,
+		// every node on the way growing as well
+		const Vector3<f32> leafMinimum = _nodes[leaf].minimum;
+		const Vector3<f32> leafMaximum = _nodes[leaf].maximum;
+
+		ui32 sibling = _root;
+		while (!_nodes[sibling].isLeaf())
+		{
+			const Node& node = _nodes[sibling];
+			const f32 area = getSurfaceArea(node.minimum, node.maximum);
+			const f32 combinedArea = getSurfaceArea(getMinimum(node.minimum, leafMinimum), getMaximum(node.maximum, leafMaximum));
+
+			// pairing the leaf with this node creates a parent with the combined area,
+			// descending makes this node grow instead
+			const f32 cost = 2.0f * combinedArea;
+			const f32 inheritanceCost = 2.0f * (combinedArea - area);
+
+			f32 childCosts[2];
+			for (ui32 childIndex = 0; childIndex < 2; ++childIndex)
+			{
+				const Node& child = _nodes[node.children[childIndex]];
+				const f32 unionArea = getSurfaceArea(getMinimum(child.minimum, leafMinimum), getMaximum(child.maximum, leafMaximum));
+				childCosts[childIndex] = child.isLeaf() ?
+					unionArea + inheritanceCost :
+					unionArea - getSurfaceArea(child.minimum, child.maximum) + inheritanceCost;
+			}
+
+			if (cost < childCosts[0] && cost < childCosts[1])
+			{
+				break;
+			}
+
+			sibling = childCosts[0] < childCosts[1] ? node.children[0] : node.children[1];
+		}
+
+		const ui32 oldParent = _nodes[sibling].parent;
+		const ui32 newParent = allocateNode();
+		_nodes[newParent].parent = oldParent;
+		_nodes[newParent].children[0] = sibling;
+		_nodes[newParent].children[1] = leaf;
+		_nodes[newParent].height = _nodes[sibling].height + 1;
+		_nodes[newParent].userData = 0;
+		setUnion(newParent);
+
+		_nodes[sibling].parent = newParent;
+		_nodes[leaf].parent = newParent;
+
+		if (oldParent == NullNode)
+		{
+			_root = newParent;
+		}
+		else
+		{
+			Node& parent = _nodes[oldParent];
+			parent.children[parent.children[0] == sibling ? 0 : 1] = newParent;
+		}
+
+		refitAncestors(oldParent);
+	}
+
+	void AABBTree::removeLeaf(ui32 leaf)
+	{
+		if (leaf == _root)
+		{
+			_root = NullNode;
+			return;
+		}
+
+		// the sibling takes the place of the parent
+		const ui32 parent = _nodes[leaf].parent;
+		const ui32 grandParent = _nodes[parent].parent;
+		const ui32 sibling = _nodes[parent].children[_nodes[parent].children[0] == leaf ? 1 : 0];
+
+		_nodes[sibling].parent = grandParent;
+		freeNode(parent);
+
+		if (grandParent == NullNode)
+		{
+			_root = sibling;
+			return;
+		}
+
+		Node& node = _nodes[grandParent];
+		node.children[node.children[0] == parent ? 0 : 1] = sibling;
+		refitAncestors(grandParent);
+	}
+
+	void AABBTree::refitAncestors(ui32 node)
+	{
+		while (node != NullNode)
+		{
+			node = balance(node);
+
+			Node& current = _nodes[node];
+			current.height = 1 + std::max(_nodes[current.children[0]].height, _nodes[current.children[1]].height);
+			setUnion(node);
+
+			node = current.parent;
+		}
+	}
+
+	ui32 AABBTree::balance(ui32 a)
+	{
+		// rotates the higher grandchild up when the heights of the children differ by more than one (as in an avl tree),
+		// returns the node now at the place of a
+		Node& nodeA = _nodes[a];
+		if (nodeA.isLeaf() || nodeA.height < 2)
+		{
+			return a;
+		}
+
+		const i32 heightDifference = _nodes[nodeA.children[1]].height - _nodes[nodeA.children[0]].height;
+		if (heightDifference >= -1 && heightDifference <= 1)
+		{
+			return a;
+		}
+
+		// b is the higher child, it goes up, c stays below a
+		const ui32 higherIndex = heightDifference > 1 ? 1 : 0;
+		const ui32 b = nodeA.children[higherIndex];
+		Node& nodeB = _nodes[b];
+
+		const ui32 f = nodeB.children[0];
+		const ui32 g = nodeB.children[1];
+
+		// b takes the place of a
+		nodeB.parent = nodeA.parent;
+		nodeA.parent = b;
+		if (nodeB.parent == NullNode)
+		{
+			_root = b;
+		}
+		else
+		{
+			Node& parent = _nodes[nodeB.parent];
+			parent.children[parent.children[0] == a ? 0 : 1] = b;
+		}
+
+		// a keeps the lower grandchild instead of b, b gets a and the higher grandchild
+		const b8 fIsHigher = _nodes[f].height > _nodes[g].height;
+		const ui32 higherGrandChild = fIsHigher ? f : g;
+		const ui32 lowerGrandChild = fIsHigher ? g : f;
+
+		nodeB.children[0] = a;
+		nodeB.children[1] = higherGrandChild;
+		nodeA.children[higherIndex] = lowerGrandChild;
+		_nodes[lowerGrandChild].parent = a;
+
+		nodeA.height = 1 + std::max(_nodes[nodeA.children[0]].height, _nodes[nodeA.children[1]].height);
+		setUnion(a);
+		nodeB.height = 1 + std::max(nodeA.height, _nodes[higherGrandChild].height);
+		setUnion(b);
+
+		return b;
+	}
+
+	void AABBTree::setUnion(ui32 node)
+	{
+		Node& current = _nodes[node];
+		const Node& child0 = _nodes[current.children[0]];
+		const Node& child1 = _nodes[current.children[1]];
+		current.minimum = getMinimum(child0.minimum, child1.minimum);
+		current.maximum = getMaximum(child0.maximum, child1.maximum);
+	}
+
+	ui32 AABBTree::buildTopDown(BuildLeaf* pLeaves, ui32 leafCount)
+	{
+		if (leafCount == 1)
+		{
+			return pLeaves[0].node;
+		}
+
+		// median split along the longest axis of the leaf centers
+		Vector3<f32> minimum = pLeaves[0].center;
+		Vector3<f32> maximum = pLeaves[0].center;
+		for (ui32 leafIndex = 1; leafIndex < leafCount; ++leafIndex)
+		{
+			minimum = getMinimum(minimum, pLeaves[leafIndex].center);
+			maximum = getMaximum(maximum, pLeaves[leafIndex].center);
+		}
+
+		const Vector3<f32> size = maximum - minimum;
+		const ui32 middle = leafCount / 2;
+		if (size.x >= size.y && size.x >= size.z)
+		{
+			std::nth_element(pLeaves, pLeaves + middle, pLeaves + leafCount, [](const BuildLeaf& a, const BuildLeaf& b) { return a.center.x < b.center.x; });
+		}
+		else if (size.y >= size.z)
+		{
+			std::nth_element(pLeaves, pLeaves + middle, pLeaves + leafCount, [](const BuildLeaf& a, const BuildLeaf& b) { return a.center.y < b.center.y; });
+		}
+		else
+		{
+			std::nth_element(pLeaves, pLeaves + middle, pLeaves + leafCount, [](const BuildLeaf& a, const BuildLeaf& b) { return a.center.z < b.center.z; });
+		}
+
+		const ui32 child0 = buildTopDown(pLeaves, middle);
+		const ui32 child1 = buildTopDown(pLeaves + middle, leafCount - middle);
+
+		const ui32 node = allocateNode();
+		_nodes[node].children[0] = child0;
+		_nodes[node].children[1] = child1;
+		_nodes[node].height = 1 + std::max(_nodes[child0].height, _nodes[child1].height);
+		_nodes[node].userData = 0;
+		setUnion(node);
+
+		_nodes[child0].parent = node;
+		_nodes[child1].parent = node;
+
+		return node;
+	}
+
+	void AABBTree::collectLeaves(ui32 node, std::vector<ui32>& userDatas) const
+	{
+		ui32 stack[MaxStackSize];
+		ui32 stackSize = 0;
+		stack[stackSize++] = node;
+
+		while (stackSize > 0)
+		{
+			const Node& current = _nodes[stack[--stackSize]];
+			if (current.isLeaf())
+			{
+				userDatas.push_back(current.userData);
+				continue;
+			}
+
+			assert(stackSize + 2 <= MaxStackSize);
+			stack[stackSize++] = current.children[0];
+			stack[stackSize++] = current.children[1];
+		}
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "types.h"
+#include "maths.h"
+#include "AABB.h"
+#include "frustum.h"
+#include "ray.h"
+
+#include <functional>
+#include <vector>
+
+namespace Visor
+{
+	/*
+	dynamic bounding volume hierarchy : every leaf holds a box and a user value, every internal node exactly two children.
+	leaves store a box enlarged by a margin, so objects moving a little inside it need no update.
+	insertion walks down to the sibling whose union grows the least, then rotations keep the tree balanced on the way up.
+	too many reinsertions degrade the tree : rebuild rebuilds it from its leaves, splitting them along their longest axis
+	*/
+	class AABBTree
+	{
+	public:
+		// called for each leaf hit by a ray, closest leaves first, with the distance where the ray enters the leaf box.
+		// returns the distance of the actual hit (the box distance at box precision) or a negative value to ignore the leaf
+		typedef std::function<f32(ui32 userData, f32 distance)> RaycastFunction;
+
+		static const ui32 NullNode = 0xFFFFFFFF;
+
+		AABBTree();
+
+		// returns the leaf node of the box, valid until it is removed
+		ui32 insert(const AABB& aabb, ui32 userData);
+		void remove(ui32 leaf);
+		// refits the leaf to the new box, returns false if it is still within its enlarged box and nothing changed
+		b8 move(ui32 leaf, const AABB& aabb);
+		void rebuild();
+		void clear();
+
+		// closest hit within maxDistance
+		b8 raycast(const Ray& ray, f32 maxDistance, ui32& userData, f32& distance) const;
+		b8 raycast(const Ray& ray, f32 maxDistance, const RaycastFunction& function, ui32& userData, f32& distance) const;
+		void queryOverlaps(const AABB& aabb, std::vector<ui32>& userDatas) const;
+		void queryFrustum(const Frustum& frustum, std::vector<ui32>& userDatas) const;
+
+		ui32 getUserData(ui32 leaf) const;
+		ui32 getLeafCount() const;
+		ui32 getHeight() const;
+		// number of leaves moved out of their enlarged box since the last rebuild
+		ui32 getReinsertionCount() const;
+
+	private:
+		struct Node
+		{
+		public:
+			b8 isLeaf() const;
+
+		public:
+			// enlarged for leaves
+			Vector3<f32> minimum;
+			Vector3<f32> maximum;
+			// exact box of leaves, queries test it once the enlarged one passed
+			Vector3<f32> leafMinimum;
+			Vector3<f32> leafMaximum;
+			ui32 parent; // next free node while in the free list
+			ui32 children[2];
+			i32 height; // 0 for leaves, -1 for free nodes
+			ui32 userData;
+		};
+
+		// leaf sorted during a rebuild, along with the center of its box
+		struct BuildLeaf
+		{
+		public:
+			Vector3<f32> center;
+			ui32 node;
+		};
+
+	private:
+		ui32 allocateNode();
+		void freeNode(ui32 node);
+		void insertLeaf(ui32 leaf);
+		void removeLeaf(ui32 leaf);
+		void refitAncestors(ui32 node);
+		ui32 balance(ui32 node);
+		void setUnion(ui32 node);
+		ui32 buildTopDown(BuildLeaf* pLeaves, ui32 leafCount);
+		void collectLeaves(ui32 node, std::vector<ui32>& userDatas) const;
+
+	private:
+		std::vector<Node> _nodes;
+		ui32 _root;
+		ui32 _freeNode;
+		ui32 _leafCount;
+		ui32 _reinsertionCount;
+	};
+}
@@ -0,0 +1,279 @@
+#include "asset_system.h"
+
+#include <trivex.h>
+
+#include <cassert>
+#include <algorithm>
+
+namespace Visor
+{
+	static AssetSystem* pInstance = nullptr;
+
+	static Mesh getPlaceholderCube(const std::string& vertexShaderName, const std::string& fragmentShaderName)
+	{
+		// unit cube centered on the origin, with one vertex per face corner so faces are flat shaded
+		const Vector3<f32> normals[6] = {
+			{1.0f, 0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f},
+			{0.0f, 1.0f, 0.0f}, {0.0f, -1.0f, 0.0f},
+			{0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f}
+		};
+
+		// an axis spanning each face, the other one being (normal x tangent) so corners wind counter clockwise seen from outside
+		const Vector3<f32> tangents[6] = {
+			{0.0f, 1.0f, 0.0f}, {0.0f, 1.0f, 0.0f},
+			{0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 1.0f},
+			{1.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}
+		};
+
+		std::vector<Mesh::Vertex> vertices;
+		std::vector<ui32> indices;
+
+		for (ui32 faceIndex = 0; faceIndex < 6; ++faceIndex)
+		{
+			const Vector3<f32>& normal = normals[faceIndex];
+			const Vector3<f32>& u = tangents[faceIndex];
+			const Vector3<f32> v = normal.cross(u);
+
+			const ui32 firstVertexIndex = (ui32)vertices.size();
+			const f32 corners[4][2] = {{-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f}};
+			for (ui32 cornerIndex = 0; cornerIndex < 4; ++cornerIndex)
+			{
+				Mesh::Vertex vertex = {};
+				vertex.position = (normal + u * corners[cornerIndex][0] + v * corners[cornerIndex][1]) * 0.5f;
+				vertex.normal = normal;
+				vertices.push_back(vertex);
+			}
+
+			const ui32 faceIndices[6] = {0, 1, 2, 0, 2, 3};
+			for (ui32 index : faceIndices)
+			{
+				indices.push_back(firstVertexIndex + index);
+			}
+		}
+
+		return Mesh(vertices, indices, vertexShaderName, fragmentShaderName);
+	}
+
+	MeshHandle AssetSystem::requestMesh(const std::string& meshPath, const std::string& vertexShaderName, const std::string& fragmentShaderName, b8 buildMeshlets)
+	{
+		// a mesh requested twice is only loaded once
+		std::unordered_map<std::string, MeshRequest>::iterator it = _requestedMeshes.find(meshPath);
+		if (it != _requestedMeshes.end() && MeshRegistry::getInstance().isValid(it->second.handle))
+		{
+			MeshRegistry::getInstance().retain(it->second.handle);
+			return it->second.handle;
+		}
+
+		const MeshRequest meshRequest = {MeshRegistry::getInstance().reserveMesh(), meshPath, vertexShaderName, fragmentShaderName, buildMeshlets};
+		_requestedMeshes[meshPath] = meshRequest;
+
+		watchFile(meshPath);
+		watchShader(vertexShaderName);
+		watchShader(fragmentShaderName);
+
+		queueMeshRequest(meshRequest);
+
+		return meshRequest.handle;
+	}
+
+	void AssetSystem::update()
+	{
+		_changedShaderNames.clear();
+
+		std::vector<std::string> changedFilePaths;
+		_fileWatcher.pollChangedFiles(changedFilePaths);
+
+		for (const std::string& changedFilePath : changedFilePaths)
+		{
+			// only meshes that are done loading are reloaded, a pending request reads the file anyway
+			std::unordered_map<std::string, MeshRequest>::const_iterator it = _requestedMeshes.find(changedFilePath);
+			if (it != _requestedMeshes.end() && MeshRegistry::getInstance().isLoaded(it->second.handle))
+			{
+				queueMeshRequest(it->second);
+			}
+
+			for (const std::string& shaderName : _shaderNames)
+			{
+				if (shaderName == changedFilePath && std::find(_changedShaderNames.begin(), _changedShaderNames.end(), shaderName) == _changedShaderNames.end())
+				{
+					_changedShaderNames.push_back(shaderName);
+				}
+			}
+		}
+
+		std::vector<LoadedMesh> loadedMeshes;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			loadedMeshes.swap(_loadedMeshes);
+		}
+
+		for (const LoadedMesh& loadedMesh : loadedMeshes)
+		{
+			_pendingRequestCount -= 1;
+
+			// the handle may have been released while its mesh was loading
+			if (!MeshRegistry::getInstance().isValid(loadedMesh.handle))
+			{
+				continue;
+			}
+
+			if (MeshRegistry::getInstance().isLoaded(loadedMesh.handle))
+			{
+				MeshRegistry::getInstance().replaceMesh(loadedMesh.handle, loadedMesh.mesh);
+			}
+			else
+			{
+				MeshRegistry::getInstance().setMesh(loadedMesh.handle, loadedMesh.mesh);
+			}
+		}
+	}
+
+	MeshHandle AssetSystem::getPlaceholderMesh() const
+	{
+		return _placeholderMesh;
+	}
+
+	ui32 AssetSystem::getPendingRequestCount() const
+	{
+		return _pendingRequestCount;
+	}
+
+	const std::vector<std::string>& AssetSystem::getChangedShaderNames() const
+	{
+		return _changedShaderNames;
+	}
+
+	Mesh AssetSystem::importMesh(const std::string& meshPath, const std::string& vertexShaderName, const std::string& fragmentShaderName)
+	{
+		std::vector<Mesh::Vertex> vertices;
+		std::vector<ui32> indices;
+
+		TVX_Mesh TVXMesh;
+		TVX_loadMeshFromOBJ(meshPath.c_str(), &TVXMesh);
+
+		vertices.reserve(TVXMesh.vertexCount);
+		for(uint32_t vertexIndex = 0; vertexIndex < TVXMesh.vertexCount; ++vertexIndex)
+		{
+			struct TVX_Position position = TVXMesh.pVertices[vertexIndex].position;
+			struct TVX_Normal normal = TVXMesh.pVertices[vertexIndex].normal;
+
+			Mesh::Vertex vertex = {};
+			vertex.position.x = position.x;
+			vertex.position.y = position.y;
+			vertex.position.z = position.z;
+			vertex.normal.x = normal.x;
+			vertex.normal.y = normal.y;
+			vertex.normal.z = normal.z;
+
+			vertices.push_back(vertex);
+		}
+
+		indices.reserve(TVXMesh.vertexIndexCount);
+		for(uint32_t vertexIndexIndex = 0; vertexIndexIndex < TVXMesh.vertexIndexCount; ++vertexIndexIndex)
+		{
+			indices.push_back(TVXMesh.pVertexIndices[vertexIndexIndex]);
+		}
+
+		TVX_destroyMesh(TVXMesh);
+
+		return Mesh(vertices, indices, vertexShaderName, fragmentShaderName);
+	}
+
+	void AssetSystem::start(const std::string& placeholderVertexShaderName, const std::string& placeholderFragmentShaderName)
+	{
+		assert(pInstance == nullptr);
+		pInstance = new AssetSystem(placeholderVertexShaderName, placeholderFragmentShaderName);
+	}
+
+	void AssetSystem::terminate()
+	{
+		assert(pInstance != nullptr);
+		delete pInstance;
+		pInstance = nullptr;
+	}
+
+	AssetSystem& AssetSystem::getInstance()
+	{
+		assert(pInstance != nullptr);
+		return *pInstance;
+	}
+
+	AssetSystem::AssetSystem(const std::string& placeholderVertexShaderName, const std::string& placeholderFragmentShaderName)
+		: _placeholderMesh(MeshRegistry::getInstance().registerMesh(getPlaceholderCube(placeholderVertexShaderName, placeholderFragmentShaderName)))
+		, _pendingRequestCount(0)
+		, _stopping(false)
+	{
+		watchShader(placeholderVertexShaderName);
+		watchShader(placeholderFragmentShaderName);
+
+		_worker = std::thread(&AssetSystem::runWorker, this);
+	}
+
+	AssetSystem::~AssetSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopping = true;
+		}
+		_condition.notify_one();
+		_worker.join();
+
+		MeshRegistry::getInstance().release(_placeholderMesh);
+	}
+
+	void AssetSystem::queueMeshRequest(const MeshRequest& meshRequest)
+	{
+		_pendingRequestCount += 1;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_meshRequests.push_back(meshRequest);
+		}
+		_condition.notify_one();
+	}
+
+	void AssetSystem::watchFile(const std::string& filePath)
+	{
+		const size_t separatorIndex = filePath.find_last_of("/\\");
+		_fileWatcher.watchDirectory(separatorIndex == std::string::npos ? std::string(".") : filePath.substr(0, separatorIndex));
+	}
+
+	void AssetSystem::watchShader(const std::string& shaderName)
+	{
+		if (std::find(_shaderNames.begin(), _shaderNames.end(), shaderName) == _shaderNames.end())
+		{
+			_shaderNames.push_back(shaderName);
+			watchFile(shaderName);
+		}
+	}
+
+	void AssetSystem::runWorker()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		while (true)
+		{
+			_condition.wait(lock, [this]() { return _stopping || !_meshRequests.empty(); });
+
+			if (_stopping)
+			{
+				break;
+			}
+
+			const MeshRequest meshRequest = _meshRequests.front();
+			_meshRequests.erase(_meshRequests.begin());
+
+			// file reading and decoding happen without holding the lock
+			lock.unlock();
+			Mesh mesh = importMesh(meshRequest.meshPath, meshRequest.vertexShaderName, meshRequest.fragmentShaderName);
+			if (meshRequest.buildMeshlets)
+			{
+				mesh.buildMeshlets(64, 124);
+			}
+			mesh.buildBVH();
+			lock.lock();
+
+			_loadedMeshes.push_back(LoadedMesh{meshRequest.handle, mesh});
+		}
+	}
+}
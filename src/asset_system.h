@@ -0,0 +1,84 @@
+#pragma once
+
+#include "types.h"
+#include "mesh.h"
+#include "mesh_registry.h"
+#include "file_watcher.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace Visor
+{
+	/*
+	loads meshes on a background thread. requestMesh returns a reserved handle right away,
+	the handle becomes loaded during the update following the end of its decoding.
+	until then, the placeholder mesh (a unit cube) is meant to be drawn instead.
+	the directories of requested meshes and shaders are watched : a mesh file written again is decoded
+	again and replaces the registry data of its handle, a shader written again is reported by getChangedShaderNames
+	for the frame following the write
+	*/
+	class AssetSystem
+	{
+	public:
+		MeshHandle requestMesh(const std::string& meshPath, const std::string& vertexShaderName, const std::string& fragmentShaderName, b8 buildMeshlets);
+		void update();
+
+		MeshHandle getPlaceholderMesh() const;
+		ui32 getPendingRequestCount() const;
+		const std::vector<std::string>& getChangedShaderNames() const;
+
+		static Mesh importMesh(const std::string& meshPath, const std::string& vertexShaderName, const std::string& fragmentShaderName);
+
+		static void start(const std::string& placeholderVertexShaderName, const std::string& placeholderFragmentShaderName);
+		static void terminate();
+		static AssetSystem& getInstance();
+
+	private:
+		struct MeshRequest
+		{
+		public:
+			MeshHandle handle;
+			std::string meshPath;
+			std::string vertexShaderName;
+			std::string fragmentShaderName;
+			b8 buildMeshlets;
+		};
+
+		struct LoadedMesh
+		{
+		public:
+			MeshHandle handle;
+			Mesh mesh;
+		};
+
+	private:
+		AssetSystem(const std::string& placeholderVertexShaderName, const std::string& placeholderFragmentShaderName);
+		~AssetSystem();
+
+		void runWorker();
+		void queueMeshRequest(const MeshRequest& meshRequest);
+		void watchFile(const std::string& filePath);
+		void watchShader(const std::string& shaderName);
+
+	private:
+		MeshHandle _placeholderMesh;
+		std::unordered_map<std::string, MeshRequest> _requestedMeshes; // by mesh path
+		ui32 _pendingRequestCount;
+		FileWatcher _fileWatcher;
+		std::vector<std::string> _shaderNames;
+		std::vector<std::string> _changedShaderNames;
+
+		// shared with the worker thread
+		std::thread _worker;
+		std::mutex _mutex;
+		std::condition_variable _condition;
+		std::vector<MeshRequest> _meshRequests;
+		std::vector<LoadedMesh> _loadedMeshes;
+		b8 _stopping;
+	};
+}
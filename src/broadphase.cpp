@@ -0,0 +1,312 @@
+#include "broadphase.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Visor
+{
+	const ui32 Broadphase::NullProxy;
+
+	static f32 getComponent(const Vector3<f32>& vector, ui32 axis)
+	{
+		return axis == 0 ? vector.x : (axis == 1 ? vector.y : vector.z);
+	}
+
+	Broadphase::Broadphase()
+		: _insertedProxyCount(0)
+		, _swapCount(0)
+	{
+	}
+
+	ui32 Broadphase::insert(const AABB& aabb, ui32 userData)
+	{
+		ui32 proxy = 0;
+		if (!_freeProxies.empty())
+		{
+			proxy = _freeProxies.back();
+			_freeProxies.pop_back();
+		}
+		else
+		{
+			proxy = (ui32)_proxies.size();
+			_proxies.push_back(Proxy{});
+		}
+
+		Proxy& newProxy = _proxies[proxy];
+		newProxy.minimum = aabb.minimum;
+		newProxy.maximum = aabb.maximum;
+		newProxy.userData = userData;
+		newProxy.isRemoved = false;
+
+		// appended past every other endpoint, where the box overlaps nothing, the next update sorts them in
+		for (ui32 axis = 0; axis < 3; ++axis)
+		{
+			_endpoints[axis].push_back(Endpoint{aabb.minimum[axis], proxy << 1, false});
+			_endpoints[axis].push_back(Endpoint{aabb.maximum[axis], (proxy << 1) | 1, false});
+		}
+
+		_insertedProxyCount += 1;
+
+		return proxy;
+	}
+
+	void Broadphase::remove(ui32 proxy)
+	{
+		assert(proxy < _proxies.size() && !_proxies[proxy].isRemoved);
+
+		// its endpoints are sorted past every other one by the next update, separating the box from all others, then dropped
+		_proxies[proxy].isRemoved = true;
+		_removedProxies.push_back(proxy);
+	}
+
+	void Broadphase::move(ui32 proxy, const AABB& aabb)
+	{
+		assert(proxy < _proxies.size() && !_proxies[proxy].isRemoved);
+
+		_proxies[proxy].minimum = aabb.minimum;
+		_proxies[proxy].maximum = aabb.maximum;
+	}
+
+	void Broadphase::update()
+	{
+		_addedPairs.clear();
+		_removedPairs.clear();
+		_swapCount = 0;
+
+		// inserting many boxes one by one costs a swap per box they pass over
+		const ui32 proxyCount = (ui32)_endpoints[0].size() / 2;
+		if (_insertedProxyCount > 64 && _insertedProxyCount * 4 > proxyCount)
+		{
+			rebuild();
+		}
+		else
+		{
+			for (ui32 axis = 0; axis < 3; ++axis)
+			{
+				updateEndpoints(axis);
+				sortAxis(axis);
+			}
+		}
+
+		// the endpoints of removed boxes are now the last ones
+		for (ui32 axis = 0; axis < 3; ++axis)
+		{
+			_endpoints[axis].resize(_endpoints[axis].size() - _removedProxies.size() * 2);
+		}
+		for (ui32 proxy : _removedProxies)
+		{
+			_freeProxies.push_back(proxy);
+		}
+		_removedProxies.clear();
+		_insertedProxyCount = 0;
+	}
+
+	void Broadphase::clear()
+	{
+		_proxies.clear();
+		_freeProxies.clear();
+		_removedProxies.clear();
+		_endpoints[0].clear();
+		_endpoints[1].clear();
+		_endpoints[2].clear();
+		_pairs.clear();
+		_addedPairs.clear();
+		_removedPairs.clear();
+		_insertedProxyCount = 0;
+		_swapCount = 0;
+	}
+
+	const std::vector<OverlapPair>& Broadphase::getAddedPairs() const
+	{
+		return _addedPairs;
+	}
+
+	const std::vector<OverlapPair>& Broadphase::getRemovedPairs() const
+	{
+		return _removedPairs;
+	}
+
+	void Broadphase::getPairs(std::vector<OverlapPair>& pairs) const
+	{
+		for (ui64 key : _pairs)
+		{
+			pairs.push_back(OverlapPair{_proxies[(ui32)(key >> 32)].userData, _proxies[(ui32)key].userData});
+		}
+	}
+
+	ui32 Broadphase::getProxyCount() const
+	{
+		return (ui32)(_proxies.size() - _freeProxies.size() - _removedProxies.size());
+	}
+
+	ui32 Broadphase::getPairCount() const
+	{
+		return (ui32)_pairs.size();
+	}
+
+	ui64 Broadphase::getSwapCount() const
+	{
+		return _swapCount;
+	}
+
+	// endpoints are not tracked through the swaps, their values are read back from the boxes once per update instead
+	void Broadphase::updateEndpoints(ui32 axis)
+	{
+		for (Endpoint& endpoint : _endpoints[axis])
+		{
+			const Proxy& proxy = _proxies[endpoint.data >> 1];
+			endpoint.value = (endpoint.data & 1) != 0 ? getComponent(proxy.maximum, axis) : getComponent(proxy.minimum, axis);
+			endpoint.isRemoved = proxy.isRemoved;
+		}
+	}
+
+	// insertion sort, every swap of two endpoints is a change of the order of two boxes along the axis.
+	// the boxes already have their new bounds, so a pair is only added if it overlaps at the end of the update,
+	// and each pair out of order is swapped exactly once
+	void Broadphase::sortAxis(ui32 axis)
+	{
+		std::vector<Endpoint>& endpoints = _endpoints[axis];
+		for (ui32 index = 1; index < endpoints.size(); ++index)
+		{
+			const Endpoint endpoint = endpoints[index];
+			const ui32 proxy = endpoint.data >> 1;
+			const b8 isMaximum = (endpoint.data & 1) != 0;
+
+			ui32 position = index;
+			while (position > 0 && isBefore(endpoint, endpoints[position - 1]))
+			{
+				const Endpoint& previous = endpoints[position - 1];
+				const ui32 previousProxy = previous.data >> 1;
+				const b8 isPreviousMaximum = (previous.data & 1) != 0;
+
+				if (!isMaximum && isPreviousMaximum)
+				{
+					// the box starts before the end of the other one along this axis
+					if (areOverlapping(proxy, previousProxy))
+					{
+						addPair(proxy, previousProxy);
+					}
+				}
+				else if (isMaximum && !isPreviousMaximum)
+				{
+					// the box now ends before the start of the other one
+					removePair(proxy, previousProxy);
+				}
+
+				endpoints[position] = previous;
+				position -= 1;
+			}
+
+			if (position != index)
+			{
+				endpoints[position] = endpoint;
+				_swapCount += index - position;
+			}
+		}
+	}
+
+	// sorts every axis from scratch and finds the pairs with a sweep along the first axis
+	void Broadphase::rebuild()
+	{
+		for (ui32 axis = 0; axis < 3; ++axis)
+		{
+			updateEndpoints(axis);
+			std::sort(_endpoints[axis].begin(), _endpoints[axis].end(), isBefore);
+		}
+
+		std::unordered_set<ui64> previousPairs;
+		previousPairs.swap(_pairs);
+
+		// boxes whose minimum was passed but not their maximum
+		std::vector<ui32> activeProxies;
+		for (const Endpoint& endpoint : _endpoints[0])
+		{
+			const ui32 proxy = endpoint.data >> 1;
+			if (_proxies[proxy].isRemoved)
+			{
+				continue;
+			}
+
+			if ((endpoint.data & 1) == 0)
+			{
+				for (ui32 activeProxy : activeProxies)
+				{
+					if (areOverlapping(proxy, activeProxy))
+					{
+						_pairs.insert(getPairKey(proxy, activeProxy));
+					}
+				}
+				activeProxies.push_back(proxy);
+			}
+			else
+			{
+				*std::find(activeProxies.begin(), activeProxies.end(), proxy) = activeProxies.back();
+				activeProxies.pop_back();
+			}
+		}
+
+		for (ui64 key : _pairs)
+		{
+			if (previousPairs.count(key) == 0)
+			{
+				_addedPairs.push_back(OverlapPair{_proxies[(ui32)(key >> 32)].userData, _proxies[(ui32)key].userData});
+			}
+		}
+		for (ui64 key : previousPairs)
+		{
+			if (_pairs.count(key) == 0)
+			{
+				_removedPairs.push_back(OverlapPair{_proxies[(ui32)(key >> 32)].userData, _proxies[(ui32)key].userData});
+			}
+		}
+	}
+
+	void Broadphase::addPair(ui32 proxyA, ui32 proxyB)
+	{
+		if (_pairs.insert(getPairKey(proxyA, proxyB)).second)
+		{
+			_addedPairs.push_back(OverlapPair{_proxies[proxyA].userData, _proxies[proxyB].userData});
+		}
+	}
+
+	void Broadphase::removePair(ui32 proxyA, ui32 proxyB)
+	{
+		if (_pairs.erase(getPairKey(proxyA, proxyB)) > 0)
+		{
+			_removedPairs.push_back(OverlapPair{_proxies[proxyA].userData, _proxies[proxyB].userData});
+		}
+	}
+
+	b8 Broadphase::areOverlapping(ui32 proxyA, ui32 proxyB) const
+	{
+		const Proxy& a = _proxies[proxyA];
+		const Proxy& b = _proxies[proxyB];
+
+		return a.minimum.x <= b.maximum.x && b.minimum.x <= a.maximum.x
+			&& a.minimum.y <= b.maximum.y && b.minimum.y <= a.maximum.y
+			&& a.minimum.z <= b.maximum.z && b.minimum.z <= a.maximum.z
+			&& !a.isRemoved && !b.isRemoved;
+	}
+
+	// minimums go first on ties, so touching boxes overlap.
+	// removed boxes go after all the others whatever their bounds, ordered by proxy so they stop overlapping each other too
+	b8 Broadphase::isBefore(const Endpoint& endpointA, const Endpoint& endpointB)
+	{
+		if (endpointA.isRemoved || endpointB.isRemoved)
+		{
+			return endpointA.isRemoved == endpointB.isRemoved ? endpointA.data < endpointB.data : endpointB.isRemoved;
+		}
+
+		if (endpointA.value != endpointB.value)
+		{
+			return endpointA.value < endpointB.value;
+		}
+
+		return (endpointA.data & 1) < (endpointB.data & 1);
+	}
+
+	ui64 Broadphase::getPairKey(ui32 proxyA, ui32 proxyB)
+	{
+		return proxyA < proxyB ? ((ui64)proxyA << 32) | proxyB : ((ui64)proxyB << 32) | proxyA;
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "types.h"
+#include "maths.h"
+#include "AABB.h"
+
+#include <unordered_set>
+#include <vector>
+
+namespace Visor
+{
+	struct OverlapPair
+	{
+	public:
+		ui32 userDataA;
+		ui32 userDataB;
+	};
+
+	/*
+	overlapping pairs among a set of boxes, by sort and sweep : the two endpoints of every box are kept sorted along each axis
+	between updates, so sorting them again only costs a swap for each endpoint passing another one.
+	two boxes start overlapping when a minimum endpoint of one crosses a maximum endpoint of the other, which is when the
+	other axes are checked, and stop overlapping when a maximum crosses a minimum.
+	insert, remove and move are applied by the following update, which reports the pairs which started and stopped overlapping
+	*/
+	class Broadphase
+	{
+	public:
+		static const ui32 NullProxy = 0xFFFFFFFF;
+
+		Broadphase();
+
+		// returns the proxy of the box, valid until it is removed
+		ui32 insert(const AABB& aabb, ui32 userData);
+		// the pairs of the proxy are reported as removed by the next update
+		void remove(ui32 proxy);
+		void move(ui32 proxy, const AABB& aabb);
+		void update();
+		void clear();
+
+		// pairs of the last update, touching boxes overlap
+		const std::vector<OverlapPair>& getAddedPairs() const;
+		const std::vector<OverlapPair>& getRemovedPairs() const;
+		void getPairs(std::vector<OverlapPair>& pairs) const;
+
+		ui32 getProxyCount() const;
+		ui32 getPairCount() const;
+		// endpoint swaps of the last update. every box projects onto each axis among all the others, so it grows with the
+		// distance moved times the boxes per unit of axis : 36 swaps per box for the 100k boxes of the broadphase benchmark
+		ui64 getSwapCount() const;
+
+	private:
+		struct Proxy
+		{
+		public:
+			Vector3<f32> minimum;
+			Vector3<f32> maximum;
+			ui32 userData;
+			b8 isRemoved;
+		};
+
+		struct Endpoint
+		{
+		public:
+			f32 value;
+			// proxy << 1, lowest bit set for maximums
+			ui32 data;
+			// copied from the proxy by the update, these endpoints sort after all the others
+			b8 isRemoved;
+		};
+
+	private:
+		void updateEndpoints(ui32 axis);
+		void sortAxis(ui32 axis);
+		void rebuild();
+		void addPair(ui32 proxyA, ui32 proxyB);
+		void removePair(ui32 proxyA, ui32 proxyB);
+		b8 areOverlapping(ui32 proxyA, ui32 proxyB) const;
+		static b8 isBefore(const Endpoint& endpointA, const Endpoint& endpointB);
+		static ui64 getPairKey(ui32 proxyA, ui32 proxyB);
+
+	private:
+		std::vector<Proxy> _proxies;
+		std::vector<ui32> _freeProxies;
+		std::vector<ui32> _removedProxies;
+		std::vector<Endpoint> _endpoints[3];
+		std::unordered_set<ui64> _pairs;
+		std::vector<OverlapPair> _addedPairs;
+		std::vector<OverlapPair> _removedPairs;
+		// inserted since the last update, many of them are sorted from scratch rather than one by one
+		ui32 _insertedProxyCount;
+		ui64 _swapCount;
+	};
+}
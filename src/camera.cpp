@@ -6,7 +6,31 @@ namespace Visor
 	{
 		Vector3<f32> direction = position - this->position;
 		direction.normalize();
-		yaw = std::atan2(-direction.x, direction.z);
-		pitch = std::asin(direction.y);
+
+		f32 yaw = 0.0f;
+		f32 pitch = 0.0f;
+		f32 roll = 0.0f;
+		getAnglesFromDirection(direction, yaw, pitch, roll);
+		orientation = Quaternion<f32>::getFromAngles(yaw, pitch, roll);
+	}
+
+	void Camera::setTransformation(const Matrix4<f32>& transformationMatrix)
+	{
+		position.x = transformationMatrix.m[0][3];
+		position.y = transformationMatrix.m[1][3];
+		position.z = transformationMatrix.m[2][3];
+
+		// the columns are the rotated axes, scaled
+		Matrix3<f32> rotation = transformationMatrix.getUpperLeft();
+		for (ui32 column = 0; column < 3; ++column)
+		{
+			const Vector3<f32> axis = {rotation.m[0][column], rotation.m[1][column], rotation.m[2][column]};
+			const f32 scale = axis.getNorm();
+			rotation.m[0][column] /= scale;
+			rotation.m[1][column] /= scale;
+			rotation.m[2][column] /= scale;
+		}
+
+		orientation = Quaternion<f32>::getFromRotation(rotation);
 	}
-}
+}
\ No newline at end of file
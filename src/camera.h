@@ -9,12 +9,11 @@ namespace Visor
 	{
 	public:
 		void lookAt(const Vector3<f32>& position); // TODO: same as in entity
+		void setTransformation(const Matrix4<f32>& transformationMatrix); // places the camera like an entity, to follow one in the hierarchy
 
 	public:
 		f32 fov;
 		Vector3<f32> position;
-		f32 yaw;
-		f32 pitch;
-		f32 roll;
+		Quaternion<f32> orientation;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include "culling.h"
+#include "job_system.h"
+#include "mesh_registry.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define VSR_CULLING_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define VSR_CULLING_SSE
+#endif
+
+namespace Visor
+{
+	void BoundsArrays::resize(ui32 count)
+	{
+		centersX.resize(count);
+		centersY.resize(count);
+		centersZ.resize(count);
+		extentsX.resize(count);
+		extentsY.resize(count);
+		extentsZ.resize(count);
+	}
+
+	void BoundsArrays::setBox(ui32 index, const Vector3<f32>& minimum, const Vector3<f32>& maximum)
+	{
+		centersX[index] = (minimum.x + maximum.x) * 0.5f;
+		centersY[index] = (minimum.y + maximum.y) * 0.5f;
+		centersZ[index] = (minimum.z + maximum.z) * 0.5f;
+		extentsX[index] = (maximum.x - minimum.x) * 0.5f;
+		extentsY[index] = (maximum.y - minimum.y) * 0.5f;
+		extentsZ[index] = (maximum.z - minimum.z) * 0.5f;
+	}
+
+	ui32 BoundsArrays::getCount() const
+	{
+		return (ui32)centersX.size();
+	}
+
+	void cullBoxes(const Frustum& frustum, const BoundsArrays& bounds, ui32 begin, ui32 end, ui8* pVisibilities)
+	{
+		// a box is outside a plane when its center is further behind it than its projected radius :
+		// n.c + d + |n|.e < 0
+		const f32* pCentersX = bounds.centersX.data();
+		const f32* pCentersY = bounds.centersY.data();
+		const f32* pCentersZ = bounds.centersZ.data();
+		const f32* pExtentsX = bounds.extentsX.data();
+		const f32* pExtentsY = bounds.extentsY.data();
+		const f32* pExtentsZ = bounds.extentsZ.data();
+
+		ui32 boxIndex = begin;
+
+		#if defined(VSR_CULLING_AVX)
+			// eight boxes at once
+			__m256 normalsX[6], normalsY[6], normalsZ[6], distances[6], absoluteNormalsX[6], absoluteNormalsY[6], absoluteNormalsZ[6];
+			for (ui32 planeIndex = 0; planeIndex < 6; ++planeIndex)
+			{
+				const Plane& plane = frustum.planes[planeIndex];
+				normalsX[planeIndex] = _mm256_set1_ps(plane.normal.x);
+				normalsY[planeIndex] = _mm256_set1_ps(plane.normal.y);
+				normalsZ[planeIndex] = _mm256_set1_ps(plane.normal.z);
+				distances[planeIndex] = _mm256_set1_ps(plane.distance);
+				absoluteNormalsX[planeIndex] = _mm256_set1_ps(std::abs(plane.normal.x));
+				absoluteNormalsY[planeIndex] = _mm256_set1_ps(std::abs(plane.normal.y));
+				absoluteNormalsZ[planeIndex] = _mm256_set1_ps(std::abs(plane.normal.z));
+			}
+
+			const __m256 zero = _mm256_setzero_ps();
+			for (; boxIndex + 8 <= end; boxIndex += 8)
+			{
+				const __m256 centerX = _mm256_loadu_ps(pCentersX + boxIndex);
+				const __m256 centerY = _mm256_loadu_ps(pCentersY + boxIndex);
+				const __m256 centerZ = _mm256_loadu_ps(pCentersZ + boxIndex);
+				const __m256 extentX = _mm256_loadu_ps(pExtentsX + boxIndex);
+				const __m256 extentY = _mm256_loadu_ps(pExtentsY + boxIndex);
+				const __m256 extentZ = _mm256_loadu_ps(pExtentsZ + boxIndex);
+
+				__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+				for (ui32 planeIndex = 0; planeIndex < 6; ++planeIndex)
+				{
+					__m256 distance = _mm256_add_ps(_mm256_mul_ps(centerX, normalsX[planeIndex]), distances[planeIndex]);
+					distance = _mm256_add_ps(distance, _mm256_mul_ps(centerY, normalsY[planeIndex]));
+					distance = _mm256_add_ps(distance, _mm256_mul_ps(centerZ, normalsZ[planeIndex]));
+					distance = _mm256_add_ps(distance, _mm256_mul_ps(extentX, absoluteNormalsX[planeIndex]));
+					distance = _mm256_add_ps(distance, _mm256_mul_ps(extentY, absoluteNormalsY[planeIndex]));
+					distance = _mm256_add_ps(distance, _mm256_mul_ps(extentZ, absoluteNormalsZ[planeIndex]));
+					inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+				}
+
+				const i32 mask = _mm256_movemask_ps(inside);
+				for (ui32 lane = 0; lane < 8; ++lane)
+				{
+					pVisibilities[boxIndex + lane] = (ui8)((mask >> lane) & 1);
+				}
+			}
+		#elif defined(VSR_CULLING_SSE)
+			// four boxes at once
+			__m128 normalsX[6], normalsY[6], normalsZ[6], distances[6], absoluteNormalsX[6], absoluteNormalsY[6], absoluteNormalsZ[6];
+			for (ui32 planeIndex = 0; planeIndex < 6; ++planeIndex)
+			{
+				const Plane& plane = frustum.planes[planeIndex];
+				normalsX[planeIndex] = _mm_set1_ps(plane.normal.x);
+				normalsY[planeIndex] = _mm_set1_ps(plane.normal.y);
+				normalsZ[planeIndex] = _mm_set1_ps(plane.normal.z);
+				distances[planeIndex] = _mm_set1_ps(plane.distance);
+				absoluteNormalsX[planeIndex] = _mm_set1_ps(std::abs(plane.normal.x));
+				absoluteNormalsY[planeIndex] = _mm_set1_ps(std::abs(plane.normal.y));
+				absoluteNormalsZ[planeIndex] = _mm_set1_ps(std::abs(plane.normal.z));
+			}
+
+			const __m128 zero = _mm_setzero_ps();
+			for (; boxIndex + 4 <= end; boxIndex += 4)
+			{
+				const __m128 centerX = _mm_loadu_ps(pCentersX + boxIndex);
+				const __m128 centerY = _mm_loadu_ps(pCentersY + boxIndex);
+				const __m128 centerZ = _mm_loadu_ps(pCentersZ + boxIndex);
+				const __m128 extentX = _mm_loadu_ps(pExtentsX + boxIndex);
+				const __m128 extentY = _mm_loadu_ps(pExtentsY + boxIndex);
+				const __m128 extentZ = _mm_loadu_ps(pExtentsZ + boxIndex);
+
+				__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (ui32 planeIndex = 0; planeIndex < 6; ++planeIndex)
+				{
+					__m128 distance = _mm_add_ps(_mm_mul_ps(centerX, normalsX[planeIndex]), distances[planeIndex]);
+					distance = _mm_add_ps(distance, _mm_mul_ps(centerY, normalsY[planeIndex]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(centerZ, normalsZ[planeIndex]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(extentX, absoluteNormalsX[planeIndex]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(extentY, absoluteNormalsY[planeIndex]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(extentZ, absoluteNormalsZ[planeIndex]));
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+				}
+
+				const i32 mask = _mm_movemask_ps(inside);
+				for (ui32 lane = 0; lane < 4; ++lane)
+				{
+					pVisibilities[boxIndex + lane] = (ui8)((mask >> lane) & 1);
+				}
+			}
+		#endif
+
+		// remaining boxes, or all of them without SIMD
+		for (; boxIndex < end; ++boxIndex)
+		{
+			ui8 inside = 1;
+			for (ui32 planeIndex = 0; planeIndex < 6; ++planeIndex)
+			{
+				const Plane& plane = frustum.planes[planeIndex];
+				const f32 distance = 
+					pCentersX[boxIndex] * plane.normal.x + plane.distance + 
+					pCentersY[boxIndex] * plane.normal.y + 
+					pCentersZ[boxIndex] * plane.normal.z + 
+					pExtentsX[boxIndex] * std::abs(plane.normal.x) + 
+					pExtentsY[boxIndex] * std::abs(plane.normal.y) + 
+					pExtentsZ[boxIndex] * std::abs(plane.normal.z);
+				if (distance < 0.0f)
+				{
+					inside = 0;
+				}
+			}
+			pVisibilities[boxIndex] = inside;
+		}
+	}
+
+	void computeWorldBounds(const EntityStore& entities, BoundsArrays& bounds)
+	{
+		const ui32 entityCount = entities.getEntityCount();
+		bounds.resize(entityCount);
+
+		const std::vector<MeshHandle>& meshHandles = entities.getMeshHandles();
+		const std::vector<Matrix4<f32>>& transformationMatrices = entities.getTransformationMatrices();
+
+		JobSystem::getInstance().parallelFor(entityCount, 4096, [&bounds, &meshHandles, &transformationMatrices](ui32 begin, ui32 end)
+		{
+			const MeshRegistry& meshRegistry = MeshRegistry::getInstance();
+
+			for (ui32 entityIndex = begin; entityIndex < end; ++entityIndex)
+			{
+				const MeshHandle meshHandle = meshHandles[entityIndex];
+				if (meshHandle == NullMeshHandle)
+				{
+					// no geometry, users of the bounds skip entities without mesh
+					bounds.setBox(entityIndex, Vector3<f32>{0.0f, 0.0f, 0.0f}, Vector3<f32>{0.0f, 0.0f, 0.0f});
+					continue;
+				}
+
+				const AABB worldAABB = meshRegistry.getAABB(meshHandle).getTransformed(transformationMatrices[entityIndex]);
+				bounds.setBox(entityIndex, worldAABB.minimum, worldAABB.maximum);
+			}
+		});
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "types.h"
+#include "maths.h"
+#include "frustum.h"
+#include "entity.h"
+
+#include <vector>
+
+namespace Visor
+{
+	// boxes as center and half extent, one array per coordinate so several boxes are tested at once
+	struct BoundsArrays
+	{
+	public:
+		void resize(ui32 count);
+		void setBox(ui32 index, const Vector3<f32>& minimum, const Vector3<f32>& maximum);
+		ui32 getCount() const;
+
+	public:
+		std::vector<f32> centersX;
+		std::vector<f32> centersY;
+		std::vector<f32> centersZ;
+		std::vector<f32> extentsX;
+		std::vector<f32> extentsY;
+		std::vector<f32> extentsZ;
+	};
+
+	struct CullingStatistics
+	{
+	public:
+		ui32 entityCount;
+		ui32 frustumCulledEntityCount;
+		ui32 occlusionCulledEntityCount;
+		ui32 occluderCount;
+		ui32 occluderTriangleCount;
+	};
+
+	// world boxes of every entity in dense order, from their mesh bounds (or the placeholder cube while loading).
+	// entities without mesh get an empty box at the origin
+	void computeWorldBounds(const EntityStore& entities, BoundsArrays& bounds);
+
+	// visibilities[i] is 1 when box i touches the frustum, 0 when it is entirely outside one of its planes.
+	// boxes in [begin, end) only, so the work can be split
+	void cullBoxes(const Frustum& frustum, const BoundsArrays& bounds, ui32 begin, ui32 end, ui8* pVisibilities);
+}
@@ -0,0 +1,165 @@
+#include "draw_list.h"
+#include "asset_system.h"
+#include "frustum.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Visor
+{
+	static void addTransformSlot(ui32 slot, std::vector<TransformRange>& ranges)
+	{
+		// slots come sorted, neighbours are coalesced into a single copy
+		if (!ranges.empty() && ranges.back().first + ranges.back().count == slot)
+		{
+			ranges.back().count += 1;
+		}
+		else
+		{
+			ranges.push_back(TransformRange{slot, 1});
+		}
+	}
+
+	DrawList::DrawList()
+		: _entityCount(0)
+		, _meshletCullingStatistics()
+	{
+	}
+
+	void DrawList::create(const FramePacket& packet, const Matrix4<f32>& viewProjectionMatrix, const ResidencyFunction& getResidency)
+	{
+		_draws.clear();
+		_indexRanges.clear();
+		_placeholderTransformationMatrices.clear();
+		_meshletCullingStatistics = {};
+		_entityCount = (ui32)packet.transformationMatrices.size();
+
+		const MeshRegistry& meshRegistry = MeshRegistry::getInstance();
+		const MeshHandle placeholderMesh = AssetSystem::getInstance().getPlaceholderMesh();
+		ui32 placeholderIndexCount = 0;
+		b8 isPlaceholderCurrent = false;
+		const b8 isPlaceholderResident = placeholderMesh != NullMeshHandle && getResidency(placeholderMesh, placeholderIndexCount, isPlaceholderCurrent);
+
+		for (ui32 entityIndex : packet.visibleEntityIndices)
+		{
+			const MeshHandle meshHandle = packet.meshHandles[entityIndex];
+			const Matrix4<f32>& transformationMatrix = packet.transformationMatrices[entityIndex];
+
+			if (meshHandle == NullMeshHandle)
+			{
+				continue;
+			}
+
+			Draw draw = {};
+			draw.mesh = meshHandle;
+			draw.transformIndex = entityIndex;
+			draw.firstIndexRange = (ui32)_indexRanges.size();
+
+			ui32 indexCount = 0;
+			b8 isCurrentRevision = false;
+			if (getResidency(meshHandle, indexCount, isCurrentRevision))
+			{
+				const Mesh& mesh = meshRegistry.getMesh(meshHandle);
+
+				// a previous revision is drawn whole, and a mesh flattened by a zero scale has no local space to cull meshlets in
+				Matrix3<f32> inverseUpperLeft;
+				if (mesh.getMeshlets().empty() || !isCurrentRevision || !transformationMatrix.getUpperLeft().getInverse(inverseUpperLeft))
+				{
+					_indexRanges.push_back(IndexRange{0, indexCount});
+				}
+				else
+				{
+					// meshlets are culled in the local space of the mesh : the frustum comes from the model view projection
+					// and the camera is brought back through the inverse of the world matrix
+					const Frustum localFrustum = Frustum::fromMatrix(viewProjectionMatrix * transformationMatrix);
+					const Vector3<f32> translation = {transformationMatrix.m[0][3], transformationMatrix.m[1][3], transformationMatrix.m[2][3]};
+					const Vector3<f32> localCameraPosition = inverseUpperLeft * (packet.camera.position - translation);
+
+					cullMeshlets(mesh.getMeshlets(), localFrustum, localCameraPosition, _indexRanges, _meshletCullingStatistics);
+				}
+			}
+			else if (isPlaceholderResident)
+			{
+				// the unit cube with the matrix of the entity until the bounds are known
+				if (meshRegistry.isLoaded(meshHandle))
+				{
+					const AABB& meshAABB = meshRegistry.getAABB(meshHandle);
+					const Vector3<f32> extent = meshAABB.maximum - meshAABB.minimum;
+
+					draw.transformIndex = _entityCount + (ui32)_placeholderTransformationMatrices.size();
+					_placeholderTransformationMatrices.push_back(transformationMatrix *
+						Matrix4<f32>::getTranslation((meshAABB.minimum + meshAABB.maximum) * 0.5f) *
+						Matrix4<f32>::getScaling(std::max(extent.x, 0.01f), std::max(extent.y, 0.01f), std::max(extent.z, 0.01f)));
+				}
+
+				draw.mesh = placeholderMesh;
+				_indexRanges.push_back(IndexRange{0, placeholderIndexCount});
+			}
+			else
+			{
+				continue;
+			}
+
+			draw.indexRangeCount = (ui32)_indexRanges.size() - draw.firstIndexRange;
+			_draws.push_back(draw);
+		}
+	}
+
+	ui32 DrawList::getTransformCount() const
+	{
+		return _entityCount + (ui32)_placeholderTransformationMatrices.size();
+	}
+
+	void DrawList::stageTransforms(const FramePacket& packet, b8 uploadAll, ui8* pStagingData, ui32 stride, std::vector<TransformRange>& ranges) const
+	{
+		ranges.clear();
+
+		// only the entities moved since the previous frame (or attached to one) get a new matrix,
+		// culled ones included so the buffer stays in sync when they come back into view
+		const std::vector<Matrix4<f32>>& transformationMatrices = packet.transformationMatrices;
+		const std::vector<ui32>& updatedTransformIndices = packet.updatedIndices;
+
+		const ui32 updatedTransformCount = uploadAll ? _entityCount : (ui32)updatedTransformIndices.size();
+		for (ui32 updatedIndex = 0; updatedIndex < updatedTransformCount; ++updatedIndex)
+		{
+			const ui32 transformIndex = uploadAll ? updatedIndex : updatedTransformIndices[updatedIndex];
+			const Matrix3x4<f32> transform = Matrix3x4<f32>::getFromMatrix4(transformationMatrices[transformIndex]);
+			std::memcpy(pStagingData + transformIndex * stride, &transform, sizeof(Matrix3x4<f32>));
+			addTransformSlot(transformIndex, ranges);
+		}
+
+		// placeholder slots are rewritten every frame, the draws using them change
+		for (ui32 placeholderIndex = 0; placeholderIndex < _placeholderTransformationMatrices.size(); ++placeholderIndex)
+		{
+			const ui32 transformIndex = _entityCount + placeholderIndex;
+			const Matrix3x4<f32> transform = Matrix3x4<f32>::getFromMatrix4(_placeholderTransformationMatrices[placeholderIndex]);
+			std::memcpy(pStagingData + transformIndex * stride, &transform, sizeof(Matrix3x4<f32>));
+			addTransformSlot(transformIndex, ranges);
+		}
+	}
+
+	const std::vector<DrawList::Draw>& DrawList::getDraws() const
+	{
+		return _draws;
+	}
+
+	const Matrix4<f32>& DrawList::getTransformationMatrix(const FramePacket& packet, const Draw& draw) const
+	{
+		if (draw.transformIndex < _entityCount)
+		{
+			return packet.transformationMatrices[draw.transformIndex];
+		}
+
+		return _placeholderTransformationMatrices[draw.transformIndex - _entityCount];
+	}
+
+	const std::vector<IndexRange>& DrawList::getIndexRanges() const
+	{
+		return _indexRanges;
+	}
+
+	const MeshletCullingStatistics& DrawList::getMeshletCullingStatistics() const
+	{
+		return _meshletCullingStatistics;
+	}
+}
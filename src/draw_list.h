@@ -0,0 +1,83 @@
+#pragma once
+
+#include "types.h"
+#include "frame_packet.h"
+#include "maths.h"
+#include "meshlet.h"
+#include "mesh_registry.h"
+
+#include <functional>
+#include <vector>
+
+namespace Visor
+{
+	// geometry copied to the device per frame at most, so a big mesh never stalls a frame
+	static const ui32 MeshUploadBudget = 4 * 1024 * 1024;
+
+	// what the last frame would have sent to the gpu
+	struct DrawStatistics
+	{
+	public:
+		// one per index range, as the vulkan backend records them
+		ui32 drawCount;
+		ui32 triangleCount;
+		// uniforms, transforms and mesh geometry copied to the device
+		ui64 uploadedByteCount;
+	};
+
+	// slots first to first + count - 1 of the transform buffer
+	struct TransformRange
+	{
+	public:
+		ui32 first;
+		ui32 count;
+	};
+
+	/*
+	the draws of a frame shared by the backends : a draw per visible entity with its meshlets culled, and for the gpu
+	backends (vulkan and null) the 3x4 rows of the transforms to copy to the transform buffer.
+	the placeholder cube stands in for the meshes the backend cannot draw yet, scaled to their bounds once they are loaded.
+	those scaled cubes get transforms of their own, in the slots past the entities
+	*/
+	class DrawList
+	{
+	public:
+		struct Draw
+		{
+		public:
+			// the placeholder for a mesh which is not resident
+			MeshHandle mesh;
+			// slot in the transform buffer
+			ui32 transformIndex;
+			// in getIndexRanges
+			ui32 firstIndexRange;
+			ui32 indexRangeCount;
+		};
+
+		// whether the backend can draw the geometry of a mesh, and its index count. while a hot reloaded revision streams in,
+		// the previous one is drawn and isCurrentRevision is false : the meshlets of the mesh describe the new one
+		typedef std::function<b8(MeshHandle mesh, ui32& indexCount, b8& isCurrentRevision)> ResidencyFunction;
+
+		DrawList();
+
+		void create(const FramePacket& packet, const Matrix4<f32>& viewProjectionMatrix, const ResidencyFunction& getResidency);
+		// slots the transform buffer needs, entities then placeholders
+		ui32 getTransformCount() const;
+		// writes the rows of the transforms to copy at slot * stride of the staging data : the updated entities of the packet,
+		// all of them when uploadAll, then the placeholders. the slots written are coalesced into ranges
+		void stageTransforms(const FramePacket& packet, b8 uploadAll, ui8* pStagingData, ui32 stride, std::vector<TransformRange>& ranges) const;
+
+		const std::vector<Draw>& getDraws() const;
+		// the world matrix of a draw, the one of its entity or of its scaled placeholder
+		const Matrix4<f32>& getTransformationMatrix(const FramePacket& packet, const Draw& draw) const;
+		const std::vector<IndexRange>& getIndexRanges() const;
+		const MeshletCullingStatistics& getMeshletCullingStatistics() const;
+
+	private:
+		std::vector<Draw> _draws;
+		std::vector<IndexRange> _indexRanges;
+		ui32 _entityCount;
+		std::vector<Matrix4<f32>> _placeholderTransformationMatrices;
+		MeshletCullingStatistics _meshletCullingStatistics;
+	};
+}
@@ -1,20 +1,623 @@
 #include "entity.h"
 
+#include <cassert>
+#include <algorithm>
+
 namespace Visor
 {
-	Entity::Entity(const Vector3<f32>& position, f32 scaleX, f32 scaleY, f32 scaleZ, f32 yaw, f32 pitch, f32 roll, const Mesh& mesh)
-		: position(position)
-		, scaleX(scaleX)
-		, scaleY(scaleY)
-		, scaleZ(scaleZ)
-		, yaw(yaw)
-		, pitch(pitch)
-		, roll(roll)
-		, _mesh(mesh)
-	{}
-
-	const Mesh& Entity::getMesh() const
-	{
-		return _mesh;
-	}
-}
\ No newline at end of file
+	static const ui32 InvalidIndex = 0xFFFFFFFF;
+
+	b8 EntityId::operator==(const EntityId& id) const
+	{
+		return index == id.index && generation == id.generation;
+	}
+
+	b8 EntityId::operator!=(const EntityId& id) const
+	{
+		return !(*this == id);
+	}
+
+	EntityStore::EntityStore()
+		: _hierarchyChanged(false)
+		, _childEntityCount(0)
+	{
+	}
+
+	EntityStore::~EntityStore()
+	{
+		clear();
+	}
+
+	EntityId EntityStore::createEntity(const Vector3<f32>& position, f32 scaleX, f32 scaleY, f32 scaleZ, f32 yaw, f32 pitch, f32 roll, MeshHandle mesh)
+	{
+		ui32 slotIndex = 0;
+		if (!_freeSlotIndices.empty())
+		{
+			slotIndex = _freeSlotIndices.back();
+			_freeSlotIndices.pop_back();
+		}
+		else
+		{
+			slotIndex = (ui32)_denseIndices.size();
+			_denseIndices.push_back(0);
+			_generations.push_back(0);
+			_childCounts.push_back(0);
+			_hierarchyPositions.push_back(InvalidIndex);
+		}
+
+		_denseIndices[slotIndex] = (ui32)_slotIndices.size();
+		_slotIndices.push_back(slotIndex);
+
+		_transforms.positionsX.push_back(position.x);
+		_transforms.positionsY.push_back(position.y);
+		_transforms.positionsZ.push_back(position.z);
+		const Quaternion<f32> orientation = Quaternion<f32>::getFromAngles(yaw, pitch, roll);
+		_transforms.orientationsX.push_back(orientation.x);
+		_transforms.orientationsY.push_back(orientation.y);
+		_transforms.orientationsZ.push_back(orientation.z);
+		_transforms.orientationsW.push_back(orientation.w);
+		_transforms.scalesX.push_back(scaleX);
+		_transforms.scalesY.push_back(scaleY);
+		_transforms.scalesZ.push_back(scaleZ);
+
+		if (mesh != NullMeshHandle)
+		{
+			MeshRegistry::getInstance().retain(mesh);
+		}
+		_meshHandles.push_back(mesh);
+		_occluderFlags.push_back(0);
+
+		_parentSlotIndices.push_back(InvalidIndex);
+		_localTransformationMatrices.push_back(Matrix4<f32>::getIdentity());
+		_transformationMatrices.push_back(Matrix4<f32>::getIdentity());
+		_dirtyFlags.push_back(0);
+		_movedFlags.push_back(0);
+		markDirty((ui32)_slotIndices.size() - 1);
+
+		return EntityId{slotIndex, _generations[slotIndex]};
+	}
+
+	void EntityStore::destroyEntity(EntityId id)
+	{
+		assert(isValid(id));
+
+		if (hasParent(id))
+		{
+			removeParent(id);
+		}
+
+		// children are referenced by slot, only the destroyed entity's ones need a look
+		if (_childCounts[id.index] > 0)
+		{
+			for (ui32 childIndex = 0; childIndex < _parentSlotIndices.size(); ++childIndex)
+			{
+				if (_parentSlotIndices[childIndex] == id.index)
+				{
+					removeParent(getId(childIndex));
+				}
+			}
+		}
+
+		const ui32 index = _denseIndices[id.index];
+		const ui32 lastIndex = (ui32)_slotIndices.size() - 1;
+
+		if (_meshHandles[index] != NullMeshHandle)
+		{
+			MeshRegistry::getInstance().release(_meshHandles[index]);
+		}
+
+		// the last entity fills the hole, keeping the arrays packed
+		_transforms.positionsX[index] = _transforms.positionsX[lastIndex];
+		_transforms.positionsY[index] = _transforms.positionsY[lastIndex];
+		_transforms.positionsZ[index] = _transforms.positionsZ[lastIndex];
+		_transforms.orientationsX[index] = _transforms.orientationsX[lastIndex];
+		_transforms.orientationsY[index] = _transforms.orientationsY[lastIndex];
+		_transforms.orientationsZ[index] = _transforms.orientationsZ[lastIndex];
+		_transforms.orientationsW[index] = _transforms.orientationsW[lastIndex];
+		_transforms.scalesX[index] = _transforms.scalesX[lastIndex];
+		_transforms.scalesY[index] = _transforms.scalesY[lastIndex];
+		_transforms.scalesZ[index] = _transforms.scalesZ[lastIndex];
+		_meshHandles[index] = _meshHandles[lastIndex];
+		_occluderFlags[index] = _occluderFlags[lastIndex];
+		_slotIndices[index] = _slotIndices[lastIndex];
+		_denseIndices[_slotIndices[index]] = index;
+		_parentSlotIndices[index] = _parentSlotIndices[lastIndex];
+		_localTransformationMatrices[index] = _localTransformationMatrices[lastIndex];
+		_transformationMatrices[index] = _transformationMatrices[lastIndex];
+
+		// the moved entity is reported again, its matrix now lives at another index
+		_dirtyFlags[index] = 0;
+		_movedFlags[index] = 0;
+		if (index != lastIndex)
+		{
+			markDirty(index);
+		}
+
+		_transforms.positionsX.pop_back();
+		_transforms.positionsY.pop_back();
+		_transforms.positionsZ.pop_back();
+		_transforms.orientationsX.pop_back();
+		_transforms.orientationsY.pop_back();
+		_transforms.orientationsZ.pop_back();
+		_transforms.orientationsW.pop_back();
+		_transforms.scalesX.pop_back();
+		_transforms.scalesY.pop_back();
+		_transforms.scalesZ.pop_back();
+		_meshHandles.pop_back();
+		_occluderFlags.pop_back();
+		_slotIndices.pop_back();
+		_parentSlotIndices.pop_back();
+		_localTransformationMatrices.pop_back();
+		_transformationMatrices.pop_back();
+		_dirtyFlags.pop_back();
+		_movedFlags.pop_back();
+
+		_generations[id.index] += 1;
+		_freeSlotIndices.push_back(id.index);
+	}
+
+	void EntityStore::clear()
+	{
+		while (!_slotIndices.empty())
+		{
+			const ui32 slotIndex = _slotIndices.back();
+			destroyEntity(EntityId{slotIndex, _generations[slotIndex]});
+		}
+	}
+
+	b8 EntityStore::isValid(EntityId id) const
+	{
+		// destroying an entity bumps the generation of its slot, older ids no longer match.
+		// a free slot keeps its last dense index, only a live one is found back from there
+		if (id.index >= _generations.size() || _generations[id.index] != id.generation)
+		{
+			return false;
+		}
+
+		const ui32 index = _denseIndices[id.index];
+		return index < _slotIndices.size() && _slotIndices[index] == id.index;
+	}
+
+	ui32 EntityStore::getEntityCount() const
+	{
+		return (ui32)_slotIndices.size();
+	}
+
+	ui32 EntityStore::getIndex(EntityId id) const
+	{
+		assert(isValid(id));
+		return _denseIndices[id.index];
+	}
+
+	EntityId EntityStore::getId(ui32 index) const
+	{
+		assert(index < _slotIndices.size());
+		const ui32 slotIndex = _slotIndices[index];
+		return EntityId{slotIndex, _generations[slotIndex]};
+	}
+
+	Vector3<f32> EntityStore::getPosition(EntityId id) const
+	{
+		const ui32 index = getIndex(id);
+		return Vector3<f32>{_transforms.positionsX[index], _transforms.positionsY[index], _transforms.positionsZ[index]};
+	}
+
+	void EntityStore::setPosition(EntityId id, const Vector3<f32>& position)
+	{
+		const ui32 index = getIndex(id);
+		_transforms.positionsX[index] = position.x;
+		_transforms.positionsY[index] = position.y;
+		_transforms.positionsZ[index] = position.z;
+		markDirty(index);
+	}
+
+	void EntityStore::getRotation(EntityId id, f32& yaw, f32& pitch, f32& roll) const
+	{
+		getOrientation(id).getAngles(yaw, pitch, roll);
+	}
+
+	void EntityStore::setRotation(EntityId id, f32 yaw, f32 pitch, f32 roll)
+	{
+		setOrientation(id, Quaternion<f32>::getFromAngles(yaw, pitch, roll));
+	}
+
+	Quaternion<f32> EntityStore::getOrientation(EntityId id) const
+	{
+		const ui32 index = getIndex(id);
+		return Quaternion<f32>{_transforms.orientationsX[index], _transforms.orientationsY[index], _transforms.orientationsZ[index], _transforms.orientationsW[index]};
+	}
+
+	void EntityStore::setOrientation(EntityId id, const Quaternion<f32>& orientation)
+	{
+		const ui32 index = getIndex(id);
+		_transforms.orientationsX[index] = orientation.x;
+		_transforms.orientationsY[index] = orientation.y;
+		_transforms.orientationsZ[index] = orientation.z;
+		_transforms.orientationsW[index] = orientation.w;
+		markDirty(index);
+	}
+
+	void EntityStore::lookAt(const std::vector<EntityId>& ids, const Vector3<f32>& target)
+	{
+		const ui32 count = (ui32)ids.size();
+		_lookAtComponents.resize(count * 7);
+		f32* pPositionsX = _lookAtComponents.data();
+		f32* pPositionsY = pPositionsX + count;
+		f32* pPositionsZ = pPositionsY + count;
+		f32* pOrientationsX = pPositionsZ + count;
+		f32* pOrientationsY = pOrientationsX + count;
+		f32* pOrientationsZ = pOrientationsY + count;
+		f32* pOrientationsW = pOrientationsZ + count;
+
+		for (ui32 idIndex = 0; idIndex < count; ++idIndex)
+		{
+			const ui32 index = getIndex(ids[idIndex]);
+			pPositionsX[idIndex] = _transforms.positionsX[index];
+			pPositionsY[idIndex] = _transforms.positionsY[index];
+			pPositionsZ[idIndex] = _transforms.positionsZ[index];
+		}
+
+		computeLookAtOrientations(pPositionsX, pPositionsY, pPositionsZ, target, count, pOrientationsX, pOrientationsY, pOrientationsZ, pOrientationsW);
+
+		for (ui32 idIndex = 0; idIndex < count; ++idIndex)
+		{
+			const ui32 index = getIndex(ids[idIndex]);
+			_transforms.orientationsX[index] = pOrientationsX[idIndex];
+			_transforms.orientationsY[index] = pOrientationsY[idIndex];
+			_transforms.orientationsZ[index] = pOrientationsZ[idIndex];
+			_transforms.orientationsW[index] = pOrientationsW[idIndex];
+			markDirty(index);
+		}
+	}
+
+	Vector3<f32> EntityStore::getScale(EntityId id) const
+	{
+		const ui32 index = getIndex(id);
+		return Vector3<f32>{_transforms.scalesX[index], _transforms.scalesY[index], _transforms.scalesZ[index]};
+	}
+
+	void EntityStore::setScale(EntityId id, const Vector3<f32>& scale)
+	{
+		const ui32 index = getIndex(id);
+		_transforms.scalesX[index] = scale.x;
+		_transforms.scalesY[index] = scale.y;
+		_transforms.scalesZ[index] = scale.z;
+		markDirty(index);
+	}
+
+	MeshHandle EntityStore::getMeshHandle(EntityId id) const
+	{
+		return _meshHandles[getIndex(id)];
+	}
+
+	const Mesh& EntityStore::getMesh(EntityId id) const
+	{
+		return MeshRegistry::getInstance().getMesh(getMeshHandle(id));
+	}
+
+	void EntityStore::setOccluder(EntityId id, b8 occluder)
+	{
+		_occluderFlags[getIndex(id)] = occluder ? 1 : 0;
+	}
+
+	b8 EntityStore::isOccluder(EntityId id) const
+	{
+		return _occluderFlags[getIndex(id)] != 0;
+	}
+
+	void EntityStore::setParent(EntityId id, EntityId parent)
+	{
+		assert(isValid(parent) && !isAncestor(id, parent) && "an entity cannot be attached to itself or to one of its descendants");
+
+		if (hasParent(id))
+		{
+			removeParent(id);
+		}
+
+		const ui32 index = getIndex(id);
+		_parentSlotIndices[index] = parent.index;
+		_childCounts[parent.index] += 1;
+		_childEntityCount += 1;
+
+		markDirty(index);
+		_hierarchyChanged = true;
+	}
+
+	void EntityStore::removeParent(EntityId id)
+	{
+		assert(hasParent(id));
+
+		const ui32 index = getIndex(id);
+		_childCounts[_parentSlotIndices[index]] -= 1;
+		_parentSlotIndices[index] = InvalidIndex;
+		_childEntityCount -= 1;
+
+		markDirty(index);
+		_hierarchyChanged = true;
+	}
+
+	b8 EntityStore::hasParent(EntityId id) const
+	{
+		return _parentSlotIndices[getIndex(id)] != InvalidIndex;
+	}
+
+	EntityId EntityStore::getParent(EntityId id) const
+	{
+		assert(hasParent(id));
+		const ui32 parentSlotIndex = _parentSlotIndices[getIndex(id)];
+		return EntityId{parentSlotIndex, _generations[parentSlotIndex]};
+	}
+
+	const EntityTransforms& EntityStore::getTransforms() const
+	{
+		return _transforms;
+	}
+
+	void EntityStore::setTransforms(const std::vector<ui32>& indices, const EntityTransforms& transforms)
+	{
+		for (ui32 transformIndex = 0; transformIndex < indices.size(); ++transformIndex)
+		{
+			const ui32 index = indices[transformIndex];
+			assert(index < getEntityCount());
+
+			_transforms.positionsX[index] = transforms.positionsX[transformIndex];
+			_transforms.positionsY[index] = transforms.positionsY[transformIndex];
+			_transforms.positionsZ[index] = transforms.positionsZ[transformIndex];
+			_transforms.orientationsX[index] = transforms.orientationsX[transformIndex];
+			_transforms.orientationsY[index] = transforms.orientationsY[transformIndex];
+			_transforms.orientationsZ[index] = transforms.orientationsZ[transformIndex];
+			_transforms.orientationsW[index] = transforms.orientationsW[transformIndex];
+			_transforms.scalesX[index] = transforms.scalesX[transformIndex];
+			_transforms.scalesY[index] = transforms.scalesY[transformIndex];
+			_transforms.scalesZ[index] = transforms.scalesZ[transformIndex];
+			markDirty(index);
+		}
+	}
+
+	const std::vector<MeshHandle>& EntityStore::getMeshHandles() const
+	{
+		return _meshHandles;
+	}
+
+	const std::vector<ui8>& EntityStore::getOccluderFlags() const
+	{
+		return _occluderFlags;
+	}
+
+	void EntityStore::updateTransformationMatrices()
+	{
+		const ui32 entityCount = getEntityCount();
+
+		// local matrices of the modified entities
+		if (_dirtyIndices.size() > entityCount / 4)
+		{
+			// most entities moved, composing every matrix in groups across the job threads is cheaper than going
+			// through the indices, and the clean ones come out unchanged
+			composeTransformationMatricesParallel(getTransformArrays(), entityCount, _localTransformationMatrices.data());
+		}
+		else
+		{
+			const TransformArrays transforms = getTransformArrays();
+			for (ui32 index : _dirtyIndices)
+			{
+				// skips entities destroyed since they were marked
+				if (index < entityCount && _dirtyFlags[index] != 0)
+				{
+					composeTransformationMatrices(transforms, index, index + 1, _localTransformationMatrices.data());
+				}
+			}
+		}
+
+		if (_childEntityCount == 0)
+		{
+			// no hierarchy, world matrices are the local ones
+			for (ui32 index : _dirtyIndices)
+			{
+				if (index < entityCount && _dirtyFlags[index] != 0)
+				{
+					_transformationMatrices[index] = _localTransformationMatrices[index];
+					_dirtyFlags[index] = 0;
+					_updatedIndices.push_back(index);
+				}
+			}
+		}
+		else
+		{
+			if (_hierarchyChanged)
+			{
+				sortHierarchy();
+			}
+
+			// entities outside the hierarchy are done right away, the others are updated with their whole subtree
+			_dirtySubtreePositions.clear();
+			for (ui32 index : _dirtyIndices)
+			{
+				if (index >= entityCount || _dirtyFlags[index] == 0)
+				{
+					continue;
+				}
+
+				const ui32 position = _hierarchyPositions[_slotIndices[index]];
+				if (position == InvalidIndex)
+				{
+					_transformationMatrices[index] = _localTransformationMatrices[index];
+					_dirtyFlags[index] = 0;
+					_updatedIndices.push_back(index);
+				}
+				else
+				{
+					_dirtySubtreePositions.push_back(position);
+				}
+			}
+
+			// a subtree starting within the one just updated was updated with it. parents come before their children,
+			// and the parent of the root of a subtree is either clean or updated in an earlier subtree
+			std::sort(_dirtySubtreePositions.begin(), _dirtySubtreePositions.end());
+			ui32 updatedEnd = 0;
+			for (ui32 subtreePosition : _dirtySubtreePositions)
+			{
+				if (subtreePosition < updatedEnd)
+				{
+					continue;
+				}
+
+				updatedEnd = subtreePosition + _subtreeSizes[subtreePosition];
+				for (ui32 position = subtreePosition; position < updatedEnd; ++position)
+				{
+					const ui32 index = _denseIndices[_hierarchyOrder[position]];
+					const ui32 parentSlotIndex = _parentSlotIndices[index];
+					if (parentSlotIndex == InvalidIndex)
+					{
+						_transformationMatrices[index] = _localTransformationMatrices[index];
+					}
+					else
+					{
+						// both are affine, their product skips the last rows
+						const Matrix3x4<f32> transformationMatrix = 
+							Matrix3x4<f32>::getFromMatrix4(_transformationMatrices[_denseIndices[parentSlotIndex]]) * Matrix3x4<f32>::getFromMatrix4(_localTransformationMatrices[index]);
+						_transformationMatrices[index] = transformationMatrix.getMatrix4();
+					}
+
+					_dirtyFlags[index] = 0;
+					_updatedIndices.push_back(index);
+				}
+			}
+		}
+
+		_dirtyIndices.clear();
+	}
+
+	void EntityStore::takeUpdatedIndices(std::vector<ui32>& updatedIndices)
+	{
+		// entities destroyed since their update are dropped, the ones moved in their place were marked dirty
+		std::sort(_updatedIndices.begin(), _updatedIndices.end());
+		_updatedIndices.erase(std::unique(_updatedIndices.begin(), _updatedIndices.end()), _updatedIndices.end());
+		_updatedIndices.erase(std::lower_bound(_updatedIndices.begin(), _updatedIndices.end(), getEntityCount()), _updatedIndices.end());
+
+		updatedIndices.swap(_updatedIndices);
+		_updatedIndices.clear();
+	}
+
+	void EntityStore::takeMovedIndices(std::vector<ui32>& movedIndices)
+	{
+		// as for the updated indices, a flag reset by destroyEntity may leave the same index twice
+		std::sort(_movedIndices.begin(), _movedIndices.end());
+		_movedIndices.erase(std::unique(_movedIndices.begin(), _movedIndices.end()), _movedIndices.end());
+		_movedIndices.erase(std::lower_bound(_movedIndices.begin(), _movedIndices.end(), getEntityCount()), _movedIndices.end());
+		for (ui32 index : _movedIndices)
+		{
+			_movedFlags[index] = 0;
+		}
+
+		movedIndices.swap(_movedIndices);
+		_movedIndices.clear();
+	}
+
+	const std::vector<Matrix4<f32>>& EntityStore::getTransformationMatrices() const
+	{
+		return _transformationMatrices;
+	}
+
+	const Matrix4<f32>& EntityStore::getTransformationMatrix(EntityId id) const
+	{
+		return _transformationMatrices[getIndex(id)];
+	}
+
+	void EntityStore::markDirty(ui32 index)
+	{
+		if (_dirtyFlags[index] == 0)
+		{
+			_dirtyFlags[index] = 1;
+			_dirtyIndices.push_back(index);
+		}
+
+		if (_movedFlags[index] == 0)
+		{
+			_movedFlags[index] = 1;
+			_movedIndices.push_back(index);
+		}
+	}
+
+	TransformArrays EntityStore::getTransformArrays() const
+	{
+		return TransformArrays{
+			_transforms.positionsX.data(), _transforms.positionsY.data(), _transforms.positionsZ.data(),
+			_transforms.orientationsX.data(), _transforms.orientationsY.data(), _transforms.orientationsZ.data(), _transforms.orientationsW.data(),
+			_transforms.scalesX.data(), _transforms.scalesY.data(), _transforms.scalesZ.data()};
+	}
+
+	void EntityStore::sortHierarchy()
+	{
+		for (ui32 slotIndex : _hierarchyOrder)
+		{
+			_hierarchyPositions[slotIndex] = InvalidIndex;
+		}
+		_hierarchyOrder.clear();
+
+		// children grouped by parent, the scan over the parents is only paid when the hierarchy changes
+		_hierarchyLinks.clear();
+		for (ui32 index = 0; index < _parentSlotIndices.size(); ++index)
+		{
+			if (_parentSlotIndices[index] != InvalidIndex)
+			{
+				_hierarchyLinks.push_back(((ui64)_parentSlotIndices[index] << 32) | _slotIndices[index]);
+			}
+		}
+		std::sort(_hierarchyLinks.begin(), _hierarchyLinks.end());
+
+		// depth first from every root, the children of a slot being the links starting with it
+		for (ui32 linkIndex = 0; linkIndex < _hierarchyLinks.size(); ++linkIndex)
+		{
+			const ui32 parentSlotIndex = (ui32)(_hierarchyLinks[linkIndex] >> 32);
+			if ((linkIndex > 0 && (ui32)(_hierarchyLinks[linkIndex - 1] >> 32) == parentSlotIndex) ||
+				_parentSlotIndices[_denseIndices[parentSlotIndex]] != InvalidIndex)
+			{
+				continue;
+			}
+
+			_hierarchyStack.push_back(parentSlotIndex);
+			while (!_hierarchyStack.empty())
+			{
+				const ui32 slotIndex = _hierarchyStack.back();
+				_hierarchyStack.pop_back();
+				_hierarchyPositions[slotIndex] = (ui32)_hierarchyOrder.size();
+				_hierarchyOrder.push_back(slotIndex);
+
+				// pushed backwards, children are visited in slot order
+				const std::vector<ui64>::const_iterator firstChild = std::lower_bound(_hierarchyLinks.begin(), _hierarchyLinks.end(), (ui64)slotIndex << 32);
+				for (std::vector<ui64>::const_iterator child = firstChild + _childCounts[slotIndex]; child != firstChild; --child)
+				{
+					_hierarchyStack.push_back((ui32)*(child - 1));
+				}
+			}
+		}
+
+		// backwards, every subtree is complete when it is added to the one of its parent
+		_subtreeSizes.assign(_hierarchyOrder.size(), 1);
+		for (ui32 position = (ui32)_hierarchyOrder.size(); position-- > 0;)
+		{
+			const ui32 parentSlotIndex = _parentSlotIndices[_denseIndices[_hierarchyOrder[position]]];
+			if (parentSlotIndex != InvalidIndex)
+			{
+				_subtreeSizes[_hierarchyPositions[parentSlotIndex]] += _subtreeSizes[position];
+			}
+		}
+
+		_hierarchyChanged = false;
+	}
+
+	b8 EntityStore::isAncestor(EntityId ancestor, EntityId id) const
+	{
+		ui32 slotIndex = id.index;
+		while (slotIndex != InvalidIndex)
+		{
+			if (slotIndex == ancestor.index)
+			{
+				return true;
+			}
+			slotIndex = _parentSlotIndices[_denseIndices[slotIndex]];
+		}
+
+		return false;
+	}
+}
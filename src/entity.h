@@ -3,26 +3,151 @@
 #include "types.h"
 #include "maths.h"
 #include "mesh.h"
+#include "mesh_registry.h"
+
+#include <vector>
 
 namespace Visor
 {
-	class Entity
+	// stable reference to an entity of a store, the generation detects destroyed entities
+	struct EntityId
 	{
 	public:
-		Entity(const Vector3<f32>& position, f32 scaleX, f32 scaleY, f32 scaleZ, f32 yaw, f32 pitch, f32 roll, const Mesh& mesh);
+		b8 operator==(const EntityId& id) const;
+		b8 operator!=(const EntityId& id) const;
 
-		const Mesh& getMesh() const;
+	public:
+		ui32 index;
+		ui32 generation;
+	};
+
+	// one array per coordinate, indexed by dense entity index
+	struct EntityTransforms
+	{
+	public:
+		std::vector<f32> positionsX;
+		std::vector<f32> positionsY;
+		std::vector<f32> positionsZ;
+		// unit quaternions
+		std::vector<f32> orientationsX;
+		std::vector<f32> orientationsY;
+		std::vector<f32> orientationsZ;
+		std::vector<f32> orientationsW;
+		std::vector<f32> scalesX;
+		std::vector<f32> scalesY;
+		std::vector<f32> scalesZ;
+	};
 
+	/*
+	entities stored as a structure of arrays : every component lives in its own contiguous array,
+	packed without holes, so passes over all entities stream through memory and vectorize.
+	destroying an entity moves the last one into its place : dense indices change, ids stay valid.
+	each entity holds a reference to its mesh, released when the entity is destroyed.
+	transformation matrices are cached : setters mark entities dirty and only those are recomputed.
+	an entity attached to a parent has its transform expressed relative to it : world matrices are propagated
+	down the dirty subtrees only, walking the entities of the hierarchy depth first.
+	destroying a parent detaches its children, their transform is then relative to the world
+	*/
+	class EntityStore
+	{
 	public:
-		Vector3<f32> position;
-		f32 scaleX;
-		f32 scaleY;
-		f32 scaleZ;
-		f32 yaw;
-		f32 pitch;
-		f32 roll;
+		EntityStore();
+		~EntityStore();
+
+		EntityId createEntity(const Vector3<f32>& position, f32 scaleX, f32 scaleY, f32 scaleZ, f32 yaw, f32 pitch, f32 roll, MeshHandle mesh);
+		void destroyEntity(EntityId id);
+		void clear();
+
+		b8 isValid(EntityId id) const;
+		ui32 getEntityCount() const;
+		ui32 getIndex(EntityId id) const;
+		EntityId getId(ui32 index) const;
+
+		Vector3<f32> getPosition(EntityId id) const;
+		void setPosition(EntityId id, const Vector3<f32>& position);
+		// angles as in Matrix4::getRotation, converted from and to the orientation
+		void getRotation(EntityId id, f32& yaw, f32& pitch, f32& roll) const;
+		void setRotation(EntityId id, f32 yaw, f32 pitch, f32 roll);
+		Quaternion<f32> getOrientation(EntityId id) const;
+		void setOrientation(EntityId id, const Quaternion<f32>& orientation);
+		// orients the entities toward the target as setRotation with getAnglesFromDirection would, all at once.
+		// positions are taken as they are stored, relative to the parent for attached entities
+		void lookAt(const std::vector<EntityId>& ids, const Vector3<f32>& target);
+		Vector3<f32> getScale(EntityId id) const;
+		void setScale(EntityId id, const Vector3<f32>& scale);
+		MeshHandle getMeshHandle(EntityId id) const;
+		const Mesh& getMesh(EntityId id) const;
+		// occluders are rasterized into the occlusion depth buffer, pick big and simple meshes (walls, buildings)
+		void setOccluder(EntityId id, b8 occluder);
+		b8 isOccluder(EntityId id) const;
+
+		void setParent(EntityId id, EntityId parent);
+		void removeParent(EntityId id);
+		b8 hasParent(EntityId id) const;
+		EntityId getParent(EntityId id) const;
+
+		const EntityTransforms& getTransforms() const;
+		// transforms[i] becomes the local transform of the entity at dense index indices[i], marked dirty
+		void setTransforms(const std::vector<ui32>& indices, const EntityTransforms& transforms);
+		const std::vector<MeshHandle>& getMeshHandles() const;
+		const std::vector<ui8>& getOccluderFlags() const;
+
+		// recomputes the world matrices of the entities modified (or whose ancestors were modified) since the last call
+		void updateTransformationMatrices();
+		// dense indices of the world matrices changed since the last call, sorted
+		void takeUpdatedIndices(std::vector<ui32>& updatedIndices);
+		// dense indices whose local transform (or entity) changed since the last call, sorted. kept apart from the
+		// updated indices, the matrices are updated once per frame while the simulation may step several times
+		void takeMovedIndices(std::vector<ui32>& movedIndices);
+		// world matrices of every entity in dense order, as of the last update
+		const std::vector<Matrix4<f32>>& getTransformationMatrices() const;
+		const Matrix4<f32>& getTransformationMatrix(EntityId id) const;
+
+	private:
+		EntityStore(const EntityStore&);
+		EntityStore& operator=(const EntityStore&);
+
+		void markDirty(ui32 index);
+		TransformArrays getTransformArrays() const;
+		void sortHierarchy();
+		b8 isAncestor(EntityId ancestor, EntityId id) const;
 
 	private:
-		Mesh _mesh;
+		// dense components
+		EntityTransforms _transforms;
+		std::vector<MeshHandle> _meshHandles;
+		std::vector<ui8> _occluderFlags;
+		std::vector<ui32> _slotIndices;
+		std::vector<ui32> _parentSlotIndices; // stable across moves, InvalidIndex for roots
+		std::vector<Matrix4<f32>> _localTransformationMatrices;
+		std::vector<Matrix4<f32>> _transformationMatrices;
+		std::vector<ui8> _dirtyFlags;
+
+		// may hold duplicates and indices that are not dirty anymore, the flags are authoritative
+		std::vector<ui32> _dirtyIndices;
+		std::vector<ui32> _updatedIndices;
+		std::vector<ui8> _movedFlags;
+		std::vector<ui32> _movedIndices;
+		// gathered positions then orientations of lookAt, kept to avoid allocations
+		std::vector<f32> _lookAtComponents;
+
+		// slots of the entities with a parent and of their roots, depth first : the subtree of the entity at a position
+		// is the range of its subtree size starting there. the other entities are left out, their world matrix is the local one
+		std::vector<ui32> _hierarchyOrder;
+		std::vector<ui32> _subtreeSizes;
+		b8 _hierarchyChanged;
+		ui32 _childEntityCount;
+		// parent slot in the high bits, child slot in the low ones, then the slots to visit, kept for sortHierarchy
+		std::vector<ui64> _hierarchyLinks;
+		std::vector<ui32> _hierarchyStack;
+		// positions in the order of the dirty entities of the hierarchy, kept for updateTransformationMatrices
+		std::vector<ui32> _dirtySubtreePositions;
+
+		// sparse, indexed by id
+		std::vector<ui32> _denseIndices;
+		std::vector<ui32> _generations;
+		std::vector<ui32> _childCounts;
+		std::vector<ui32> _hierarchyPositions; // InvalidIndex outside the hierarchy
+		std::vector<ui32> _freeSlotIndices;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,182 @@
+#include "entity_tree.h"
+#include "mesh_registry.h"
+
+#include <algorithm>
+
+namespace Visor
+{
+	EntityTree::EntityTree()
+		: _updateStamp(0)
+	{
+	}
+
+	void EntityTree::update(const EntityStore& entities)
+	{
+		computeWorldBounds(entities, _bounds);
+
+		// leaves whose entity is not seen during this pass belong to destroyed entities
+		_updateStamp += 1;
+
+		const std::vector<MeshHandle>& meshHandles = entities.getMeshHandles();
+		for (ui32 entityIndex = 0; entityIndex < entities.getEntityCount(); ++entityIndex)
+		{
+			if (meshHandles[entityIndex] == NullMeshHandle)
+			{
+				continue;
+			}
+
+			const EntityId id = entities.getId(entityIndex);
+			if (id.index >= _leaves.size())
+			{
+				_leaves.resize(id.index + 1, AABBTree::NullNode);
+				_generations.resize(id.index + 1, 0);
+				_updateStamps.resize(id.index + 1, 0);
+			}
+
+			const Vector3<f32> center = {_bounds.centersX[entityIndex], _bounds.centersY[entityIndex], _bounds.centersZ[entityIndex]};
+			const Vector3<f32> extent = {_bounds.extentsX[entityIndex], _bounds.extentsY[entityIndex], _bounds.extentsZ[entityIndex]};
+			const AABB aabb(center - extent, center + extent);
+
+			// a slot reused by a new entity since the last update
+			if (_leaves[id.index] != AABBTree::NullNode && _generations[id.index] != id.generation)
+			{
+				_tree.remove(_leaves[id.index]);
+				_leaves[id.index] = AABBTree::NullNode;
+			}
+
+			if (_leaves[id.index] == AABBTree::NullNode)
+			{
+				_leaves[id.index] = _tree.insert(aabb, id.index);
+				_generations[id.index] = id.generation;
+			}
+			else
+			{
+				_tree.move(_leaves[id.index], aabb);
+			}
+
+			_updateStamps[id.index] = _updateStamp;
+		}
+
+		for (ui32 slotIndex = 0; slotIndex < _leaves.size(); ++slotIndex)
+		{
+			if (_leaves[slotIndex] != AABBTree::NullNode && _updateStamps[slotIndex] != _updateStamp)
+			{
+				_tree.remove(_leaves[slotIndex]);
+				_leaves[slotIndex] = AABBTree::NullNode;
+			}
+		}
+
+		// rotations keep the tree balanced but not tight, once half the leaves moved it is rebuilt from scratch
+		if (_tree.getReinsertionCount() > _tree.getLeafCount() / 2 + 64)
+		{
+			_tree.rebuild();
+		}
+	}
+
+	b8 EntityTree::raycast(const Ray& ray, f32 maxDistance, EntityId& entity, f32& distance) const
+	{
+		ui32 slotIndex = 0;
+		if (!_tree.raycast(ray, maxDistance, slotIndex, distance))
+		{
+			return false;
+		}
+
+		entity = getEntity(slotIndex);
+		return true;
+	}
+
+	b8 EntityTree::raycast(const Ray& ray, f32 maxDistance, const RaycastFunction& function, EntityId& entity, f32& distance) const
+	{
+		ui32 slotIndex = 0;
+		const b8 hit = _tree.raycast(ray, maxDistance, [this, &function](ui32 userData, f32 boxDistance)
+		{
+			return function(getEntity(userData), boxDistance);
+		}, slotIndex, distance);
+
+		if (!hit)
+		{
+			return false;
+		}
+
+		entity = getEntity(slotIndex);
+		return true;
+	}
+
+	void EntityTree::queryOverlaps(const AABB& aabb, std::vector<EntityId>& entities) const
+	{
+		std::vector<ui32> slotIndices;
+		_tree.queryOverlaps(aabb, slotIndices);
+		for (ui32 slotIndex : slotIndices)
+		{
+			entities.push_back(getEntity(slotIndex));
+		}
+	}
+
+	void EntityTree::queryFrustum(const Frustum& frustum, std::vector<EntityId>& entities) const
+	{
+		std::vector<ui32> slotIndices;
+		_tree.queryFrustum(frustum, slotIndices);
+		for (ui32 slotIndex : slotIndices)
+		{
+			entities.push_back(getEntity(slotIndex));
+		}
+	}
+
+	const AABBTree& EntityTree::getTree() const
+	{
+		return _tree;
+	}
+
+	EntityId EntityTree::getEntity(ui32 slotIndex) const
+	{
+		return EntityId{slotIndex, _generations[slotIndex]};
+	}
+
+	b8 intersectEntity(const EntityStore& entities, EntityId entity, const Ray& ray, f32 maxDistance, RayHit& hit)
+	{
+		const MeshHandle meshHandle = entities.getMeshHandle(entity);
+		if (meshHandle == NullMeshHandle)
+		{
+			return false;
+		}
+
+		// the ray is brought into the local space of the mesh without renormalizing it, so distances along it stay world distances
+		// an entity flattened by a zero scale has no volume to hit
+		Matrix3x4<f32> inverseMatrix;
+		if (!Matrix3x4<f32>::getFromMatrix4(entities.getTransformationMatrix(entity)).getInverse(inverseMatrix))
+		{
+			return false;
+		}
+		const Ray localRay(inverseMatrix * ray.position, inverseMatrix.transformDirection(ray.getDirection()));
+
+		const MeshRegistry& meshRegistry = MeshRegistry::getInstance();
+		if (meshRegistry.isLoaded(meshHandle) && meshRegistry.getMesh(meshHandle).getBVH().isBuilt())
+		{
+			return meshRegistry.getMesh(meshHandle).intersect(localRay, maxDistance, hit);
+		}
+
+		// without a hierarchy the bounds are hit instead, those of the placeholder cube while the mesh loads
+		const AABB& localAABB = meshRegistry.getAABB(meshHandle);
+
+		f32 entry = 0.0f;
+		f32 exit = maxDistance;
+		for (ui32 axis = 0; axis < 3; ++axis)
+		{
+			const f32 t0 = (localAABB.minimum[axis] - localRay.position[axis]) * localRay.inverseDirection[axis];
+			const f32 t1 = (localAABB.maximum[axis] - localRay.position[axis]) * localRay.inverseDirection[axis];
+			entry = std::max(entry, std::min(t0, t1));
+			exit = std::min(exit, std::max(t0, t1));
+		}
+
+		if (entry > exit)
+		{
+			return false;
+		}
+
+		hit.triangleIndex = NullTriangle;
+		hit.distance = entry;
+		hit.u = 0.0f;
+		hit.v = 0.0f;
+		return true;
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "types.h"
+#include "aabb_tree.h"
+#include "culling.h"
+#include "entity.h"
+#include "triangle_bvh.h"
+
+#include <functional>
+#include <vector>
+
+namespace Visor
+{
+	/*
+	bounding volume hierarchy over the world boxes of the entities of a store, for picking, line of sight and area queries.
+	update follows the store : entities created since the last update are inserted, destroyed ones removed
+	and moved ones refitted. entities without mesh are left out
+	*/
+	class EntityTree
+	{
+	public:
+		// see AABBTree::RaycastFunction
+		typedef std::function<f32(EntityId entity, f32 distance)> RaycastFunction;
+
+		EntityTree();
+
+		// call after the world matrices of the store were updated
+		void update(const EntityStore& entities);
+
+		b8 raycast(const Ray& ray, f32 maxDistance, EntityId& entity, f32& distance) const;
+		b8 raycast(const Ray& ray, f32 maxDistance, const RaycastFunction& function, EntityId& entity, f32& distance) const;
+		void queryOverlaps(const AABB& aabb, std::vector<EntityId>& entities) const;
+		void queryFrustum(const Frustum& frustum, std::vector<EntityId>& entities) const;
+
+		const AABBTree& getTree() const;
+
+	private:
+		EntityId getEntity(ui32 slotIndex) const;
+
+	private:
+		AABBTree _tree;
+		BoundsArrays _bounds;
+
+		// indexed by entity slot, the slot of an id is stable and becomes the user value of its leaf
+		std::vector<ui32> _leaves;
+		std::vector<ui32> _generations;
+		std::vector<ui32> _updateStamps;
+		ui32 _updateStamp;
+	};
+
+	// exact hit of a world space ray against the triangles of the mesh of an entity, the distance being along the world ray.
+	// meshes still streaming or without triangle hierarchy are hit on their local box, with a triangle index of NullTriangle
+	const ui32 NullTriangle = 0xFFFFFFFF;
+	b8 intersectEntity(const EntityStore& entities, EntityId entity, const Ray& ray, f32 maxDistance, RayHit& hit);
+}
@@ -0,0 +1,97 @@
+#include "file_watcher.h"
+
+#if defined(VSR_PLATFORM_LINUX)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <iostream>
+
+namespace Visor
+{
+	FileWatcher::FileWatcher()
+		: _fileDescriptor(-1)
+	{
+		#if defined(VSR_PLATFORM_LINUX)
+			_fileDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (_fileDescriptor < 0)
+			{
+				std::cerr << "could not initialize inotify, files will not be watched\n";
+			}
+		#endif
+	}
+
+	FileWatcher::~FileWatcher()
+	{
+		#if defined(VSR_PLATFORM_LINUX)
+			if (_fileDescriptor >= 0)
+			{
+				close(_fileDescriptor);
+			}
+		#endif
+	}
+
+	void FileWatcher::watchDirectory(const std::string& directory)
+	{
+		for (const std::pair<const i32, std::string>& watchedDirectory : _watchedDirectories)
+		{
+			if (watchedDirectory.second == directory)
+			{
+				return;
+			}
+		}
+
+		#if defined(VSR_PLATFORM_LINUX)
+			if (_fileDescriptor < 0)
+			{
+				return;
+			}
+
+			// written files trigger IN_CLOSE_WRITE, files saved through a rename (most editors, glslc) trigger IN_MOVED_TO
+			const i32 watchDescriptor = inotify_add_watch(_fileDescriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+			if (watchDescriptor < 0)
+			{
+				std::cerr << "could not watch directory " << directory << "\n";
+				return;
+			}
+
+			_watchedDirectories[watchDescriptor] = directory;
+		#endif
+	}
+
+	void FileWatcher::pollChangedFiles(std::vector<std::string>& changedFilePaths)
+	{
+		#if defined(VSR_PLATFORM_LINUX)
+			if (_fileDescriptor < 0)
+			{
+				return;
+			}
+
+			alignas(struct inotify_event) c8 buffer[4096];
+
+			while (true)
+			{
+				const ssize_t length = read(_fileDescriptor, buffer, sizeof(buffer));
+				if (length <= 0)
+				{
+					break;
+				}
+
+				for (c8* pEvent = buffer; pEvent < buffer + length; )
+				{
+					const struct inotify_event* pInotifyEvent = (const struct inotify_event*)pEvent;
+
+					std::unordered_map<i32, std::string>::const_iterator it = _watchedDirectories.find(pInotifyEvent->wd);
+					if (it != _watchedDirectories.end() && pInotifyEvent->len > 0)
+					{
+						changedFilePaths.push_back(it->second + "/" + pInotifyEvent->name);
+					}
+
+					pEvent += sizeof(struct inotify_event) + pInotifyEvent->len;
+				}
+			}
+		#else
+			(void)changedFilePaths;
+		#endif
+	}
+}
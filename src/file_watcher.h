@@ -0,0 +1,34 @@
+#pragma once
+
+#include "types.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace Visor
+{
+	/*
+	reports files written or moved into the watched directories (not recursive).
+	only implemented on linux (inotify) for now, elsewhere nothing is ever reported
+	*/
+	class FileWatcher
+	{
+	public:
+		FileWatcher();
+		~FileWatcher();
+
+		void watchDirectory(const std::string& directory);
+
+		// non blocking, appends the path of every file changed since the last call (directory + "/" + file name)
+		void pollChangedFiles(std::vector<std::string>& changedFilePaths);
+
+	private:
+		FileWatcher(const FileWatcher& fileWatcher);
+		FileWatcher& operator=(const FileWatcher& fileWatcher);
+
+	private:
+		i32 _fileDescriptor;
+		std::unordered_map<i32, std::string> _watchedDirectories; // by watch descriptor
+	};
+}
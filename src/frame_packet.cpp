@@ -0,0 +1,107 @@
+#include "frame_packet.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Visor
+{
+	FramePacketBuffer::FramePacketBuffer()
+		: _writeSlot(0)
+		, _packetCount(0)
+		, _readSlot(2)
+		, _publishedSlot(1)
+	{
+		for (ui32 slot = 0; slot < SlotCount; ++slot)
+		{
+			_packets[slot].index = 0;
+			_packets[slot].camera = {};
+			_isSlotStale[slot] = true;
+		}
+	}
+
+	void FramePacketBuffer::publish(const Camera& camera, EntityStore& entities, const std::vector<ui32>& visibleEntityIndices)
+	{
+		const ui32 entityCount = entities.getEntityCount();
+		entities.takeUpdatedIndices(_updatedIndices);
+
+		FramePacket& packet = _packets[_writeSlot];
+		packet.index = ++_packetCount;
+		packet.camera = camera;
+		packet.visibleEntityIndices = visibleEntityIndices;
+
+		// the reader may take the published packet right after this test, its indices are then uploaded twice, which is harmless
+		packet.updatedIndices = _updatedIndices;
+		const ui32 publishedSlot = _publishedSlot.load(std::memory_order_acquire);
+		if (publishedSlot & NewPacketBit)
+		{
+			const std::vector<ui32>& unreadIndices = _packets[publishedSlot & ~NewPacketBit].updatedIndices;
+			packet.updatedIndices.insert(packet.updatedIndices.end(), unreadIndices.begin(), unreadIndices.end());
+			std::sort(packet.updatedIndices.begin(), packet.updatedIndices.end());
+			packet.updatedIndices.erase(std::unique(packet.updatedIndices.begin(), packet.updatedIndices.end()), packet.updatedIndices.end());
+			packet.updatedIndices.erase(std::lower_bound(packet.updatedIndices.begin(), packet.updatedIndices.end(), entityCount), packet.updatedIndices.end());
+		}
+
+		// entities created since the slot was written are among the updated ones, the rest of the slot is still valid
+		const std::vector<Matrix4<f32>>& transformationMatrices = entities.getTransformationMatrices();
+		const std::vector<MeshHandle>& meshHandles = entities.getMeshHandles();
+		packet.transformationMatrices.resize(entityCount);
+		packet.meshHandles.resize(entityCount);
+		if (_isSlotStale[_writeSlot])
+		{
+			std::copy(transformationMatrices.begin(), transformationMatrices.end(), packet.transformationMatrices.begin());
+			std::copy(meshHandles.begin(), meshHandles.end(), packet.meshHandles.begin());
+		}
+		else
+		{
+			for (const std::vector<ui32>* pIndices : {&_staleIndices[_writeSlot], &_updatedIndices})
+			{
+				for (ui32 entityIndex : *pIndices)
+				{
+					if (entityIndex < entityCount)
+					{
+						packet.transformationMatrices[entityIndex] = transformationMatrices[entityIndex];
+						packet.meshHandles[entityIndex] = meshHandles[entityIndex];
+					}
+				}
+			}
+		}
+		_staleIndices[_writeSlot].clear();
+		_isSlotStale[_writeSlot] = false;
+
+		// past the entity count, copying the whole slot is cheaper than going through the indices
+		for (ui32 slot = 0; slot < SlotCount; ++slot)
+		{
+			if (slot == _writeSlot || _isSlotStale[slot])
+			{
+				continue;
+			}
+
+			if (_staleIndices[slot].size() + _updatedIndices.size() > entityCount)
+			{
+				_staleIndices[slot].clear();
+				_isSlotStale[slot] = true;
+			}
+			else
+			{
+				_staleIndices[slot].insert(_staleIndices[slot].end(), _updatedIndices.begin(), _updatedIndices.end());
+			}
+		}
+
+		// the slot published before, whether it was read or not, is the next one written
+		const ui32 previousSlot = _publishedSlot.exchange(_writeSlot | NewPacketBit, std::memory_order_acq_rel);
+		_writeSlot = previousSlot & ~NewPacketBit;
+	}
+
+	const FramePacket* FramePacketBuffer::acquire()
+	{
+		if ((_publishedSlot.load(std::memory_order_acquire) & NewPacketBit) == 0)
+		{
+			return nullptr;
+		}
+
+		const ui32 publishedSlot = _publishedSlot.exchange(_readSlot, std::memory_order_acq_rel);
+		assert(publishedSlot & NewPacketBit);
+		_readSlot = publishedSlot & ~NewPacketBit;
+		return &_packets[_readSlot];
+	}
+}
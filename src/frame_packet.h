@@ -0,0 +1,68 @@
+#pragma once
+
+#include "types.h"
+#include "camera.h"
+#include "entity.h"
+#include "maths.h"
+#include "mesh_registry.h"
+
+#include <atomic>
+#include <vector>
+
+namespace Visor
+{
+	// what a backend draws a frame from, copied out of the entity store so the store can change while the frame is drawn
+	struct FramePacket
+	{
+	public:
+		// 1 for the first packet published, then increasing by one
+		ui64 index;
+		Camera camera;
+		// world matrices and meshes of every entity in dense order
+		std::vector<Matrix4<f32>> transformationMatrices;
+		std::vector<MeshHandle> meshHandles;
+		// dense indices of the matrices changed since the previous packet drawn, sorted
+		std::vector<ui32> updatedIndices;
+		// the draw list, entities left after culling
+		std::vector<ui32> visibleEntityIndices;
+	};
+
+	/*
+	triple buffer of frame packets between one writer (the main thread) and one reader (the render thread).
+	the slots change hands through a single atomic exchange, neither side ever waits for the other : the writer always
+	has a slot of its own to fill, the reader takes the last packet published and the ones it never took are reused.
+	the updated indices of a packet published while the previous one was still unread include those of the previous one,
+	so the reader misses no matrix. a slot only copies the matrices changed since it was last written
+	*/
+	class FramePacketBuffer
+	{
+	public:
+		FramePacketBuffer();
+
+		// writer side, the world matrices of the store must be up to date. takes the updated indices of the store
+		void publish(const Camera& camera, EntityStore& entities, const std::vector<ui32>& visibleEntityIndices);
+		// reader side, the last packet published or nullptr when it was already acquired. valid until the next call
+		const FramePacket* acquire();
+
+	private:
+		static const ui32 SlotCount = 3;
+		// set in the published slot index until the reader takes it
+		static const ui32 NewPacketBit = 4;
+
+	private:
+		FramePacket _packets[SlotCount];
+
+		// writer side
+		ui32 _writeSlot;
+		ui64 _packetCount;
+		std::vector<ui32> _updatedIndices;
+		// indices updated since each slot was last written, or the whole slot when flagged
+		std::vector<ui32> _staleIndices[SlotCount];
+		b8 _isSlotStale[SlotCount];
+
+		// reader side
+		ui32 _readSlot;
+
+		std::atomic<ui32> _publishedSlot;
+	};
+}
@@ -0,0 +1,57 @@
+#include "frustum.h"
+
+namespace Visor
+{
+	f32 Plane::getSignedDistance(const Vector3<f32>& point) const
+	{
+		return normal.dot(point) + distance;
+	}
+
+	static Plane getNormalizedPlane(const Matrix4<f32>& matrix, ui32 row, f32 rowSign, f32 wSign)
+	{
+		Plane plane = {};
+		plane.normal.x = wSign * matrix.m[3][0] + rowSign * matrix.m[row][0];
+		plane.normal.y = wSign * matrix.m[3][1] + rowSign * matrix.m[row][1];
+		plane.normal.z = wSign * matrix.m[3][2] + rowSign * matrix.m[row][2];
+		plane.distance = wSign * matrix.m[3][3] + rowSign * matrix.m[row][3];
+
+		// the far plane of an infinite projection has a null normal, it never rejects anything
+		const f32 norm = plane.normal.getNorm();
+		if (norm > 0.0f)
+		{
+			plane.normal = plane.normal / norm;
+			plane.distance /= norm;
+		}
+
+		return plane;
+	}
+
+	Frustum Frustum::fromMatrix(const Matrix4<f32>& matrix)
+	{
+		// clip space is (x, y, z, w) = matrix * (p, 1), a point is inside when -w <= x <= w, -w <= y <= w and 0 <= z <= w
+		// so each side is the w row plus or minus another row (Gribb & Hartmann)
+		Frustum frustum = {};
+
+		frustum.planes[0] = getNormalizedPlane(matrix, 0, 1.0f, 1.0f);
+		frustum.planes[1] = getNormalizedPlane(matrix, 0, -1.0f, 1.0f);
+		frustum.planes[2] = getNormalizedPlane(matrix, 1, 1.0f, 1.0f);
+		frustum.planes[3] = getNormalizedPlane(matrix, 1, -1.0f, 1.0f);
+		frustum.planes[4] = getNormalizedPlane(matrix, 2, 1.0f, 0.0f);
+		frustum.planes[5] = getNormalizedPlane(matrix, 2, -1.0f, 1.0f);
+
+		return frustum;
+	}
+
+	b8 Frustum::intersectsSphere(const Vector3<f32>& center, f32 radius) const
+	{
+		for (ui32 planeIndex = 0; planeIndex < 6; ++planeIndex)
+		{
+			if (planes[planeIndex].getSignedDistance(center) < -radius)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
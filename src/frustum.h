@@ -0,0 +1,31 @@
+#pragma once
+
+#include "types.h"
+#include "maths.h"
+
+namespace Visor
+{
+	struct Plane
+	{
+	public:
+		f32 getSignedDistance(const Vector3<f32>& point) const;
+
+	public:
+		Vector3<f32> normal;
+		f32 distance;
+	};
+
+	struct Frustum
+	{
+	public:
+		// planes are extracted from a (model) view projection matrix, so they live in the space
+		// the matrix transforms from (world space for a view projection, local space for a model view projection)
+		static Frustum fromMatrix(const Matrix4<f32>& matrix);
+
+		b8 intersectsSphere(const Vector3<f32>& center, f32 radius) const;
+
+	public:
+		// left, right, bottom, top, near, far
+		Plane planes[6];
+	};
+}
@@ -0,0 +1,301 @@
+#include "job_system.h"
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+
+namespace Visor
+{
+	static JobSystem* pInstance = nullptr;
+
+	// index of the deque owned by the current thread, threads outside the pool use the one of thread 0
+	static thread_local ui32 currentWorkerIndex = 0;
+
+	JobCounter::JobCounter()
+		: _pendingJobCount(0)
+	{
+	}
+
+	b8 JobCounter::isDone() const
+	{
+		return _pendingJobCount.load() == 0;
+	}
+
+	void JobSystem::run(const JobFunction& function, JobCounter& counter)
+	{
+		counter._pendingJobCount += 1;
+		pushJob(Job{function, &counter});
+	}
+
+	void JobSystem::runAfter(JobCounter& dependency, const JobFunction& function, JobCounter& counter)
+	{
+		counter._pendingJobCount += 1;
+
+		// the last job of the dependency schedules the continuations, unless it is already done
+		std::unique_lock<std::mutex> lock(dependency._mutex);
+		if (dependency._pendingJobCount.load() == 0)
+		{
+			lock.unlock();
+			pushJob(Job{function, &counter});
+			return;
+		}
+
+		dependency._continuations.push_back(JobCounter::Continuation{function, &counter});
+	}
+
+	void JobSystem::parallelFor(ui32 count, ui32 batchSize, const RangeFunction& function, JobCounter& counter)
+	{
+		assert(batchSize > 0);
+
+		// shared by every batch, the caller's function may be gone by the time they run
+		std::shared_ptr<RangeFunction> pFunction = std::make_shared<RangeFunction>(function);
+
+		for (ui32 begin = 0; begin < count; begin += batchSize)
+		{
+			const ui32 end = std::min(begin + batchSize, count);
+			run([pFunction, begin, end]() { (*pFunction)(begin, end); }, counter);
+		}
+	}
+
+	void JobSystem::parallelFor(ui32 count, ui32 batchSize, const RangeFunction& function)
+	{
+		// like the overload with a counter, an empty range runs nothing
+		if (count == 0)
+		{
+			return;
+		}
+
+		if (count <= batchSize)
+		{
+			function(0, count);
+			return;
+		}
+
+		JobCounter counter;
+		parallelFor(count, batchSize, function, counter);
+		wait(counter);
+	}
+
+	void JobSystem::wait(JobCounter& counter)
+	{
+		// help instead of blocking, the jobs waited on may sit in this thread's deque
+		const ui32 workerIndex = getCurrentWorkerIndex();
+		while (!counter.isDone())
+		{
+			Job job;
+			if (popJob(workerIndex, job))
+			{
+				executeJob(job);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		// the last job may still be releasing the continuations
+		std::lock_guard<std::mutex> lock(counter._mutex);
+	}
+
+	ui32 JobSystem::getThreadCount() const
+	{
+		return (ui32)_workers.size();
+	}
+
+	void JobSystem::getStatistics(std::vector<WorkerStatistics>& statistics) const
+	{
+		statistics.resize(_workers.size());
+		for (ui32 workerIndex = 0; workerIndex < _workers.size(); ++workerIndex)
+		{
+			const Worker& worker = *_workers[workerIndex];
+			statistics[workerIndex].executedJobCount = worker.executedJobCount.load();
+			statistics[workerIndex].stolenJobCount = worker.stolenJobCount.load();
+			statistics[workerIndex].failedStealCount = worker.failedStealCount.load();
+			statistics[workerIndex].maximumQueuedJobCount = worker.maximumQueuedJobCount.load();
+		}
+	}
+
+	void JobSystem::resetStatistics()
+	{
+		for (Worker* pWorker : _workers)
+		{
+			pWorker->executedJobCount = 0;
+			pWorker->stolenJobCount = 0;
+			pWorker->failedStealCount = 0;
+			pWorker->maximumQueuedJobCount = 0;
+		}
+	}
+
+	void JobSystem::start(ui32 threadCount)
+	{
+		assert(pInstance == nullptr);
+		pInstance = new JobSystem(threadCount);
+	}
+
+	void JobSystem::terminate()
+	{
+		assert(pInstance != nullptr);
+		delete pInstance;
+		pInstance = nullptr;
+	}
+
+	JobSystem& JobSystem::getInstance()
+	{
+		assert(pInstance != nullptr);
+		return *pInstance;
+	}
+
+	JobSystem::JobSystem(ui32 threadCount)
+		: _queuedJobCount(0)
+		, _stopping(false)
+	{
+		assert(threadCount > 0);
+
+		for (ui32 workerIndex = 0; workerIndex < threadCount; ++workerIndex)
+		{
+			Worker* pWorker = new Worker();
+			pWorker->executedJobCount = 0;
+			pWorker->stolenJobCount = 0;
+			pWorker->failedStealCount = 0;
+			pWorker->maximumQueuedJobCount = 0;
+			_workers.push_back(pWorker);
+		}
+
+		// thread 0 is the calling thread
+		currentWorkerIndex = 0;
+		for (ui32 workerIndex = 1; workerIndex < threadCount; ++workerIndex)
+		{
+			_workers[workerIndex]->thread = std::thread(&JobSystem::runWorker, this, workerIndex);
+		}
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_sleepMutex);
+			_stopping = true;
+		}
+		_sleepCondition.notify_all();
+
+		// workers drain the remaining jobs before leaving
+		for (ui32 workerIndex = 1; workerIndex < _workers.size(); ++workerIndex)
+		{
+			_workers[workerIndex]->thread.join();
+		}
+
+		for (Worker* pWorker : _workers)
+		{
+			delete pWorker;
+		}
+	}
+
+	void JobSystem::runWorker(ui32 workerIndex)
+	{
+		currentWorkerIndex = workerIndex;
+
+		while (true)
+		{
+			Job job;
+			if (popJob(workerIndex, job))
+			{
+				executeJob(job);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(_sleepMutex);
+			_sleepCondition.wait(lock, [this]() { return _queuedJobCount.load() > 0 || _stopping; });
+			if (_stopping && _queuedJobCount.load() == 0)
+			{
+				return;
+			}
+		}
+	}
+
+	void JobSystem::pushJob(const Job& job)
+	{
+		Worker& worker = *_workers[getCurrentWorkerIndex()];
+		{
+			std::lock_guard<std::mutex> lock(worker.mutex);
+			worker.jobs.push_back(job);
+			if (worker.jobs.size() > worker.maximumQueuedJobCount.load())
+			{
+				worker.maximumQueuedJobCount = worker.jobs.size();
+			}
+		}
+
+		_queuedJobCount += 1;
+
+		// taking the lock orders the notification after a worker's check of the job count
+		{
+			std::lock_guard<std::mutex> lock(_sleepMutex);
+		}
+		_sleepCondition.notify_one();
+	}
+
+	b8 JobSystem::popJob(ui32 workerIndex, Job& job)
+	{
+		// newest job of its own deque first, its data is likely still in cache
+		{
+			Worker& worker = *_workers[workerIndex];
+			std::lock_guard<std::mutex> lock(worker.mutex);
+			if (!worker.jobs.empty())
+			{
+				job = worker.jobs.back();
+				worker.jobs.pop_back();
+				_queuedJobCount -= 1;
+				return true;
+			}
+		}
+
+		// then the oldest job of another deque, which tends to be the biggest chunk of work left
+		Worker& thief = *_workers[workerIndex];
+		for (ui32 offset = 1; offset < _workers.size(); ++offset)
+		{
+			Worker& victim = *_workers[(workerIndex + offset) % _workers.size()];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.jobs.empty())
+			{
+				job = victim.jobs.front();
+				victim.jobs.pop_front();
+				_queuedJobCount -= 1;
+				thief.stolenJobCount += 1;
+				return true;
+			}
+		}
+
+		if (_workers.size() > 1)
+		{
+			thief.failedStealCount += 1;
+		}
+
+		return false;
+	}
+
+	void JobSystem::executeJob(Job& job)
+	{
+		job.function();
+		_workers[getCurrentWorkerIndex()]->executedJobCount += 1;
+
+		// decremented under the lock : a waiter seeing zero takes it before letting the counter go
+		JobCounter& counter = *job.pCounter;
+		std::vector<JobCounter::Continuation> continuations;
+		{
+			std::lock_guard<std::mutex> lock(counter._mutex);
+			if (counter._pendingJobCount.fetch_sub(1) == 1)
+			{
+				// last job of the counter, release the jobs waiting on it
+				continuations.swap(counter._continuations);
+			}
+		}
+
+		for (const JobCounter::Continuation& continuation : continuations)
+		{
+			pushJob(Job{continuation.function, continuation.pCounter});
+		}
+	}
+
+	ui32 JobSystem::getCurrentWorkerIndex() const
+	{
+		return currentWorkerIndex;
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "types.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Visor
+{
+	// number of unfinished jobs attached to it, jobs can be scheduled to run once it drops to zero.
+	// a counter must be waited on with JobSystem::wait before it is destroyed
+	class JobCounter
+	{
+	public:
+		JobCounter();
+
+		b8 isDone() const;
+
+	private:
+		JobCounter(const JobCounter&);
+		JobCounter& operator=(const JobCounter&);
+
+	private:
+		friend class JobSystem;
+
+		struct Continuation
+		{
+		public:
+			std::function<void()> function;
+			JobCounter* pCounter;
+		};
+
+		std::atomic<ui32> _pendingJobCount;
+		std::mutex _mutex;
+		std::vector<Continuation> _continuations;
+	};
+
+	struct WorkerStatistics
+	{
+	public:
+		ui64 executedJobCount;
+		ui64 stolenJobCount;
+		ui64 failedStealCount;
+		ui64 maximumQueuedJobCount;
+	};
+
+	/*
+	fixed pool of worker threads, each owning a deque of jobs.
+	a thread pushes and pops jobs at the back of its own deque, idle threads steal from the front of the others.
+	thread 0 is the thread which started the system, it works while waiting on a counter.
+	threads outside the pool (asset streaming) submit to the deque of thread 0
+	*/
+	class JobSystem
+	{
+	public:
+		typedef std::function<void()> JobFunction;
+		typedef std::function<void(ui32 begin, ui32 end)> RangeFunction;
+
+		void run(const JobFunction& function, JobCounter& counter);
+		void runAfter(JobCounter& dependency, const JobFunction& function, JobCounter& counter);
+		void parallelFor(ui32 count, ui32 batchSize, const RangeFunction& function, JobCounter& counter);
+		void parallelFor(ui32 count, ui32 batchSize, const RangeFunction& function);
+		void wait(JobCounter& counter);
+
+		ui32 getThreadCount() const;
+		void getStatistics(std::vector<WorkerStatistics>& statistics) const;
+		void resetStatistics();
+
+		static void start(ui32 threadCount);
+		static void terminate();
+		static JobSystem& getInstance();
+
+	private:
+		struct Job
+		{
+		public:
+			JobFunction function;
+			JobCounter* pCounter;
+		};
+
+		struct Worker
+		{
+		public:
+			std::mutex mutex;
+			std::deque<Job> jobs;
+			std::thread thread;
+			std::atomic<ui64> executedJobCount;
+			std::atomic<ui64> stolenJobCount;
+			std::atomic<ui64> failedStealCount;
+			std::atomic<ui64> maximumQueuedJobCount;
+		};
+
+	private:
+		JobSystem(ui32 threadCount);
+		~JobSystem();
+
+		void runWorker(ui32 workerIndex);
+		void pushJob(const Job& job);
+		b8 popJob(ui32 workerIndex, Job& job);
+		void executeJob(Job& job);
+		ui32 getCurrentWorkerIndex() const;
+
+	private:
+		std::vector<Worker*> _workers;
+		std::atomic<ui32> _queuedJobCount;
+		std::mutex _sleepMutex;
+		std::condition_variable _sleepCondition;
+		b8 _stopping;
+	};
+}
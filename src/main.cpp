@@ -1,47 +1,20 @@
 #include <visor.h>
 
-#include <trivex.h>
-
 #include <string>
 #include <iostream>
 #include <vector>
 #include <random>
+#include <thread>
+#include <algorithm>
+#include <chrono>
 
-static Visor::Mesh loadMesh(const std::string& meshPath)
-{
-	std::vector<Visor::Mesh::Vertex> vertices;
-	std::vector<Visor::ui32> indices;
-
-	TVX_Mesh TVXMesh;
-	TVX_loadMeshFromOBJ(meshPath.c_str(), &TVXMesh);
+// the simulation advances by steps of a fixed duration whatever the frame rate, the frames in between are interpolated
+static const Visor::f64 SimulationStepDuration = 1.0 / 60.0;
+static const Visor::ui32 MaximumSimulationStepCount = 8;
+// the backend records and submits a frame on its own thread while the next one is simulated
+static const Visor::b8 HasRenderThread = true;
 
-	for(uint32_t vertexIndex = 0; vertexIndex < TVXMesh.vertexCount; ++vertexIndex)
-	{
-		struct TVX_Position position = TVXMesh.pVertices[vertexIndex].position;
-		struct TVX_Normal normal = TVXMesh.pVertices[vertexIndex].normal;
-
-		Visor::Mesh::Vertex vertex = {};
-		vertex.position.x = position.x;
-		vertex.position.y = position.y;
-		vertex.position.z = position.z;
-		vertex.normal.x = normal.x;
-		vertex.normal.y = normal.y;
-		vertex.normal.z = normal.z;
-
-		vertices.push_back(vertex);
-	}
-
-	for(uint32_t vertexIndexIndex = 0; vertexIndexIndex < TVXMesh.vertexIndexCount; ++vertexIndexIndex)
-	{
-		indices.push_back(TVXMesh.pVertexIndices[vertexIndexIndex]);
-	}
-
-	TVX_destroyMesh(TVXMesh);
-
-	return Visor::Mesh(vertices, indices, "../assets/shaders/intermediate/vertex.spv", "../assets/shaders/intermediate/fragment.spv");
-}
-
-static void addRandomEntities(const Visor::Mesh& mesh, std::vector<Visor::Entity>& entities)
+static void addRandomEntities(Visor::MeshHandle mesh, Visor::EntityStore& entities)
 {
 	std::random_device rd;
 	std::mt19937 gen(rd());
@@ -52,97 +25,61 @@ static void addRandomEntities(const Visor::Mesh& mesh, std::vector<Visor::Entity
 
 	for(Visor::ui32 entityIndex = 0; entityIndex < entityCount; ++entityIndex)
 	{
-		Visor::Entity entity({(Visor::f32)distrib(gen), (Visor::f32)distrib(gen), (Visor::f32)distrib(gen)}, scale, scale, scale, 0.0f, 0.0f, 0.0f, mesh);	
-		entities.push_back(entity);
+		entities.createEntity({(Visor::f32)distrib(gen), (Visor::f32)distrib(gen), (Visor::f32)distrib(gen)}, scale, scale, scale, 0.0f, 0.0f, 0.0f, mesh);
 	}
 }
 
-static void updatePlayer(Visor::Entity& player)
+// the mouse moves of the frames since the previous step are applied at once
+static void updatePlayer(Visor::EntityStore& entities, Visor::EntityId player, Visor::f32 stepDuration, Visor::f32 dx, Visor::f32 dy)
 {
+	// 1.2 units per second
 	Visor::f32 speed = 0.0f;
 
 	if(Visor::InputSystem::getInstance().isKeyPressed(Visor::InputSystem::Key::W))
 	{
-		speed += 0.02f;
+		speed += 1.2f * stepDuration;
 	}
 	if(Visor::InputSystem::getInstance().isKeyPressed(Visor::InputSystem::Key::S))
 	{
-		speed -= 0.02f;
+		speed -= 1.2f * stepDuration;
 	}
 
-	Visor::f32 currentMouseX = 0.0f;
-	Visor::f32 currentMouseY = 0.0f;
-	Visor::InputSystem::getInstance().getMousePosition(currentMouseX, currentMouseY);
-
-	Visor::f32 previousMouseX = 0.0f;
-	Visor::f32 previousMouseY = 0.0f;
-	Visor::InputSystem::getInstance().getPreviousMousePosition(previousMouseX, previousMouseY);
-
-	Visor::f32 dx = previousMouseX - currentMouseX;
-	Visor::f32 dy = previousMouseY - currentMouseY;
-
 	const Visor::f32 yaw = dx * 0.01f;
 	const Visor::f32 pitch = dy * 0.01f;
 
-	player.yaw += yaw;
-	player.pitch += pitch;
+	// yaw around the world vertical axis, pitch around the player's own horizontal axis.
+	// renormalized since the rounding errors of the products add up step after step
+	Visor::Quaternion<Visor::f32> playerOrientation = 
+		Visor::Quaternion<Visor::f32>::getFromAngles(yaw, 0.0f, 0.0f) * 
+		entities.getOrientation(player) * 
+		Visor::Quaternion<Visor::f32>::getFromAngles(0.0f, pitch, 0.0f);
+	playerOrientation.normalize();
+	entities.setOrientation(player, playerOrientation);
 	
 	Visor::Vector3<Visor::f32> forward = {
 			0.0f,
 			0.0f,
 			1.0f,
 	};
-	const Visor::Matrix3<Visor::f32> rotation = (Visor::Matrix4<Visor::f32>::getRotation(player.yaw, player.pitch, 0.0f)).getUpperLeft();
-	const Visor::Vector3<Visor::f32> rotatedForward = rotation * forward;
+	const Visor::Vector3<Visor::f32> rotatedForward = playerOrientation * forward;
 	const Visor::Vector3<Visor::f32> scaledRotatedForwardVector = rotatedForward * speed;
 	
-	player.position = player.position + scaledRotatedForwardVector;
+	entities.setPosition(player, entities.getPosition(player) + scaledRotatedForwardVector);
 }
 
-static void updateOtherEntities(std::vector<Visor::Entity>& entities)
+static void updateOtherEntities(Visor::EntityStore& entities, const std::vector<Visor::EntityId>& others, Visor::EntityId player, Visor::f32 stepDuration)
 {
 	static Visor::f32 toy = 0.0f;
-	for(Visor::ui32 i = 2; i < entities.size(); ++i)
-	{
-		Visor::Vector3<Visor::f32> direction = entities[0].position - entities[i].position;
-		direction.normalize();
+	entities.lookAt(others, entities.getPosition(player));
 
-		Visor::f32 yaw = 0.0f;
-		Visor::f32 pitch = 0.0f;
-		Visor::f32 roll = 0.0f;
-
-		Visor::getAnglesFromDirection(direction, yaw, pitch, roll);
-
-		entities[i].yaw = yaw;
-		entities[i].pitch = pitch;
-		entities[i].roll = roll;
-		entities[i].scaleX = std::abs(std::cosf(toy)) * 0.3f + 0.3f;
-		entities[i].scaleZ = std::abs(std::cosf(toy)) * 0.3f + 0.3f;
+	for(const Visor::EntityId& other : others)
+	{
+		Visor::Vector3<Visor::f32> scale = entities.getScale(other);
+		scale.x = std::abs(std::cosf(toy)) * 0.3f + 0.3f;
+		scale.z = std::abs(std::cosf(toy)) * 0.3f + 0.3f;
+		entities.setScale(other, scale);
 	}
-	toy += 0.01f;
-}
-
-static void updateCamera(const Visor::Entity& player, Visor::Camera& camera)
-{
-	Visor::Vector3<Visor::f32> playerViewDir = {
-			0.0f,
-			0.0f,
-			1.0f,
-	};
-
-	const Visor::Matrix4<Visor::f32> translation = Visor::Matrix4<Visor::f32>::getTranslation(player.position);
-	const Visor::Matrix4<Visor::f32> rotation = Visor::Matrix4<Visor::f32>::getRotation(player.yaw, player.pitch, 0.0f);
-	const Visor::Vector3<Visor::f32> rotatedForward = rotation.getUpperLeft() * playerViewDir;
-
-	Visor::Vector4<Visor::f32> cameraPosition = {1.5f, 1.5f, -5.0f, 1.0f};
-	cameraPosition = translation * rotation * cameraPosition;
-	
-	camera.position.x = cameraPosition.x;
-	camera.position.y = cameraPosition.y;
-	camera.position.z = cameraPosition.z;
-
-	camera.yaw = player.yaw;
-	camera.pitch = player.pitch;
+	toy += 0.6f * stepDuration;
 }
 
 static Visor::Mesh getAABBMesh(const Visor::AABB& AABB)
@@ -191,63 +128,153 @@ static Visor::Mesh getAABBMesh(const Visor::AABB& AABB)
 		0, 5, 1, 0, 3, 5
 	};
 
-	return Visor::Mesh(vertices, indices, "../assets/shaders/intermediate/vertex.spv", "../assets/shaders/intermediate/fragment.spv");
+	Visor::Mesh mesh(vertices, indices, "../assets/shaders/intermediate/vertex.spv", "../assets/shaders/intermediate/fragment.spv");
+	mesh.buildBVH();
+
+	return mesh;
 }
 
 int main()
 {
-	std::vector<Visor::Entity> entities;
+	Visor::JobSystem::start(std::max(std::thread::hardware_concurrency(), 1u));
+	Visor::MeshRegistry::start();
+	Visor::AssetSystem::start("../assets/shaders/intermediate/vertex.spv", "../assets/shaders/intermediate/fragment.spv");
+
+	Visor::EntityStore entities;
 	
-	const Visor::Mesh cubeMesh = loadMesh("../assets/models/cube.obj");
-	const Visor::Mesh manMesh = loadMesh("../assets/models/man.obj");
+	// meshes are streamed in the background, entities show a placeholder until their mesh is ready
+	const Visor::MeshHandle cubeMesh = Visor::AssetSystem::getInstance().requestMesh("../assets/models/cube.obj", "../assets/shaders/intermediate/vertex.spv", "../assets/shaders/intermediate/fragment.spv", false);
+	const Visor::MeshHandle manMesh = Visor::AssetSystem::getInstance().requestMesh("../assets/models/man.obj", "../assets/shaders/intermediate/vertex.spv", "../assets/shaders/intermediate/fragment.spv", true);
 
 	Visor::AABB playerAABB({0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f});
-	Visor::Entity playerAABBEntity(playerAABB.minimum, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, getAABBMesh(playerAABB));
-	entities.push_back(playerAABBEntity);
+	const Visor::MeshHandle playerAABBMesh = Visor::MeshRegistry::getInstance().registerMesh(getAABBMesh(playerAABB));
+	const Visor::EntityId player = entities.createEntity(playerAABB.minimum, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, playerAABBMesh);
 	
 	Visor::AABB targetAABB({1.0f, 0.0f, 0.0f}, {2.0f, 2.0f, 1.0f});
-	Visor::Entity targetAABBEntity(targetAABB.minimum, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, getAABBMesh(targetAABB));
-	entities.push_back(targetAABBEntity);
+	const Visor::MeshHandle targetAABBMesh = Visor::MeshRegistry::getInstance().registerMesh(getAABBMesh(targetAABB));
+	const Visor::EntityId target = entities.createEntity(targetAABB.minimum, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, targetAABBMesh);
+	entities.setOccluder(target, true);
+	
+	// the camera follows the player through the hierarchy
+	const Visor::EntityId cameraAnchor = entities.createEntity({1.5f, 1.5f, -5.0f}, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, Visor::NullMeshHandle);
+	entities.setParent(cameraAnchor, player);
 	
 	//addRandomEntities(manMesh, entities);
+	std::vector<Visor::EntityId> others;
+	for(Visor::ui32 entityIndex = 3; entityIndex < entities.getEntityCount(); ++entityIndex)
+	{
+		others.push_back(entities.getId(entityIndex));
+	}
 	
 	Visor::InputSystem::start();
 	Visor::WindowSystem::start(1000, 700);
-	Visor::RenderSystem::start();
+	Visor::RenderSystem::start(HasRenderThread);
 	
 	Visor::Camera camera = {};
 	camera.fov = 1.2f;
+	camera.orientation = Visor::Quaternion<Visor::f32>::getIdentity();
 	
 	Visor::Ray ray({0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f});
+	Visor::EntityTree entityTree;
+
+	Visor::SimulationClock simulationClock(SimulationStepDuration, MaximumSimulationStepCount);
+	Visor::TransformHistory transformHistory;
+	transformHistory.capture(entities);
+	Visor::f32 mouseDeltaX = 0.0f;
+	Visor::f32 mouseDeltaY = 0.0f;
+	std::chrono::steady_clock::time_point previousFrameTime = std::chrono::steady_clock::now();
 	
 	while(!Visor::WindowSystem::getInstance().getWindow().shouldClose())
 	{
 		Visor::InputSystem::getInstance().update();
 		Visor::WindowSystem::getInstance().pollEvents();
 
-		updatePlayer(entities[0]);
-		updateOtherEntities(entities);
-		updateCamera(entities[0], camera);
+		Visor::f32 currentMouseX = 0.0f;
+		Visor::f32 currentMouseY = 0.0f;
+		Visor::InputSystem::getInstance().getMousePosition(currentMouseX, currentMouseY);
 
-		ray.position = entities[0].position;
-		ray.direction = Visor::getDirectionFromAngles(entities[0].yaw, entities[0].pitch, entities[0].roll);
+		Visor::f32 previousMouseX = 0.0f;
+		Visor::f32 previousMouseY = 0.0f;
+		Visor::InputSystem::getInstance().getPreviousMousePosition(previousMouseX, previousMouseY);
 
-		Visor::Vector3<Visor::f32> intersection;
-		if(ray.getIntersection(targetAABB, intersection))
+		mouseDeltaX += previousMouseX - currentMouseX;
+		mouseDeltaY += previousMouseY - currentMouseY;
+
+		const std::chrono::steady_clock::time_point frameTime = std::chrono::steady_clock::now();
+		const Visor::ui32 stepCount = simulationClock.advance(std::chrono::duration<Visor::f64>(frameTime - previousFrameTime).count());
+		previousFrameTime = frameTime;
+
+		const Visor::f32 stepDuration = (Visor::f32)simulationClock.getStepDuration();
+		for(Visor::ui32 stepIndex = 0; stepIndex < stepCount; ++stepIndex)
 		{
-			std::cout << "hit !\n";
+			updatePlayer(entities, player, stepDuration, mouseDeltaX, mouseDeltaY);
+			updateOtherEntities(entities, others, player, stepDuration);
+			transformHistory.capture(entities);
+
+			mouseDeltaX = 0.0f;
+			mouseDeltaY = 0.0f;
+		}
+
+		entities.updateTransformationMatrices();
+
+		ray.position = entities.getPosition(player);
+		ray.setDirection(entities.getOrientation(player) * Visor::Vector3<Visor::f32>{0.0f, 0.0f, 1.0f});
+
+		// picks the closest entity in front of the player, the ray starts inside the player box
+		entityTree.update(entities);
+		Visor::EntityId hitEntity = {};
+		Visor::f32 hitDistance = 0.0f;
+		const Visor::b8 hit = entityTree.raycast(ray, 1000.0f, [&entities, &ray, player](Visor::EntityId entity, Visor::f32)
+		{
+			// the box only tells the ray may hit the mesh, its triangles tell where
+			Visor::RayHit triangleHit = {};
+			if(entity == player || !Visor::intersectEntity(entities, entity, ray, 1000.0f, triangleHit))
+			{
+				return -1.0f;
+			}
+
+			return triangleHit.distance;
+		}, hitEntity, hitDistance);
+
+		if(hit)
+		{
+			std::cout << "hit " << hitEntity.index << " at " << hitDistance << "\n";
 		}
 		else
 		{
 			std::cout << "miss\n";
 		}
 		
+		// the render thread is done with the meshes of the previous frame, the streamed ones can replace them
+		Visor::RenderSystem::getInstance().synchronize();
+		Visor::AssetSystem::getInstance().update();
+
+		// drawn between the last two steps, then put back where the simulation left them
+		transformHistory.apply(entities, simulationClock.getInterpolationFactor());
+		entities.updateTransformationMatrices();
+		camera.setTransformation(entities.getTransformationMatrix(cameraAnchor));
 		Visor::RenderSystem::getInstance().render(camera, entities);
+		transformHistory.restore(entities);
+
+		// T dumps what the occlusion culling sees
+		if(Visor::InputSystem::getInstance().isKeyPressed(Visor::InputSystem::Key::T))
+		{
+			Visor::RenderSystem::getInstance().writeOcclusionDepthImage("occlusion_depth.pgm");
+		}
 	}
 
 	Visor::RenderSystem::terminate();
 	Visor::WindowSystem::terminate();
 	Visor::InputSystem::terminate();
 
+	entities.clear();
+	Visor::MeshRegistry::getInstance().release(cubeMesh);
+	Visor::MeshRegistry::getInstance().release(manMesh);
+	Visor::MeshRegistry::getInstance().release(playerAABBMesh);
+	Visor::MeshRegistry::getInstance().release(targetAABBMesh);
+	Visor::AssetSystem::terminate();
+	Visor::MeshRegistry::terminate();
+	Visor::JobSystem::terminate();
+
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,699 @@
+#include "maths.h"
+#include "types.h"
+#include "job_system.h"
+
+#include <cmath>
+
+namespace Visor
+{
+	// ===== Lanes =====
+	// the approximations below are written once over these functions, for one float or a vector of floats,
+	// so the remainders of the arrays computed one float at a time get the same results as the vectors
+	#if defined(VSR_MATHS_AVX)
+		typedef __m256 VectorLanes;
+	#elif defined(VSR_MATHS_SSE)
+		typedef __m128 VectorLanes;
+	#endif
+
+	template<typename Lanes>
+	static Lanes load(const f32* pValues);
+	template<typename Lanes>
+	static Lanes broadcast(f32 value);
+
+	template<>
+	inline f32 load<f32>(const f32* pValues) { return *pValues; }
+	template<>
+	inline f32 broadcast<f32>(f32 value) { return value; }
+	static inline void store(f32* pValues, f32 values) { *pValues = values; }
+	static inline f32 add(f32 a, f32 b) { return a + b; }
+	static inline f32 sub(f32 a, f32 b) { return a - b; }
+	static inline f32 mul(f32 a, f32 b) { return a * b; }
+	static inline f32 div(f32 a, f32 b) { return a / b; }
+	static inline f32 minimum(f32 a, f32 b) { return a < b ? a : b; }
+	static inline f32 maximum(f32 a, f32 b) { return a > b ? a : b; }
+	static inline f32 negate(f32 value) { return -value; }
+	static inline f32 absolute(f32 value) { return std::abs(value); }
+	static inline f32 flipSign(f32 value, f32 source) { return std::signbit(source) ? -value : value; }
+	// out of range values do not matter, but converting them to an integer is undefined
+	static inline f32 truncate(f32 value) { return std::abs(value) < 2147483648.0f ? (f32)(i32)value : value; }
+	static inline f32 squareRoot(f32 value) { return std::sqrt(value); }
+	static inline b8 isLess(f32 a, f32 b) { return a < b; }
+	static inline b8 isGreater(f32 a, f32 b) { return a > b; }
+	static inline b8 isEqual(f32 a, f32 b) { return a == b; }
+	static inline b8 maskOr(b8 a, b8 b) { return a || b; }
+	static inline f32 select(b8 mask, f32 a, f32 b) { return mask ? a : b; }
+	static inline b8 allTrue(b8 mask) { return mask; }
+	static inline b8 anyTrue(b8 mask) { return mask; }
+
+	#if defined(VSR_MATHS_AVX)
+		template<>
+		inline __m256 load<__m256>(const f32* pValues) { return _mm256_loadu_ps(pValues); }
+		template<>
+		inline __m256 broadcast<__m256>(f32 value) { return _mm256_set1_ps(value); }
+		static inline void store(f32* pValues, __m256 values) { _mm256_storeu_ps(pValues, values); }
+		static inline __m256 add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+		static inline __m256 sub(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+		static inline __m256 mul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+		static inline __m256 div(__m256 a, __m256 b) { return _mm256_div_ps(a, b); }
+		static inline __m256 minimum(__m256 a, __m256 b) { return _mm256_min_ps(a, b); }
+		static inline __m256 maximum(__m256 a, __m256 b) { return _mm256_max_ps(a, b); }
+		static inline __m256 negate(__m256 value) { return _mm256_xor_ps(value, _mm256_set1_ps(-0.0f)); }
+		static inline __m256 absolute(__m256 value) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), value); }
+		static inline __m256 flipSign(__m256 value, __m256 source) { return _mm256_xor_ps(value, _mm256_and_ps(source, _mm256_set1_ps(-0.0f))); }
+		static inline __m256 truncate(__m256 value) { return _mm256_cvtepi32_ps(_mm256_cvttps_epi32(value)); }
+		static inline __m256 squareRoot(__m256 value) { return _mm256_sqrt_ps(value); }
+		static inline __m256 isLess(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		static inline __m256 isGreater(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+		static inline __m256 isEqual(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+		static inline __m256 maskOr(__m256 a, __m256 b) { return _mm256_or_ps(a, b); }
+		static inline __m256 select(__m256 mask, __m256 a, __m256 b) { return _mm256_blendv_ps(b, a, mask); }
+		static inline b8 allTrue(__m256 mask) { return _mm256_movemask_ps(mask) == 0xFF; }
+		static inline b8 anyTrue(__m256 mask) { return _mm256_movemask_ps(mask) != 0; }
+	#elif defined(VSR_MATHS_SSE)
+		template<>
+		inline __m128 load<__m128>(const f32* pValues) { return _mm_loadu_ps(pValues); }
+		template<>
+		inline __m128 broadcast<__m128>(f32 value) { return _mm_set1_ps(value); }
+		static inline void store(f32* pValues, __m128 values) { _mm_storeu_ps(pValues, values); }
+		static inline __m128 add(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+		static inline __m128 sub(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+		static inline __m128 mul(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+		static inline __m128 div(__m128 a, __m128 b) { return _mm_div_ps(a, b); }
+		static inline __m128 minimum(__m128 a, __m128 b) { return _mm_min_ps(a, b); }
+		static inline __m128 maximum(__m128 a, __m128 b) { return _mm_max_ps(a, b); }
+		static inline __m128 negate(__m128 value) { return _mm_xor_ps(value, _mm_set1_ps(-0.0f)); }
+		static inline __m128 absolute(__m128 value) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), value); }
+		static inline __m128 flipSign(__m128 value, __m128 source) { return _mm_xor_ps(value, _mm_and_ps(source, _mm_set1_ps(-0.0f))); }
+		static inline __m128 truncate(__m128 value) { return _mm_cvtepi32_ps(_mm_cvttps_epi32(value)); }
+		static inline __m128 squareRoot(__m128 value) { return _mm_sqrt_ps(value); }
+		static inline __m128 isLess(__m128 a, __m128 b) { return _mm_cmplt_ps(a, b); }
+		static inline __m128 isGreater(__m128 a, __m128 b) { return _mm_cmpgt_ps(a, b); }
+		static inline __m128 isEqual(__m128 a, __m128 b) { return _mm_cmpeq_ps(a, b); }
+		static inline __m128 maskOr(__m128 a, __m128 b) { return _mm_or_ps(a, b); }
+		static inline __m128 select(__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+		static inline b8 allTrue(__m128 mask) { return _mm_movemask_ps(mask) == 0xF; }
+		static inline b8 anyTrue(__m128 mask) { return _mm_movemask_ps(mask) != 0; }
+	#endif
+
+	// the hardware estimate (12 bits) refined by a step of newton's method, the same estimate for vectors and single floats
+	static inline f32 reciprocalSquareRootEstimate(f32 value)
+	{
+	#if defined(VSR_MATHS_SSE)
+		return _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(value)));
+	#else
+		return 1.0f / std::sqrt(value);
+	#endif
+	}
+	#if defined(VSR_MATHS_AVX)
+		static inline __m256 reciprocalSquareRootEstimate(__m256 value) { return _mm256_rsqrt_ps(value); }
+	#elif defined(VSR_MATHS_SSE)
+		static inline __m128 reciprocalSquareRootEstimate(__m128 value) { return _mm_rsqrt_ps(value); }
+	#endif
+
+	// ===== Approximations =====
+	static const f32 Pi = 3.14159265f;
+	static const f32 HalfPi = 1.57079633f;
+	static const f32 QuarterPi = 0.785398163f;
+
+	// sine and cosine after reducing the angle to [-pi/4, pi/4] around the nearest multiple of pi/2, polynomials of cephes
+	static const f32 SinCosLimit = 8192.0f;
+	static const f32 TwoOverPi = 0.636619772f;
+	// pi / 2 split in parts whose products with the quadrant are exact
+	static const f32 HalfPi0 = 1.5703125f;
+	static const f32 HalfPi1 = 4.837512969970703125e-4f;
+	static const f32 HalfPi2 = 7.54978995489188216e-8f;
+	static const f32 Sin0 = -1.9515295891e-4f;
+	static const f32 Sin1 = 8.3321608736e-3f;
+	static const f32 Sin2 = -1.6666654611e-1f;
+	static const f32 Cos0 = 2.443315711809948e-5f;
+	static const f32 Cos1 = -1.388731625493765e-3f;
+	static const f32 Cos2 = 4.166664568298827e-2f;
+
+	// returns whether some angles are beyond the limit, their results are not valid
+	template<typename Lanes>
+	static b8 getSinCos(Lanes angles, Lanes& sines, Lanes& cosines)
+	{
+		const Lanes absoluteAngles = absolute(angles);
+		const Lanes quadrants = truncate(add(mul(absoluteAngles, broadcast<Lanes>(TwoOverPi)), broadcast<Lanes>(0.5f)));
+		Lanes reduced = sub(absoluteAngles, mul(quadrants, broadcast<Lanes>(HalfPi0)));
+		reduced = sub(reduced, mul(quadrants, broadcast<Lanes>(HalfPi1)));
+		reduced = sub(reduced, mul(quadrants, broadcast<Lanes>(HalfPi2)));
+		const Lanes reduced2 = mul(reduced, reduced);
+
+		Lanes polynomialSines = add(mul(reduced2, broadcast<Lanes>(Sin0)), broadcast<Lanes>(Sin1));
+		polynomialSines = add(mul(polynomialSines, reduced2), broadcast<Lanes>(Sin2));
+		polynomialSines = add(mul(mul(polynomialSines, reduced2), reduced), reduced);
+
+		Lanes polynomialCosines = add(mul(reduced2, broadcast<Lanes>(Cos0)), broadcast<Lanes>(Cos1));
+		polynomialCosines = add(mul(polynomialCosines, reduced2), broadcast<Lanes>(Cos2));
+		polynomialCosines = sub(mul(mul(polynomialCosines, reduced2), reduced2), mul(reduced2, broadcast<Lanes>(0.5f)));
+		polynomialCosines = add(polynomialCosines, broadcast<Lanes>(1.0f));
+
+		// the quadrant modulo 4 picks which polynomial gives which function, and their signs
+		const Lanes quadrantIndices = sub(quadrants, mul(truncate(mul(quadrants, broadcast<Lanes>(0.25f))), broadcast<Lanes>(4.0f)));
+		const auto isQuadrant1 = isEqual(quadrantIndices, broadcast<Lanes>(1.0f));
+		const auto isQuadrant2 = isEqual(quadrantIndices, broadcast<Lanes>(2.0f));
+		const auto isQuadrant3 = isEqual(quadrantIndices, broadcast<Lanes>(3.0f));
+
+		const auto isSwapped = maskOr(isQuadrant1, isQuadrant3);
+		sines = select(isSwapped, polynomialCosines, polynomialSines);
+		cosines = select(isSwapped, polynomialSines, polynomialCosines);
+		sines = flipSign(select(maskOr(isQuadrant2, isQuadrant3), negate(sines), sines), angles);
+		cosines = select(maskOr(isQuadrant1, isQuadrant2), negate(cosines), cosines);
+
+		// comparisons with nans are false, so they are caught too
+		return !allTrue(isLess(absoluteAngles, broadcast<Lanes>(SinCosLimit)));
+	}
+
+	// arctangent of the ratio of the smallest to the largest coordinate, reduced to [-tan(pi/8), tan(pi/8)], polynomial of cephes
+	static const f32 TanEighthPi = 0.414213562f;
+	static const f32 Atan0 = 8.05374449538e-2f;
+	static const f32 Atan1 = -1.38776856032e-1f;
+	static const f32 Atan2 = 1.99777106478e-1f;
+	static const f32 Atan3 = -3.33329491539e-1f;
+
+	template<typename Lanes>
+	static Lanes getAtan2(Lanes y, Lanes x)
+	{
+		const Lanes zero = broadcast<Lanes>(0.0f);
+		const Lanes one = broadcast<Lanes>(1.0f);
+		const Lanes absoluteX = absolute(x);
+		const Lanes absoluteY = absolute(y);
+
+		const auto isSteep = isGreater(absoluteY, absoluteX);
+		const Lanes smallest = select(isSteep, absoluteX, absoluteY);
+		const Lanes largest = select(isSteep, absoluteY, absoluteX);
+		const Lanes ratio = select(isEqual(largest, zero), zero, div(smallest, largest));
+
+		const auto isAboveEighth = isGreater(ratio, broadcast<Lanes>(TanEighthPi));
+		const Lanes reduced = select(isAboveEighth, div(sub(ratio, one), add(ratio, one)), ratio);
+		const Lanes reduced2 = mul(reduced, reduced);
+
+		Lanes angles = add(mul(reduced2, broadcast<Lanes>(Atan0)), broadcast<Lanes>(Atan1));
+		angles = add(mul(angles, reduced2), broadcast<Lanes>(Atan2));
+		angles = add(mul(angles, reduced2), broadcast<Lanes>(Atan3));
+		angles = add(mul(mul(angles, reduced2), reduced), reduced);
+		angles = add(angles, select(isAboveEighth, broadcast<Lanes>(QuarterPi), zero));
+
+		// back to the full circle
+		angles = select(isSteep, sub(broadcast<Lanes>(HalfPi), angles), angles);
+		angles = select(isLess(x, zero), sub(broadcast<Lanes>(Pi), angles), angles);
+
+		return flipSign(angles, y);
+	}
+
+	// polynomial of cephes, on x for |x| <= 0.5, else through asin(x) = pi/2 - 2.asin(sqrt((1 - x) / 2))
+	static const f32 Asin0 = 4.2163199048e-2f;
+	static const f32 Asin1 = 2.4181311049e-2f;
+	static const f32 Asin2 = 4.5470025998e-2f;
+	static const f32 Asin3 = 7.4953002686e-2f;
+	static const f32 Asin4 = 1.6666752422e-1f;
+
+	template<typename Lanes>
+	static Lanes getAsin(Lanes values)
+	{
+		const Lanes absoluteValues = absolute(values);
+		const auto isAboveHalf = isGreater(absoluteValues, broadcast<Lanes>(0.5f));
+
+		const Lanes halfComplements = mul(sub(broadcast<Lanes>(1.0f), absoluteValues), broadcast<Lanes>(0.5f));
+		const Lanes variables = select(isAboveHalf, squareRoot(halfComplements), absoluteValues);
+		const Lanes variables2 = select(isAboveHalf, halfComplements, mul(absoluteValues, absoluteValues));
+
+		Lanes angles = add(mul(variables2, broadcast<Lanes>(Asin0)), broadcast<Lanes>(Asin1));
+		angles = add(mul(angles, variables2), broadcast<Lanes>(Asin2));
+		angles = add(mul(angles, variables2), broadcast<Lanes>(Asin3));
+		angles = add(mul(angles, variables2), broadcast<Lanes>(Asin4));
+		angles = add(mul(mul(angles, variables2), variables), variables);
+
+		angles = select(isAboveHalf, sub(broadcast<Lanes>(HalfPi), add(angles, angles)), angles);
+
+		return flipSign(angles, values);
+	}
+
+	template<typename Lanes>
+	static Lanes getReciprocalSquareRoot(Lanes values)
+	{
+		// x' = x.(1.5 - 0.5.v.x.x)
+		const Lanes estimates = reciprocalSquareRootEstimate(values);
+		const Lanes halfValues = mul(values, broadcast<Lanes>(0.5f));
+
+		return mul(estimates, sub(broadcast<Lanes>(1.5f), mul(mul(halfValues, estimates), estimates)));
+	}
+
+	// ===== Array functions =====
+	// each runs the vectors over the start of the range and returns where they stopped, then runs again on floats for the rest
+	template<typename Lanes>
+	static ui32 computeSinCos(const f32* pAngles, ui32 begin, ui32 end, f32* pSines, f32* pCosines)
+	{
+		const ui32 laneCount = sizeof(Lanes) / sizeof(f32);
+
+		ui32 index = begin;
+		for (; index + laneCount <= end; index += laneCount)
+		{
+			Lanes sines;
+			Lanes cosines;
+			const b8 isBeyondLimit = getSinCos(load<Lanes>(pAngles + index), sines, cosines);
+			store(pSines + index, sines);
+			store(pCosines + index, cosines);
+
+			// the reduction loses precision far from zero
+			if (isBeyondLimit)
+			{
+				for (ui32 lane = index; lane < index + laneCount; ++lane)
+				{
+					if (!(std::abs(pAngles[lane]) < SinCosLimit))
+					{
+						pSines[lane] = std::sin(pAngles[lane]);
+						pCosines[lane] = std::cos(pAngles[lane]);
+					}
+				}
+			}
+		}
+
+		return index;
+	}
+
+	template<typename Lanes>
+	static ui32 computeAtan2(const f32* pY, const f32* pX, ui32 begin, ui32 end, f32* pAngles)
+	{
+		const ui32 laneCount = sizeof(Lanes) / sizeof(f32);
+
+		ui32 index = begin;
+		for (; index + laneCount <= end; index += laneCount)
+		{
+			store(pAngles + index, getAtan2(load<Lanes>(pY + index), load<Lanes>(pX + index)));
+		}
+
+		return index;
+	}
+
+	template<typename Lanes>
+	static ui32 computeAsin(const f32* pValues, ui32 begin, ui32 end, f32* pAngles)
+	{
+		const ui32 laneCount = sizeof(Lanes) / sizeof(f32);
+
+		ui32 index = begin;
+		for (; index + laneCount <= end; index += laneCount)
+		{
+			store(pAngles + index, getAsin(load<Lanes>(pValues + index)));
+		}
+
+		return index;
+	}
+
+	template<typename Lanes>
+	static ui32 computeReciprocalSquareRoot(const f32* pValues, ui32 begin, ui32 end, f32* pResults)
+	{
+		const ui32 laneCount = sizeof(Lanes) / sizeof(f32);
+
+		ui32 index = begin;
+		for (; index + laneCount <= end; index += laneCount)
+		{
+			store(pResults + index, getReciprocalSquareRoot(load<Lanes>(pValues + index)));
+		}
+
+		return index;
+	}
+
+	template<typename Lanes>
+	static ui32 computeLookAtOrientations(const f32* pPositionsX, const f32* pPositionsY, const f32* pPositionsZ, const Vector3<f32>& target, 
+		ui32 begin, ui32 end, f32* pOrientationsX, f32* pOrientationsY, f32* pOrientationsZ, f32* pOrientationsW)
+	{
+		const ui32 laneCount = sizeof(Lanes) / sizeof(f32);
+		const Lanes zero = broadcast<Lanes>(0.0f);
+		const Lanes one = broadcast<Lanes>(1.0f);
+		const Lanes half = broadcast<Lanes>(0.5f);
+
+		ui32 index = begin;
+		for (; index + laneCount <= end; index += laneCount)
+		{
+			const Lanes directionsX = sub(broadcast<Lanes>(target.x), load<Lanes>(pPositionsX + index));
+			const Lanes directionsY = sub(broadcast<Lanes>(target.y), load<Lanes>(pPositionsY + index));
+			const Lanes directionsZ = sub(broadcast<Lanes>(target.z), load<Lanes>(pPositionsZ + index));
+			const Lanes squaredDistances = add(add(mul(directionsX, directionsX), mul(directionsY, directionsY)), mul(directionsZ, directionsZ));
+
+			// the angles of getAnglesFromDirection, the approximate normalization can push the height a little past 1
+			const Lanes heights = minimum(maximum(mul(directionsY, getReciprocalSquareRoot(squaredDistances)), negate(one)), one);
+			const Lanes yaws = getAtan2(negate(directionsX), directionsZ);
+			const Lanes pitches = getAsin(heights);
+
+			// the product of the yaw and pitch rotations of Quaternion::getFromAngles, on half angles
+			Lanes sinYaws;
+			Lanes cosYaws;
+			Lanes sinPitches;
+			Lanes cosPitches;
+			getSinCos(mul(yaws, half), sinYaws, cosYaws);
+			getSinCos(mul(pitches, half), sinPitches, cosPitches);
+
+			// nothing to look at from the target itself
+			const auto isAtTarget = isEqual(squaredDistances, zero);
+			store(pOrientationsX + index, select(isAtTarget, zero, negate(mul(cosYaws, sinPitches))));
+			store(pOrientationsY + index, select(isAtTarget, zero, negate(mul(sinYaws, cosPitches))));
+			store(pOrientationsZ + index, select(isAtTarget, zero, negate(mul(sinYaws, sinPitches))));
+			store(pOrientationsW + index, select(isAtTarget, one, mul(cosYaws, cosPitches)));
+		}
+
+		return index;
+	}
+
+	void computeSinCos(const f32* pAngles, ui32 count, f32* pSines, f32* pCosines)
+	{
+		ui32 index = 0;
+	#if defined(VSR_MATHS_SSE)
+		index = computeSinCos<VectorLanes>(pAngles, index, count, pSines, pCosines);
+	#endif
+		computeSinCos<f32>(pAngles, index, count, pSines, pCosines);
+	}
+
+	void computeAtan2(const f32* pY, const f32* pX, ui32 count, f32* pAngles)
+	{
+		ui32 index = 0;
+	#if defined(VSR_MATHS_SSE)
+		index = computeAtan2<VectorLanes>(pY, pX, index, count, pAngles);
+	#endif
+		computeAtan2<f32>(pY, pX, index, count, pAngles);
+	}
+
+	void computeAsin(const f32* pValues, ui32 count, f32* pAngles)
+	{
+		ui32 index = 0;
+	#if defined(VSR_MATHS_SSE)
+		index = computeAsin<VectorLanes>(pValues, index, count, pAngles);
+	#endif
+		computeAsin<f32>(pValues, index, count, pAngles);
+	}
+
+	void computeReciprocalSquareRoot(const f32* pValues, ui32 count, f32* pResults)
+	{
+		ui32 index = 0;
+	#if defined(VSR_MATHS_SSE)
+		index = computeReciprocalSquareRoot<VectorLanes>(pValues, index, count, pResults);
+	#endif
+		computeReciprocalSquareRoot<f32>(pValues, index, count, pResults);
+	}
+
+	void computeLookAtOrientations(const f32* pPositionsX, const f32* pPositionsY, const f32* pPositionsZ, const Vector3<f32>& target, 
+		ui32 count, f32* pOrientationsX, f32* pOrientationsY, f32* pOrientationsZ, f32* pOrientationsW)
+	{
+		ui32 index = 0;
+	#if defined(VSR_MATHS_SSE)
+		index = computeLookAtOrientations<VectorLanes>(pPositionsX, pPositionsY, pPositionsZ, target, index, count, pOrientationsX, pOrientationsY, pOrientationsZ, pOrientationsW);
+	#endif
+		computeLookAtOrientations<f32>(pPositionsX, pPositionsY, pPositionsZ, target, index, count, pOrientationsX, pOrientationsY, pOrientationsZ, pOrientationsW);
+	}
+
+	// ===== Transform batches =====
+	#if defined(VSR_MATHS_AVX)
+		// the same row of eight matrices from its four columns, each holding one element of the eight matrices
+		static void storeRows(__m256 column0, __m256 column1, __m256 column2, __m256 column3, ui32 row, Matrix4<f32>* pMatrices)
+		{
+			const __m256 low01 = _mm256_unpacklo_ps(column0, column1);
+			const __m256 high01 = _mm256_unpackhi_ps(column0, column1);
+			const __m256 low23 = _mm256_unpacklo_ps(column2, column3);
+			const __m256 high23 = _mm256_unpackhi_ps(column2, column3);
+
+			// matrices 0 to 3 in the low halves, 4 to 7 in the high ones
+			const __m256 rows04 = _mm256_shuffle_ps(low01, low23, 0x44);
+			const __m256 rows15 = _mm256_shuffle_ps(low01, low23, 0xEE);
+			const __m256 rows26 = _mm256_shuffle_ps(high01, high23, 0x44);
+			const __m256 rows37 = _mm256_shuffle_ps(high01, high23, 0xEE);
+
+			_mm_storeu_ps(pMatrices[0].m[row], _mm256_castps256_ps128(rows04));
+			_mm_storeu_ps(pMatrices[1].m[row], _mm256_castps256_ps128(rows15));
+			_mm_storeu_ps(pMatrices[2].m[row], _mm256_castps256_ps128(rows26));
+			_mm_storeu_ps(pMatrices[3].m[row], _mm256_castps256_ps128(rows37));
+			_mm_storeu_ps(pMatrices[4].m[row], _mm256_extractf128_ps(rows04, 1));
+			_mm_storeu_ps(pMatrices[5].m[row], _mm256_extractf128_ps(rows15, 1));
+			_mm_storeu_ps(pMatrices[6].m[row], _mm256_extractf128_ps(rows26, 1));
+			_mm_storeu_ps(pMatrices[7].m[row], _mm256_extractf128_ps(rows37, 1));
+		}
+	#elif defined(VSR_MATHS_SSE)
+		// the same row of four matrices from its four columns, each holding one element of the four matrices
+		static void storeRows(__m128 column0, __m128 column1, __m128 column2, __m128 column3, ui32 row, Matrix4<f32>* pMatrices)
+		{
+			_MM_TRANSPOSE4_PS(column0, column1, column2, column3);
+			_mm_storeu_ps(pMatrices[0].m[row], column0);
+			_mm_storeu_ps(pMatrices[1].m[row], column1);
+			_mm_storeu_ps(pMatrices[2].m[row], column2);
+			_mm_storeu_ps(pMatrices[3].m[row], column3);
+		}
+	#endif
+
+	void composeTransformationMatrices(const TransformArrays& transforms, ui32 begin, ui32 end, Matrix4<f32>* pMatrices)
+	{
+		// every element is computed with the same operations in the same order as Matrix4::getTransformation
+		ui32 index = begin;
+
+		#if defined(VSR_MATHS_AVX)
+			// eight transforms at once
+			const __m256 one = _mm256_set1_ps(1.0f);
+			const __m128 lastRow = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+			for (; index + 8 <= end; index += 8)
+			{
+				const __m256 x = _mm256_loadu_ps(transforms.pOrientationsX + index);
+				const __m256 y = _mm256_loadu_ps(transforms.pOrientationsY + index);
+				const __m256 z = _mm256_loadu_ps(transforms.pOrientationsZ + index);
+				const __m256 w = _mm256_loadu_ps(transforms.pOrientationsW + index);
+
+				const __m256 x2 = _mm256_add_ps(x, x);
+				const __m256 y2 = _mm256_add_ps(y, y);
+				const __m256 z2 = _mm256_add_ps(z, z);
+				const __m256 xx = _mm256_mul_ps(x, x2);
+				const __m256 yy = _mm256_mul_ps(y, y2);
+				const __m256 zz = _mm256_mul_ps(z, z2);
+				const __m256 xy = _mm256_mul_ps(x, y2);
+				const __m256 xz = _mm256_mul_ps(x, z2);
+				const __m256 yz = _mm256_mul_ps(y, z2);
+				const __m256 wx = _mm256_mul_ps(w, x2);
+				const __m256 wy = _mm256_mul_ps(w, y2);
+				const __m256 wz = _mm256_mul_ps(w, z2);
+
+				const __m256 scaleX = _mm256_loadu_ps(transforms.pScalesX + index);
+				const __m256 scaleY = _mm256_loadu_ps(transforms.pScalesY + index);
+				const __m256 scaleZ = _mm256_loadu_ps(transforms.pScalesZ + index);
+
+				storeRows(
+					_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), scaleX),
+					_mm256_mul_ps(_mm256_sub_ps(xy, wz), scaleY),
+					_mm256_mul_ps(_mm256_add_ps(xz, wy), scaleZ),
+					_mm256_loadu_ps(transforms.pPositionsX + index),
+					0, pMatrices + index);
+
+				storeRows(
+					_mm256_mul_ps(_mm256_add_ps(xy, wz), scaleX),
+					_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), scaleY),
+					_mm256_mul_ps(_mm256_sub_ps(yz, wx), scaleZ),
+					_mm256_loadu_ps(transforms.pPositionsY + index),
+					1, pMatrices + index);
+
+				storeRows(
+					_mm256_mul_ps(_mm256_sub_ps(xz, wy), scaleX),
+					_mm256_mul_ps(_mm256_add_ps(yz, wx), scaleY),
+					_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), scaleZ),
+					_mm256_loadu_ps(transforms.pPositionsZ + index),
+					2, pMatrices + index);
+
+				for (ui32 lane = 0; lane < 8; ++lane)
+				{
+					_mm_storeu_ps(pMatrices[index + lane].m[3], lastRow);
+				}
+			}
+		#elif defined(VSR_MATHS_SSE)
+			// four transforms at once
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 lastRow = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+			for (; index + 4 <= end; index += 4)
+			{
+				const __m128 x = _mm_loadu_ps(transforms.pOrientationsX + index);
+				const __m128 y = _mm_loadu_ps(transforms.pOrientationsY + index);
+				const __m128 z = _mm_loadu_ps(transforms.pOrientationsZ + index);
+				const __m128 w = _mm_loadu_ps(transforms.pOrientationsW + index);
+
+				const __m128 x2 = _mm_add_ps(x, x);
+				const __m128 y2 = _mm_add_ps(y, y);
+				const __m128 z2 = _mm_add_ps(z, z);
+				const __m128 xx = _mm_mul_ps(x, x2);
+				const __m128 yy = _mm_mul_ps(y, y2);
+				const __m128 zz = _mm_mul_ps(z, z2);
+				const __m128 xy = _mm_mul_ps(x, y2);
+				const __m128 xz = _mm_mul_ps(x, z2);
+				const __m128 yz = _mm_mul_ps(y, z2);
+				const __m128 wx = _mm_mul_ps(w, x2);
+				const __m128 wy = _mm_mul_ps(w, y2);
+				const __m128 wz = _mm_mul_ps(w, z2);
+
+				const __m128 scaleX = _mm_loadu_ps(transforms.pScalesX + index);
+				const __m128 scaleY = _mm_loadu_ps(transforms.pScalesY + index);
+				const __m128 scaleZ = _mm_loadu_ps(transforms.pScalesZ + index);
+
+				storeRows(
+					_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), scaleX),
+					_mm_mul_ps(_mm_sub_ps(xy, wz), scaleY),
+					_mm_mul_ps(_mm_add_ps(xz, wy), scaleZ),
+					_mm_loadu_ps(transforms.pPositionsX + index),
+					0, pMatrices + index);
+
+				storeRows(
+					_mm_mul_ps(_mm_add_ps(xy, wz), scaleX),
+					_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), scaleY),
+					_mm_mul_ps(_mm_sub_ps(yz, wx), scaleZ),
+					_mm_loadu_ps(transforms.pPositionsY + index),
+					1, pMatrices + index);
+
+				storeRows(
+					_mm_mul_ps(_mm_sub_ps(xz, wy), scaleX),
+					_mm_mul_ps(_mm_add_ps(yz, wx), scaleY),
+					_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), scaleZ),
+					_mm_loadu_ps(transforms.pPositionsZ + index),
+					2, pMatrices + index);
+
+				for (ui32 lane = 0; lane < 4; ++lane)
+				{
+					_mm_storeu_ps(pMatrices[index + lane].m[3], lastRow);
+				}
+			}
+		#endif
+
+		// remaining transforms, or all of them without SIMD
+		for (; index < end; ++index)
+		{
+			pMatrices[index] = Matrix4<f32>::getTransformation(
+				Vector3<f32>{transforms.pPositionsX[index], transforms.pPositionsY[index], transforms.pPositionsZ[index]},
+				Quaternion<f32>{transforms.pOrientationsX[index], transforms.pOrientationsY[index], transforms.pOrientationsZ[index], transforms.pOrientationsW[index]},
+				Vector3<f32>{transforms.pScalesX[index], transforms.pScalesY[index], transforms.pScalesZ[index]});
+		}
+	}
+
+	void composeTransformationMatricesParallel(const TransformArrays& transforms, ui32 count, Matrix4<f32>* pMatrices)
+	{
+		// batches are a multiple of the SIMD width, only the last one has a scalar remainder
+		JobSystem::getInstance().parallelFor(count, 1024, [&transforms, pMatrices](ui32 begin, ui32 end)
+		{
+			composeTransformationMatrices(transforms, begin, end, pMatrices);
+		});
+	}
+
+	// ===== Vector batches =====
+	// the operations of the Vector3 templates in the same order, so the floats get the same results as the vectors
+	template<typename Lanes>
+	static ui32 computeDots(const VectorArrays& vectorsA, const VectorArrays& vectorsB, ui32 begin, ui32 end, f32* pDots)
+	{
+		const ui32 laneCount = sizeof(Lanes) / sizeof(f32);
+
+		ui32 index = begin;
+		for (; index + laneCount <= end; index += laneCount)
+		{
+			const Lanes products = add(add(
+				mul(load<Lanes>(vectorsA.pX + index), load<Lanes>(vectorsB.pX + index)),
+				mul(load<Lanes>(vectorsA.pY + index), load<Lanes>(vectorsB.pY + index))),
+				mul(load<Lanes>(vectorsA.pZ + index), load<Lanes>(vectorsB.pZ + index)));
+			store(pDots + index, products);
+		}
+
+		return index;
+	}
+
+	template<typename Lanes>
+	static ui32 computeCrosses(const VectorArrays& vectorsA, const VectorArrays& vectorsB, ui32 begin, ui32 end, f32* pResultsX, f32* pResultsY, f32* pResultsZ)
+	{
+		const ui32 laneCount = sizeof(Lanes) / sizeof(f32);
+
+		ui32 index = begin;
+		for (; index + laneCount <= end; index += laneCount)
+		{
+			const Lanes xA = load<Lanes>(vectorsA.pX + index);
+			const Lanes yA = load<Lanes>(vectorsA.pY + index);
+			const Lanes zA = load<Lanes>(vectorsA.pZ + index);
+			const Lanes xB = load<Lanes>(vectorsB.pX + index);
+			const Lanes yB = load<Lanes>(vectorsB.pY + index);
+			const Lanes zB = load<Lanes>(vectorsB.pZ + index);
+			store(pResultsX + index, sub(mul(yA, zB), mul(zA, yB)));
+			store(pResultsY + index, sub(mul(zA, xB), mul(xA, zB)));
+			store(pResultsZ + index, sub(mul(xA, yB), mul(yA, xB)));
+		}
+
+		return index;
+	}
+
+	template<typename Lanes>
+	static ui32 computeScaledSums(const VectorArrays& vectorsA, const VectorArrays& vectorsB, f32 scale, ui32 begin, ui32 end, 
+		f32* pResultsX, f32* pResultsY, f32* pResultsZ)
+	{
+		const ui32 laneCount = sizeof(Lanes) / sizeof(f32);
+		const Lanes scales = broadcast<Lanes>(scale);
+
+		ui32 index = begin;
+		for (; index + laneCount <= end; index += laneCount)
+		{
+			store(pResultsX + index, add(load<Lanes>(vectorsA.pX + index), mul(load<Lanes>(vectorsB.pX + index), scales)));
+			store(pResultsY + index, add(load<Lanes>(vectorsA.pY + index), mul(load<Lanes>(vectorsB.pY + index), scales)));
+			store(pResultsZ + index, add(load<Lanes>(vectorsA.pZ + index), mul(load<Lanes>(vectorsB.pZ + index), scales)));
+		}
+
+		return index;
+	}
+
+	template<typename Lanes>
+	static ui32 normalizeVectors(f32* pX, f32* pY, f32* pZ, ui32 begin, ui32 end)
+	{
+		const ui32 laneCount = sizeof(Lanes) / sizeof(f32);
+		const Lanes zero = broadcast<Lanes>(0.0f);
+
+		ui32 index = begin;
+		for (; index + laneCount <= end; index += laneCount)
+		{
+			const Lanes x = load<Lanes>(pX + index);
+			const Lanes y = load<Lanes>(pY + index);
+			const Lanes z = load<Lanes>(pZ + index);
+			const Lanes norms = squareRoot(add(add(mul(x, x), mul(y, y)), mul(z, z)));
+
+			if (anyTrue(isEqual(norms, zero)))
+			{
+				std::cerr << "normalizing a null vector\n";
+				std::exit(EXIT_FAILURE);
+			}
+
+			store(pX + index, div(x, norms));
+			store(pY + index, div(y, norms));
+			store(pZ + index, div(z, norms));
+		}
+
+		return index;
+	}
+
+	void computeDots(const VectorArrays& vectorsA, const VectorArrays& vectorsB, ui32 count, f32* pDots)
+	{
+		ui32 index = 0;
+	#if defined(VSR_MATHS_SSE)
+		index = computeDots<VectorLanes>(vectorsA, vectorsB, index, count, pDots);
+	#endif
+		computeDots<f32>(vectorsA, vectorsB, index, count, pDots);
+	}
+
+	void computeCrosses(const VectorArrays& vectorsA, const VectorArrays& vectorsB, ui32 count, f32* pResultsX, f32* pResultsY, f32* pResultsZ)
+	{
+		ui32 index = 0;
+	#if defined(VSR_MATHS_SSE)
+		index = computeCrosses<VectorLanes>(vectorsA, vectorsB, index, count, pResultsX, pResultsY, pResultsZ);
+	#endif
+		computeCrosses<f32>(vectorsA, vectorsB, index, count, pResultsX, pResultsY, pResultsZ);
+	}
+
+	void computeScaledSums(const VectorArrays& vectorsA, const VectorArrays& vectorsB, f32 scale, ui32 count, f32* pResultsX, f32* pResultsY, f32* pResultsZ)
+	{
+		ui32 index = 0;
+	#if defined(VSR_MATHS_SSE)
+		index = computeScaledSums<VectorLanes>(vectorsA, vectorsB, scale, index, count, pResultsX, pResultsY, pResultsZ);
+	#endif
+		computeScaledSums<f32>(vectorsA, vectorsB, scale, index, count, pResultsX, pResultsY, pResultsZ);
+	}
+
+	void normalizeVectors(f32* pX, f32* pY, f32* pZ, ui32 count)
+	{
+		ui32 index = 0;
+	#if defined(VSR_MATHS_SSE)
+		index = normalizeVectors<VectorLanes>(pX, pY, pZ, index, count);
+	#endif
+		normalizeVectors<f32>(pX, pY, pZ, index, count);
+	}
+}
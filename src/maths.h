@@ -1,10 +1,24 @@
 #pragma once
 
+#include <cassert>
 #include <cmath>
 #include <iostream>
 #include <cstdlib> 
 #include <cstdint>
 
+// instruction set of the float specializations, the generic templates are used otherwise
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define VSR_MATHS_AVX
+	#define VSR_MATHS_SSE
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define VSR_MATHS_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define VSR_MATHS_NEON
+#endif
+
 namespace Visor
 {
 	template<typename T>
@@ -13,12 +27,18 @@ namespace Visor
 	template<typename T>
 	struct Matrix3;
 
+	template<typename T>
+	struct Matrix3x4;
+
 	template<typename T>
 	struct Vector4;
 
 	template<typename T>
 	struct Vector3;
 
+	template<typename T>
+	struct Quaternion;
+
 	// ===== Matrix4 =====
 	template<typename T>
 	struct Matrix4
@@ -33,13 +53,18 @@ namespace Visor
 		static Matrix4<T> getIdentity();
 		static Matrix4<T> getScaling(T scalingX, T scalingY, T scalingZ);
 		static Matrix4<T> getRotation(T yaw, T pitch, T roll);
+		static Matrix4<T> getRotation(const Quaternion<T>& orientation);
 		static Matrix4<T> getInverseRotation(T yaw, T pitch, T roll);
 		static Matrix4<T> getTranslation(const Vector3<T>& position);
+		// getTranslation * getRotation * getScaling, written directly
+		static Matrix4<T> getTransformation(const Vector3<T>& position, const Quaternion<T>& orientation, const Vector3<T>& scale);
 		static Matrix4<T> getView(const Vector3<T>& position, T yaw, T pitch, T roll);
+		static Matrix4<T> getView(const Vector3<T>& position, const Quaternion<T>& orientation);
 		static Matrix4<T> getProjection(T fov, T aspectRatio);
 		
 	public:
-		T m[4][4];
+		// aligned so rows load in a single vector register
+		alignas(16) T m[4][4];
 	};
 
 	template<typename T>
@@ -222,15 +247,15 @@ namespace Visor
 	template<typename T>
 	Matrix4<T> Matrix4<T>::getView(const Vector3<T>& position, T yaw, T pitch, T roll)
 	{
-		Matrix4<T> inverseRotation = getInverseRotation(yaw, pitch, roll);
+		// the inverse rotation applied to the position relative to the camera, the translation is the rotated position
+		Matrix4<T> result = getInverseRotation(yaw, pitch, roll);
 
-		Vector3<T> negativePosition = {
-			-position.x,
-			-position.y,
-			-position.z,
-		};
+		for (uint32_t row = 0; row < 3; ++row)
+		{
+			result.m[row][3] = -(result.m[row][0] * position.x + result.m[row][1] * position.y + result.m[row][2] * position.z);
+		}
 
-		return inverseRotation * getTranslation(negativePosition);
+		return result;
 	}
 
 	template<typename T>
@@ -260,6 +285,9 @@ namespace Visor
 		Matrix3<T> operator*(const Matrix3<T>& matrix) const;
 		Vector3<T> operator*(const Vector3<T>& vector) const;
 
+		// false for a singular matrix, a transform with a zero scale for instance, inverse is then left as it was
+		bool getInverse(Matrix3<T>& inverse) const;
+
 	public:
 		T m[3][3];
 	};
@@ -296,9 +324,234 @@ namespace Visor
 		return result;
 	}
 
+	template<typename T>
+	bool Matrix3<T>::getInverse(Matrix3<T>& inverse) const
+	{
+		// transposed cofactors divided by the determinant
+		Matrix3<T> result = {};
+
+		result.m[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+		result.m[0][1] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+		result.m[0][2] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+		result.m[1][0] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+		result.m[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+		result.m[1][2] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+		result.m[2][0] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+		result.m[2][1] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+		result.m[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+
+		const T determinant = m[0][0] * result.m[0][0] + m[0][1] * result.m[1][0] + m[0][2] * result.m[2][0];
+
+		if (determinant == T(0))
+		{
+			return false;
+		}
+
+		const T inverseDeterminant = T(1) / determinant;
+		for (uint32_t row = 0; row < 3; ++row)
+		{
+			for (uint32_t column = 0; column < 3; ++column)
+			{
+				result.m[row][column] *= inverseDeterminant;
+			}
+		}
+		inverse = result;
+
+		return true;
+	}
+
+	// ===== Matrix3x4 =====
+	/*
+	affine transformation : the first three rows of a Matrix4 whose last row is 0, 0, 0, 1.
+	products and inverses skip the constant row, and it takes 48 bytes instead of 64
+	*/
+	template<typename T>
+	struct Matrix3x4
+	{
+	public:
+		Matrix3x4<T> operator*(const Matrix3x4<T>& matrix) const;
+		// the point transformed, translation included
+		Vector3<T> operator*(const Vector3<T>& point) const;
+		Vector3<T> transformDirection(const Vector3<T>& direction) const;
+
+		Matrix3<T> getUpperLeft() const;
+		Vector3<T> getTranslationColumn() const;
+		// false when the upper left is singular, inverse is then left as it was
+		bool getInverse(Matrix3x4<T>& inverse) const;
+		// inverse transpose of the upper left, for normals under non uniform scales (to normalize once transformed).
+		// false when the upper left is singular
+		bool getNormalMatrix(Matrix3<T>& normalMatrix) const;
+		Matrix4<T> getMatrix4() const;
+
+		static Matrix3x4<T> getIdentity();
+		// the last row of the matrix is ignored
+		static Matrix3x4<T> getFromMatrix4(const Matrix4<T>& matrix);
+		static Matrix3x4<T> getTransformation(const Vector3<T>& position, const Quaternion<T>& orientation, const Vector3<T>& scale);
+		static Matrix3x4<T> getView(const Vector3<T>& position, const Quaternion<T>& orientation);
+
+	public:
+		// aligned so rows load in a single vector register
+		alignas(16) T m[3][4];
+	};
+
+	template<typename T>
+	Matrix3x4<T> Matrix3x4<T>::operator*(const Matrix3x4<T>& matrix) const
+	{
+		Matrix3x4<T> result;
+
+		for (uint32_t row = 0; row < 3; ++row)
+		{
+			for (uint32_t column = 0; column < 4; ++column)
+			{
+				result.m[row][column] = m[row][0] * matrix.m[0][column] + m[row][1] * matrix.m[1][column] + m[row][2] * matrix.m[2][column];
+			}
+			// the implicit last row of the right matrix
+			result.m[row][3] += m[row][3];
+		}
+
+		return result;
+	}
+
+	template<typename T>
+	Vector3<T> Matrix3x4<T>::operator*(const Vector3<T>& point) const
+	{
+		Vector3<T> result = {};
+
+		result.x = m[0][0] * point.x + m[0][1] * point.y + m[0][2] * point.z + m[0][3];
+		result.y = m[1][0] * point.x + m[1][1] * point.y + m[1][2] * point.z + m[1][3];
+		result.z = m[2][0] * point.x + m[2][1] * point.y + m[2][2] * point.z + m[2][3];
+
+		return result;
+	}
+
+	template<typename T>
+	Vector3<T> Matrix3x4<T>::transformDirection(const Vector3<T>& direction) const
+	{
+		Vector3<T> result = {};
+
+		result.x = m[0][0] * direction.x + m[0][1] * direction.y + m[0][2] * direction.z;
+		result.y = m[1][0] * direction.x + m[1][1] * direction.y + m[1][2] * direction.z;
+		result.z = m[2][0] * direction.x + m[2][1] * direction.y + m[2][2] * direction.z;
+
+		return result;
+	}
+
+	template<typename T>
+	Matrix3<T> Matrix3x4<T>::getUpperLeft() const
+	{
+		Matrix3<T> result = {};
+
+		for (uint32_t row = 0; row < 3; ++row)
+		{
+			for (uint32_t column = 0; column < 3; ++column)
+			{
+				result.m[row][column] = m[row][column];
+			}
+		}
+
+		return result;
+	}
+
+	template<typename T>
+	Vector3<T> Matrix3x4<T>::getTranslationColumn() const
+	{
+		return Vector3<T>{m[0][3], m[1][3], m[2][3]};
+	}
+
+	template<typename T>
+	bool Matrix3x4<T>::getInverse(Matrix3x4<T>& inverse) const
+	{
+		// the inverse of the upper left, then the translation brought back through it
+		Matrix3<T> inverseUpperLeft;
+		if (!getUpperLeft().getInverse(inverseUpperLeft))
+		{
+			return false;
+		}
+		const Vector3<T> translation = inverseUpperLeft * getTranslationColumn();
+
+		for (uint32_t row = 0; row < 3; ++row)
+		{
+			for (uint32_t column = 0; column < 3; ++column)
+			{
+				inverse.m[row][column] = inverseUpperLeft.m[row][column];
+			}
+		}
+		inverse.m[0][3] = -translation.x;
+		inverse.m[1][3] = -translation.y;
+		inverse.m[2][3] = -translation.z;
+
+		return true;
+	}
+
+	template<typename T>
+	bool Matrix3x4<T>::getNormalMatrix(Matrix3<T>& normalMatrix) const
+	{
+		Matrix3<T> inverseUpperLeft;
+		if (!getUpperLeft().getInverse(inverseUpperLeft))
+		{
+			return false;
+		}
+
+		for (uint32_t row = 0; row < 3; ++row)
+		{
+			for (uint32_t column = 0; column < 3; ++column)
+			{
+				normalMatrix.m[row][column] = inverseUpperLeft.m[column][row];
+			}
+		}
+
+		return true;
+	}
+
+	template<typename T>
+	Matrix4<T> Matrix3x4<T>::getMatrix4() const
+	{
+		Matrix4<T> result = {};
+
+		for (uint32_t row = 0; row < 3; ++row)
+		{
+			for (uint32_t column = 0; column < 4; ++column)
+			{
+				result.m[row][column] = m[row][column];
+			}
+		}
+		result.m[3][3] = T(1);
+
+		return result;
+	}
+
+	template<typename T>
+	Matrix3x4<T> Matrix3x4<T>::getIdentity()
+	{
+		Matrix3x4<T> result = {};
+
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			result.m[i][i] = T(1);
+		}
+
+		return result;
+	}
+
+	template<typename T>
+	Matrix3x4<T> Matrix3x4<T>::getFromMatrix4(const Matrix4<T>& matrix)
+	{
+		Matrix3x4<T> result;
+
+		for (uint32_t row = 0; row < 3; ++row)
+		{
+			for (uint32_t column = 0; column < 4; ++column)
+			{
+				result.m[row][column] = matrix.m[row][column];
+			}
+		}
+
+		return result;
+	}
+
 	// ===== Vector4 =====
 	template<typename T>
-	struct Vector4
+	struct alignas(16) Vector4
 	{
 	public:
 		T x;
@@ -435,31 +688,17 @@ namespace Visor
 	template<typename T>
 	T& Vector3<T>::operator[](uint32_t index)
 	{
-		switch (index)
-		{
-		case 0: return x;
-		case 1: return y;
-		case 2: return z;
-		default: {
-			std::cerr << "invalid access index\n";
-			std::exit(EXIT_FAILURE);
-		}
-		}
+		// selects without branching, where a switch kept loops over the axes from being unrolled and vectorized
+		assert(index < 3);
+		return index == 0 ? x : (index == 1 ? y : z);
 	}
 
 	template<typename T>
 	const T& Vector3<T>::operator[](uint32_t index) const
 	{
-		switch (index)
-		{
-		case 0: return x;
-		case 1: return y;
-		case 2: return z;
-		default: {
-			std::cerr << "invalid access index\n";
-			std::exit(EXIT_FAILURE);
-		}
-		}
+		// selects without branching, where a switch kept loops over the axes from being unrolled and vectorized
+		assert(index < 3);
+		return index == 0 ? x : (index == 1 ? y : z);
 	}
 
 	template<typename T>
@@ -508,20 +747,467 @@ namespace Visor
 		return std::sqrt(getNorm2());
 	}
 
+	// ===== Quaternion =====
+	/*
+	rotation as a unit quaternion x.i + y.j + z.k + w.
+	like matrices, quaternionA * quaternionB rotates by quaternionB then by quaternionA.
+	the angles are the ones of Matrix4::getRotation : roll around z, then pitch around x, then yaw around y
+	*/
+	template<typename T>
+	struct Quaternion
+	{
+	public:
+		T x;
+		T y;
+		T z;
+		T w;
+
+	public:
+		Quaternion<T> operator-() const;
+		Quaternion<T> operator+(const Quaternion<T>& quaternion) const;
+		Quaternion<T> operator*(const Quaternion<T>& quaternion) const;
+		Quaternion<T> operator*(T scalar) const;
+		// rotates the vector without building the matrix
+		Vector3<T> operator*(const Vector3<T>& vector) const;
+
+		void normalize();
+		T dot(const Quaternion<T>& quaternion) const;
+		// the inverse rotation, for unit quaternions
+		Quaternion<T> getConjugate() const;
+		void getAngles(T& yaw, T& pitch, T& roll) const;
+
+		static Quaternion<T> getIdentity();
+		static Quaternion<T> getFromAngles(T yaw, T pitch, T roll);
+		static Quaternion<T> getFromAxisAngle(const Vector3<T>& axis, T angle);
+		// the rotation must be orthonormal
+		static Quaternion<T> getFromRotation(const Matrix3<T>& rotation);
+		// both interpolate along the shortest arc, nlerp is cheaper but does not turn at a constant speed
+		static Quaternion<T> nlerp(const Quaternion<T>& quaternionA, const Quaternion<T>& quaternionB, T t);
+		static Quaternion<T> slerp(const Quaternion<T>& quaternionA, const Quaternion<T>& quaternionB, T t);
+	};
+
+	template<typename T>
+	Quaternion<T> Quaternion<T>::operator-() const
+	{
+		return Quaternion<T>{-x, -y, -z, -w};
+	}
+
+	template<typename T>
+	Quaternion<T> Quaternion<T>::operator+(const Quaternion<T>& quaternion) const
+	{
+		return Quaternion<T>{x + quaternion.x, y + quaternion.y, z + quaternion.z, w + quaternion.w};
+	}
+
+	template<typename T>
+	Quaternion<T> Quaternion<T>::operator*(const Quaternion<T>& quaternion) const
+	{
+		Quaternion<T> result = {};
+
+		result.x = w * quaternion.x + x * quaternion.w + y * quaternion.z - z * quaternion.y;
+		result.y = w * quaternion.y - x * quaternion.z + y * quaternion.w + z * quaternion.x;
+		result.z = w * quaternion.z + x * quaternion.y - y * quaternion.x + z * quaternion.w;
+		result.w = w * quaternion.w - x * quaternion.x - y * quaternion.y - z * quaternion.z;
+
+		return result;
+	}
+
+	template<typename T>
+	Quaternion<T> Quaternion<T>::operator*(T scalar) const
+	{
+		return Quaternion<T>{x * scalar, y * scalar, z * scalar, w * scalar};
+	}
+
+	template<typename T>
+	Vector3<T> Quaternion<T>::operator*(const Vector3<T>& vector) const
+	{
+		// v + w.t + u x t with t = 2.u x v, u the vector part : two cross products instead of a whole matrix
+		const Vector3<T> axis = {x, y, z};
+		const Vector3<T> twiceCross = axis.cross(vector) * T(2);
+
+		return vector + twiceCross * w + axis.cross(twiceCross);
+	}
+
+	template<typename T>
+	void Quaternion<T>::normalize()
+	{
+		const T norm = std::sqrt(dot(*this));
+		x /= norm;
+		y /= norm;
+		z /= norm;
+		w /= norm;
+	}
+
+	template<typename T>
+	T Quaternion<T>::dot(const Quaternion<T>& quaternion) const
+	{
+		return x * quaternion.x + y * quaternion.y + z * quaternion.z + w * quaternion.w;
+	}
+
+	template<typename T>
+	Quaternion<T> Quaternion<T>::getConjugate() const
+	{
+		return Quaternion<T>{-x, -y, -z, w};
+	}
+
+	template<typename T>
+	void Quaternion<T>::getAngles(T& yaw, T& pitch, T& roll) const
+	{
+		// from the elements of the rotation matrix : m[1][2] = sin(pitch), m[0][2] and m[2][2] give the yaw
+		// and the cosine of the pitch, which is more precise than an arcsine near the poles, m[1][0] and m[1][1] give the roll
+		const T sinPitchCosYaw = T(1) - T(2) * (x * x + y * y);
+		const T sinPitchSinYaw = -T(2) * (x * z + w * y);
+		const T cosPitch = std::sqrt(sinPitchCosYaw * sinPitchCosYaw + sinPitchSinYaw * sinPitchSinYaw);
+		pitch = std::atan2(T(2) * (y * z - w * x), cosPitch);
+
+		if (cosPitch > T(0.0001))
+		{
+			yaw = std::atan2(sinPitchSinYaw, sinPitchCosYaw);
+			roll = std::atan2(T(2) * (x * y + w * z), T(1) - T(2) * (x * x + z * z));
+		}
+		else
+		{
+			// looking straight up or down, yaw and roll turn around the same axis : all of it goes to the yaw
+			yaw = std::atan2(T(2) * (x * z - w * y), T(1) - T(2) * (y * y + z * z));
+			roll = T(0);
+		}
+	}
+
+	template<typename T>
+	Quaternion<T> Quaternion<T>::getIdentity()
+	{
+		return Quaternion<T>{T(0), T(0), T(0), T(1)};
+	}
+
+	template<typename T>
+	Quaternion<T> Quaternion<T>::getFromAngles(T yaw, T pitch, T roll)
+	{
+		// yaw * pitch * roll, the yaw and pitch of Matrix4::getRotation turn the other way around their axes
+		const Quaternion<T> yawRotation = {T(0), -std::sin(yaw / T(2)), T(0), std::cos(yaw / T(2))};
+		const Quaternion<T> pitchRotation = {-std::sin(pitch / T(2)), T(0), T(0), std::cos(pitch / T(2))};
+		const Quaternion<T> rollRotation = {T(0), T(0), std::sin(roll / T(2)), std::cos(roll / T(2))};
+
+		return yawRotation * pitchRotation * rollRotation;
+	}
+
+	template<typename T>
+	Quaternion<T> Quaternion<T>::getFromAxisAngle(const Vector3<T>& axis, T angle)
+	{
+		const Vector3<T> vector = axis * std::sin(angle / T(2));
+
+		return Quaternion<T>{vector.x, vector.y, vector.z, std::cos(angle / T(2))};
+	}
+
+	template<typename T>
+	Quaternion<T> Quaternion<T>::getFromRotation(const Matrix3<T>& rotation)
+	{
+		// from the largest of w, x, y and z, the others are divided by it
+		const T (&m)[3][3] = rotation.m;
+		const T trace = m[0][0] + m[1][1] + m[2][2];
+
+		Quaternion<T> result = {};
+		if (trace > T(0))
+		{
+			const T s = std::sqrt(trace + T(1)) * T(2);
+			result.w = s / T(4);
+			result.x = (m[2][1] - m[1][2]) / s;
+			result.y = (m[0][2] - m[2][0]) / s;
+			result.z = (m[1][0] - m[0][1]) / s;
+		}
+		else if (m[0][0] > m[1][1] && m[0][0] > m[2][2])
+		{
+			const T s = std::sqrt(T(1) + m[0][0] - m[1][1] - m[2][2]) * T(2);
+			result.w = (m[2][1] - m[1][2]) / s;
+			result.x = s / T(4);
+			result.y = (m[0][1] + m[1][0]) / s;
+			result.z = (m[0][2] + m[2][0]) / s;
+		}
+		else if (m[1][1] > m[2][2])
+		{
+			const T s = std::sqrt(T(1) + m[1][1] - m[0][0] - m[2][2]) * T(2);
+			result.w = (m[0][2] - m[2][0]) / s;
+			result.x = (m[0][1] + m[1][0]) / s;
+			result.y = s / T(4);
+			result.z = (m[1][2] + m[2][1]) / s;
+		}
+		else
+		{
+			const T s = std::sqrt(T(1) + m[2][2] - m[0][0] - m[1][1]) * T(2);
+			result.w = (m[1][0] - m[0][1]) / s;
+			result.x = (m[0][2] + m[2][0]) / s;
+			result.y = (m[1][2] + m[2][1]) / s;
+			result.z = s / T(4);
+		}
+
+		return result;
+	}
+
+	template<typename T>
+	Quaternion<T> Quaternion<T>::nlerp(const Quaternion<T>& quaternionA, const Quaternion<T>& quaternionB, T t)
+	{
+		// q and -q are the same rotation, the one closest to the start takes the shortest arc
+		const Quaternion<T> end = quaternionA.dot(quaternionB) < T(0) ? -quaternionB : quaternionB;
+
+		Quaternion<T> result = quaternionA * (T(1) - t) + end * t;
+		result.normalize();
+
+		return result;
+	}
+
+	template<typename T>
+	Quaternion<T> Quaternion<T>::slerp(const Quaternion<T>& quaternionA, const Quaternion<T>& quaternionB, T t)
+	{
+		T cosAngle = quaternionA.dot(quaternionB);
+		Quaternion<T> end = quaternionB;
+		if (cosAngle < T(0))
+		{
+			end = -quaternionB;
+			cosAngle = -cosAngle;
+		}
+
+		// nearly the same rotation, the sine below vanishes and a straight line is as good
+		if (cosAngle > T(0.9995))
+		{
+			return nlerp(quaternionA, end, t);
+		}
+
+		const T angle = std::acos(cosAngle);
+		const T sinAngle = std::sin(angle);
+
+		return quaternionA * (std::sin((T(1) - t) * angle) / sinAngle) + end * (std::sin(t * angle) / sinAngle);
+	}
+
+	template<typename T>
+	Matrix4<T> Matrix4<T>::getRotation(const Quaternion<T>& orientation)
+	{
+		return getTransformation(Vector3<T>{T(0), T(0), T(0)}, orientation, Vector3<T>{T(1), T(1), T(1)});
+	}
+
+	template<typename T>
+	Matrix4<T> Matrix4<T>::getTransformation(const Vector3<T>& position, const Quaternion<T>& orientation, const Vector3<T>& scale)
+	{
+		return Matrix3x4<T>::getTransformation(position, orientation, scale).getMatrix4();
+	}
+
+	template<typename T>
+	Matrix4<T> Matrix4<T>::getView(const Vector3<T>& position, const Quaternion<T>& orientation)
+	{
+		return Matrix3x4<T>::getView(position, orientation).getMatrix4();
+	}
+
+	template<typename T>
+	Matrix3x4<T> Matrix3x4<T>::getTransformation(const Vector3<T>& position, const Quaternion<T>& orientation, const Vector3<T>& scale)
+	{
+		// the rotation columns scaled, the translation in the last column : products only, no trigonometry
+		const T x2 = orientation.x + orientation.x;
+		const T y2 = orientation.y + orientation.y;
+		const T z2 = orientation.z + orientation.z;
+		const T xx = orientation.x * x2;
+		const T yy = orientation.y * y2;
+		const T zz = orientation.z * z2;
+		const T xy = orientation.x * y2;
+		const T xz = orientation.x * z2;
+		const T yz = orientation.y * z2;
+		const T wx = orientation.w * x2;
+		const T wy = orientation.w * y2;
+		const T wz = orientation.w * z2;
+
+		Matrix3x4<T> result;
+
+		result.m[0][0] = (T(1) - (yy + zz)) * scale.x;
+		result.m[0][1] = (xy - wz) * scale.y;
+		result.m[0][2] = (xz + wy) * scale.z;
+		result.m[0][3] = position.x;
+
+		result.m[1][0] = (xy + wz) * scale.x;
+		result.m[1][1] = (T(1) - (xx + zz)) * scale.y;
+		result.m[1][2] = (yz - wx) * scale.z;
+		result.m[1][3] = position.y;
+
+		result.m[2][0] = (xz - wy) * scale.x;
+		result.m[2][1] = (yz + wx) * scale.y;
+		result.m[2][2] = (T(1) - (xx + yy)) * scale.z;
+		result.m[2][3] = position.z;
+
+		return result;
+	}
+
+	template<typename T>
+	Matrix3x4<T> Matrix3x4<T>::getView(const Vector3<T>& position, const Quaternion<T>& orientation)
+	{
+		// the inverse rotation applied to the position relative to the camera
+		const Quaternion<T> inverseOrientation = orientation.getConjugate();
+		const Vector3<T> translation = -(inverseOrientation * position);
+
+		return getTransformation(translation, inverseOrientation, Vector3<T>{T(1), T(1), T(1)});
+	}
+
+	// ===== Matrix4<float> and Matrix3x4<float> =====
+#if defined(VSR_MATHS_SSE) || defined(VSR_MATHS_NEON)
+	// float specializations : every element is computed with the same operations in the same order as the generic templates,
+	// so results are identical bit for bit (as long as the compiler does not contract the generic code into fused multiply adds)
+
+	template<>
+	inline void Matrix4<float>::transpose()
+	{
+	#if defined(VSR_MATHS_SSE)
+		__m128 row0 = _mm_loadu_ps(m[0]);
+		__m128 row1 = _mm_loadu_ps(m[1]);
+		__m128 row2 = _mm_loadu_ps(m[2]);
+		__m128 row3 = _mm_loadu_ps(m[3]);
+		_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+		_mm_storeu_ps(m[0], row0);
+		_mm_storeu_ps(m[1], row1);
+		_mm_storeu_ps(m[2], row2);
+		_mm_storeu_ps(m[3], row3);
+	#elif defined(VSR_MATHS_NEON)
+		// the interleaved load reads the columns
+		const float32x4x4_t columns = vld4q_f32(&m[0][0]);
+		vst1q_f32(m[0], columns.val[0]);
+		vst1q_f32(m[1], columns.val[1]);
+		vst1q_f32(m[2], columns.val[2]);
+		vst1q_f32(m[3], columns.val[3]);
+	#endif
+	}
+
+	// a row of the result is the rows of the right matrix weighted by a row of the left one.
+	// the generic loop starts its sums from zero, so do these, which only matters for the sign of zero results
+	template<>
+	inline Matrix4<float> Matrix4<float>::operator*(const Matrix4<float>& matrix) const
+	{
+		Matrix4<float> result;
+
+	#if defined(VSR_MATHS_AVX)
+		// two rows of the result at a time, one per 128 bit lane
+		const __m256 rightRow0 = _mm256_broadcast_ps((const __m128*)matrix.m[0]);
+		const __m256 rightRow1 = _mm256_broadcast_ps((const __m128*)matrix.m[1]);
+		const __m256 rightRow2 = _mm256_broadcast_ps((const __m128*)matrix.m[2]);
+		const __m256 rightRow3 = _mm256_broadcast_ps((const __m128*)matrix.m[3]);
+
+		for (uint32_t row = 0; row < 4; row += 2)
+		{
+			const __m256 leftRows = _mm256_loadu_ps(m[row]);
+			__m256 sum = _mm256_add_ps(_mm256_setzero_ps(), _mm256_mul_ps(_mm256_shuffle_ps(leftRows, leftRows, _MM_SHUFFLE(0, 0, 0, 0)), rightRow0));
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_shuffle_ps(leftRows, leftRows, _MM_SHUFFLE(1, 1, 1, 1)), rightRow1));
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_shuffle_ps(leftRows, leftRows, _MM_SHUFFLE(2, 2, 2, 2)), rightRow2));
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_shuffle_ps(leftRows, leftRows, _MM_SHUFFLE(3, 3, 3, 3)), rightRow3));
+			_mm256_storeu_ps(result.m[row], sum);
+		}
+	#elif defined(VSR_MATHS_SSE)
+		const __m128 rightRow0 = _mm_loadu_ps(matrix.m[0]);
+		const __m128 rightRow1 = _mm_loadu_ps(matrix.m[1]);
+		const __m128 rightRow2 = _mm_loadu_ps(matrix.m[2]);
+		const __m128 rightRow3 = _mm_loadu_ps(matrix.m[3]);
+
+		for (uint32_t row = 0; row < 4; ++row)
+		{
+			__m128 sum = _mm_add_ps(_mm_setzero_ps(), _mm_mul_ps(_mm_set1_ps(m[row][0]), rightRow0));
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(m[row][1]), rightRow1));
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(m[row][2]), rightRow2));
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(m[row][3]), rightRow3));
+			_mm_storeu_ps(result.m[row], sum);
+		}
+	#elif defined(VSR_MATHS_NEON)
+		const float32x4_t rightRow0 = vld1q_f32(matrix.m[0]);
+		const float32x4_t rightRow1 = vld1q_f32(matrix.m[1]);
+		const float32x4_t rightRow2 = vld1q_f32(matrix.m[2]);
+		const float32x4_t rightRow3 = vld1q_f32(matrix.m[3]);
+
+		// separate multiplies and adds, fused ones would round differently
+		for (uint32_t row = 0; row < 4; ++row)
+		{
+			float32x4_t sum = vaddq_f32(vdupq_n_f32(0.0f), vmulq_n_f32(rightRow0, m[row][0]));
+			sum = vaddq_f32(sum, vmulq_n_f32(rightRow1, m[row][1]));
+			sum = vaddq_f32(sum, vmulq_n_f32(rightRow2, m[row][2]));
+			sum = vaddq_f32(sum, vmulq_n_f32(rightRow3, m[row][3]));
+			vst1q_f32(result.m[row], sum);
+		}
+	#endif
+
+		return result;
+	}
+
+	// the columns weighted by the vector, each lane summing in the order of the generic row
+	template<>
+	inline Vector4<float> Matrix4<float>::operator*(const Vector4<float>& vector) const
+	{
+		Vector4<float> result;
+
+	#if defined(VSR_MATHS_SSE)
+		__m128 column0 = _mm_loadu_ps(m[0]);
+		__m128 column1 = _mm_loadu_ps(m[1]);
+		__m128 column2 = _mm_loadu_ps(m[2]);
+		__m128 column3 = _mm_loadu_ps(m[3]);
+		_MM_TRANSPOSE4_PS(column0, column1, column2, column3);
+
+		__m128 sum = _mm_mul_ps(column0, _mm_set1_ps(vector.x));
+		sum = _mm_add_ps(sum, _mm_mul_ps(column1, _mm_set1_ps(vector.y)));
+		sum = _mm_add_ps(sum, _mm_mul_ps(column2, _mm_set1_ps(vector.z)));
+		sum = _mm_add_ps(sum, _mm_mul_ps(column3, _mm_set1_ps(vector.w)));
+		_mm_storeu_ps(&result.x, sum);
+	#elif defined(VSR_MATHS_NEON)
+		const float32x4x4_t columns = vld4q_f32(&m[0][0]);
+
+		float32x4_t sum = vmulq_n_f32(columns.val[0], vector.x);
+		sum = vaddq_f32(sum, vmulq_n_f32(columns.val[1], vector.y));
+		sum = vaddq_f32(sum, vmulq_n_f32(columns.val[2], vector.z));
+		sum = vaddq_f32(sum, vmulq_n_f32(columns.val[3], vector.w));
+		vst1q_f32(&result.x, sum);
+	#endif
+
+		return result;
+	}
+
+	// as the Matrix4 product without the last row. the translation of the left matrix is added to the last lane only,
+	// the other lanes get -0 which leaves every value unchanged
+	template<>
+	inline Matrix3x4<float> Matrix3x4<float>::operator*(const Matrix3x4<float>& matrix) const
+	{
+		Matrix3x4<float> result;
+
+	#if defined(VSR_MATHS_SSE)
+		const __m128 rightRow0 = _mm_loadu_ps(matrix.m[0]);
+		const __m128 rightRow1 = _mm_loadu_ps(matrix.m[1]);
+		const __m128 rightRow2 = _mm_loadu_ps(matrix.m[2]);
+
+		for (uint32_t row = 0; row < 3; ++row)
+		{
+			__m128 sum = _mm_mul_ps(_mm_set1_ps(m[row][0]), rightRow0);
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(m[row][1]), rightRow1));
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(m[row][2]), rightRow2));
+			sum = _mm_add_ps(sum, _mm_set_ps(m[row][3], -0.0f, -0.0f, -0.0f));
+			_mm_storeu_ps(result.m[row], sum);
+		}
+	#elif defined(VSR_MATHS_NEON)
+		const float32x4_t rightRow0 = vld1q_f32(matrix.m[0]);
+		const float32x4_t rightRow1 = vld1q_f32(matrix.m[1]);
+		const float32x4_t rightRow2 = vld1q_f32(matrix.m[2]);
+
+		for (uint32_t row = 0; row < 3; ++row)
+		{
+			float32x4_t sum = vmulq_n_f32(rightRow0, m[row][0]);
+			sum = vaddq_f32(sum, vmulq_n_f32(rightRow1, m[row][1]));
+			sum = vaddq_f32(sum, vmulq_n_f32(rightRow2, m[row][2]));
+			sum = vaddq_f32(sum, vsetq_lane_f32(m[row][3], vdupq_n_f32(-0.0f), 3));
+			vst1q_f32(result.m[row], sum);
+		}
+	#endif
+
+		return result;
+	}
+#endif
+
 	// ===== Utils =====
 	template<typename T>
 	Vector3<T> getDirectionFromAngles(T yaw, T pitch, T roll)
 	{
-		Vector3<T> direction = {
-			T(0), 
-			T(0), 
-			T(1)};
+		// the last column of Matrix4::getRotation, where the forward axis (0, 0, 1) goes, the roll does not move it
+		(void)roll;
+		const T cosPitch = std::cos(pitch);
 
-		const Matrix4<T> rotation = Matrix4<T>::getRotation(yaw, pitch, roll);
-		direction = rotation.getUpperLeft() * direction;
-		direction.normalize();
-		
-		return direction;
+		return Vector3<T>{
+			-cosPitch * std::sin(yaw), 
+			std::sin(pitch), 
+			cosPitch * std::cos(yaw)};
 	}
 
 	template<typename T>
@@ -531,4 +1217,69 @@ namespace Visor
 		pitch = std::asin(direction.y);
 		roll = T(0);
 	}
+
+	// ===== Fast approximations =====
+	/*
+	polynomial approximations for arrays of floats, several values at once with SIMD and the same results for the last values.
+	max errors against the double precision functions of the standard library, measured over 16M values :
+	- sine and cosine : 8e-8 absolute for |angle| < 8192, the standard functions are used beyond
+	- atan2 : 3e-7 radians, on every finite input (-0 is not told from 0 for x)
+	- asin : 2e-7 radians on [-1, 1], nan beyond
+	- reciprocal square root : 3e-7 relative on normal positive values (1.1e-7 without SSE), the hardware estimate refined varies between processors
+	*/
+	void computeSinCos(const float* pAngles, uint32_t count, float* pSines, float* pCosines);
+	void computeAtan2(const float* pY, const float* pX, uint32_t count, float* pAngles);
+	void computeAsin(const float* pValues, uint32_t count, float* pAngles);
+	void computeReciprocalSquareRoot(const float* pValues, uint32_t count, float* pResults);
+	// orientations[i] = Quaternion::getFromAngles of getAnglesFromDirection of the direction from position i to the target,
+	// the identity for positions on the target
+	void computeLookAtOrientations(const float* pPositionsX, const float* pPositionsY, const float* pPositionsZ, const Vector3<float>& target, 
+		uint32_t count, float* pOrientationsX, float* pOrientationsY, float* pOrientationsZ, float* pOrientationsW);
+
+	// ===== Transform batches =====
+	// transforms as one array per coordinate, orientations are unit quaternions
+	struct TransformArrays
+	{
+	public:
+		const float* pPositionsX;
+		const float* pPositionsY;
+		const float* pPositionsZ;
+		const float* pOrientationsX;
+		const float* pOrientationsY;
+		const float* pOrientationsZ;
+		const float* pOrientationsW;
+		const float* pScalesX;
+		const float* pScalesY;
+		const float* pScalesZ;
+	};
+
+	// matrices[i] = Matrix4::getTransformation of transform i, for the transforms in [begin, end) only so the work can be split.
+	// the same operations as the template, several transforms at once
+	void composeTransformationMatrices(const TransformArrays& transforms, uint32_t begin, uint32_t end, Matrix4<float>* pMatrices);
+	// same, split across the job threads, for many transforms
+	void composeTransformationMatricesParallel(const TransformArrays& transforms, uint32_t count, Matrix4<float>* pMatrices);
+
+	// ===== Vector batches =====
+	/*
+	Vector3 operations on arrays of vectors, several vectors at once with SIMD.
+	a Vector3<float> is 12 bytes, one vector in a register leaves a lane empty and costs more in shuffles than it saves,
+	so the operations are only vectorized over arrays, the same operations as the templates so the results are the same bit for bit.
+	*/
+	// vectors as one array per coordinate
+	struct VectorArrays
+	{
+	public:
+		const float* pX;
+		const float* pY;
+		const float* pZ;
+	};
+
+	// dots[i] = vectorsA[i].dot(vectorsB[i])
+	void computeDots(const VectorArrays& vectorsA, const VectorArrays& vectorsB, uint32_t count, float* pDots);
+	// results[i] = vectorsA[i].cross(vectorsB[i])
+	void computeCrosses(const VectorArrays& vectorsA, const VectorArrays& vectorsB, uint32_t count, float* pResultsX, float* pResultsY, float* pResultsZ);
+	// results[i] = vectorsA[i] + vectorsB[i] * scale
+	void computeScaledSums(const VectorArrays& vectorsA, const VectorArrays& vectorsB, float scale, uint32_t count, float* pResultsX, float* pResultsY, float* pResultsZ);
+	// Vector3::normalize of each vector in place, exits on a null vector as it does
+	void normalizeVectors(float* pX, float* pY, float* pZ, uint32_t count);
 }
\ No newline at end of file
@@ -1,5 +1,9 @@
 #include "mesh.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
 namespace Visor
 {
 	Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<ui32>& indices, const std::string& vertexShaderName, const std::string& fragmentShaderName)
@@ -7,7 +11,10 @@ namespace Visor
 		, _indices(indices)
 		, _vertexShaderName(vertexShaderName)
 		, _fragmentShaderName(fragmentShaderName)
-	{}
+		, _aabb(computeAABB(vertices))
+	{
+		computeBoundingSphere();
+	}
 
 	const std::vector<Mesh::Vertex>& Mesh::getVertices() const
 	{
@@ -28,4 +35,256 @@ namespace Visor
 	{
 		return _fragmentShaderName;
 	}
-}
\ No newline at end of file
+
+	const std::vector<Meshlet>& Mesh::getMeshlets() const
+	{
+		return _meshlets;
+	}
+
+	const AABB& Mesh::getAABB() const
+	{
+		return _aabb;
+	}
+
+	const Vector3<f32>& Mesh::getBoundingSphereCenter() const
+	{
+		return _boundingSphereCenter;
+	}
+
+	f32 Mesh::getBoundingSphereRadius() const
+	{
+		return _boundingSphereRadius;
+	}
+
+	void Mesh::buildBVH()
+	{
+		_bvh.build(*this);
+	}
+
+	const TriangleBVH& Mesh::getBVH() const
+	{
+		return _bvh;
+	}
+
+	b8 Mesh::intersect(const Ray& ray, f32 maxDistance, RayHit& hit) const
+	{
+		return _bvh.intersect(*this, ray, maxDistance, hit);
+	}
+
+	void Mesh::buildMeshlets(ui32 maxVertexCount, ui32 maxTriangleCount)
+	{
+		assert(maxVertexCount >= 3 && maxTriangleCount >= 1);
+
+		const ui32 vertexCount = (ui32)_vertices.size();
+		const ui32 triangleCount = (ui32)_indices.size() / 3;
+
+		// vertex to triangles adjacency
+		std::vector<ui32> adjacencyOffsets(vertexCount + 1, 0);
+		for (ui32 index : _indices)
+		{
+			adjacencyOffsets[index + 1] += 1;
+		}
+		for (ui32 vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex)
+		{
+			adjacencyOffsets[vertexIndex + 1] += adjacencyOffsets[vertexIndex];
+		}
+		std::vector<ui32> adjacentTriangles(triangleCount * 3);
+		{
+			std::vector<ui32> fillCounts(vertexCount, 0);
+			for (ui32 triangleIndex = 0; triangleIndex < triangleCount; ++triangleIndex)
+			{
+				for (ui32 corner = 0; corner < 3; ++corner)
+				{
+					const ui32 vertexIndex = _indices[triangleIndex * 3 + corner];
+					adjacentTriangles[adjacencyOffsets[vertexIndex] + fillCounts[vertexIndex]++] = triangleIndex;
+				}
+			}
+		}
+
+		std::vector<ui32> reorderedIndices;
+		reorderedIndices.reserve(_indices.size());
+		std::vector<b8> emittedTriangles(triangleCount, false);
+		std::vector<ui32> vertexMeshletIndices(vertexCount, UINT32_MAX);
+		std::vector<ui32> candidateTriangles;
+
+		_meshlets.clear();
+
+		for (ui32 seedTriangleIndex = 0; seedTriangleIndex < triangleCount; ++seedTriangleIndex)
+		{
+			if (emittedTriangles[seedTriangleIndex])
+			{
+				continue;
+			}
+
+			// grow the meshlet from the seed through shared vertices, so it stays spatially compact
+			const ui32 meshletIndex = (ui32)_meshlets.size();
+			Meshlet meshlet = {};
+			meshlet.indexOffset = (ui32)reorderedIndices.size();
+
+			candidateTriangles.clear();
+			candidateTriangles.push_back(seedTriangleIndex);
+
+			for (size_t candidateIndex = 0; candidateIndex < candidateTriangles.size() && meshlet.triangleCount < maxTriangleCount; ++candidateIndex)
+			{
+				const ui32 triangleIndex = candidateTriangles[candidateIndex];
+				if (emittedTriangles[triangleIndex])
+				{
+					continue;
+				}
+
+				const ui32* pTriangle = &_indices[triangleIndex * 3];
+				ui32 newVertexCount = 0;
+				for (ui32 corner = 0; corner < 3; ++corner)
+				{
+					const b8 duplicate = (corner > 0 && pTriangle[corner] == pTriangle[0]) || (corner > 1 && pTriangle[corner] == pTriangle[1]);
+					if (!duplicate && vertexMeshletIndices[pTriangle[corner]] != meshletIndex)
+					{
+						newVertexCount += 1;
+					}
+				}
+
+				if (meshlet.vertexCount + newVertexCount > maxVertexCount)
+				{
+					continue;
+				}
+
+				emittedTriangles[triangleIndex] = true;
+				meshlet.vertexCount += newVertexCount;
+				meshlet.triangleCount += 1;
+
+				for (ui32 corner = 0; corner < 3; ++corner)
+				{
+					const ui32 vertexIndex = pTriangle[corner];
+					vertexMeshletIndices[vertexIndex] = meshletIndex;
+					reorderedIndices.push_back(vertexIndex);
+
+					for (ui32 adjacencyIndex = adjacencyOffsets[vertexIndex]; adjacencyIndex < adjacencyOffsets[vertexIndex + 1]; ++adjacencyIndex)
+					{
+						if (!emittedTriangles[adjacentTriangles[adjacencyIndex]])
+						{
+							candidateTriangles.push_back(adjacentTriangles[adjacencyIndex]);
+						}
+					}
+				}
+			}
+
+			computeMeshletBounds(reorderedIndices, meshlet);
+			_meshlets.push_back(meshlet);
+		}
+
+		// trailing indices that do not form a triangle are kept as is
+		for (size_t index = triangleCount * 3; index < _indices.size(); ++index)
+		{
+			reorderedIndices.push_back(_indices[index]);
+		}
+
+		_indices = reorderedIndices;
+	}
+
+	AABB Mesh::computeAABB(const std::vector<Vertex>& vertices)
+	{
+		if (vertices.empty())
+		{
+			return AABB({0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f});
+		}
+
+		Vector3<f32> minimum = vertices[0].position;
+		Vector3<f32> maximum = vertices[0].position;
+		for (const Vertex& vertex : vertices)
+		{
+			minimum.x = std::min(minimum.x, vertex.position.x);
+			minimum.y = std::min(minimum.y, vertex.position.y);
+			minimum.z = std::min(minimum.z, vertex.position.z);
+			maximum.x = std::max(maximum.x, vertex.position.x);
+			maximum.y = std::max(maximum.y, vertex.position.y);
+			maximum.z = std::max(maximum.z, vertex.position.z);
+		}
+
+		return AABB(minimum, maximum);
+	}
+
+	void Mesh::computeBoundingSphere()
+	{
+		// centered on the bounding box, not minimal but tight enough for culling
+		_boundingSphereCenter = (_aabb.minimum + _aabb.maximum) * 0.5f;
+		_boundingSphereRadius = 0.0f;
+		for (const Vertex& vertex : _vertices)
+		{
+			_boundingSphereRadius = std::max(_boundingSphereRadius, (vertex.position - _boundingSphereCenter).getNorm());
+		}
+	}
+
+	void Mesh::computeMeshletBounds(const std::vector<ui32>& indices, Meshlet& meshlet) const
+	{
+		const ui32 firstIndex = meshlet.indexOffset;
+		const ui32 lastIndex = meshlet.indexOffset + meshlet.triangleCount * 3;
+
+		// bounding sphere centered on the bounding box
+		Vector3<f32> minimum = _vertices[indices[firstIndex]].position;
+		Vector3<f32> maximum = minimum;
+		for (ui32 index = firstIndex; index < lastIndex; ++index)
+		{
+			const Vector3<f32>& position = _vertices[indices[index]].position;
+			minimum.x = std::min(minimum.x, position.x);
+			minimum.y = std::min(minimum.y, position.y);
+			minimum.z = std::min(minimum.z, position.z);
+			maximum.x = std::max(maximum.x, position.x);
+			maximum.y = std::max(maximum.y, position.y);
+			maximum.z = std::max(maximum.z, position.z);
+		}
+
+		meshlet.center = (minimum + maximum) * 0.5f;
+		meshlet.radius = 0.0f;
+		for (ui32 index = firstIndex; index < lastIndex; ++index)
+		{
+			meshlet.radius = std::max(meshlet.radius, (_vertices[indices[index]].position - meshlet.center).getNorm());
+		}
+
+		// normal cone from the face normals, (b - a) x (c - a) points outward
+		std::vector<Vector3<f32>> faceNormals;
+		faceNormals.reserve(meshlet.triangleCount);
+		Vector3<f32> normalSum = {0.0f, 0.0f, 0.0f};
+		for (ui32 index = firstIndex; index < lastIndex; index += 3)
+		{
+			const Vector3<f32>& a = _vertices[indices[index + 0]].position;
+			const Vector3<f32>& b = _vertices[indices[index + 1]].position;
+			const Vector3<f32>& c = _vertices[indices[index + 2]].position;
+			Vector3<f32> faceNormal = (b - a).cross(c - a);
+
+			// degenerate triangles are never visible, they do not constrain the cone
+			if (faceNormal.getNorm2() == 0.0f)
+			{
+				continue;
+			}
+
+			faceNormal.normalize();
+			faceNormals.push_back(faceNormal);
+			normalSum = normalSum + faceNormal;
+		}
+
+		meshlet.coneAxis = {0.0f, 0.0f, 0.0f};
+		meshlet.coneCutoff = 1.0f;
+
+		if (faceNormals.empty() || normalSum.getNorm2() == 0.0f)
+		{
+			return;
+		}
+
+		normalSum.normalize();
+
+		f32 minimumDot = 1.0f;
+		for (const Vector3<f32>& faceNormal : faceNormals)
+		{
+			minimumDot = std::min(minimumDot, faceNormal.dot(normalSum));
+		}
+
+		// cones wider than ~84 degrees are almost never entirely back facing, do not bother testing them
+		if (minimumDot <= 0.1f)
+		{
+			return;
+		}
+
+		meshlet.coneAxis = normalSum;
+		meshlet.coneCutoff = std::sqrt(1.0f - minimumDot * minimumDot);
+	}
+}
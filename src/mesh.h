@@ -2,6 +2,10 @@
 
 #include "types.h"
 #include "maths.h"
+#include "meshlet.h"
+#include "AABB.h"
+#include "ray.h"
+#include "triangle_bvh.h"
 
 #include <vector>
 #include <string>
@@ -23,11 +27,33 @@ namespace Visor
 		const std::vector<ui32>& getIndices() const;
 		const std::string& getVertexShaderName() const;
 		const std::string& getFragmentShaderName() const;
+		const std::vector<Meshlet>& getMeshlets() const;
+		const AABB& getAABB() const;
+		const Vector3<f32>& getBoundingSphereCenter() const;
+		f32 getBoundingSphereRadius() const;
+
+		// partitions the mesh into meshlets, reordering its indices so each meshlet is a contiguous index range
+		void buildMeshlets(ui32 maxVertexCount, ui32 maxTriangleCount);
+		// builds the triangle hierarchy used by intersect, call it after buildMeshlets which reorders the triangles
+		void buildBVH();
+		const TriangleBVH& getBVH() const;
+		// closest triangle hit by a ray in the local space of the mesh, false if the hierarchy was not built
+		b8 intersect(const Ray& ray, f32 maxDistance, RayHit& hit) const;
+
+	private:
+		static AABB computeAABB(const std::vector<Vertex>& vertices);
+		void computeBoundingSphere();
+		void computeMeshletBounds(const std::vector<ui32>& indices, Meshlet& meshlet) const;
 
 	private:
 		std::vector<Vertex> _vertices;
 		std::vector<ui32> _indices;
 		std::string _vertexShaderName;
 		std::string _fragmentShaderName;
+		std::vector<Meshlet> _meshlets;
+		AABB _aabb;
+		Vector3<f32> _boundingSphereCenter;
+		f32 _boundingSphereRadius;
+		TriangleBVH _bvh;
 	};
 }
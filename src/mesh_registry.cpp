@@ -0,0 +1,248 @@
+#include "mesh_registry.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace Visor
+{
+	static MeshRegistry* pInstance = nullptr;
+
+	// the unit cube of the placeholder mesh
+	static const AABB PlaceholderAABB(Vector3<f32>{-0.5f, -0.5f, -0.5f}, Vector3<f32>{0.5f, 0.5f, 0.5f});
+
+	b8 MeshHandle::operator==(const MeshHandle& handle) const
+	{
+		return index == handle.index && generation == handle.generation;
+	}
+
+	b8 MeshHandle::operator!=(const MeshHandle& handle) const
+	{
+		return !(*this == handle);
+	}
+
+	MeshHandle MeshRegistry::registerMesh(const Mesh& mesh)
+	{
+		const ui64 hash = computeHash(mesh);
+
+		// share the existing allocation if the exact same mesh is already registered
+		typedef std::unordered_multimap<ui64, ui32>::iterator Iterator;
+		std::pair<Iterator, Iterator> range = _slotIndicesByHash.equal_range(hash);
+		for (Iterator it = range.first; it != range.second; ++it)
+		{
+			Slot& slot = _slots[it->second];
+			if (areIdentical(*slot.pMesh, mesh))
+			{
+				slot.referenceCount += 1;
+				return MeshHandle{it->second, slot.generation};
+			}
+		}
+
+		const ui32 slotIndex = allocateSlot();
+
+		Slot& slot = _slots[slotIndex];
+		slot.pMesh = new Mesh(mesh);
+		slot.hash = hash;
+
+		_slotIndicesByHash.insert(std::make_pair(hash, slotIndex));
+
+		return MeshHandle{slotIndex, slot.generation};
+	}
+
+	MeshHandle MeshRegistry::reserveMesh()
+	{
+		const ui32 slotIndex = allocateSlot();
+		return MeshHandle{slotIndex, _slots[slotIndex].generation};
+	}
+
+	void MeshRegistry::setMesh(MeshHandle handle, const Mesh& mesh)
+	{
+		assert(isValid(handle) && !isLoaded(handle));
+
+		Slot& slot = _slots[handle.index];
+		slot.pMesh = new Mesh(mesh);
+		slot.hash = computeHash(mesh);
+
+		_slotIndicesByHash.insert(std::make_pair(slot.hash, handle.index));
+	}
+
+	void MeshRegistry::replaceMesh(MeshHandle handle, const Mesh& mesh)
+	{
+		assert(isLoaded(handle));
+
+		Slot& slot = _slots[handle.index];
+		removeFromHashes(handle.index);
+
+		delete slot.pMesh;
+		slot.pMesh = new Mesh(mesh);
+		slot.hash = computeHash(mesh);
+		slot.revision += 1;
+
+		_slotIndicesByHash.insert(std::make_pair(slot.hash, handle.index));
+	}
+
+	void MeshRegistry::retain(MeshHandle handle)
+	{
+		assert(isValid(handle));
+		_slots[handle.index].referenceCount += 1;
+	}
+
+	void MeshRegistry::release(MeshHandle handle)
+	{
+		assert(isValid(handle));
+
+		Slot& slot = _slots[handle.index];
+		slot.referenceCount -= 1;
+		if (slot.referenceCount > 0)
+		{
+			return;
+		}
+
+		if (slot.pMesh != nullptr)
+		{
+			removeFromHashes(handle.index);
+		}
+
+		delete slot.pMesh;
+		slot.pMesh = nullptr;
+		slot.generation += 1; // invalidates every outstanding handle to this slot
+		_freeSlotIndices.push_back(handle.index);
+		_meshCount -= 1;
+	}
+
+	b8 MeshRegistry::isValid(MeshHandle handle) const
+	{
+		return handle.index < _slots.size() && _slots[handle.index].referenceCount > 0 && _slots[handle.index].generation == handle.generation;
+	}
+
+	b8 MeshRegistry::isLoaded(MeshHandle handle) const
+	{
+		return isValid(handle) && _slots[handle.index].pMesh != nullptr;
+	}
+
+	const Mesh& MeshRegistry::getMesh(MeshHandle handle) const
+	{
+		assert(isLoaded(handle));
+		return *_slots[handle.index].pMesh;
+	}
+
+	const AABB& MeshRegistry::getAABB(MeshHandle handle) const
+	{
+		assert(isValid(handle));
+		return isLoaded(handle) ? _slots[handle.index].pMesh->getAABB() : PlaceholderAABB;
+	}
+
+	ui32 MeshRegistry::getRevision(MeshHandle handle) const
+	{
+		assert(isValid(handle));
+		return _slots[handle.index].revision;
+	}
+
+	ui32 MeshRegistry::getMeshCount() const
+	{
+		return _meshCount;
+	}
+
+	void MeshRegistry::start()
+	{
+		assert(pInstance == nullptr);
+		pInstance = new MeshRegistry();
+	}
+
+	void MeshRegistry::terminate()
+	{
+		assert(pInstance != nullptr);
+		delete pInstance;
+		pInstance = nullptr;
+	}
+
+	MeshRegistry& MeshRegistry::getInstance()
+	{
+		assert(pInstance != nullptr);
+		return *pInstance;
+	}
+
+	MeshRegistry::MeshRegistry()
+		: _meshCount(0)
+	{}
+
+	MeshRegistry::~MeshRegistry()
+	{
+		assert(_meshCount == 0 && "meshes are still referenced when terminating the mesh registry");
+
+		for (Slot& slot : _slots)
+		{
+			delete slot.pMesh;
+		}
+	}
+
+	ui32 MeshRegistry::allocateSlot()
+	{
+		ui32 slotIndex = 0;
+		if (_freeSlotIndices.empty())
+		{
+			slotIndex = (ui32)_slots.size();
+			_slots.push_back(Slot{nullptr, 0, 0, 0, 0});
+		}
+		else
+		{
+			slotIndex = _freeSlotIndices.back();
+			_freeSlotIndices.pop_back();
+		}
+
+		_slots[slotIndex].referenceCount = 1;
+		_meshCount += 1;
+
+		return slotIndex;
+	}
+
+	void MeshRegistry::removeFromHashes(ui32 slotIndex)
+	{
+		typedef std::unordered_multimap<ui64, ui32>::iterator Iterator;
+		std::pair<Iterator, Iterator> range = _slotIndicesByHash.equal_range(_slots[slotIndex].hash);
+		for (Iterator it = range.first; it != range.second; ++it)
+		{
+			if (it->second == slotIndex)
+			{
+				_slotIndicesByHash.erase(it);
+				break;
+			}
+		}
+	}
+
+	static ui64 hashBytes(ui64 hash, const void* pData, size_t size)
+	{
+		// FNV-1a
+		const ui8* pBytes = (const ui8*)pData;
+		for (size_t byteIndex = 0; byteIndex < size; ++byteIndex)
+		{
+			hash ^= pBytes[byteIndex];
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	ui64 MeshRegistry::computeHash(const Mesh& mesh)
+	{
+		ui64 hash = 14695981039346656037ull;
+		hash = hashBytes(hash, mesh.getVertices().data(), mesh.getVertices().size() * sizeof(Mesh::Vertex));
+		hash = hashBytes(hash, mesh.getIndices().data(), mesh.getIndices().size() * sizeof(ui32));
+		hash = hashBytes(hash, mesh.getMeshlets().data(), mesh.getMeshlets().size() * sizeof(Meshlet));
+		hash = hashBytes(hash, mesh.getVertexShaderName().data(), mesh.getVertexShaderName().size());
+		hash = hashBytes(hash, mesh.getFragmentShaderName().data(), mesh.getFragmentShaderName().size());
+
+		return hash;
+	}
+
+	b8 MeshRegistry::areIdentical(const Mesh& meshA, const Mesh& meshB)
+	{
+		return meshA.getVertices().size() == meshB.getVertices().size() &&
+			(meshA.getVertices().empty() || std::memcmp(meshA.getVertices().data(), meshB.getVertices().data(), meshA.getVertices().size() * sizeof(Mesh::Vertex)) == 0) &&
+			meshA.getIndices() == meshB.getIndices() &&
+			meshA.getMeshlets().size() == meshB.getMeshlets().size() &&
+			(meshA.getMeshlets().empty() || std::memcmp(meshA.getMeshlets().data(), meshB.getMeshlets().data(), meshA.getMeshlets().size() * sizeof(Meshlet)) == 0) &&
+			meshA.getBVH().isBuilt() == meshB.getBVH().isBuilt() &&
+			meshA.getVertexShaderName() == meshB.getVertexShaderName() &&
+			meshA.getFragmentShaderName() == meshB.getFragmentShaderName();
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "types.h"
+#include "mesh.h"
+
+#include <vector>
+#include <unordered_map>
+
+namespace Visor
+{
+	// lightweight reference to a mesh owned by the registry, the generation detects stale handles
+	struct MeshHandle
+	{
+	public:
+		b8 operator==(const MeshHandle& handle) const;
+		b8 operator!=(const MeshHandle& handle) const;
+
+	public:
+		ui32 index;
+		ui32 generation;
+	};
+
+	// references no mesh, for entities that only carry a transform (camera anchors, pivots)
+	const MeshHandle NullMeshHandle = {0xFFFFFFFF, 0};
+
+	/*
+	owns every mesh, identical meshes (same geometry and shaders) share a single allocation.
+	handles are reference counted : registerMesh, reserveMesh and retain add a reference, release removes one
+	and the mesh is destroyed once nobody references it anymore.
+	a reserved handle is valid but not loaded until setMesh gives it its data (used for streaming).
+	replaceMesh swaps the data of a loaded mesh (used for hot reload), bumping its revision
+	*/
+	class MeshRegistry
+	{
+	public:
+		MeshHandle registerMesh(const Mesh& mesh);
+		MeshHandle reserveMesh();
+		void setMesh(MeshHandle handle, const Mesh& mesh);
+		void replaceMesh(MeshHandle handle, const Mesh& mesh);
+		void retain(MeshHandle handle);
+		void release(MeshHandle handle);
+
+		b8 isValid(MeshHandle handle) const;
+		b8 isLoaded(MeshHandle handle) const;
+		const Mesh& getMesh(MeshHandle handle) const;
+		// bounds of the mesh, or of the placeholder cube drawn while it loads
+		const AABB& getAABB(MeshHandle handle) const;
+		ui32 getRevision(MeshHandle handle) const;
+		ui32 getMeshCount() const;
+
+		static void start();
+		static void terminate();
+		static MeshRegistry& getInstance();
+
+	private:
+		struct Slot
+		{
+		public:
+			Mesh* pMesh;
+			ui64 hash;
+			ui32 generation;
+			ui32 revision;
+			ui32 referenceCount;
+		};
+
+	private:
+		MeshRegistry();
+		~MeshRegistry();
+
+		ui32 allocateSlot();
+		void removeFromHashes(ui32 slotIndex);
+		static ui64 computeHash(const Mesh& mesh);
+		// compares the data itself, vertices, indices and meshlets, a hash collision never shares a mesh
+		static b8 areIdentical(const Mesh& meshA, const Mesh& meshB);
+
+	private:
+		std::vector<Slot> _slots;
+		std::vector<ui32> _freeSlotIndices;
+		std::unordered_multimap<ui64, ui32> _slotIndicesByHash;
+		ui32 _meshCount;
+	};
+}
@@ -0,0 +1,48 @@
+#include "meshlet.h"
+
+namespace Visor
+{
+	static b8 isMeshletBackFacing(const Meshlet& meshlet, const Vector3<f32>& cameraPosition)
+	{
+		// every triangle normal is within the cone, if the whole bounding sphere is seen from behind the cone
+		// every triangle is back facing
+		const Vector3<f32> cameraToCenter = meshlet.center - cameraPosition;
+		return cameraToCenter.dot(meshlet.coneAxis) >= meshlet.coneCutoff * cameraToCenter.getNorm() + meshlet.radius;
+	}
+
+	void cullMeshlets(
+		const std::vector<Meshlet>& meshlets,
+		const Frustum& frustum,
+		const Vector3<f32>& cameraPosition,
+		std::vector<IndexRange>& indexRanges,
+		MeshletCullingStatistics& statistics)
+	{
+		const size_t firstRangeIndex = indexRanges.size();
+
+		for (const Meshlet& meshlet : meshlets)
+		{
+			statistics.meshletCount += 1;
+			statistics.triangleCount += meshlet.triangleCount;
+
+			if (!frustum.intersectsSphere(meshlet.center, meshlet.radius) || isMeshletBackFacing(meshlet, cameraPosition))
+			{
+				statistics.culledMeshletCount += 1;
+				statistics.culledTriangleCount += meshlet.triangleCount;
+				continue;
+			}
+
+			const ui32 indexCount = meshlet.triangleCount * 3;
+			if (indexRanges.size() > firstRangeIndex && indexRanges.back().offset + indexRanges.back().count == meshlet.indexOffset)
+			{
+				indexRanges.back().count += indexCount;
+			}
+			else
+			{
+				IndexRange indexRange = {};
+				indexRange.offset = meshlet.indexOffset;
+				indexRange.count = indexCount;
+				indexRanges.push_back(indexRange);
+			}
+		}
+	}
+}
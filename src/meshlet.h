@@ -0,0 +1,52 @@
+#pragma once
+
+#include "types.h"
+#include "maths.h"
+#include "frustum.h"
+
+#include <vector>
+
+namespace Visor
+{
+	// a small cluster of triangles, contiguous in the index buffer of its mesh
+	struct Meshlet
+	{
+	public:
+		ui32 indexOffset;
+		ui32 triangleCount;
+		ui32 vertexCount;
+
+		// bounding sphere
+		Vector3<f32> center;
+		f32 radius;
+
+		// normal cone, a cutoff of 1 means the cone is too wide to ever be back facing
+		Vector3<f32> coneAxis;
+		f32 coneCutoff;
+	};
+
+	struct IndexRange
+	{
+	public:
+		ui32 offset;
+		ui32 count;
+	};
+
+	struct MeshletCullingStatistics
+	{
+	public:
+		ui32 meshletCount;
+		ui32 culledMeshletCount;
+		ui32 triangleCount;
+		ui32 culledTriangleCount;
+	};
+
+	// frustum and camera position must be in the local space of the mesh the meshlets belong to
+	// surviving meshlets are appended to indexRanges, adjacent ones being merged into a single range
+	void cullMeshlets(
+		const std::vector<Meshlet>& meshlets,
+		const Frustum& frustum,
+		const Vector3<f32>& cameraPosition,
+		std::vector<IndexRange>& indexRanges,
+		MeshletCullingStatistics& statistics);
+}
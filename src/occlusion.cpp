@@ -0,0 +1,483 @@
+#include "occlusion.h"
+#include "job_system.h"
+#include "mesh_registry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define VSR_OCCLUSION_SSE
+#endif
+
+namespace Visor
+{
+	static const ui32 OccluderBatchSize = 4;
+	static const ui32 BoxBatchSize = 1024;
+
+	OcclusionCuller::OcclusionCuller()
+		: _viewProjectionMatrix(Matrix4<f32>::getIdentity())
+	{
+		ui32 width = Width;
+		ui32 height = Height;
+		while (true)
+		{
+			_levelWidths.push_back(width);
+			_levelHeights.push_back(height);
+			_depthLevels.push_back(std::vector<f32>(width * height, 1.0f));
+
+			if (width == 1 && height == 1)
+			{
+				break;
+			}
+
+			width = (width + 1) / 2;
+			height = (height + 1) / 2;
+		}
+
+		_tileTriangleIndices.resize((Width / TileWidth) * (Height / TileHeight));
+	}
+
+	void OcclusionCuller::render(const Matrix4<f32>& viewProjectionMatrix, const EntityStore& entities)
+	{
+		_viewProjectionMatrix = viewProjectionMatrix;
+
+		const MeshRegistry& meshRegistry = MeshRegistry::getInstance();
+		const std::vector<MeshHandle>& meshHandles = entities.getMeshHandles();
+		const std::vector<ui8>& occluderFlags = entities.getOccluderFlags();
+		const std::vector<Matrix4<f32>>& transformationMatrices = entities.getTransformationMatrices();
+
+		_occluderIndices.clear();
+		for (ui32 entityIndex = 0; entityIndex < entities.getEntityCount(); ++entityIndex)
+		{
+			if (occluderFlags[entityIndex] && meshHandles[entityIndex] != NullMeshHandle && meshRegistry.isLoaded(meshHandles[entityIndex]))
+			{
+				_occluderIndices.push_back(entityIndex);
+			}
+		}
+
+		// occluders are projected in parallel, each batch into its own list
+		const ui32 batchCount = ((ui32)_occluderIndices.size() + OccluderBatchSize - 1) / OccluderBatchSize;
+		_batchTriangles.resize(batchCount);
+		JobSystem::getInstance().parallelFor((ui32)_occluderIndices.size(), OccluderBatchSize, [&](ui32 begin, ui32 end)
+		{
+			std::vector<ScreenTriangle>& triangles = _batchTriangles[begin / OccluderBatchSize];
+			triangles.clear();
+			for (ui32 occluderIndex = begin; occluderIndex < end; ++occluderIndex)
+			{
+				const ui32 entityIndex = _occluderIndices[occluderIndex];
+				setupTriangles(_viewProjectionMatrix * transformationMatrices[entityIndex], meshRegistry.getMesh(meshHandles[entityIndex]), triangles);
+			}
+		});
+
+		// then binned to the tiles their bounds overlap
+		_triangles.clear();
+		for (const std::vector<ScreenTriangle>& triangles : _batchTriangles)
+		{
+			_triangles.insert(_triangles.end(), triangles.begin(), triangles.end());
+		}
+
+		for (std::vector<ui32>& triangleIndices : _tileTriangleIndices)
+		{
+			triangleIndices.clear();
+		}
+
+		const ui32 tileCountX = Width / TileWidth;
+		for (ui32 triangleIndex = 0; triangleIndex < _triangles.size(); ++triangleIndex)
+		{
+			const ScreenTriangle& triangle = _triangles[triangleIndex];
+			for (ui32 tileY = triangle.bounds.minimumY / TileHeight; tileY <= triangle.bounds.maximumY / TileHeight; ++tileY)
+			{
+				for (ui32 tileX = triangle.bounds.minimumX / TileWidth; tileX <= triangle.bounds.maximumX / TileWidth; ++tileX)
+				{
+					_tileTriangleIndices[tileY * tileCountX + tileX].push_back(triangleIndex);
+				}
+			}
+		}
+
+		JobSystem::getInstance().parallelFor((ui32)_tileTriangleIndices.size(), 1, [this](ui32 begin, ui32 end)
+		{
+			for (ui32 tileIndex = begin; tileIndex < end; ++tileIndex)
+			{
+				rasterizeTile(tileIndex);
+			}
+		});
+
+		// levels coarser than a tile mix several tiles
+		for (ui32 level = 1; level < _depthLevels.size(); ++level)
+		{
+			if ((TileWidth >> level) << level != TileWidth || (TileHeight >> level) << level != TileHeight)
+			{
+				downsample(level, 0, 0, _levelWidths[level], _levelHeights[level]);
+			}
+		}
+	}
+
+	void OcclusionCuller::cullBoxes(const BoundsArrays& bounds, const std::vector<ui32>& indices, ui8* pVisibilities) const
+	{
+		JobSystem::getInstance().parallelFor((ui32)indices.size(), BoxBatchSize, [&](ui32 begin, ui32 end)
+		{
+			for (ui32 position = begin; position < end; ++position)
+			{
+				const ui32 boxIndex = indices[position];
+				const Vector3<f32> center = {bounds.centersX[boxIndex], bounds.centersY[boxIndex], bounds.centersZ[boxIndex]};
+				const Vector3<f32> extent = {bounds.extentsX[boxIndex], bounds.extentsY[boxIndex], bounds.extentsZ[boxIndex]};
+				if (pVisibilities[boxIndex] && isOccluded(center, extent))
+				{
+					pVisibilities[boxIndex] = 0;
+				}
+			}
+		});
+	}
+
+	b8 OcclusionCuller::isOccluded(const Vector3<f32>& center, const Vector3<f32>& extent) const
+	{
+		if (_triangles.empty())
+		{
+			return false;
+		}
+
+		// the corners are the projected center plus or minus the projected extent along each axis
+		const Matrix4<f32>& m = _viewProjectionMatrix;
+		f32 clipCenter[4];
+		f32 clipExtents[3][4];
+		for (ui32 row = 0; row < 4; ++row)
+		{
+			clipCenter[row] = m.m[row][0] * center.x + m.m[row][1] * center.y + m.m[row][2] * center.z + m.m[row][3];
+			clipExtents[0][row] = m.m[row][0] * extent.x;
+			clipExtents[1][row] = m.m[row][1] * extent.y;
+			clipExtents[2][row] = m.m[row][2] * extent.z;
+		}
+
+		f32 minimumX = std::numeric_limits<f32>::max();
+		f32 minimumY = std::numeric_limits<f32>::max();
+		f32 maximumX = -std::numeric_limits<f32>::max();
+		f32 maximumY = -std::numeric_limits<f32>::max();
+		f32 minimumDepth = 1.0f;
+
+		#if defined(VSR_OCCLUSION_SSE)
+			// corners 0 to 3 on the negative z side, 4 to 7 on the positive one
+			const __m128 signsX = _mm_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f);
+			const __m128 signsY = _mm_setr_ps(-1.0f, -1.0f, 1.0f, 1.0f);
+			__m128 clips[2][4];
+			for (ui32 row = 0; row < 4; ++row)
+			{
+				const __m128 sideCenter = _mm_add_ps(_mm_add_ps(_mm_set1_ps(clipCenter[row]),
+					_mm_mul_ps(signsX, _mm_set1_ps(clipExtents[0][row]))),
+					_mm_mul_ps(signsY, _mm_set1_ps(clipExtents[1][row])));
+				clips[0][row] = _mm_sub_ps(sideCenter, _mm_set1_ps(clipExtents[2][row]));
+				clips[1][row] = _mm_add_ps(sideCenter, _mm_set1_ps(clipExtents[2][row]));
+			}
+
+			// a box crossing the near plane is too close to be hidden
+			const __m128 zero = _mm_setzero_ps();
+			if (_mm_movemask_ps(_mm_or_ps(_mm_cmple_ps(clips[0][2], zero), _mm_cmple_ps(clips[1][2], zero))) != 0)
+			{
+				return false;
+			}
+
+			const __m128 half = _mm_set1_ps(0.5f);
+			__m128 minimumsX = _mm_set1_ps(minimumX);
+			__m128 minimumsY = _mm_set1_ps(minimumY);
+			__m128 maximumsX = _mm_set1_ps(maximumX);
+			__m128 maximumsY = _mm_set1_ps(maximumY);
+			__m128 minimumDepths = _mm_set1_ps(minimumDepth);
+			for (ui32 side = 0; side < 2; ++side)
+			{
+				const __m128 inverseW = _mm_div_ps(_mm_set1_ps(1.0f), clips[side][3]);
+				const __m128 x = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(clips[side][0], inverseW), half), half), _mm_set1_ps((f32)Width));
+				const __m128 y = _mm_mul_ps(_mm_sub_ps(half, _mm_mul_ps(_mm_mul_ps(clips[side][1], inverseW), half)), _mm_set1_ps((f32)Height));
+				minimumsX = _mm_min_ps(minimumsX, x);
+				minimumsY = _mm_min_ps(minimumsY, y);
+				maximumsX = _mm_max_ps(maximumsX, x);
+				maximumsY = _mm_max_ps(maximumsY, y);
+				minimumDepths = _mm_min_ps(minimumDepths, _mm_mul_ps(clips[side][2], inverseW));
+			}
+
+			f32 lanes[5][4];
+			_mm_storeu_ps(lanes[0], minimumsX);
+			_mm_storeu_ps(lanes[1], minimumsY);
+			_mm_storeu_ps(lanes[2], maximumsX);
+			_mm_storeu_ps(lanes[3], maximumsY);
+			_mm_storeu_ps(lanes[4], minimumDepths);
+			for (ui32 lane = 0; lane < 4; ++lane)
+			{
+				minimumX = std::min(minimumX, lanes[0][lane]);
+				minimumY = std::min(minimumY, lanes[1][lane]);
+				maximumX = std::max(maximumX, lanes[2][lane]);
+				maximumY = std::max(maximumY, lanes[3][lane]);
+				minimumDepth = std::min(minimumDepth, lanes[4][lane]);
+			}
+		#else
+			for (ui32 cornerIndex = 0; cornerIndex < 8; ++cornerIndex)
+			{
+				f32 clip[4];
+				for (ui32 row = 0; row < 4; ++row)
+				{
+					clip[row] = clipCenter[row] +
+						((cornerIndex & 1) ? clipExtents[0][row] : -clipExtents[0][row]) +
+						((cornerIndex & 2) ? clipExtents[1][row] : -clipExtents[1][row]) +
+						((cornerIndex & 4) ? clipExtents[2][row] : -clipExtents[2][row]);
+				}
+
+				// a box crossing the near plane is too close to be hidden
+				if (clip[2] <= 0.0f)
+				{
+					return false;
+				}
+
+				const f32 inverseW = 1.0f / clip[3];
+				const f32 x = (clip[0] * inverseW * 0.5f + 0.5f) * Width;
+				const f32 y = (0.5f - clip[1] * inverseW * 0.5f) * Height;
+				minimumX = std::min(minimumX, x);
+				minimumY = std::min(minimumY, y);
+				maximumX = std::max(maximumX, x);
+				maximumY = std::max(maximumY, y);
+				minimumDepth = std::min(minimumDepth, clip[2] * inverseW);
+			}
+		#endif
+
+		// off screen boxes are left to the frustum
+		if (maximumX < 0.0f || maximumY < 0.0f || minimumX >= Width || minimumY >= Height)
+		{
+			return false;
+		}
+
+		const ui32 beginX = (ui32)std::max(minimumX, 0.0f);
+		const ui32 beginY = (ui32)std::max(minimumY, 0.0f);
+		const ui32 endX = (ui32)std::min(maximumX, (f32)(Width - 1));
+		const ui32 endY = (ui32)std::min(maximumY, (f32)(Height - 1));
+
+		// the coarsest level where the box spans at most 4x4 texels
+		ui32 level = 0;
+		while (level + 1 < _depthLevels.size() && ((endX >> level) - (beginX >> level) >= 4 || (endY >> level) - (beginY >> level) >= 4))
+		{
+			level += 1;
+		}
+
+		const std::vector<f32>& depths = _depthLevels[level];
+		const ui32 levelWidth = _levelWidths[level];
+		for (ui32 y = beginY >> level; y <= endY >> level; ++y)
+		{
+			for (ui32 x = beginX >> level; x <= endX >> level; ++x)
+			{
+				if (depths[y * levelWidth + x] >= minimumDepth)
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	void OcclusionCuller::writeDepthImage(const std::string& path) const
+	{
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open())
+		{
+			std::cerr << "could not open file " << path << "\n";
+			std::exit(EXIT_FAILURE);
+		}
+
+		file << "P5\n" << Width << " " << Height << "\n255\n";
+
+		// 1 - depth is near / z, the square root keeps distant occluders visible
+		const std::vector<f32>& depths = _depthLevels[0];
+		std::vector<ui8> pixels(depths.size());
+		for (ui32 pixelIndex = 0; pixelIndex < depths.size(); ++pixelIndex)
+		{
+			pixels[pixelIndex] = (ui8)(std::sqrt(std::max(1.0f - depths[pixelIndex], 0.0f)) * 255.0f);
+		}
+		file.write((const c8*)pixels.data(), pixels.size());
+	}
+
+	ui32 OcclusionCuller::getOccluderCount() const
+	{
+		return (ui32)_occluderIndices.size();
+	}
+
+	ui32 OcclusionCuller::getOccluderTriangleCount() const
+	{
+		return (ui32)_triangles.size();
+	}
+
+	void OcclusionCuller::setupTriangles(const Matrix4<f32>& matrix, const Mesh& mesh, std::vector<ScreenTriangle>& triangles) const
+	{
+		const std::vector<Mesh::Vertex>& vertices = mesh.getVertices();
+		const std::vector<ui32>& indices = mesh.getIndices();
+
+		for (ui32 index = 0; index + 2 < indices.size(); index += 3)
+		{
+			Vector4<f32> clipPositions[3];
+			for (ui32 cornerIndex = 0; cornerIndex < 3; ++cornerIndex)
+			{
+				const Vector3<f32>& position = vertices[indices[index + cornerIndex]].position;
+				clipPositions[cornerIndex] = matrix * Vector4<f32>{position.x, position.y, position.z, 1.0f};
+			}
+
+			// cut by the near plane, which leaves up to two triangles
+			ClipCorner polygon[4];
+			const ui32 polygonSize = clipTriangle(clipPositions[0], clipPositions[1], clipPositions[2], polygon);
+			for (ui32 cornerIndex = 2; cornerIndex < polygonSize; ++cornerIndex)
+			{
+				addTriangle(polygon[0].position, polygon[cornerIndex - 1].position, polygon[cornerIndex].position, triangles);
+			}
+		}
+	}
+
+	void OcclusionCuller::addTriangle(const Vector4<f32>& a, const Vector4<f32>& b, const Vector4<f32>& c, std::vector<ScreenTriangle>& triangles) const
+	{
+		const Vector4<f32>* clipPositions[3] = {&a, &b, &c};
+
+		ScreenTriangle triangle = {};
+		for (ui32 cornerIndex = 0; cornerIndex < 3; ++cornerIndex)
+		{
+			const Vector4<f32>& clip = *clipPositions[cornerIndex];
+			const Vector3<f32> screenPosition = getScreenPosition(clip, 1.0f / clip.w, Width, Height);
+			triangle.x[cornerIndex] = screenPosition.x;
+			triangle.y[cornerIndex] = screenPosition.y;
+			triangle.z[cornerIndex] = screenPosition.z;
+		}
+
+		// back faces and triangles between pixel centers are dropped
+		if (getPixelBounds(triangle.x, triangle.y, Width, Height, triangle.bounds))
+		{
+			triangles.push_back(triangle);
+		}
+	}
+
+	void OcclusionCuller::rasterizeTile(ui32 tileIndex)
+	{
+		const ui32 tileX = (tileIndex % (Width / TileWidth)) * TileWidth;
+		const ui32 tileY = (tileIndex / (Width / TileWidth)) * TileHeight;
+
+		std::vector<f32>& depths = _depthLevels[0];
+		for (ui32 y = tileY; y < tileY + TileHeight; ++y)
+		{
+			std::fill(depths.begin() + y * Width + tileX, depths.begin() + y * Width + tileX + TileWidth, 1.0f);
+		}
+
+		for (ui32 triangleIndex : _tileTriangleIndices[tileIndex])
+		{
+			rasterizeTriangle(_triangles[triangleIndex], tileX, tileY);
+		}
+
+		// the levels finer than a tile only depend on its own pixels
+		for (ui32 level = 1; level < _depthLevels.size(); ++level)
+		{
+			if ((TileWidth >> level) << level != TileWidth || (TileHeight >> level) << level != TileHeight)
+			{
+				break;
+			}
+
+			downsample(level, tileX >> level, tileY >> level, (tileX + TileWidth) >> level, (tileY + TileHeight) >> level);
+		}
+	}
+
+	void OcclusionCuller::rasterizeTriangle(const ScreenTriangle& triangle, ui32 tileX, ui32 tileY)
+	{
+		// edge functions e(x, y) = a * x + b * y + c, positive inside, and the depth plane
+		f32 edgeA[3];
+		f32 edgeB[3];
+		f32 edgeC[3];
+		for (ui32 edgeIndex = 0; edgeIndex < 3; ++edgeIndex)
+		{
+			const ui32 begin = edgeIndex;
+			const ui32 end = (edgeIndex + 1) % 3;
+			edgeA[edgeIndex] = triangle.y[begin] - triangle.y[end];
+			edgeB[edgeIndex] = triangle.x[end] - triangle.x[begin];
+			edgeC[edgeIndex] = (triangle.y[end] - triangle.y[begin]) * triangle.x[begin] - (triangle.x[end] - triangle.x[begin]) * triangle.y[begin];
+		}
+
+		// the weight of a corner is the edge function of the opposite edge over the area
+		const f32 area = edgeC[0] + edgeA[0] * triangle.x[2] + edgeB[0] * triangle.y[2];
+		const f32 depthA = (triangle.z[0] * edgeA[1] + triangle.z[1] * edgeA[2] + triangle.z[2] * edgeA[0]) / area;
+		const f32 depthB = (triangle.z[0] * edgeB[1] + triangle.z[1] * edgeB[2] + triangle.z[2] * edgeB[0]) / area;
+		const f32 depthC = (triangle.z[0] * edgeC[1] + triangle.z[1] * edgeC[2] + triangle.z[2] * edgeC[0]) / area;
+
+		// tiles are multiples of 4 pixels wide, so aligned groups of 4 never leave the tile
+		const ui32 beginX = std::max(triangle.bounds.minimumX, tileX) & ~3u;
+		const ui32 beginY = std::max(triangle.bounds.minimumY, tileY);
+		const ui32 endX = std::min(triangle.bounds.maximumX, tileX + TileWidth - 1);
+		const ui32 endY = std::min(triangle.bounds.maximumY, tileY + TileHeight - 1);
+
+		f32* pDepths = _depthLevels[0].data();
+
+		#if defined(VSR_OCCLUSION_SSE)
+			const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+			const __m128 zero = _mm_setzero_ps();
+			for (ui32 y = beginY; y <= endY; ++y)
+			{
+				const f32 pixelY = y + 0.5f;
+				const __m128 rowEdge0 = _mm_set1_ps(edgeB[0] * pixelY + edgeC[0]);
+				const __m128 rowEdge1 = _mm_set1_ps(edgeB[1] * pixelY + edgeC[1]);
+				const __m128 rowEdge2 = _mm_set1_ps(edgeB[2] * pixelY + edgeC[2]);
+				const __m128 rowDepth = _mm_set1_ps(depthB * pixelY + depthC);
+
+				for (ui32 x = beginX; x <= endX; x += 4)
+				{
+					const __m128 pixelX = _mm_add_ps(_mm_set1_ps((f32)x), laneOffsets);
+					const __m128 edge0 = _mm_add_ps(_mm_mul_ps(pixelX, _mm_set1_ps(edgeA[0])), rowEdge0);
+					const __m128 edge1 = _mm_add_ps(_mm_mul_ps(pixelX, _mm_set1_ps(edgeA[1])), rowEdge1);
+					const __m128 edge2 = _mm_add_ps(_mm_mul_ps(pixelX, _mm_set1_ps(edgeA[2])), rowEdge2);
+					const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_cmpge_ps(edge1, zero)), _mm_cmpge_ps(edge2, zero));
+					if (_mm_movemask_ps(inside) == 0)
+					{
+						continue;
+					}
+
+					f32* pRow = pDepths + y * Width + x;
+					const __m128 previousDepth = _mm_loadu_ps(pRow);
+					const __m128 depth = _mm_min_ps(_mm_add_ps(_mm_mul_ps(pixelX, _mm_set1_ps(depthA)), rowDepth), previousDepth);
+					_mm_storeu_ps(pRow, _mm_or_ps(_mm_and_ps(inside, depth), _mm_andnot_ps(inside, previousDepth)));
+				}
+			}
+		#else
+			for (ui32 y = beginY; y <= endY; ++y)
+			{
+				const f32 pixelY = y + 0.5f;
+				for (ui32 x = beginX; x <= endX; ++x)
+				{
+					const f32 pixelX = x + 0.5f;
+					if (edgeA[0] * pixelX + edgeB[0] * pixelY + edgeC[0] < 0.0f ||
+						edgeA[1] * pixelX + edgeB[1] * pixelY + edgeC[1] < 0.0f ||
+						edgeA[2] * pixelX + edgeB[2] * pixelY + edgeC[2] < 0.0f)
+					{
+						continue;
+					}
+
+					f32& depth = pDepths[y * Width + x];
+					depth = std::min(depth, depthA * pixelX + depthB * pixelY + depthC);
+				}
+			}
+		#endif
+	}
+
+	void OcclusionCuller::downsample(ui32 level, ui32 beginX, ui32 beginY, ui32 endX, ui32 endY)
+	{
+		const std::vector<f32>& sources = _depthLevels[level - 1];
+		const ui32 sourceWidth = _levelWidths[level - 1];
+		const ui32 sourceHeight = _levelHeights[level - 1];
+		std::vector<f32>& destinations = _depthLevels[level];
+		const ui32 destinationWidth = _levelWidths[level];
+
+		// odd sizes repeat their last row or column
+		for (ui32 y = beginY; y < endY; ++y)
+		{
+			const ui32 sourceY0 = y * 2;
+			const ui32 sourceY1 = std::min(y * 2 + 1, sourceHeight - 1);
+			for (ui32 x = beginX; x < endX; ++x)
+			{
+				const ui32 sourceX0 = x * 2;
+				const ui32 sourceX1 = std::min(x * 2 + 1, sourceWidth - 1);
+				destinations[y * destinationWidth + x] = std::max(
+					std::max(sources[sourceY0 * sourceWidth + sourceX0], sources[sourceY0 * sourceWidth + sourceX1]),
+					std::max(sources[sourceY1 * sourceWidth + sourceX0], sources[sourceY1 * sourceWidth + sourceX1]));
+			}
+		}
+	}
+}
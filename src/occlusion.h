@@ -0,0 +1,76 @@
+#pragma once
+
+#include "types.h"
+#include "maths.h"
+#include "culling.h"
+#include "entity.h"
+#include "rasterization.h"
+
+#include <string>
+#include <vector>
+
+namespace Visor
+{
+	/*
+	software occlusion culling : the occluder entities are rasterized on the cpu into a small depth buffer,
+	then boxes are tested against a hierarchy of its maximum depths.
+	the screen is split into tiles, triangles are binned per tile and each tile is rasterized (4 pixels at a time)
+	by its own job, so tiles never share pixels.
+	depth is z / w of the engine projection : 0 on the near plane, 1 infinitely far
+	*/
+	class OcclusionCuller
+	{
+	public:
+		static const ui32 Width = 256;
+		static const ui32 Height = 144;
+		static const ui32 TileWidth = 32;
+		static const ui32 TileHeight = 16;
+
+		OcclusionCuller();
+
+		// clears the depth buffer and rasterizes every occluder with a loaded mesh
+		void render(const Matrix4<f32>& viewProjectionMatrix, const EntityStore& entities);
+		// clears visibilities[i] for the boxes at indices entirely hidden behind the occluders
+		void cullBoxes(const BoundsArrays& bounds, const std::vector<ui32>& indices, ui8* pVisibilities) const;
+		b8 isOccluded(const Vector3<f32>& center, const Vector3<f32>& extent) const;
+
+		// grayscale binary pgm of the depth buffer, brighter is closer
+		void writeDepthImage(const std::string& path) const;
+
+		ui32 getOccluderCount() const;
+		ui32 getOccluderTriangleCount() const;
+
+	private:
+		struct ScreenTriangle
+		{
+		public:
+			// pixel coordinates, y going down, and depth
+			f32 x[3];
+			f32 y[3];
+			f32 z[3];
+			PixelBounds bounds;
+		};
+
+	private:
+		void setupTriangles(const Matrix4<f32>& matrix, const Mesh& mesh, std::vector<ScreenTriangle>& triangles) const;
+		void addTriangle(const Vector4<f32>& a, const Vector4<f32>& b, const Vector4<f32>& c, std::vector<ScreenTriangle>& triangles) const;
+		void rasterizeTile(ui32 tileIndex);
+		void rasterizeTriangle(const ScreenTriangle& triangle, ui32 tileX, ui32 tileY);
+		void downsample(ui32 level, ui32 beginX, ui32 beginY, ui32 endX, ui32 endY);
+
+	private:
+		Matrix4<f32> _viewProjectionMatrix;
+
+		// level 0 is the depth buffer, each next level holds the maximum depth of 2x2 texels of the previous one
+		std::vector<std::vector<f32>> _depthLevels;
+		std::vector<ui32> _levelWidths;
+		std::vector<ui32> _levelHeights;
+
+		// triangles of each setup batch, then the indices of those touching each tile
+		std::vector<std::vector<ScreenTriangle>> _batchTriangles;
+		std::vector<ScreenTriangle> _triangles;
+		std::vector<std::vector<ui32>> _tileTriangleIndices;
+
+		std::vector<ui32> _occluderIndices;
+	};
+}
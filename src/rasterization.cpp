@@ -0,0 +1,95 @@
+#include "rasterization.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Visor
+{
+	ui32 clipTriangle(const Vector4<f32>& a, const Vector4<f32>& b, const Vector4<f32>& c, ClipCorner polygon[4])
+	{
+		const Vector4<f32>* pCorners[3] = {&a, &b, &c};
+
+		ui32 behindCount = 0;
+		for (ui32 cornerIndex = 0; cornerIndex < 3; ++cornerIndex)
+		{
+			behindCount += pCorners[cornerIndex]->z < 0.0f ? 1 : 0;
+		}
+
+		if (behindCount == 3)
+		{
+			return 0;
+		}
+
+		if (behindCount == 0)
+		{
+			for (ui32 cornerIndex = 0; cornerIndex < 3; ++cornerIndex)
+			{
+				polygon[cornerIndex] = ClipCorner{*pCorners[cornerIndex], cornerIndex, cornerIndex, 0.0f};
+			}
+			return 3;
+		}
+
+		// one or two corners behind leave a triangle or a quad
+		ui32 polygonSize = 0;
+		for (ui32 cornerIndex = 0; cornerIndex < 3; ++cornerIndex)
+		{
+			const ui32 nextIndex = (cornerIndex + 1) % 3;
+			const Vector4<f32>& current = *pCorners[cornerIndex];
+			const Vector4<f32>& next = *pCorners[nextIndex];
+			if (current.z >= 0.0f)
+			{
+				polygon[polygonSize++] = ClipCorner{current, cornerIndex, cornerIndex, 0.0f};
+			}
+
+			if ((current.z >= 0.0f) != (next.z >= 0.0f))
+			{
+				const f32 t = current.z / (current.z - next.z);
+				const Vector4<f32> position = {
+					current.x + (next.x - current.x) * t,
+					current.y + (next.y - current.y) * t,
+					0.0f,
+					current.w + (next.w - current.w) * t};
+				polygon[polygonSize++] = ClipCorner{position, cornerIndex, nextIndex, t};
+			}
+		}
+
+		return polygonSize;
+	}
+
+	Vector3<f32> getScreenPosition(const Vector4<f32>& clipPosition, f32 inverseW, ui32 width, ui32 height)
+	{
+		return Vector3<f32>{
+			(clipPosition.x * inverseW * 0.5f + 0.5f) * width,
+			(0.5f - clipPosition.y * inverseW * 0.5f) * height,
+			clipPosition.z * inverseW};
+	}
+
+	b8 getPixelBounds(const f32 x[3], const f32 y[3], ui32 width, ui32 height, PixelBounds& bounds)
+	{
+		const f32 area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+		if (!(area > 0.0f))
+		{
+			return false;
+		}
+
+		const f32 minimumX = std::min(x[0], std::min(x[1], x[2]));
+		const f32 minimumY = std::min(y[0], std::min(y[1], y[2]));
+		const f32 maximumX = std::max(x[0], std::max(x[1], x[2]));
+		const f32 maximumY = std::max(y[0], std::max(y[1], y[2]));
+
+		const f32 beginX = std::ceil(minimumX - 0.5f);
+		const f32 beginY = std::ceil(minimumY - 0.5f);
+		const f32 endX = std::floor(maximumX - 0.5f);
+		const f32 endY = std::floor(maximumY - 0.5f);
+		if (endX < 0.0f || endY < 0.0f || beginX > width - 1 || beginY > height - 1 || beginX > endX || beginY > endY)
+		{
+			return false;
+		}
+
+		bounds.minimumX = (ui32)std::max(beginX, 0.0f);
+		bounds.minimumY = (ui32)std::max(beginY, 0.0f);
+		bounds.maximumX = (ui32)std::min(endX, (f32)(width - 1));
+		bounds.maximumY = (ui32)std::min(endY, (f32)(height - 1));
+		return true;
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "types.h"
+#include "maths.h"
+
+namespace Visor
+{
+	/*
+	triangle setup of the cpu rasterizers, the software backend and the occlusion culler.
+	clip space is the one of the engine projection, 0 <= z <= w in front of the camera. the viewport maps y up in
+	normalized device coordinates to y going down the screen, so front faces are clockwise on screen, like in the graphics pipeline.
+	pixel centers are at half integers
+	*/
+
+	// corner of the polygon left of a triangle cut by the near plane : the point at t from corner first toward corner second,
+	// which attributes are interpolated to
+	struct ClipCorner
+	{
+	public:
+		Vector4<f32> position;
+		ui32 first;
+		ui32 second;
+		f32 t;
+	};
+
+	// pixels whose center lies within a triangle on screen, bounds included
+	struct PixelBounds
+	{
+	public:
+		ui32 minimumX;
+		ui32 minimumY;
+		ui32 maximumX;
+		ui32 maximumY;
+	};
+
+	// the polygon left of the triangle in front of the near plane (z = 0 in clip space), in the winding of the triangle.
+	// returns its corner count : 0 when the triangle is behind, 3 with the corners unchanged when it is in front, 3 or 4 when it is cut
+	ui32 clipTriangle(const Vector4<f32>& a, const Vector4<f32>& b, const Vector4<f32>& c, ClipCorner polygon[4]);
+	// pixel coordinates and depth of a clip space position, inverseW being 1 / w
+	Vector3<f32> getScreenPosition(const Vector4<f32>& clipPosition, f32 inverseW, ui32 width, ui32 height);
+	// false for back faces, and for triangles covering no pixel center of the screen
+	b8 getPixelBounds(const f32 x[3], const f32 y[3], ui32 width, ui32 height, PixelBounds& bounds);
+}
@@ -1,43 +1,280 @@
 #include "ray.h"
 
+#include <limits>
+
 namespace Visor
 {
 	Ray::Ray(const Vector3<f32>& position, const Vector3<f32>& direction)
 		: position(position)
-		, direction(direction)
-	{};
+	{
+		setDirection(direction);
+	}
 
-	b8 Ray::getIntersection(const AABB& AABB, Vector3<f32>& intersection)
+	void Ray::setDirection(const Vector3<f32>& direction)
 	{
-		f32 tmin = -1000000.0f;
-		f32 tmax = 100000.0f;
-		
-		// Pour chaque axe
-		for (int i = 0; i < 3; ++i)
+		_direction = direction;
+		inverseDirection = {1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z};
+
+		// the sign of the inverse also tells -0 from 0
+		directionSigns[0] = inverseDirection.x < 0.0f ? 1 : 0;
+		directionSigns[1] = inverseDirection.y < 0.0f ? 1 : 0;
+		directionSigns[2] = inverseDirection.z < 0.0f ? 1 : 0;
+	}
+
+	const Vector3<f32>& Ray::getDirection() const
+	{
+		return _direction;
+	}
+
+	// as the SIMD min and max : the second operand when either is nan, so a nan distance leaves the bound unchanged
+	static inline f32 getMinimum(f32 a, f32 b)
+	{
+		return a < b ? a : b;
+	}
+
+	static inline f32 getMaximum(f32 a, f32 b)
+	{
+		return a > b ? a : b;
+	}
+
+	b8 Ray::getIntersection(const AABB& AABB, Vector3<f32>& intersection) const
+	{
+		// the whole line, the box may start behind the ray
+		const f32 infinity = std::numeric_limits<f32>::infinity();
+
+		const f32 nearX = ((directionSigns[0] != 0 ? AABB.maximum.x : AABB.minimum.x) - position.x) * inverseDirection.x;
+		const f32 nearY = ((directionSigns[1] != 0 ? AABB.maximum.y : AABB.minimum.y) - position.y) * inverseDirection.y;
+		const f32 nearZ = ((directionSigns[2] != 0 ? AABB.maximum.z : AABB.minimum.z) - position.z) * inverseDirection.z;
+		const f32 farX = ((directionSigns[0] != 0 ? AABB.minimum.x : AABB.maximum.x) - position.x) * inverseDirection.x;
+		const f32 farY = ((directionSigns[1] != 0 ? AABB.minimum.y : AABB.maximum.y) - position.y) * inverseDirection.y;
+		const f32 farZ = ((directionSigns[2] != 0 ? AABB.minimum.z : AABB.maximum.z) - position.z) * inverseDirection.z;
+
+		const f32 entry = getMaximum(nearX, getMaximum(nearY, getMaximum(nearZ, -infinity)));
+		const f32 exit = getMinimum(farX, getMinimum(farY, getMinimum(farZ, infinity)));
+
+		// missed, behind the ray, or outside a slab the ray is parallel to which puts the entry at infinity
+		if (entry > exit || exit < 0.0f || entry == infinity)
 		{
-		    if (direction[i] != 0.0f)
-		    {
-		        f32 invD = 1.0f / direction[i];
-		        f32 t0 = (AABB.minimum[i] - position[i]) * invD;
-		        f32 t1 = (AABB.maximum[i] - position[i]) * invD;
-		        if (t0 > t1) std::swap(t0, t1);		
-		        tmin = std::max(tmin, t0);
-		        tmax = std::min(tmax, t1);		
-		        if (tmax < tmin) 
-		            return false; // pas d’intersection
-		    }
-		    else
-		    {
-		        // Rayon parallèle à l’axe : il faut vérifier qu’il est dans la "tranche"
-		        if (position[i] < AABB.minimum[i] || position[i] > AABB.maximum[i])
-		            return false;
-		    }
-		}		
-		if (tmax < 0.0f)
-		    return false; // boîte est derrière le rayon		
-		// Premier point d’intersection valide
-		f32 tHit = (tmin >= 0.0f) ? tmin : tmax;
-		intersection = position + direction * tHit;
+			return false;
+		}
+
+		intersection = position + _direction * (entry >= 0.0f ? entry : exit);
 		return true;
 	}
-}
\ No newline at end of file
+
+#if !defined(VSR_MATHS_SSE)
+	// one ray against one box with the operations of the vector kernels, when there are none.
+	// the plane entered first on each axis is picked from the sign, no min and max of the two slab distances.
+	// a ray parallel to a slab gets infinite distances, or nan when it starts exactly on a plane, which the bounds ignore
+	static inline b8 intersectSlabs(f32 positionX, f32 positionY, f32 positionZ, f32 inverseDirectionX, f32 inverseDirectionY, f32 inverseDirectionZ,
+		f32 minimumX, f32 minimumY, f32 minimumZ, f32 maximumX, f32 maximumY, f32 maximumZ, f32 maxDistance, f32& entry, f32& exit)
+	{
+		const f32 nearX = ((inverseDirectionX < 0.0f ? maximumX : minimumX) - positionX) * inverseDirectionX;
+		const f32 nearY = ((inverseDirectionY < 0.0f ? maximumY : minimumY) - positionY) * inverseDirectionY;
+		const f32 nearZ = ((inverseDirectionZ < 0.0f ? maximumZ : minimumZ) - positionZ) * inverseDirectionZ;
+		const f32 farX = ((inverseDirectionX < 0.0f ? minimumX : maximumX) - positionX) * inverseDirectionX;
+		const f32 farY = ((inverseDirectionY < 0.0f ? minimumY : maximumY) - positionY) * inverseDirectionY;
+		const f32 farZ = ((inverseDirectionZ < 0.0f ? minimumZ : maximumZ) - positionZ) * inverseDirectionZ;
+
+		entry = getMaximum(nearX, getMaximum(nearY, getMaximum(nearZ, 0.0f)));
+		exit = getMinimum(farX, getMinimum(farY, getMinimum(farZ, maxDistance)));
+
+		return entry <= exit;
+	}
+
+	static ui32 intersectBoxesOneByOne(const Ray& ray, const AABBArrays& boxes, ui32 firstBox, ui32 boxCount, f32 maxDistance, f32* pEntries, f32* pExits)
+	{
+		ui32 hitMask = 0;
+		for (ui32 lane = 0; lane < boxCount; ++lane)
+		{
+			const ui32 box = firstBox + lane;
+			const b8 hit = intersectSlabs(ray.position.x, ray.position.y, ray.position.z, ray.inverseDirection.x, ray.inverseDirection.y, ray.inverseDirection.z,
+				boxes.pMinimumsX[box], boxes.pMinimumsY[box], boxes.pMinimumsZ[box], boxes.pMaximumsX[box], boxes.pMaximumsY[box], boxes.pMaximumsZ[box],
+				maxDistance, pEntries[lane], pExits[lane]);
+			hitMask |= hit ? 1u << lane : 0u;
+		}
+
+		return hitMask;
+	}
+
+	static ui32 intersectRaysOneByOne(const RayArrays& rays, ui32 firstRay, ui32 rayCount, const AABB& box, f32 maxDistance, f32* pEntries, f32* pExits)
+	{
+		ui32 hitMask = 0;
+		for (ui32 lane = 0; lane < rayCount; ++lane)
+		{
+			const ui32 ray = firstRay + lane;
+			const b8 hit = intersectSlabs(rays.pPositionsX[ray], rays.pPositionsY[ray], rays.pPositionsZ[ray],
+				rays.pInverseDirectionsX[ray], rays.pInverseDirectionsY[ray], rays.pInverseDirectionsZ[ray],
+				box.minimum.x, box.minimum.y, box.minimum.z, box.maximum.x, box.maximum.y, box.maximum.z,
+				maxDistance, pEntries[lane], pExits[lane]);
+			hitMask |= hit ? 1u << lane : 0u;
+		}
+
+		return hitMask;
+	}
+
+#endif
+
+	ui32 intersectBoxes4(const Ray& ray, const AABBArrays& boxes, ui32 firstBox, f32 maxDistance, f32* pEntries, f32* pExits)
+	{
+	#if defined(VSR_MATHS_SSE)
+		// the planes entered first are the same for every box
+		const f32* pNearsX = (ray.directionSigns[0] != 0 ? boxes.pMaximumsX : boxes.pMinimumsX) + firstBox;
+		const f32* pNearsY = (ray.directionSigns[1] != 0 ? boxes.pMaximumsY : boxes.pMinimumsY) + firstBox;
+		const f32* pNearsZ = (ray.directionSigns[2] != 0 ? boxes.pMaximumsZ : boxes.pMinimumsZ) + firstBox;
+		const f32* pFarsX = (ray.directionSigns[0] != 0 ? boxes.pMinimumsX : boxes.pMaximumsX) + firstBox;
+		const f32* pFarsY = (ray.directionSigns[1] != 0 ? boxes.pMinimumsY : boxes.pMaximumsY) + firstBox;
+		const f32* pFarsZ = (ray.directionSigns[2] != 0 ? boxes.pMinimumsZ : boxes.pMaximumsZ) + firstBox;
+
+		const __m128 positionX = _mm_set1_ps(ray.position.x);
+		const __m128 positionY = _mm_set1_ps(ray.position.y);
+		const __m128 positionZ = _mm_set1_ps(ray.position.z);
+		const __m128 inverseDirectionX = _mm_set1_ps(ray.inverseDirection.x);
+		const __m128 inverseDirectionY = _mm_set1_ps(ray.inverseDirection.y);
+		const __m128 inverseDirectionZ = _mm_set1_ps(ray.inverseDirection.z);
+
+		const __m128 nearX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pNearsX), positionX), inverseDirectionX);
+		const __m128 nearY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pNearsY), positionY), inverseDirectionY);
+		const __m128 nearZ = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pNearsZ), positionZ), inverseDirectionZ);
+		const __m128 farX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pFarsX), positionX), inverseDirectionX);
+		const __m128 farY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pFarsY), positionY), inverseDirectionY);
+		const __m128 farZ = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pFarsZ), positionZ), inverseDirectionZ);
+
+		const __m128 entries = _mm_max_ps(nearX, _mm_max_ps(nearY, _mm_max_ps(nearZ, _mm_setzero_ps())));
+		const __m128 exits = _mm_min_ps(farX, _mm_min_ps(farY, _mm_min_ps(farZ, _mm_set1_ps(maxDistance))));
+		_mm_storeu_ps(pEntries, entries);
+		_mm_storeu_ps(pExits, exits);
+
+		return (ui32)_mm_movemask_ps(_mm_cmple_ps(entries, exits));
+	#else
+		return intersectBoxesOneByOne(ray, boxes, firstBox, 4, maxDistance, pEntries, pExits);
+	#endif
+	}
+
+	ui32 intersectBoxes8(const Ray& ray, const AABBArrays& boxes, ui32 firstBox, f32 maxDistance, f32* pEntries, f32* pExits)
+	{
+	#if defined(VSR_MATHS_AVX)
+		const f32* pNearsX = (ray.directionSigns[0] != 0 ? boxes.pMaximumsX : boxes.pMinimumsX) + firstBox;
+		const f32* pNearsY = (ray.directionSigns[1] != 0 ? boxes.pMaximumsY : boxes.pMinimumsY) + firstBox;
+		const f32* pNearsZ = (ray.directionSigns[2] != 0 ? boxes.pMaximumsZ : boxes.pMinimumsZ) + firstBox;
+		const f32* pFarsX = (ray.directionSigns[0] != 0 ? boxes.pMinimumsX : boxes.pMaximumsX) + firstBox;
+		const f32* pFarsY = (ray.directionSigns[1] != 0 ? boxes.pMinimumsY : boxes.pMaximumsY) + firstBox;
+		const f32* pFarsZ = (ray.directionSigns[2] != 0 ? boxes.pMinimumsZ : boxes.pMaximumsZ) + firstBox;
+
+		const __m256 positionX = _mm256_set1_ps(ray.position.x);
+		const __m256 positionY = _mm256_set1_ps(ray.position.y);
+		const __m256 positionZ = _mm256_set1_ps(ray.position.z);
+		const __m256 inverseDirectionX = _mm256_set1_ps(ray.inverseDirection.x);
+		const __m256 inverseDirectionY = _mm256_set1_ps(ray.inverseDirection.y);
+		const __m256 inverseDirectionZ = _mm256_set1_ps(ray.inverseDirection.z);
+
+		const __m256 nearX = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(pNearsX), positionX), inverseDirectionX);
+		const __m256 nearY = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(pNearsY), positionY), inverseDirectionY);
+		const __m256 nearZ = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(pNearsZ), positionZ), inverseDirectionZ);
+		const __m256 farX = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(pFarsX), positionX), inverseDirectionX);
+		const __m256 farY = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(pFarsY), positionY), inverseDirectionY);
+		const __m256 farZ = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(pFarsZ), positionZ), inverseDirectionZ);
+
+		const __m256 entries = _mm256_max_ps(nearX, _mm256_max_ps(nearY, _mm256_max_ps(nearZ, _mm256_setzero_ps())));
+		const __m256 exits = _mm256_min_ps(farX, _mm256_min_ps(farY, _mm256_min_ps(farZ, _mm256_set1_ps(maxDistance))));
+		_mm256_storeu_ps(pEntries, entries);
+		_mm256_storeu_ps(pExits, exits);
+
+		return (ui32)_mm256_movemask_ps(_mm256_cmp_ps(entries, exits, _CMP_LE_OQ));
+	#elif defined(VSR_MATHS_SSE)
+		return intersectBoxes4(ray, boxes, firstBox, maxDistance, pEntries, pExits) | 
+			intersectBoxes4(ray, boxes, firstBox + 4, maxDistance, pEntries + 4, pExits + 4) << 4;
+	#else
+		return intersectBoxesOneByOne(ray, boxes, firstBox, 8, maxDistance, pEntries, pExits);
+	#endif
+	}
+
+	ui32 intersectRays4(const RayArrays& rays, ui32 firstRay, const AABB& box, f32 maxDistance, f32* pEntries, f32* pExits)
+	{
+	#if defined(VSR_MATHS_SSE)
+		const __m128 inverseDirectionX = _mm_loadu_ps(rays.pInverseDirectionsX + firstRay);
+		const __m128 inverseDirectionY = _mm_loadu_ps(rays.pInverseDirectionsY + firstRay);
+		const __m128 inverseDirectionZ = _mm_loadu_ps(rays.pInverseDirectionsZ + firstRay);
+		const __m128 positionX = _mm_loadu_ps(rays.pPositionsX + firstRay);
+		const __m128 positionY = _mm_loadu_ps(rays.pPositionsY + firstRay);
+		const __m128 positionZ = _mm_loadu_ps(rays.pPositionsZ + firstRay);
+
+		// the planes entered first differ per ray, picked from the signs
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 isNegativeX = _mm_cmplt_ps(inverseDirectionX, zero);
+		const __m128 isNegativeY = _mm_cmplt_ps(inverseDirectionY, zero);
+		const __m128 isNegativeZ = _mm_cmplt_ps(inverseDirectionZ, zero);
+		const __m128 minimumX = _mm_set1_ps(box.minimum.x);
+		const __m128 minimumY = _mm_set1_ps(box.minimum.y);
+		const __m128 minimumZ = _mm_set1_ps(box.minimum.z);
+		const __m128 maximumX = _mm_set1_ps(box.maximum.x);
+		const __m128 maximumY = _mm_set1_ps(box.maximum.y);
+		const __m128 maximumZ = _mm_set1_ps(box.maximum.z);
+
+		const __m128 nearX = _mm_or_ps(_mm_and_ps(isNegativeX, maximumX), _mm_andnot_ps(isNegativeX, minimumX));
+		const __m128 nearY = _mm_or_ps(_mm_and_ps(isNegativeY, maximumY), _mm_andnot_ps(isNegativeY, minimumY));
+		const __m128 nearZ = _mm_or_ps(_mm_and_ps(isNegativeZ, maximumZ), _mm_andnot_ps(isNegativeZ, minimumZ));
+		const __m128 farX = _mm_or_ps(_mm_and_ps(isNegativeX, minimumX), _mm_andnot_ps(isNegativeX, maximumX));
+		const __m128 farY = _mm_or_ps(_mm_and_ps(isNegativeY, minimumY), _mm_andnot_ps(isNegativeY, maximumY));
+		const __m128 farZ = _mm_or_ps(_mm_and_ps(isNegativeZ, minimumZ), _mm_andnot_ps(isNegativeZ, maximumZ));
+
+		const __m128 nearDistanceX = _mm_mul_ps(_mm_sub_ps(nearX, positionX), inverseDirectionX);
+		const __m128 nearDistanceY = _mm_mul_ps(_mm_sub_ps(nearY, positionY), inverseDirectionY);
+		const __m128 nearDistanceZ = _mm_mul_ps(_mm_sub_ps(nearZ, positionZ), inverseDirectionZ);
+		const __m128 farDistanceX = _mm_mul_ps(_mm_sub_ps(farX, positionX), inverseDirectionX);
+		const __m128 farDistanceY = _mm_mul_ps(_mm_sub_ps(farY, positionY), inverseDirectionY);
+		const __m128 farDistanceZ = _mm_mul_ps(_mm_sub_ps(farZ, positionZ), inverseDirectionZ);
+
+		const __m128 entries = _mm_max_ps(nearDistanceX, _mm_max_ps(nearDistanceY, _mm_max_ps(nearDistanceZ, zero)));
+		const __m128 exits = _mm_min_ps(farDistanceX, _mm_min_ps(farDistanceY, _mm_min_ps(farDistanceZ, _mm_set1_ps(maxDistance))));
+		_mm_storeu_ps(pEntries, entries);
+		_mm_storeu_ps(pExits, exits);
+
+		return (ui32)_mm_movemask_ps(_mm_cmple_ps(entries, exits));
+	#else
+		return intersectRaysOneByOne(rays, firstRay, 4, box, maxDistance, pEntries, pExits);
+	#endif
+	}
+
+	ui32 intersectRays8(const RayArrays& rays, ui32 firstRay, const AABB& box, f32 maxDistance, f32* pEntries, f32* pExits)
+	{
+	#if defined(VSR_MATHS_AVX)
+		const __m256 inverseDirectionX = _mm256_loadu_ps(rays.pInverseDirectionsX + firstRay);
+		const __m256 inverseDirectionY = _mm256_loadu_ps(rays.pInverseDirectionsY + firstRay);
+		const __m256 inverseDirectionZ = _mm256_loadu_ps(rays.pInverseDirectionsZ + firstRay);
+		const __m256 positionX = _mm256_loadu_ps(rays.pPositionsX + firstRay);
+		const __m256 positionY = _mm256_loadu_ps(rays.pPositionsY + firstRay);
+		const __m256 positionZ = _mm256_loadu_ps(rays.pPositionsZ + firstRay);
+
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 isNegativeX = _mm256_cmp_ps(inverseDirectionX, zero, _CMP_LT_OQ);
+		const __m256 isNegativeY = _mm256_cmp_ps(inverseDirectionY, zero, _CMP_LT_OQ);
+		const __m256 isNegativeZ = _mm256_cmp_ps(inverseDirectionZ, zero, _CMP_LT_OQ);
+		const __m256 minimumX = _mm256_set1_ps(box.minimum.x);
+		const __m256 minimumY = _mm256_set1_ps(box.minimum.y);
+		const __m256 minimumZ = _mm256_set1_ps(box.minimum.z);
+		const __m256 maximumX = _mm256_set1_ps(box.maximum.x);
+		const __m256 maximumY = _mm256_set1_ps(box.maximum.y);
+		const __m256 maximumZ = _mm256_set1_ps(box.maximum.z);
+
+		const __m256 nearDistanceX = _mm256_mul_ps(_mm256_sub_ps(_mm256_blendv_ps(minimumX, maximumX, isNegativeX), positionX), inverseDirectionX);
+		const __m256 nearDistanceY = _mm256_mul_ps(_mm256_sub_ps(_mm256_blendv_ps(minimumY, maximumY, isNegativeY), positionY), inverseDirectionY);
+		const __m256 nearDistanceZ = _mm256_mul_ps(_mm256_sub_ps(_mm256_blendv_ps(minimumZ, maximumZ, isNegativeZ), positionZ), inverseDirectionZ);
+		const __m256 farDistanceX = _mm256_mul_ps(_mm256_sub_ps(_mm256_blendv_ps(maximumX, minimumX, isNegativeX), positionX), inverseDirectionX);
+		const __m256 farDistanceY = _mm256_mul_ps(_mm256_sub_ps(_mm256_blendv_ps(maximumY, minimumY, isNegativeY), positionY), inverseDirectionY);
+		const __m256 farDistanceZ = _mm256_mul_ps(_mm256_sub_ps(_mm256_blendv_ps(maximumZ, minimumZ, isNegativeZ), positionZ), inverseDirectionZ);
+
+		const __m256 entries = _mm256_max_ps(nearDistanceX, _mm256_max_ps(nearDistanceY, _mm256_max_ps(nearDistanceZ, zero)));
+		const __m256 exits = _mm256_min_ps(farDistanceX, _mm256_min_ps(farDistanceY, _mm256_min_ps(farDistanceZ, _mm256_set1_ps(maxDistance))));
+		_mm256_storeu_ps(pEntries, entries);
+		_mm256_storeu_ps(pExits, exits);
+
+		return (ui32)_mm256_movemask_ps(_mm256_cmp_ps(entries, exits, _CMP_LE_OQ));
+	#elif defined(VSR_MATHS_SSE)
+		return intersectRays4(rays, firstRay, box, maxDistance, pEntries, pExits) | 
+			intersectRays4(rays, firstRay + 4, box, maxDistance, pEntries + 4, pExits + 4) << 4;
+	#else
+		return intersectRaysOneByOne(rays, firstRay, 8, box, maxDistance, pEntries, pExits);
+	#endif
+	}
+}
@@ -11,10 +11,57 @@ namespace Visor
 	public:
 		Ray(const Vector3<f32>& position, const Vector3<f32>& direction);
 
-		b8 getIntersection(const AABB& AABB, Vector3<f32>& intersection);
+		// also refreshes the cached inverse direction and signs
+		void setDirection(const Vector3<f32>& direction);
+		const Vector3<f32>& getDirection() const;
+
+		// first point of the box along the ray, its exit point if the ray starts inside
+		b8 getIntersection(const AABB& AABB, Vector3<f32>& intersection) const;
 
 	public:
 		Vector3<f32> position;
-		Vector3<f32> direction;
+		// an axis the ray is parallel to gets an infinite inverse
+		Vector3<f32> inverseDirection;
+		// 1 where the direction is negative : the slab of that axis is entered through its maximum
+		ui32 directionSigns[3];
+
+	private:
+		// only set through setDirection, so the inverse and signs always match it
+		Vector3<f32> _direction;
+	};
+
+	// boxes as one array per bound coordinate, for the packet kernels
+	struct AABBArrays
+	{
+	public:
+		const f32* pMinimumsX;
+		const f32* pMinimumsY;
+		const f32* pMinimumsZ;
+		const f32* pMaximumsX;
+		const f32* pMaximumsY;
+		const f32* pMaximumsZ;
 	};
-}
\ No newline at end of file
+
+	// rays as one array per coordinate, inverse directions as in Ray
+	struct RayArrays
+	{
+	public:
+		const f32* pPositionsX;
+		const f32* pPositionsY;
+		const f32* pPositionsZ;
+		const f32* pInverseDirectionsX;
+		const f32* pInverseDirectionsY;
+		const f32* pInverseDirectionsZ;
+	};
+
+	/*
+	branchless slab tests of packets, the node and leaf tests of spatial queries.
+	bit i of the result is set when ray or box first + i is hit between 0 and maxDistance. entries and exits are
+	the distances along the rays where they enter and leave the boxes, entries clamped to 0, valid for the hit lanes only.
+	a ray parallel to a slab and starting exactly on one of its planes counts as inside it
+	*/
+	ui32 intersectBoxes4(const Ray& ray, const AABBArrays& boxes, ui32 firstBox, f32 maxDistance, f32* pEntries, f32* pExits);
+	ui32 intersectBoxes8(const Ray& ray, const AABBArrays& boxes, ui32 firstBox, f32 maxDistance, f32* pEntries, f32* pExits);
+	ui32 intersectRays4(const RayArrays& rays, ui32 firstRay, const AABB& box, f32 maxDistance, f32* pEntries, f32* pExits);
+	ui32 intersectRays8(const RayArrays& rays, ui32 firstRay, const AABB& box, f32 maxDistance, f32* pEntries, f32* pExits);
+}
@@ -0,0 +1,293 @@
+#include "ray_query.h"
+#include "job_system.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace Visor
+{
+	// rays traced in a row by a job, enough for the rays of a job to share most of their nodes
+	static const ui32 BatchSize = 128;
+	// below it the sort costs more than the coherence it brings
+	static const ui32 MinSortedRayCount = 256;
+
+	// 5 bits spread over 15, two zero bits between each bit, to interleave 3 coordinates
+	static ui32 spreadBits(ui32 value)
+	{
+		ui32 bits = value & 0x1F;
+		bits = (bits | bits << 8) & 0x0000F00F;
+		bits = (bits | bits << 4) & 0x000C30C3;
+		bits = (bits | bits << 2) & 0x00249249;
+		return bits;
+	}
+
+	// written so a NaN ends up in the last cell rather than overflowing the cast
+	static ui32 getCell(f32 value, f32 maximum)
+	{
+		return (ui32)std::max(0.0f, std::min(maximum, value));
+	}
+
+	static void setMiss(RayHit& hit)
+	{
+		hit.triangleIndex = NullTriangle;
+		hit.distance = -1.0f;
+		hit.u = 0.0f;
+		hit.v = 0.0f;
+	}
+
+	RayQuery::RayQuery()
+		: _target(Target::EntityBoxes)
+		, _pTree(nullptr)
+		, _pEntities(nullptr)
+		, _pMesh(nullptr)
+		, _pRays(nullptr)
+		, _rayCount(0)
+		, _maxDistance(0.0f)
+		, _pEntityHits(nullptr)
+		, _pHits(nullptr)
+		, _nextBatch(0)
+	{
+	}
+
+	void RayQuery::raycast(const EntityTree& tree, const Ray* pRays, ui32 rayCount, f32 maxDistance, EntityRayHit* pHits)
+	{
+		sortRays(pRays, rayCount);
+
+		_target = Target::EntityBoxes;
+		_pTree = &tree;
+		_pRays = pRays;
+		_rayCount = rayCount;
+		_maxDistance = maxDistance;
+		_pEntityHits = pHits;
+		dispatch();
+	}
+
+	void RayQuery::raycast(const EntityTree& tree, const EntityStore& entities, const Ray* pRays, ui32 rayCount, f32 maxDistance, EntityRayHit* pHits)
+	{
+		sortRays(pRays, rayCount);
+
+		_target = Target::EntityTriangles;
+		_pTree = &tree;
+		_pEntities = &entities;
+		_pRays = pRays;
+		_rayCount = rayCount;
+		_maxDistance = maxDistance;
+		_pEntityHits = pHits;
+		dispatch();
+	}
+
+	void RayQuery::intersect(const Mesh& mesh, const Ray* pRays, ui32 rayCount, f32 maxDistance, RayHit* pHits)
+	{
+		assert(mesh.getBVH().isBuilt());
+
+		sortRays(pRays, rayCount);
+
+		_target = Target::MeshTriangles;
+		_pMesh = &mesh;
+		_pRays = pRays;
+		_rayCount = rayCount;
+		_maxDistance = maxDistance;
+		_pHits = pHits;
+		dispatch();
+	}
+
+	void RayQuery::dispatch()
+	{
+		if (_rayCount <= BatchSize)
+		{
+			traceRays(0, _rayCount);
+			return;
+		}
+
+		// a function capturing only this is stored inside the std::function of the job, with no allocation
+		JobSystem& jobSystem = JobSystem::getInstance();
+		const ui32 batchCount = (_rayCount + BatchSize - 1) / BatchSize;
+		const ui32 jobCount = std::min(jobSystem.getThreadCount(), batchCount);
+		_nextBatch = 0;
+
+		JobCounter counter;
+		for (ui32 jobIndex = 0; jobIndex < jobCount; ++jobIndex)
+		{
+			jobSystem.run([this]() { traceBatches(); }, counter);
+		}
+		jobSystem.wait(counter);
+	}
+
+	void RayQuery::traceBatches()
+	{
+		while (true)
+		{
+			const ui32 begin = _nextBatch.fetch_add(1) * BatchSize;
+			if (begin >= _rayCount)
+			{
+				return;
+			}
+
+			traceRays(begin, std::min(begin + BatchSize, _rayCount));
+		}
+	}
+
+	void RayQuery::traceRays(ui32 begin, ui32 end)
+	{
+		if (_target == Target::EntityBoxes)
+		{
+			traceEntityBoxes(begin, end);
+		}
+		else if (_target == Target::EntityTriangles)
+		{
+			traceEntityTriangles(begin, end);
+		}
+		else
+		{
+			traceMeshTriangles(begin, end);
+		}
+	}
+
+	void RayQuery::traceEntityBoxes(ui32 begin, ui32 end)
+	{
+		for (ui32 sortedIndex = begin; sortedIndex < end; ++sortedIndex)
+		{
+			const ui32 rayIndex = _sortedRays[sortedIndex].rayIndex;
+			EntityRayHit& hit = _pEntityHits[rayIndex];
+			setMiss(hit.hit);
+			hit.entity = EntityId{};
+
+			f32 distance = 0.0f;
+			if (_pTree->raycast(_pRays[rayIndex], _maxDistance, hit.entity, distance))
+			{
+				hit.hit.distance = distance;
+			}
+		}
+	}
+
+	void RayQuery::traceEntityTriangles(ui32 begin, ui32 end)
+	{
+		// the callback captures a single reference so the function wrapping it needs no allocation
+		struct TriangleRaycast
+		{
+		public:
+			const EntityStore* pEntities;
+			const Ray* pRay;
+			f32 maxDistance;
+			RayHit closestHit;
+		};
+
+		for (ui32 sortedIndex = begin; sortedIndex < end; ++sortedIndex)
+		{
+			const ui32 rayIndex = _sortedRays[sortedIndex].rayIndex;
+			EntityRayHit& hit = _pEntityHits[rayIndex];
+			hit.entity = EntityId{};
+
+			TriangleRaycast triangleRaycast = {_pEntities, &_pRays[rayIndex], _maxDistance, {}};
+			setMiss(triangleRaycast.closestHit);
+
+			f32 distance = 0.0f;
+			_pTree->raycast(_pRays[rayIndex], _maxDistance, [&triangleRaycast](EntityId entity, f32)
+			{
+				RayHit triangleHit = {};
+				if (!intersectEntity(*triangleRaycast.pEntities, entity, *triangleRaycast.pRay, triangleRaycast.maxDistance, triangleHit))
+				{
+					return -1.0f;
+				}
+
+				if (triangleRaycast.closestHit.distance < 0.0f || triangleHit.distance < triangleRaycast.closestHit.distance)
+				{
+					triangleRaycast.closestHit = triangleHit;
+				}
+				return triangleHit.distance;
+			}, hit.entity, distance);
+
+			hit.hit = triangleRaycast.closestHit;
+		}
+	}
+
+	void RayQuery::traceMeshTriangles(ui32 begin, ui32 end)
+	{
+		for (ui32 sortedIndex = begin; sortedIndex < end; ++sortedIndex)
+		{
+			const ui32 rayIndex = _sortedRays[sortedIndex].rayIndex;
+			if (!_pMesh->intersect(_pRays[rayIndex], _maxDistance, _pHits[rayIndex]))
+			{
+				setMiss(_pHits[rayIndex]);
+			}
+		}
+	}
+
+	void RayQuery::sortRays(const Ray* pRays, ui32 rayCount)
+	{
+		_sortedRays.resize(rayCount);
+
+		if (rayCount < MinSortedRayCount)
+		{
+			for (ui32 rayIndex = 0; rayIndex < rayCount; ++rayIndex)
+			{
+				_sortedRays[rayIndex].key = 0;
+				_sortedRays[rayIndex].rayIndex = rayIndex;
+			}
+			return;
+		}
+
+		Vector3<f32> minimum = pRays[0].position;
+		Vector3<f32> maximum = pRays[0].position;
+		for (ui32 rayIndex = 1; rayIndex < rayCount; ++rayIndex)
+		{
+			for (ui32 axis = 0; axis < 3; ++axis)
+			{
+				minimum[axis] = std::min(minimum[axis], pRays[rayIndex].position[axis]);
+				maximum[axis] = std::max(maximum[axis], pRays[rayIndex].position[axis]);
+			}
+		}
+
+		// origins on a 32 cells grid over their box, directions on a 16 cells grid within their octant
+		Vector3<f32> cellScales = {};
+		for (ui32 axis = 0; axis < 3; ++axis)
+		{
+			cellScales[axis] = maximum[axis] > minimum[axis] ? 31.0f / (maximum[axis] - minimum[axis]) : 0.0f;
+		}
+
+		for (ui32 rayIndex = 0; rayIndex < rayCount; ++rayIndex)
+		{
+			const Ray& ray = pRays[rayIndex];
+
+			ui32 octant = 0;
+			ui32 originCode = 0;
+			ui32 directionCode = 0;
+			for (ui32 axis = 0; axis < 3; ++axis)
+			{
+				octant |= ray.directionSigns[axis] << axis;
+				originCode |= spreadBits(getCell((ray.position[axis] - minimum[axis]) * cellScales[axis], 31.0f)) << axis;
+				directionCode |= spreadBits(getCell(std::abs(ray.getDirection()[axis]) * 15.0f, 15.0f)) << axis;
+			}
+
+			// 3 bits of octant, 15 of origin, 12 of direction
+			_sortedRays[rayIndex].key = octant << 27 | originCode << 12 | directionCode;
+			_sortedRays[rayIndex].rayIndex = rayIndex;
+		}
+
+		// least significant digit first, each pass stable, 10 bits at a time
+		_sortBuffer.resize(rayCount);
+		for (ui32 shift = 0; shift < 30; shift += 10)
+		{
+			ui32 offsets[1024] = {};
+			for (const SortedRay& sortedRay : _sortedRays)
+			{
+				offsets[sortedRay.key >> shift & 0x3FF] += 1;
+			}
+
+			ui32 offset = 0;
+			for (ui32& bucketOffset : offsets)
+			{
+				const ui32 bucketSize = bucketOffset;
+				bucketOffset = offset;
+				offset += bucketSize;
+			}
+
+			for (const SortedRay& sortedRay : _sortedRays)
+			{
+				_sortBuffer[offsets[sortedRay.key >> shift & 0x3FF]++] = sortedRay;
+			}
+			_sortedRays.swap(_sortBuffer);
+		}
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "types.h"
+#include "ray.h"
+#include "mesh.h"
+#include "entity.h"
+#include "entity_tree.h"
+#include "triangle_bvh.h"
+
+#include <atomic>
+#include <vector>
+
+namespace Visor
+{
+	// closest entity along a ray of a batch
+	struct EntityRayHit
+	{
+	public:
+		EntityId entity;
+		// distance is negative when the ray hit nothing. box hits have a triangle index of NullTriangle
+		RayHit hit;
+	};
+
+	/*
+	casts many rays at once : pHits[i] receives the closest hit of pRays[i], misses get a negative distance.
+	rays are first sorted by direction octant, then origin cell, then direction (a radix sort of 30 bit keys), so the rays
+	traced one after the other walk down the same nodes. the sorted rays are split in batches, one job per job thread
+	takes batches until none are left.
+	the sort buffers are kept from one call to the next and the jobs only hold a pointer to the query, so a query of at most
+	as many rays as the previous ones allocates nothing itself, the job system may still grow its deques.
+	a query is not thread safe, use one per thread
+	*/
+	class RayQuery
+	{
+	public:
+		RayQuery();
+
+		// on the entity boxes
+		void raycast(const EntityTree& tree, const Ray* pRays, ui32 rayCount, f32 maxDistance, EntityRayHit* pHits);
+		// on the entity triangles, see intersectEntity
+		void raycast(const EntityTree& tree, const EntityStore& entities, const Ray* pRays, ui32 rayCount, f32 maxDistance, EntityRayHit* pHits);
+		// on the triangles of a mesh with a built hierarchy, rays in the local space of the mesh
+		void intersect(const Mesh& mesh, const Ray* pRays, ui32 rayCount, f32 maxDistance, RayHit* pHits);
+
+	private:
+		struct SortedRay
+		{
+		public:
+			ui32 key;
+			ui32 rayIndex;
+		};
+
+		enum class Target
+		{
+			EntityBoxes,
+			EntityTriangles,
+			MeshTriangles
+		};
+
+	private:
+		void sortRays(const Ray* pRays, ui32 rayCount);
+		// runs the query set in the members on the job threads
+		void dispatch();
+		void traceBatches();
+		void traceRays(ui32 begin, ui32 end);
+		void traceEntityBoxes(ui32 begin, ui32 end);
+		void traceEntityTriangles(ui32 begin, ui32 end);
+		void traceMeshTriangles(ui32 begin, ui32 end);
+
+	private:
+		std::vector<SortedRay> _sortedRays;
+		std::vector<SortedRay> _sortBuffer;
+
+		// the query being run, read by its jobs
+		Target _target;
+		const EntityTree* _pTree;
+		const EntityStore* _pEntities;
+		const Mesh* _pMesh;
+		const Ray* _pRays;
+		ui32 _rayCount;
+		f32 _maxDistance;
+		EntityRayHit* _pEntityHits;
+		RayHit* _pHits;
+		std::atomic<ui32> _nextBatch;
+	};
+}
@@ -1,38 +1,280 @@
 #include "render_system.h"
 #include "window_system.h"
+#include "job_system.h"
+#include "mesh_registry.h"
 
 #if defined(VSR_GRAPHICS_API_VULKAN)
 #include "render_system_backend_vk.h"
+#elif defined(VSR_GRAPHICS_API_SOFTWARE)
+#include "render_system_backend_sw.h"
+#elif defined(VSR_GRAPHICS_API_NULL)
+#include "render_system_backend_null.h"
 #endif
 
+#include <algorithm>
 #include <cassert>
+#include <iostream>
 
 namespace Visor
 {
 	static RenderSystem* pInstance = nullptr;
 
-	void RenderSystem::render(const Camera& camera, const std::vector<Entity>& entities)
+	void RenderSystem::render(const Camera& camera, EntityStore& entities)
 	{
 		assert(pInstance != nullptr);
+
+		// entities outside the view never reach the backend
+		entities.updateTransformationMatrices();
+		computeWorldBounds(entities, _bounds);
+		cullEntities(camera, entities);
+
+		// the backend reads the packet only, the store can change as soon as it is published
+		_framePackets.publish(camera, entities, _visibleEntityIndices);
+
+		if (!_hasRenderThread)
+		{
+			renderPacket(*_framePackets.acquire());
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_renderMutex);
+			_publishedPacketIndex += 1;
+		}
+		_packetCondition.notify_one();
+	}
+
+	void RenderSystem::synchronize()
+	{
+		assert(pInstance != nullptr);
+		waitForRenderThread();
+	}
+
+	MeshletCullingStatistics RenderSystem::getMeshletCullingStatistics() const
+	{
+		assert(pInstance != nullptr);
+		waitForRenderThread();
 		#if defined(VSR_GRAPHICS_API_VULKAN)
-			RenderSystemBackendVk::getInstance().render(camera, entities);
+			return RenderSystemBackendVk::getInstance().getMeshletCullingStatistics();
+		#elif defined(VSR_GRAPHICS_API_SOFTWARE)
+			return RenderSystemBackendSw::getInstance().getMeshletCullingStatistics();
+		#elif defined(VSR_GRAPHICS_API_NULL)
+			return RenderSystemBackendNull::getInstance().getMeshletCullingStatistics();
+		#else
+			return MeshletCullingStatistics{};
+		#endif
+	}
+
+	DrawStatistics RenderSystem::getDrawStatistics() const
+	{
+		assert(pInstance != nullptr);
+		waitForRenderThread();
+		#if defined(VSR_GRAPHICS_API_NULL)
+			return RenderSystemBackendNull::getInstance().getDrawStatistics();
+		#else
+			return DrawStatistics{};
 		#endif
 	}
 
-	void RenderSystem::start()
+	CullingStatistics RenderSystem::getCullingStatistics() const
+	{
+		assert(pInstance != nullptr);
+		return _cullingStatistics;
+	}
+
+	void RenderSystem::writeOcclusionDepthImage(const std::string& path) const
+	{
+		assert(pInstance != nullptr);
+		_occlusionCuller.writeDepthImage(path);
+	}
+
+	void RenderSystem::writeColorImage(const std::string& path) const
+	{
+		assert(pInstance != nullptr);
+		waitForRenderThread();
+		#if defined(VSR_GRAPHICS_API_SOFTWARE)
+			RenderSystemBackendSw::getInstance().writeColorImage(path);
+		#else
+			std::cerr << "could not write " << path << ", color images are only kept by the software backend\n";
+		#endif
+	}
+
+	void RenderSystem::cullEntities(const Camera& camera, const EntityStore& entities)
+	{
+		const ui32 entityCount = entities.getEntityCount();
+		_visibilities.resize(entityCount);
+
+		// a minimized window has no height, its planes would be nans
+		const f32 aspectRatio = _height > 0 ? _width / (f32)_height : 1.0f;
+		const Matrix4<f32> viewProjectionMatrix = 
+			Matrix4<f32>::getProjection(camera.fov, aspectRatio) * 
+			Matrix4<f32>::getView(camera.position, camera.orientation);
+		const Frustum frustum = Frustum::fromMatrix(viewProjectionMatrix);
+
+		JobSystem::getInstance().parallelFor(entityCount, 4096, [this, &frustum](ui32 begin, ui32 end)
+		{
+			cullBoxes(frustum, _bounds, begin, end, _visibilities.data());
+		});
+
+		_visibleEntityIndices.clear();
+		_cullingStatistics = {};
+		for (ui32 entityIndex = 0; entityIndex < entityCount; ++entityIndex)
+		{
+			if (entities.getMeshHandles()[entityIndex] == NullMeshHandle)
+			{
+				continue;
+			}
+
+			_cullingStatistics.entityCount += 1;
+			if (_visibilities[entityIndex])
+			{
+				_visibleEntityIndices.push_back(entityIndex);
+			}
+			else
+			{
+				_cullingStatistics.frustumCulledEntityCount += 1;
+			}
+		}
+
+		// the entities left are tested against the depth of the occluders
+		_occlusionCuller.render(viewProjectionMatrix, entities);
+		_occlusionCuller.cullBoxes(_bounds, _visibleEntityIndices, _visibilities.data());
+
+		_cullingStatistics.occluderCount = _occlusionCuller.getOccluderCount();
+		_cullingStatistics.occluderTriangleCount = _occlusionCuller.getOccluderTriangleCount();
+
+		ui32 visibleEntityCount = 0;
+		for (ui32 entityIndex : _visibleEntityIndices)
+		{
+			if (_visibilities[entityIndex])
+			{
+				_visibleEntityIndices[visibleEntityCount++] = entityIndex;
+			}
+		}
+		_cullingStatistics.occlusionCulledEntityCount = (ui32)_visibleEntityIndices.size() - visibleEntityCount;
+		_visibleEntityIndices.resize(visibleEntityCount);
+	}
+
+	void RenderSystem::renderPacket(const FramePacket& packet)
+	{
+		#if defined(VSR_GRAPHICS_API_VULKAN)
+			RenderSystemBackendVk::getInstance().render(packet);
+		#elif defined(VSR_GRAPHICS_API_SOFTWARE)
+			RenderSystemBackendSw::getInstance().render(packet);
+		#elif defined(VSR_GRAPHICS_API_NULL)
+			RenderSystemBackendNull::getInstance().render(packet);
+		#else
+			(void)packet;
+		#endif
+	}
+
+	void RenderSystem::runRenderThread()
+	{
+		std::unique_lock<std::mutex> lock(_renderMutex);
+
+		while (true)
+		{
+			_packetCondition.wait(lock, [this]() { return _stopping || _publishedPacketIndex > _renderedPacketIndex; });
+
+			if (_stopping)
+			{
+				break;
+			}
+
+			// recording and submission happen without holding the lock, the packets published meanwhile replace each other
+			lock.unlock();
+			const FramePacket* pPacket = _framePackets.acquire();
+			assert(pPacket != nullptr);
+			renderPacket(*pPacket);
+			lock.lock();
+
+			// the packet may be ahead of the index, it was published before the main thread took the lock
+			_renderedPacketIndex = std::max(_renderedPacketIndex, pPacket->index);
+			_renderedCondition.notify_all();
+		}
+
+		// the window is destroyed on the main thread, once terminate joined this one
+		lock.unlock();
+		#if defined(VSR_GRAPHICS_API_SOFTWARE)
+			RenderSystemBackendSw::getInstance().releaseWindow();
+		#endif
+	}
+
+	void RenderSystem::waitForRenderThread() const
+	{
+		if (!_hasRenderThread)
+		{
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(_renderMutex);
+		_renderedCondition.wait(lock, [this]() { return _renderedPacketIndex >= _publishedPacketIndex; });
+	}
+
+	void RenderSystem::start(b8 hasRenderThread)
+	{
+		const WindowSystem::Window& window = WindowSystem::getInstance().getWindow();
+		start(window.getWidth(), window.getHeight(), false, hasRenderThread);
+	}
+
+	void RenderSystem::startHeadless(ui32 width, ui32 height, b8 hasRenderThread)
+	{
+		#if !defined(VSR_GRAPHICS_API_SOFTWARE) && !defined(VSR_GRAPHICS_API_NULL)
+			std::cerr << "could not start the render system without window, only the software and null backends render offscreen\n";
+			std::exit(EXIT_FAILURE);
+		#endif
+		start(width, height, true, hasRenderThread);
+	}
+
+	void RenderSystem::start(ui32 width, ui32 height, b8 isHeadless, b8 hasRenderThread)
 	{
 		assert(pInstance == nullptr);
 		pInstance = new RenderSystem();
+		pInstance->_width = width;
+		pInstance->_height = height;
+		pInstance->_cullingStatistics = {};
 		#if defined(VSR_GRAPHICS_API_VULKAN)
+			(void)isHeadless;
 			RenderSystemBackendVk::start();
+		#elif defined(VSR_GRAPHICS_API_SOFTWARE)
+			RenderSystemBackendSw::start(width, height, isHeadless);
+		#elif defined(VSR_GRAPHICS_API_NULL)
+			(void)isHeadless;
+			RenderSystemBackendNull::start(width, height);
+		#else
+			(void)isHeadless;
 		#endif
+
+		// the backend is started on the main thread, it is only used by the render thread from then on
+		pInstance->_hasRenderThread = hasRenderThread;
+		pInstance->_publishedPacketIndex = 0;
+		pInstance->_renderedPacketIndex = 0;
+		pInstance->_stopping = false;
+		if (hasRenderThread)
+		{
+			pInstance->_renderThread = std::thread(&RenderSystem::runRenderThread, pInstance);
+		}
 	}
 
 	void RenderSystem::terminate()
 	{
 		assert(pInstance != nullptr);
+		if (pInstance->_hasRenderThread)
+		{
+			{
+				std::lock_guard<std::mutex> lock(pInstance->_renderMutex);
+				pInstance->_stopping = true;
+			}
+			pInstance->_packetCondition.notify_one();
+			pInstance->_renderThread.join();
+		}
+
 		#if defined(VSR_GRAPHICS_API_VULKAN)
 			RenderSystemBackendVk::terminate();
+		#elif defined(VSR_GRAPHICS_API_SOFTWARE)
+			RenderSystemBackendSw::terminate();
+		#elif defined(VSR_GRAPHICS_API_NULL)
+			RenderSystemBackendNull::terminate();
 		#endif
 		delete pInstance;
 		pInstance = nullptr;
@@ -1,19 +1,78 @@
 #pragma once
 
 #include "camera.h"
+#include "culling.h"
+#include "draw_list.h"
 #include "entity.h"
+#include "frame_packet.h"
+#include "meshlet.h"
+#include "occlusion.h"
 
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
 namespace Visor
 {
+	/*
+	culls the entities and hands the frame to the backend as a frame packet. with a render thread, render publishes the
+	packet and returns, the backend records and submits it while the next frame is simulated ; a thread slower than
+	the main loop skips the packets it did not get to. the backend still reads the mesh registry and the asset system,
+	which may only change after synchronize : AssetSystem::update, registering, retaining or releasing meshes, so
+	creating or destroying entities with a mesh too
+	*/
 	class RenderSystem
 	{
 	public:
-		void render(const Camera& camera, const std::vector<Entity>& entities);
+		void render(const Camera& camera, EntityStore& entities);
+		// returns once the last packet published is drawn, right away without render thread
+		void synchronize();
+		MeshletCullingStatistics getMeshletCullingStatistics() const;
+		CullingStatistics getCullingStatistics() const;
+		// counted by the null backend only, zero with the others
+		DrawStatistics getDrawStatistics() const;
+		// depth buffer of the occluders as of the last frame, to check what hides what
+		void writeOcclusionDepthImage(const std::string& path) const;
+		// the last frame, software backend only
+		void writeColorImage(const std::string& path) const;
 
-		static void start();
+		// renders to the window of the window system
+		static void start(b8 hasRenderThread);
+		// renders offscreen without window system, software and null backends only
+		static void startHeadless(ui32 width, ui32 height, b8 hasRenderThread);
 		static void terminate();
 		static RenderSystem& getInstance();
+
+	private:
+		void cullEntities(const Camera& camera, const EntityStore& entities);
+		void renderPacket(const FramePacket& packet);
+		void runRenderThread();
+		void waitForRenderThread() const;
+
+		static void start(ui32 width, ui32 height, b8 isHeadless, b8 hasRenderThread);
+
+	private:
+		ui32 _width;
+		ui32 _height;
+
+		// world bounds of every entity in dense order, entities without mesh get an empty box
+		BoundsArrays _bounds;
+		std::vector<ui8> _visibilities;
+		std::vector<ui32> _visibleEntityIndices;
+		CullingStatistics _cullingStatistics;
+		OcclusionCuller _occlusionCuller;
+		FramePacketBuffer _framePackets;
+
+		// shared with the render thread, the packets go through _framePackets, the lock only puts it to sleep
+		b8 _hasRenderThread;
+		std::thread _renderThread;
+		mutable std::mutex _renderMutex;
+		std::condition_variable _packetCondition;
+		mutable std::condition_variable _renderedCondition;
+		ui64 _publishedPacketIndex;
+		ui64 _renderedPacketIndex;
+		b8 _stopping;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,215 @@
+#include "render_system_backend_null.h"
+#include "asset_system.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Visor
+{
+	static RenderSystemBackendNull* pInstance = nullptr;
+
+	void RenderSystemBackendNull::render(const FramePacket& packet)
+	{
+		assert(pInstance != nullptr);
+
+		_drawStatistics = {};
+
+		// the global uniform buffer
+		_viewProjectionMatrix =
+			Matrix4<f32>::getProjection(packet.camera.fov, _width / (f32)_height) *
+			Matrix4<f32>::getView(packet.camera.position, packet.camera.orientation);
+		_drawStatistics.uploadedByteCount += sizeof(Matrix4<f32>);
+
+		uploadMeshes(packet);
+		_drawList.create(packet, _viewProjectionMatrix, [this](MeshHandle mesh, ui32& indexCount, b8& isCurrentRevision)
+		{
+			return getResidency(mesh, indexCount, isCurrentRevision);
+		});
+		uploadTransforms(packet);
+		recordDraws();
+	}
+
+	const MeshletCullingStatistics& RenderSystemBackendNull::getMeshletCullingStatistics() const
+	{
+		return _drawList.getMeshletCullingStatistics();
+	}
+
+	const DrawStatistics& RenderSystemBackendNull::getDrawStatistics() const
+	{
+		return _drawStatistics;
+	}
+
+	void RenderSystemBackendNull::start(ui32 width, ui32 height)
+	{
+		assert(pInstance == nullptr);
+		pInstance = new RenderSystemBackendNull(width, height);
+	}
+
+	void RenderSystemBackendNull::terminate()
+	{
+		assert(pInstance != nullptr);
+		delete pInstance;
+		pInstance = nullptr;
+	}
+
+	RenderSystemBackendNull& RenderSystemBackendNull::getInstance()
+	{
+		assert(pInstance != nullptr);
+		return *pInstance;
+	}
+
+	RenderSystemBackendNull::RenderSystemBackendNull(ui32 width, ui32 height)
+		: _width(std::max(width, 1u))
+		, _height(std::max(height, 1u))
+		, _viewProjectionMatrix(Matrix4<f32>::getIdentity())
+		, _drawStatistics()
+	{
+	}
+
+	void RenderSystemBackendNull::uploadMeshes(const FramePacket& packet)
+	{
+		prepareMesh(AssetSystem::getInstance().getPlaceholderMesh());
+		for (const MeshHandle& mesh : packet.meshHandles)
+		{
+			prepareMesh(mesh);
+		}
+
+		// reloaded revisions fully copied during a previous frame replace the drawn ones, no frame uses those anymore
+		for (ResidentMesh& residentMesh : _residentMeshes)
+		{
+			if (residentMesh.isResident && residentMesh.isStreaming && residentMesh.uploadedByteCount == residentMesh.totalByteCount)
+			{
+				residentMesh.revision = residentMesh.streamingRevision;
+				residentMesh.indexCount = residentMesh.streamingIndexCount;
+				residentMesh.isStreaming = false;
+			}
+		}
+
+		// new meshes first, then the reloads, as the vulkan backend goes through them
+		ui32 remainingBudget = MeshUploadBudget;
+		for (ResidentMesh& residentMesh : _residentMeshes)
+		{
+			if (!residentMesh.isResident)
+			{
+				streamMesh(residentMesh, remainingBudget);
+			}
+		}
+
+		for (ResidentMesh& residentMesh : _residentMeshes)
+		{
+			if (residentMesh.isResident)
+			{
+				streamMesh(residentMesh, remainingBudget);
+			}
+		}
+	}
+
+	void RenderSystemBackendNull::prepareMesh(MeshHandle meshHandle)
+	{
+		const MeshRegistry& meshRegistry = MeshRegistry::getInstance();
+		if (meshHandle == NullMeshHandle || !meshRegistry.isLoaded(meshHandle))
+		{
+			return;
+		}
+
+		ResidentMesh emptyResidentMesh = {};
+		emptyResidentMesh.mesh = NullMeshHandle;
+		if (meshHandle.index >= _residentMeshes.size())
+		{
+			_residentMeshes.resize(meshHandle.index + 1, emptyResidentMesh);
+		}
+
+		ResidentMesh& residentMesh = _residentMeshes[meshHandle.index];
+		if (residentMesh.mesh != meshHandle)
+		{
+			residentMesh = emptyResidentMesh;
+			residentMesh.mesh = meshHandle;
+		}
+
+		const ui32 revision = meshRegistry.getRevision(meshHandle);
+		const b8 isUpToDate = residentMesh.isStreaming ? residentMesh.streamingRevision == revision : residentMesh.isResident && residentMesh.revision == revision;
+		if (isUpToDate)
+		{
+			return;
+		}
+
+		// a revision reloaded again before it was fully copied starts over
+		const Mesh& mesh = meshRegistry.getMesh(meshHandle);
+		residentMesh.isStreaming = true;
+		residentMesh.streamingRevision = revision;
+		residentMesh.streamingIndexCount = (ui32)mesh.getIndices().size();
+		residentMesh.uploadedByteCount = 0;
+		residentMesh.totalByteCount = (ui32)(mesh.getVertices().size() * sizeof(Mesh::Vertex) + mesh.getIndices().size() * sizeof(ui32));
+	}
+
+	void RenderSystemBackendNull::streamMesh(ResidentMesh& residentMesh, ui32& remainingBudget)
+	{
+		if (!residentMesh.isStreaming || residentMesh.uploadedByteCount == residentMesh.totalByteCount)
+		{
+			return;
+		}
+
+		const ui32 byteCount = std::min(remainingBudget, residentMesh.totalByteCount - residentMesh.uploadedByteCount);
+		residentMesh.uploadedByteCount += byteCount;
+		remainingBudget -= byteCount;
+		_drawStatistics.uploadedByteCount += byteCount;
+
+		// a new mesh is drawn as soon as it is copied, a reload replaces the drawn revision the frame after
+		if (!residentMesh.isResident && residentMesh.uploadedByteCount == residentMesh.totalByteCount)
+		{
+			residentMesh.isResident = true;
+			residentMesh.revision = residentMesh.streamingRevision;
+			residentMesh.indexCount = residentMesh.streamingIndexCount;
+			residentMesh.isStreaming = false;
+		}
+	}
+
+	b8 RenderSystemBackendNull::getResidency(MeshHandle meshHandle, ui32& indexCount, b8& isCurrentRevision) const
+	{
+		if (meshHandle.index >= _residentMeshes.size())
+		{
+			return false;
+		}
+
+		const ResidentMesh& residentMesh = _residentMeshes[meshHandle.index];
+		if (residentMesh.mesh != meshHandle || !residentMesh.isResident)
+		{
+			return false;
+		}
+
+		indexCount = residentMesh.indexCount;
+		isCurrentRevision = residentMesh.revision == MeshRegistry::getInstance().getRevision(meshHandle);
+		return true;
+	}
+
+	void RenderSystemBackendNull::uploadTransforms(const FramePacket& packet)
+	{
+		// a new buffer starts empty, every entity is uploaded
+		const ui32 transformCount = _drawList.getTransformCount();
+		b8 uploadAll = false;
+		if (transformCount > _transforms.size())
+		{
+			_transforms.resize(std::max((size_t)transformCount, _transforms.size() * 2));
+			uploadAll = true;
+		}
+
+		_drawList.stageTransforms(packet, uploadAll, (ui8*)_transforms.data(), sizeof(Matrix3x4<f32>), _transformRanges);
+		for (const TransformRange& transformRange : _transformRanges)
+		{
+			_drawStatistics.uploadedByteCount += (ui64)transformRange.count * sizeof(Matrix3x4<f32>);
+		}
+	}
+
+	void RenderSystemBackendNull::recordDraws()
+	{
+		const std::vector<IndexRange>& indexRanges = _drawList.getIndexRanges();
+		for (const DrawList::Draw& draw : _drawList.getDraws())
+		{
+			for (ui32 indexRangeIndex = draw.firstIndexRange; indexRangeIndex < draw.firstIndexRange + draw.indexRangeCount; ++indexRangeIndex)
+			{
+				_drawStatistics.drawCount += 1;
+				_drawStatistics.triangleCount += indexRanges[indexRangeIndex].count / 3;
+			}
+		}
+	}
+}
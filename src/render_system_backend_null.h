@@ -0,0 +1,75 @@
+#pragma once
+
+#include "types.h"
+#include "camera.h"
+#include "draw_list.h"
+#include "frame_packet.h"
+#include "maths.h"
+#include "meshlet.h"
+#include "mesh_registry.h"
+
+#include <vector>
+
+namespace Visor
+{
+	/*
+	backend without gpu, to measure the cost of the engine alone (culling, transforms, draw lists) on any machine.
+	it does the cpu work of the vulkan backend through the same draw list : meshlet culling, the 3x4 rows of the updated
+	transforms written to a staging copy of the transform buffer, draws of every index range. the draws are then discarded, only counted.
+	mesh geometry is counted as the vulkan backend streams it, within the same budget per frame, so the placeholder
+	stands in for the meshes still streaming and a hot reloaded revision replaces the previous one once copied
+	*/
+	class RenderSystemBackendNull
+	{
+	public:
+		// only the entities of the draw list are drawn
+		void render(const FramePacket& packet);
+		const MeshletCullingStatistics& getMeshletCullingStatistics() const;
+		const DrawStatistics& getDrawStatistics() const;
+
+		static void start(ui32 width, ui32 height);
+		static void terminate();
+		static RenderSystemBackendNull& getInstance();
+
+	private:
+		// the geometry the vulkan backend would hold for a mesh, the handle tells a reused slot from the mesh it held
+		struct ResidentMesh
+		{
+		public:
+			MeshHandle mesh;
+			// the revision drawn, once fully copied
+			b8 isResident;
+			ui32 revision;
+			ui32 indexCount;
+			// the revision being copied, of a new mesh or a hot reload
+			b8 isStreaming;
+			ui32 streamingRevision;
+			ui32 streamingIndexCount;
+			ui32 uploadedByteCount;
+			ui32 totalByteCount;
+		};
+
+	private:
+		RenderSystemBackendNull(ui32 width, ui32 height);
+
+		void uploadMeshes(const FramePacket& packet);
+		void prepareMesh(MeshHandle meshHandle);
+		void streamMesh(ResidentMesh& residentMesh, ui32& remainingBudget);
+		b8 getResidency(MeshHandle meshHandle, ui32& indexCount, b8& isCurrentRevision) const;
+		void uploadTransforms(const FramePacket& packet);
+		void recordDraws();
+
+	private:
+		ui32 _width;
+		ui32 _height;
+
+		Matrix4<f32> _viewProjectionMatrix;
+		std::vector<ResidentMesh> _residentMeshes;
+		DrawList _drawList;
+		// stands in for the staging buffer, grown like it
+		std::vector<Matrix3x4<f32>> _transforms;
+		std::vector<TransformRange> _transformRanges;
+
+		DrawStatistics _drawStatistics;
+	};
+}
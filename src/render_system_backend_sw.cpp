@@ -0,0 +1,456 @@
+#include "render_system_backend_sw.h"
+#include "window_system.h"
+#include "job_system.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+namespace Visor
+{
+	static RenderSystemBackendSw* pInstance = nullptr;
+
+	static const ui32 DrawBatchSize = 4;
+
+	// fragment.frag
+	static const f32 LightDirection[3] = {0.57735027f, 0.57735027f, 0.57735027f};
+	static const f32 Color[3] = {1.0f, 1.0f, 0.4f};
+	// the clear color of the vulkan backend, 0.2 0.5 0.8 rounded to 8 bits
+	static const ui32 ClearColor = 51u | 128u << 8 | 204u << 16 | 255u << 24;
+
+	// a * x + b * y + c, interpolating a value given at the corners of a triangle
+	struct ScreenPlane
+	{
+	public:
+		f32 a;
+		f32 b;
+		f32 c;
+	};
+
+#if !defined(VSR_MATHS_SSE)
+	static ui32 getColor(f32 lambert)
+	{
+		const ui32 red = (ui32)(lambert * (Color[0] * 255.0f) + 0.5f);
+		const ui32 green = (ui32)(lambert * (Color[1] * 255.0f) + 0.5f);
+		const ui32 blue = (ui32)(lambert * (Color[2] * 255.0f) + 0.5f);
+		return red | green << 8 | blue << 16 | 255u << 24;
+	}
+#endif
+
+	void RenderSystemBackendSw::render(const FramePacket& packet)
+	{
+		assert(pInstance != nullptr);
+
+		_viewProjectionMatrix =
+			Matrix4<f32>::getProjection(packet.camera.fov, _width / (f32)_height) *
+			Matrix4<f32>::getView(packet.camera.position, packet.camera.orientation);
+
+		_drawList.create(packet, _viewProjectionMatrix, [](MeshHandle mesh, ui32& indexCount, b8& isCurrentRevision)
+		{
+			const MeshRegistry& meshRegistry = MeshRegistry::getInstance();
+			if (!meshRegistry.isLoaded(mesh))
+			{
+				return false;
+			}
+
+			indexCount = (ui32)meshRegistry.getMesh(mesh).getIndices().size();
+			isCurrentRevision = true;
+			return true;
+		});
+
+		// draws are set up in parallel, each batch into its own lists
+		const std::vector<DrawList::Draw>& draws = _drawList.getDraws();
+		const ui32 batchCount = ((ui32)draws.size() + DrawBatchSize - 1) / DrawBatchSize;
+		_batchVertices.resize(batchCount);
+		_batchTriangles.resize(batchCount);
+		JobSystem::getInstance().parallelFor((ui32)draws.size(), DrawBatchSize, [this, &packet, &draws](ui32 begin, ui32 end)
+		{
+			std::vector<ScreenTriangle>& triangles = _batchTriangles[begin / DrawBatchSize];
+			triangles.clear();
+			for (ui32 drawIndex = begin; drawIndex < end; ++drawIndex)
+			{
+				setupTriangles(packet, draws[drawIndex], _batchVertices[begin / DrawBatchSize], triangles);
+			}
+		});
+
+		// then binned to the tiles their bounds overlap, in draw order so the result does not depend on the thread count
+		_triangles.clear();
+		for (const std::vector<ScreenTriangle>& triangles : _batchTriangles)
+		{
+			_triangles.insert(_triangles.end(), triangles.begin(), triangles.end());
+		}
+
+		for (std::vector<ui32>& triangleIndices : _tileTriangleIndices)
+		{
+			triangleIndices.clear();
+		}
+
+		for (ui32 triangleIndex = 0; triangleIndex < _triangles.size(); ++triangleIndex)
+		{
+			const ScreenTriangle& triangle = _triangles[triangleIndex];
+			for (ui32 tileY = triangle.bounds.minimumY / TileHeight; tileY <= triangle.bounds.maximumY / TileHeight; ++tileY)
+			{
+				for (ui32 tileX = triangle.bounds.minimumX / TileWidth; tileX <= triangle.bounds.maximumX / TileWidth; ++tileX)
+				{
+					_tileTriangleIndices[tileY * _tileCountX + tileX].push_back(triangleIndex);
+				}
+			}
+		}
+
+		JobSystem::getInstance().parallelFor((ui32)_tileTriangleIndices.size(), 1, [this](ui32 begin, ui32 end)
+		{
+			for (ui32 tileIndex = begin; tileIndex < end; ++tileIndex)
+			{
+				rasterizeTile(tileIndex);
+			}
+		});
+
+		#if defined(VSR_GRAPHICS_API_SOFTWARE)
+			if (!_isHeadless)
+			{
+				WindowSystem::getInstance().getWindow().presentPixels(_colors.data(), _width, _height, _stride);
+			}
+		#endif
+	}
+
+	void RenderSystemBackendSw::releaseWindow()
+	{
+		#if defined(VSR_GRAPHICS_API_SOFTWARE)
+			if (!_isHeadless)
+			{
+				WindowSystem::getInstance().getWindow().releaseContext();
+			}
+		#endif
+	}
+
+	const MeshletCullingStatistics& RenderSystemBackendSw::getMeshletCullingStatistics() const
+	{
+		return _drawList.getMeshletCullingStatistics();
+	}
+
+	void RenderSystemBackendSw::writeColorImage(const std::string& path) const
+	{
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open())
+		{
+			std::cerr << "could not open file " << path << "\n";
+			std::exit(EXIT_FAILURE);
+		}
+
+		file << "P6\n" << _width << " " << _height << "\n255\n";
+
+		std::vector<ui8> pixels(_width * _height * 3);
+		for (ui32 y = 0; y < _height; ++y)
+		{
+			for (ui32 x = 0; x < _width; ++x)
+			{
+				const ui32 color = _colors[y * _stride + x];
+				ui8* pPixel = &pixels[(y * _width + x) * 3];
+				pPixel[0] = (ui8)(color & 0xFF);
+				pPixel[1] = (ui8)(color >> 8 & 0xFF);
+				pPixel[2] = (ui8)(color >> 16 & 0xFF);
+			}
+		}
+		file.write((const c8*)pixels.data(), pixels.size());
+	}
+
+	const std::vector<ui32>& RenderSystemBackendSw::getColors() const
+	{
+		return _colors;
+	}
+
+	const std::vector<f32>& RenderSystemBackendSw::getDepths() const
+	{
+		return _depths;
+	}
+
+	ui32 RenderSystemBackendSw::getWidth() const
+	{
+		return _width;
+	}
+
+	ui32 RenderSystemBackendSw::getHeight() const
+	{
+		return _height;
+	}
+
+	ui32 RenderSystemBackendSw::getStride() const
+	{
+		return _stride;
+	}
+
+	void RenderSystemBackendSw::start(ui32 width, ui32 height, b8 isHeadless)
+	{
+		assert(pInstance == nullptr);
+		pInstance = new RenderSystemBackendSw(width, height, isHeadless);
+	}
+
+	void RenderSystemBackendSw::terminate()
+	{
+		assert(pInstance != nullptr);
+		delete pInstance;
+		pInstance = nullptr;
+	}
+
+	RenderSystemBackendSw& RenderSystemBackendSw::getInstance()
+	{
+		assert(pInstance != nullptr);
+		return *pInstance;
+	}
+
+	RenderSystemBackendSw::RenderSystemBackendSw(ui32 width, ui32 height, b8 isHeadless)
+		: _width(std::max(width, 1u))
+		, _height(std::max(height, 1u))
+		, _isHeadless(isHeadless)
+		, _viewProjectionMatrix(Matrix4<f32>::getIdentity())
+	{
+		// rows are padded to groups of 4 pixels, tiles are multiples of 4 pixels wide so groups never straddle two tiles
+		_stride = (_width + 3) & ~3u;
+		_tileCountX = (_width + TileWidth - 1) / TileWidth;
+		_tileCountY = (_height + TileHeight - 1) / TileHeight;
+		_colors.resize(_stride * _height, ClearColor);
+		_depths.resize(_stride * _height, 1.0f);
+		_tileTriangleIndices.resize(_tileCountX * _tileCountY);
+	}
+
+	void RenderSystemBackendSw::setupTriangles(const FramePacket& packet, const DrawList::Draw& draw, std::vector<ClipVertex>& vertices, std::vector<ScreenTriangle>& triangles) const
+	{
+		const Mesh& mesh = MeshRegistry::getInstance().getMesh(draw.mesh);
+		const std::vector<Mesh::Vertex>& meshVertices = mesh.getVertices();
+		const std::vector<ui32>& indices = mesh.getIndices();
+
+		// vertex.vert : world normals are the normals times the affine transformation, renormalized
+		const Matrix4<f32>& transformationMatrix = _drawList.getTransformationMatrix(packet, draw);
+		const Matrix4<f32> matrix = _viewProjectionMatrix * transformationMatrix;
+		const Matrix3<f32> normalMatrix = transformationMatrix.getUpperLeft();
+
+		vertices.resize(meshVertices.size());
+		for (ui32 vertexIndex = 0; vertexIndex < meshVertices.size(); ++vertexIndex)
+		{
+			const Vector3<f32>& position = meshVertices[vertexIndex].position;
+			vertices[vertexIndex].position = matrix * Vector4<f32>{position.x, position.y, position.z, 1.0f};
+			vertices[vertexIndex].normal = normalMatrix * meshVertices[vertexIndex].normal;
+			vertices[vertexIndex].normal.normalize();
+		}
+
+		for (ui32 rangeIndex = draw.firstIndexRange; rangeIndex < draw.firstIndexRange + draw.indexRangeCount; ++rangeIndex)
+		{
+			const IndexRange& indexRange = _drawList.getIndexRanges()[rangeIndex];
+			for (ui32 index = indexRange.offset; index + 2 < indexRange.offset + indexRange.count; index += 3)
+			{
+				const ClipVertex* pCorners[3] = {&vertices[indices[index]], &vertices[indices[index + 1]], &vertices[indices[index + 2]]};
+
+				// cut by the near plane, which leaves up to two triangles
+				ClipCorner polygon[4];
+				const ui32 polygonSize = clipTriangle(pCorners[0]->position, pCorners[1]->position, pCorners[2]->position, polygon);
+				ClipVertex polygonVertices[4];
+				for (ui32 cornerIndex = 0; cornerIndex < polygonSize; ++cornerIndex)
+				{
+					const ClipCorner& corner = polygon[cornerIndex];
+					const ClipVertex& first = *pCorners[corner.first];
+					const ClipVertex& second = *pCorners[corner.second];
+					polygonVertices[cornerIndex].position = corner.position;
+					polygonVertices[cornerIndex].normal = first.normal + (second.normal - first.normal) * corner.t;
+				}
+
+				for (ui32 cornerIndex = 2; cornerIndex < polygonSize; ++cornerIndex)
+				{
+					addTriangle(polygonVertices[0], polygonVertices[cornerIndex - 1], polygonVertices[cornerIndex], triangles);
+				}
+			}
+		}
+	}
+
+	void RenderSystemBackendSw::addTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, std::vector<ScreenTriangle>& triangles) const
+	{
+		const ClipVertex* pCorners[3] = {&a, &b, &c};
+
+		ScreenTriangle triangle = {};
+		for (ui32 cornerIndex = 0; cornerIndex < 3; ++cornerIndex)
+		{
+			const ClipVertex& corner = *pCorners[cornerIndex];
+			const f32 inverseW = 1.0f / corner.position.w;
+
+			const Vector3<f32> screenPosition = getScreenPosition(corner.position, inverseW, _width, _height);
+			triangle.x[cornerIndex] = screenPosition.x;
+			triangle.y[cornerIndex] = screenPosition.y;
+			triangle.z[cornerIndex] = screenPosition.z;
+			triangle.inverseW[cornerIndex] = inverseW;
+			triangle.normalsX[cornerIndex] = corner.normal.x * inverseW;
+			triangle.normalsY[cornerIndex] = corner.normal.y * inverseW;
+			triangle.normalsZ[cornerIndex] = corner.normal.z * inverseW;
+		}
+
+		// back faces and triangles between pixel centers are dropped
+		if (getPixelBounds(triangle.x, triangle.y, _width, _height, triangle.bounds))
+		{
+			triangles.push_back(triangle);
+		}
+	}
+
+	void RenderSystemBackendSw::rasterizeTile(ui32 tileIndex)
+	{
+		const ui32 tileX = (tileIndex % _tileCountX) * TileWidth;
+		const ui32 tileY = (tileIndex / _tileCountX) * TileHeight;
+		const ui32 tileEndX = std::min(tileX + TileWidth, _stride);
+		const ui32 tileEndY = std::min(tileY + TileHeight, _height);
+
+		for (ui32 y = tileY; y < tileEndY; ++y)
+		{
+			std::fill(_colors.begin() + y * _stride + tileX, _colors.begin() + y * _stride + tileEndX, ClearColor);
+			std::fill(_depths.begin() + y * _stride + tileX, _depths.begin() + y * _stride + tileEndX, 1.0f);
+		}
+
+		for (ui32 triangleIndex : _tileTriangleIndices[tileIndex])
+		{
+			rasterizeTriangle(_triangles[triangleIndex], tileX, tileY, tileEndX, tileEndY);
+		}
+	}
+
+	void RenderSystemBackendSw::rasterizeTriangle(const ScreenTriangle& triangle, ui32 tileX, ui32 tileY, ui32 tileEndX, ui32 tileEndY)
+	{
+		// edge functions e(x, y) = a * x + b * y + c, positive inside
+		ScreenPlane edges[3];
+		b8 isTopLeft[3];
+		for (ui32 edgeIndex = 0; edgeIndex < 3; ++edgeIndex)
+		{
+			const ui32 begin = edgeIndex;
+			const ui32 end = (edgeIndex + 1) % 3;
+			edges[edgeIndex].a = triangle.y[begin] - triangle.y[end];
+			edges[edgeIndex].b = triangle.x[end] - triangle.x[begin];
+			edges[edgeIndex].c = (triangle.y[end] - triangle.y[begin]) * triangle.x[begin] - (triangle.x[end] - triangle.x[begin]) * triangle.y[begin];
+
+			// the inside is right of a left edge, below a horizontal top edge
+			isTopLeft[edgeIndex] = edges[edgeIndex].a > 0.0f || (edges[edgeIndex].a == 0.0f && edges[edgeIndex].b > 0.0f);
+		}
+
+		// the weight of a corner is the edge function of the opposite edge over the area
+		const f32 area = edges[0].c + edges[0].a * triangle.x[2] + edges[0].b * triangle.y[2];
+		const f32* pValues[5] = {triangle.z, triangle.inverseW, triangle.normalsX, triangle.normalsY, triangle.normalsZ};
+		ScreenPlane planes[5];
+		for (ui32 planeIndex = 0; planeIndex < 5; ++planeIndex)
+		{
+			const f32* pValue = pValues[planeIndex];
+			planes[planeIndex].a = (pValue[0] * edges[1].a + pValue[1] * edges[2].a + pValue[2] * edges[0].a) / area;
+			planes[planeIndex].b = (pValue[0] * edges[1].b + pValue[1] * edges[2].b + pValue[2] * edges[0].b) / area;
+			planes[planeIndex].c = (pValue[0] * edges[1].c + pValue[1] * edges[2].c + pValue[2] * edges[0].c) / area;
+		}
+		const ScreenPlane& depthPlane = planes[0];
+		const ScreenPlane& inverseWPlane = planes[1];
+		const ScreenPlane& normalXPlane = planes[2];
+		const ScreenPlane& normalYPlane = planes[3];
+		const ScreenPlane& normalZPlane = planes[4];
+
+		// groups of 4 pixels are aligned, they never leave the tile but may cover the row padding past the bounds
+		const ui32 beginX = std::max(triangle.bounds.minimumX, tileX) & ~3u;
+		const ui32 beginY = std::max(triangle.bounds.minimumY, tileY);
+		const ui32 endX = std::min(triangle.bounds.maximumX, tileEndX - 1);
+		const ui32 endY = std::min(triangle.bounds.maximumY, tileEndY - 1);
+
+		ui32* pColors = _colors.data();
+		f32* pDepths = _depths.data();
+
+		#if defined(VSR_MATHS_SSE)
+			const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 isTopLeft0 = _mm_castsi128_ps(_mm_set1_epi32(isTopLeft[0] ? -1 : 0));
+			const __m128 isTopLeft1 = _mm_castsi128_ps(_mm_set1_epi32(isTopLeft[1] ? -1 : 0));
+			const __m128 isTopLeft2 = _mm_castsi128_ps(_mm_set1_epi32(isTopLeft[2] ? -1 : 0));
+			const __m128i alpha = _mm_set1_epi32((i32)(255u << 24));
+			for (ui32 y = beginY; y <= endY; ++y)
+			{
+				const f32 pixelY = y + 0.5f;
+				const __m128 rowEdge0 = _mm_set1_ps(edges[0].b * pixelY + edges[0].c);
+				const __m128 rowEdge1 = _mm_set1_ps(edges[1].b * pixelY + edges[1].c);
+				const __m128 rowEdge2 = _mm_set1_ps(edges[2].b * pixelY + edges[2].c);
+				const __m128 rowDepth = _mm_set1_ps(depthPlane.b * pixelY + depthPlane.c);
+
+				for (ui32 x = beginX; x <= endX; x += 4)
+				{
+					const __m128 pixelX = _mm_add_ps(_mm_set1_ps((f32)x), laneOffsets);
+					const __m128 edge0 = _mm_add_ps(_mm_mul_ps(pixelX, _mm_set1_ps(edges[0].a)), rowEdge0);
+					const __m128 edge1 = _mm_add_ps(_mm_mul_ps(pixelX, _mm_set1_ps(edges[1].a)), rowEdge1);
+					const __m128 edge2 = _mm_add_ps(_mm_mul_ps(pixelX, _mm_set1_ps(edges[2].a)), rowEdge2);
+					const __m128 inside = _mm_and_ps(_mm_and_ps(
+						_mm_or_ps(_mm_cmpgt_ps(edge0, zero), _mm_and_ps(_mm_cmpeq_ps(edge0, zero), isTopLeft0)),
+						_mm_or_ps(_mm_cmpgt_ps(edge1, zero), _mm_and_ps(_mm_cmpeq_ps(edge1, zero), isTopLeft1))),
+						_mm_or_ps(_mm_cmpgt_ps(edge2, zero), _mm_and_ps(_mm_cmpeq_ps(edge2, zero), isTopLeft2)));
+					if (_mm_movemask_ps(inside) == 0)
+					{
+						continue;
+					}
+
+					f32* pDepthRow = pDepths + y * _stride + x;
+					const __m128 previousDepth = _mm_loadu_ps(pDepthRow);
+					const __m128 depth = _mm_add_ps(_mm_mul_ps(pixelX, _mm_set1_ps(depthPlane.a)), rowDepth);
+					const __m128 isWritten = _mm_and_ps(inside, _mm_cmple_ps(depth, previousDepth));
+					if (_mm_movemask_ps(isWritten) == 0)
+					{
+						continue;
+					}
+					_mm_storeu_ps(pDepthRow, _mm_or_ps(_mm_and_ps(isWritten, depth), _mm_andnot_ps(isWritten, previousDepth)));
+
+					// perspective correct normals, interpolated without renormalizing like the varying of fragment.frag
+					const __m128 inverseW = _mm_add_ps(_mm_mul_ps(pixelX, _mm_set1_ps(inverseWPlane.a)), _mm_set1_ps(inverseWPlane.b * pixelY + inverseWPlane.c));
+					const __m128 normalX = _mm_add_ps(_mm_mul_ps(pixelX, _mm_set1_ps(normalXPlane.a)), _mm_set1_ps(normalXPlane.b * pixelY + normalXPlane.c));
+					const __m128 normalY = _mm_add_ps(_mm_mul_ps(pixelX, _mm_set1_ps(normalYPlane.a)), _mm_set1_ps(normalYPlane.b * pixelY + normalYPlane.c));
+					const __m128 normalZ = _mm_add_ps(_mm_mul_ps(pixelX, _mm_set1_ps(normalZPlane.a)), _mm_set1_ps(normalZPlane.b * pixelY + normalZPlane.c));
+					const __m128 dot = _mm_add_ps(_mm_add_ps(
+						_mm_mul_ps(normalX, _mm_set1_ps(LightDirection[0])),
+						_mm_mul_ps(normalY, _mm_set1_ps(LightDirection[1]))),
+						_mm_mul_ps(normalZ, _mm_set1_ps(LightDirection[2])));
+					const __m128 lambert = _mm_min_ps(_mm_max_ps(_mm_div_ps(dot, inverseW), zero), one);
+
+					const __m128 half = _mm_set1_ps(0.5f);
+					const __m128i red = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(lambert, _mm_set1_ps(Color[0] * 255.0f)), half));
+					const __m128i green = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(lambert, _mm_set1_ps(Color[1] * 255.0f)), half));
+					const __m128i blue = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(lambert, _mm_set1_ps(Color[2] * 255.0f)), half));
+					const __m128i color = _mm_or_si128(_mm_or_si128(red, _mm_slli_epi32(green, 8)), _mm_or_si128(_mm_slli_epi32(blue, 16), alpha));
+
+					__m128i* pColorRow = (__m128i*)(pColors + y * _stride + x);
+					const __m128i mask = _mm_castps_si128(isWritten);
+					_mm_storeu_si128(pColorRow, _mm_or_si128(_mm_and_si128(mask, color), _mm_andnot_si128(mask, _mm_loadu_si128(pColorRow))));
+				}
+			}
+		#else
+			for (ui32 y = beginY; y <= endY; ++y)
+			{
+				const f32 pixelY = y + 0.5f;
+				for (ui32 x = beginX; x <= endX; ++x)
+				{
+					const f32 pixelX = x + 0.5f;
+					b8 isInside = true;
+					for (ui32 edgeIndex = 0; edgeIndex < 3; ++edgeIndex)
+					{
+						const f32 edge = edges[edgeIndex].a * pixelX + edges[edgeIndex].b * pixelY + edges[edgeIndex].c;
+						isInside = isInside && (edge > 0.0f || (edge == 0.0f && isTopLeft[edgeIndex]));
+					}
+
+					if (!isInside)
+					{
+						continue;
+					}
+
+					f32& previousDepth = pDepths[y * _stride + x];
+					const f32 depth = depthPlane.a * pixelX + depthPlane.b * pixelY + depthPlane.c;
+					if (!(depth <= previousDepth))
+					{
+						continue;
+					}
+					previousDepth = depth;
+
+					// perspective correct normals, interpolated without renormalizing like the varying of fragment.frag
+					const f32 inverseW = inverseWPlane.a * pixelX + inverseWPlane.b * pixelY + inverseWPlane.c;
+					const f32 dot =
+						(normalXPlane.a * pixelX + normalXPlane.b * pixelY + normalXPlane.c) * LightDirection[0] +
+						(normalYPlane.a * pixelX + normalYPlane.b * pixelY + normalYPlane.c) * LightDirection[1] +
+						(normalZPlane.a * pixelX + normalZPlane.b * pixelY + normalZPlane.c) * LightDirection[2];
+					pColors[y * _stride + x] = getColor(std::min(std::max(dot / inverseW, 0.0f), 1.0f));
+				}
+			}
+		#endif
+	}
+}
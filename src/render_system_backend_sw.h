@@ -0,0 +1,102 @@
+#pragma once
+
+#include "types.h"
+#include "camera.h"
+#include "draw_list.h"
+#include "frame_packet.h"
+#include "maths.h"
+#include "meshlet.h"
+#include "mesh_registry.h"
+#include "rasterization.h"
+
+#include <string>
+#include <vector>
+
+namespace Visor
+{
+	/*
+	software rasterizer, for machines without gpu and as the reference of the vulkan output.
+	it draws what the vulkan pipeline draws : the transform of vertex.vert, back faces culled (the faces whose (b - a) x (c - a)
+	points away from the camera, like the meshlet cones), depth tested less or equal, and the lambert shading of fragment.frag on perspective correct normals.
+	pixel centers are at half integers, pixels on an edge belong to the triangle only if it is a top or left edge.
+	entities are transformed and their triangles set up in parallel, then binned to screen tiles, every tile being
+	cleared and rasterized (4 pixels at a time) by its own job. colors are stored like VK_FORMAT_R8G8B8A8_UNORM
+	*/
+	class RenderSystemBackendSw
+	{
+	public:
+		static const ui32 TileWidth = 64;
+		static const ui32 TileHeight = 32;
+
+		// only the entities of the draw list are drawn
+		void render(const FramePacket& packet);
+		const MeshletCullingStatistics& getMeshletCullingStatistics() const;
+		// binary ppm of the last frame
+		void writeColorImage(const std::string& path) const;
+		// on the thread rendering, once it is done : the window context is left current on it otherwise
+		void releaseWindow();
+
+		// rows of getStride() pixels, the padding past the width is undefined
+		const std::vector<ui32>& getColors() const;
+		const std::vector<f32>& getDepths() const;
+		ui32 getWidth() const;
+		ui32 getHeight() const;
+		ui32 getStride() const;
+
+		// frames are presented to the window of the window system, or only kept in memory when headless
+		static void start(ui32 width, ui32 height, b8 isHeadless);
+		static void terminate();
+		static RenderSystemBackendSw& getInstance();
+
+	private:
+		struct ClipVertex
+		{
+		public:
+			Vector4<f32> position;
+			Vector3<f32> normal;
+		};
+
+		struct ScreenTriangle
+		{
+		public:
+			// pixel coordinates, y going down, and depth
+			f32 x[3];
+			f32 y[3];
+			f32 z[3];
+			// attributes divided by w, interpolated linearly on screen
+			f32 inverseW[3];
+			f32 normalsX[3];
+			f32 normalsY[3];
+			f32 normalsZ[3];
+			PixelBounds bounds;
+		};
+
+	private:
+		RenderSystemBackendSw(ui32 width, ui32 height, b8 isHeadless);
+
+		void setupTriangles(const FramePacket& packet, const DrawList::Draw& draw, std::vector<ClipVertex>& vertices, std::vector<ScreenTriangle>& triangles) const;
+		void addTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, std::vector<ScreenTriangle>& triangles) const;
+		void rasterizeTile(ui32 tileIndex);
+		void rasterizeTriangle(const ScreenTriangle& triangle, ui32 tileX, ui32 tileY, ui32 tileEndX, ui32 tileEndY);
+
+	private:
+		ui32 _width;
+		ui32 _height;
+		ui32 _stride;
+		ui32 _tileCountX;
+		ui32 _tileCountY;
+		b8 _isHeadless;
+		std::vector<ui32> _colors;
+		std::vector<f32> _depths;
+
+		Matrix4<f32> _viewProjectionMatrix;
+		// there is no upload here, every loaded mesh is resident
+		DrawList _drawList;
+
+		// vertices and triangles of each setup batch, then the indices of the triangles touching each tile
+		std::vector<std::vector<ClipVertex>> _batchVertices;
+		std::vector<std::vector<ScreenTriangle>> _batchTriangles;
+		std::vector<ScreenTriangle> _triangles;
+		std::vector<std::vector<ui32>> _tileTriangleIndices;
+	};
+}
@@ -1,5 +1,9 @@
+// compiled with the vulkan API only, the other backends build without its headers
+#if defined(VSR_GRAPHICS_API_VULKAN)
+
 #include "render_system_backend_vk.h"
 #include "window_system.h"
+#include "asset_system.h"
 
 #define VOLK_IMPLEMENTATION
 #include "volk.h"
@@ -8,28 +12,19 @@
 #include <iostream>
 #include <cassert>
 #include <cmath>
+#include <algorithm>
 
 namespace Visor
 {
 	static RenderSystemBackendVk* pInstance = nullptr;
 
-	void RenderSystemBackendVk::render(const Camera& camera, const std::vector<Entity>& entities)
+	void RenderSystemBackendVk::render(const FramePacket& packet)
 	{
 		assert(pInstance != nullptr);
 
 		vkWaitForFences(_device, 1, &_commandBufferExecutedFence, VK_FALSE, UINT64_MAX);
 		vkResetFences(_device, 1, &_commandBufferExecutedFence);
 
-		updateGlobalUniformBuffer(camera);
-		updateEntityDrawInfos(entities);
-
-		ui32 availableSwapchainImageIndex = 0;
-		if (vkAcquireNextImageKHR(_device, _swapchain, UINT64_MAX, _imageAvailableSemaphore, VK_NULL_HANDLE, &availableSwapchainImageIndex) != VK_SUCCESS)
-		{
-			std::cerr << "could not acquire next swapchain image index\n";
-			std::exit(EXIT_FAILURE);
-		}
-
 		vkResetCommandBuffer(_commandBuffer, 0);
 
 		VkCommandBufferBeginInfo commandBufferBeginInfo = {};
@@ -39,6 +34,17 @@ namespace Visor
 		commandBufferBeginInfo.pInheritanceInfo = nullptr;
 		vkBeginCommandBuffer(_commandBuffer, &commandBufferBeginInfo);
 
+		// records the geometry uploads of this frame, before the draws using them
+		updateGlobalUniformBuffer(packet.camera);
+		updateEntityDrawInfos(packet);
+
+		ui32 availableSwapchainImageIndex = 0;
+		if (vkAcquireNextImageKHR(_device, _swapchain, UINT64_MAX, _imageAvailableSemaphore, VK_NULL_HANDLE, &availableSwapchainImageIndex) != VK_SUCCESS)
+		{
+			std::cerr << "could not acquire next swapchain image index\n";
+			std::exit(EXIT_FAILURE);
+		}
+
 		VkClearValue clearColor = {};
 		clearColor.color.float32[0] = 0.2f;
 		clearColor.color.float32[1] = 0.5f;
@@ -87,19 +93,26 @@ namespace Visor
 
 		vkCmdBeginRendering(_commandBuffer, &renderingInfo);
 
-		for (const EntityDrawInfo& entityDrawInfo : _entityDrawInfos)
+		const std::vector<IndexRange>& indexRanges = _drawList.getIndexRanges();
+		for (const DrawList::Draw& draw : _drawList.getDraws())
 		{
+			const MeshDrawInfo& meshDrawInfo = _meshDrawInfos[draw.mesh.index];
+
 			VkDescriptorSet descriptorSets[] = {
 				_globalDescriptorSet,
-				entityDrawInfo.entityDescriptorSet
+				_transformDescriptorSet
 			};
 
-			vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, entityDrawInfo.graphicsPipelineLayout, 0, 2, descriptorSets, 0, nullptr);
-			vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, entityDrawInfo.graphicsPipeline);
+			const ui32 transformOffset = draw.transformIndex * _transformStride;
+			vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipelineLayout, 0, 2, descriptorSets, 1, &transformOffset);
+			vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineInfos[meshDrawInfo.pipelineIndex].graphicsPipeline);
 			VkDeviceSize offset = 0;
-			vkCmdBindVertexBuffers(_commandBuffer, 0, 1, &entityDrawInfo.vertexBuffer, &offset);
-			vkCmdBindIndexBuffer(_commandBuffer, entityDrawInfo.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(_commandBuffer, entityDrawInfo.indexCount, 1, 0, 0, 0);
+			vkCmdBindVertexBuffers(_commandBuffer, 0, 1, &meshDrawInfo.vertexBuffer, &offset);
+			vkCmdBindIndexBuffer(_commandBuffer, meshDrawInfo.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+			for (ui32 indexRangeIndex = draw.firstIndexRange; indexRangeIndex < draw.firstIndexRange + draw.indexRangeCount; ++indexRangeIndex)
+			{
+				vkCmdDrawIndexed(_commandBuffer, indexRanges[indexRangeIndex].count, 1, indexRanges[indexRangeIndex].offset, 0, 0);
+			}
 		}
 
 		vkCmdEndRendering(_commandBuffer);
@@ -137,6 +150,11 @@ namespace Visor
 		vkQueuePresentKHR(_queue, &presentInfo);
 	}
 
+	const MeshletCullingStatistics& RenderSystemBackendVk::getMeshletCullingStatistics() const
+	{
+		return _drawList.getMeshletCullingStatistics();
+	}
+
 	void RenderSystemBackendVk::start()
 	{
 		assert(pInstance == nullptr);
@@ -158,6 +176,12 @@ namespace Visor
 
 	RenderSystemBackendVk::RenderSystemBackendVk()
 		: _pAllocator(nullptr)
+		, _transformBuffer(VK_NULL_HANDLE)
+		, _transformBufferMemory(VK_NULL_HANDLE)
+		, _transformStagingBuffer(VK_NULL_HANDLE)
+		, _transformStagingBufferMemory(VK_NULL_HANDLE)
+		, _pTransformStagingData(nullptr)
+		, _transformCapacity(0)
 	{
 		if (volkInitialize() != VK_SUCCESS)
 		{
@@ -242,6 +266,33 @@ namespace Visor
 		globalUniformBufferDescriptorWrite.pBufferInfo = &globalUniformBufferInfo;
 
 		vkUpdateDescriptorSets(_device, 1, &globalUniformBufferDescriptorWrite, 0, nullptr);
+
+		std::vector<VkDescriptorSetLayoutBinding> entityDescriptorSetLayoutBindings;
+
+		VkDescriptorSetLayoutBinding entityUniformBufferDescriptorSetLayoutBinding = {};
+		entityUniformBufferDescriptorSetLayoutBinding.binding = 0;
+		entityUniformBufferDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		entityUniformBufferDescriptorSetLayoutBinding.descriptorCount = 1;
+		entityUniformBufferDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+
+		entityDescriptorSetLayoutBindings.push_back(entityUniformBufferDescriptorSetLayoutBinding);
+
+		_entityDescriptorSetLayout = createDescriptorSetLayout(entityDescriptorSetLayoutBindings, _device, _pAllocator);
+
+		std::vector<VkDescriptorSetLayout> descriptorSetLayouts = {
+			_globalDescriptorSetLayout,
+			_entityDescriptorSetLayout
+		};
+
+		_graphicsPipelineLayout = createPipelineLayout(descriptorSetLayouts, 0, nullptr, _device, _pAllocator);
+
+		_transformDescriptorSet = allocateDescriptorSet(_descriptorPool, _entityDescriptorSetLayout, _device);
+
+		// dynamic offsets must respect the device alignment
+		VkPhysicalDeviceProperties physicalDeviceProperties = {};
+		vkGetPhysicalDeviceProperties(_physicalDevice, &physicalDeviceProperties);
+		const ui32 offsetAlignment = (ui32)physicalDeviceProperties.limits.minUniformBufferOffsetAlignment;
+		_transformStride = (sizeof(EntityUniformBuffer) + offsetAlignment - 1) / offsetAlignment * offsetAlignment;
 	}
 
 	RenderSystemBackendVk::~RenderSystemBackendVk()
@@ -273,7 +324,9 @@ namespace Visor
 		Matrix4<f32> projectionMatrix = Matrix4<f32>::getProjection(camera.fov, _renderArea.extent.width / (f32)_renderArea.extent.height);
 		projectionMatrix.m[1][1] *= -1.0f; // y is flipped in vulkan
 
-		globalUniformBuffer.viewProjectionMatrix = projectionMatrix * Matrix4<f32>::getView(camera.position, camera.yaw, camera.pitch, camera.roll);
+		_viewProjectionMatrix = projectionMatrix * Matrix4<f32>::getView(camera.position, camera.orientation);
+
+		globalUniformBuffer.viewProjectionMatrix = _viewProjectionMatrix;
 		globalUniformBuffer.viewProjectionMatrix.transpose();
 
 		void* pGlobalUniformBufferData = nullptr;
@@ -282,184 +335,500 @@ namespace Visor
 		vkUnmapMemory(_device, _globalUniformBufferMemory);
 	}
 
-	void RenderSystemBackendVk::updateEntityDrawInfos(const std::vector<Entity>& entities)
+	void RenderSystemBackendVk::updateEntityDrawInfos(const FramePacket& packet)
 	{
-		// destroy previous frame entity draw infos first
-		destroyEntityDrawInfos();
+		// the previous frame is done, geometry of released meshes and pipelines of changed shaders can go
+		evictMeshDrawInfos();
+		reloadChangedPipelines();
 
-		// (re)create current frame entity draw infos
-		createEntityDrawInfos(entities);
+		// start streaming newly loaded meshes and continue the ongoing uploads
+		prepareMeshDrawInfo(AssetSystem::getInstance().getPlaceholderMesh());
+		for (const MeshHandle& mesh : packet.meshHandles)
+		{
+			prepareMeshDrawInfo(mesh);
+		}
+		recordMeshUploads();
+
+		// (re)create current frame draws
+		_drawList.create(packet, _viewProjectionMatrix, [this](MeshHandle mesh, ui32& indexCount, b8& isCurrentRevision)
+		{
+			return getResidency(mesh, indexCount, isCurrentRevision);
+		});
+		recordTransformUploads(packet);
 	}
 
-	void RenderSystemBackendVk::createEntityDrawInfos(const std::vector<Entity>& entities)
+	void RenderSystemBackendVk::recordTransformUploads(const FramePacket& packet)
 	{
-		for(const Entity& entity : entities)
+		const ui32 requiredCapacity = _drawList.getTransformCount();
+		if (requiredCapacity == 0)
 		{
-			EntityDrawInfo entityDrawInfo = {};
-			
-			std::vector<VkDescriptorSetLayoutBinding> entityDescriptorSetLayoutBindings;
+			return;
+		}
 
-			VkDescriptorSetLayoutBinding entityUniformBufferDescriptorSetLayoutBinding = {};
-			entityUniformBufferDescriptorSetLayoutBinding.binding = 0;
-			entityUniformBufferDescriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			entityUniformBufferDescriptorSetLayoutBinding.descriptorCount = 1;
-			entityUniformBufferDescriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+		// a new buffer starts empty, every entity is uploaded
+		b8 uploadAll = false;
+		if (requiredCapacity > _transformCapacity)
+		{
+			destroyTransformBuffers();
+			createTransformBuffers(std::max(requiredCapacity, _transformCapacity * 2));
+			uploadAll = true;
+		}
 
-			entityDescriptorSetLayoutBindings.push_back(entityUniformBufferDescriptorSetLayoutBinding);
+		// the previous frame is done, its copies from the staging buffer too
+		std::vector<TransformRange> transformRanges;
+		_drawList.stageTransforms(packet, uploadAll, (ui8*)_pTransformStagingData, _transformStride, transformRanges);
+		if (transformRanges.empty())
+		{
+			return;
+		}
 
-			entityDrawInfo.entityDescriptorSetLayout = createDescriptorSetLayout(entityDescriptorSetLayoutBindings, _device, _pAllocator);
-			entityDrawInfo.entityDescriptorSet = allocateDescriptorSet(_descriptorPool, entityDrawInfo.entityDescriptorSetLayout, _device);
+		std::vector<VkBufferCopy> bufferCopies(transformRanges.size());
+		for (ui32 rangeIndex = 0; rangeIndex < transformRanges.size(); ++rangeIndex)
+		{
+			bufferCopies[rangeIndex].srcOffset = transformRanges[rangeIndex].first * _transformStride;
+			bufferCopies[rangeIndex].dstOffset = transformRanges[rangeIndex].first * _transformStride;
+			bufferCopies[rangeIndex].size = transformRanges[rangeIndex].count * _transformStride;
+		}
 
-			std::vector<VkDescriptorSetLayout> descriptorSetLayouts = {
-				_globalDescriptorSetLayout,
-				entityDrawInfo.entityDescriptorSetLayout
-			};
+		vkCmdCopyBuffer(_commandBuffer, _transformStagingBuffer, _transformBuffer, (ui32)bufferCopies.size(), bufferCopies.data());
 
-			entityDrawInfo.graphicsPipelineLayout = createPipelineLayout(descriptorSetLayouts, 0, nullptr, _device, _pAllocator);
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.pNext = nullptr;
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT;
 
-			VkShaderModule vertexShaderModule;
+		vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	void RenderSystemBackendVk::createTransformBuffers(ui32 capacity)
+	{
+		_transformCapacity = capacity;
+
+		_transformBuffer = createBuffer(capacity * _transformStride, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, _queueFamilyIndex, _device, _pAllocator);
+		_transformBufferMemory = allocateDeviceMemoryForBuffer(_device, _transformBuffer, _physicalDevice, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _pAllocator);
+		vkBindBufferMemory(_device, _transformBuffer, _transformBufferMemory, 0);
+
+		// stays mapped, matrices are written in place and copied by range
+		_transformStagingBuffer = createBuffer(capacity * _transformStride, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, _queueFamilyIndex, _device, _pAllocator);
+		_transformStagingBufferMemory = allocateDeviceMemoryForBuffer(_device, _transformStagingBuffer, _physicalDevice, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, _pAllocator);
+		vkBindBufferMemory(_device, _transformStagingBuffer, _transformStagingBufferMemory, 0);
+		vkMapMemory(_device, _transformStagingBufferMemory, 0, VK_WHOLE_SIZE, 0, &_pTransformStagingData);
+
+		VkDescriptorBufferInfo transformBufferInfo = {};
+		transformBufferInfo.buffer = _transformBuffer;
+		transformBufferInfo.offset = 0;
+		transformBufferInfo.range = sizeof(EntityUniformBuffer);
+
+		VkWriteDescriptorSet transformBufferDescriptorWrite = {};
+		transformBufferDescriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		transformBufferDescriptorWrite.pNext = nullptr;
+		transformBufferDescriptorWrite.dstSet = _transformDescriptorSet;
+		transformBufferDescriptorWrite.dstBinding = 0;
+		transformBufferDescriptorWrite.dstArrayElement = 0;
+		transformBufferDescriptorWrite.descriptorCount = 1;
+		transformBufferDescriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		transformBufferDescriptorWrite.pImageInfo = nullptr;
+		transformBufferDescriptorWrite.pBufferInfo = &transformBufferInfo;
+
+		vkUpdateDescriptorSets(_device, 1, &transformBufferDescriptorWrite, 0, nullptr);
+	}
+
+	void RenderSystemBackendVk::destroyTransformBuffers()
+	{
+		if (_transformBuffer == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		vkUnmapMemory(_device, _transformStagingBufferMemory);
+		vkFreeMemory(_device, _transformStagingBufferMemory, _pAllocator);
+		vkDestroyBuffer(_device, _transformStagingBuffer, _pAllocator);
+		vkFreeMemory(_device, _transformBufferMemory, _pAllocator);
+		vkDestroyBuffer(_device, _transformBuffer, _pAllocator);
+
+		_transformBuffer = VK_NULL_HANDLE;
+		_transformBufferMemory = VK_NULL_HANDLE;
+		_transformStagingBuffer = VK_NULL_HANDLE;
+		_transformStagingBufferMemory = VK_NULL_HANDLE;
+		_pTransformStagingData = nullptr;
+	}
+
+	void RenderSystemBackendVk::prepareMeshDrawInfo(MeshHandle mesh)
+	{
+		// mesh draw infos are indexed like the registry slots, so entities sharing a mesh share its buffers
+		if (!MeshRegistry::getInstance().isLoaded(mesh))
+		{
+			return;
+		}
+
+		if (mesh.index >= _meshDrawInfos.size())
+		{
+			_meshDrawInfos.resize(mesh.index + 1, MeshDrawInfo{});
+		}
+
+		MeshDrawInfo& meshDrawInfo = _meshDrawInfos[mesh.index];
+		if (meshDrawInfo.vertexBuffer != VK_NULL_HANDLE && meshDrawInfo.mesh != mesh)
+		{
+			destroyMeshDrawInfo(meshDrawInfo);
+		}
+
+		if (meshDrawInfo.vertexBuffer == VK_NULL_HANDLE)
+		{
+			createMeshDrawInfo(mesh, meshDrawInfo);
+			return;
+		}
+
+		// hot reloaded, the new revision streams next to the current one, which keeps being drawn until the swap
+		const ui32 revision = MeshRegistry::getInstance().getRevision(mesh);
+		if (meshDrawInfo.revision == revision)
+		{
+			return;
+		}
+
+		for (ui32 reloadingIndex = 0; reloadingIndex < _reloadingMeshDrawInfos.size(); ++reloadingIndex)
+		{
+			if (_reloadingMeshDrawInfos[reloadingIndex].mesh == mesh)
 			{
-				ui32 codeSize = 0;
-				ui32* pCode = nullptr;
-				readShader(entity.getMesh().getVertexShaderName(), &codeSize, &pCode);
-				vertexShaderModule = createShaderModule(codeSize, pCode, _device, _pAllocator);
+				if (_reloadingMeshDrawInfos[reloadingIndex].revision == revision)
+				{
+					return;
+				}
+
+				// reloaded again before the previous revision was done streaming
+				destroyMeshDrawInfo(_reloadingMeshDrawInfos[reloadingIndex]);
+				_reloadingMeshDrawInfos.erase(_reloadingMeshDrawInfos.begin() + reloadingIndex);
+				break;
 			}
+		}
+
+		MeshDrawInfo reloadingMeshDrawInfo = {};
+		createMeshDrawInfo(mesh, reloadingMeshDrawInfo);
+		_reloadingMeshDrawInfos.push_back(reloadingMeshDrawInfo);
+	}
+
+	void RenderSystemBackendVk::createMeshDrawInfo(MeshHandle mesh, MeshDrawInfo& meshDrawInfo)
+	{
+		const Mesh& meshData = MeshRegistry::getInstance().getMesh(mesh);
+
+		meshDrawInfo.mesh = mesh;
+		meshDrawInfo.revision = MeshRegistry::getInstance().getRevision(mesh);
+		meshDrawInfo.pipelineIndex = getPipelineIndex(meshData.getVertexShaderName(), meshData.getFragmentShaderName());
+
+		meshDrawInfo.vertexByteCount = sizeof(Mesh::Vertex) * meshData.getVertices().size();
+		meshDrawInfo.indexCount = meshData.getIndices().size();
+		meshDrawInfo.totalByteCount = meshDrawInfo.vertexByteCount + sizeof(ui32) * meshDrawInfo.indexCount;
+		meshDrawInfo.uploadedByteCount = 0;
+
+		meshDrawInfo.vertexBuffer = createBuffer(meshDrawInfo.vertexByteCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, _queueFamilyIndex, _device, _pAllocator);
+		meshDrawInfo.vertexBufferMemory = allocateDeviceMemoryForBuffer(_device, meshDrawInfo.vertexBuffer, _physicalDevice, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _pAllocator);
+		vkBindBufferMemory(_device, meshDrawInfo.vertexBuffer, meshDrawInfo.vertexBufferMemory, 0);
+
+		meshDrawInfo.indexBuffer = createBuffer(sizeof(ui32) * meshDrawInfo.indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, _queueFamilyIndex, _device, _pAllocator);
+		meshDrawInfo.indexBufferMemory = allocateDeviceMemoryForBuffer(_device, meshDrawInfo.indexBuffer, _physicalDevice, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _pAllocator);
+		vkBindBufferMemory(_device, meshDrawInfo.indexBuffer, meshDrawInfo.indexBufferMemory, 0);
+
+		// vertices then indices
+		meshDrawInfo.stagingBuffer = createBuffer(meshDrawInfo.totalByteCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, _queueFamilyIndex, _device, _pAllocator);
+		meshDrawInfo.stagingBufferMemory = allocateDeviceMemoryForBuffer(_device, meshDrawInfo.stagingBuffer, _physicalDevice, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, _pAllocator);
+		vkBindBufferMemory(_device, meshDrawInfo.stagingBuffer, meshDrawInfo.stagingBufferMemory, 0);
+
+		void* pStagingData = nullptr;
+		vkMapMemory(_device, meshDrawInfo.stagingBufferMemory, 0, meshDrawInfo.totalByteCount, 0, &pStagingData);
+		std::memcpy(pStagingData, meshData.getVertices().data(), meshDrawInfo.vertexByteCount);
+		std::memcpy((ui8*)pStagingData + meshDrawInfo.vertexByteCount, meshData.getIndices().data(), sizeof(ui32) * meshDrawInfo.indexCount);
+		vkUnmapMemory(_device, meshDrawInfo.stagingBufferMemory);
+	}
+
+	void RenderSystemBackendVk::destroyMeshDrawInfo(MeshDrawInfo& meshDrawInfo)
+	{
+		vkFreeMemory(_device, meshDrawInfo.vertexBufferMemory, _pAllocator);
+		vkDestroyBuffer(_device, meshDrawInfo.vertexBuffer, _pAllocator);
+		vkFreeMemory(_device, meshDrawInfo.indexBufferMemory, _pAllocator);
+		vkDestroyBuffer(_device, meshDrawInfo.indexBuffer, _pAllocator);
+		if (meshDrawInfo.stagingBuffer != VK_NULL_HANDLE)
+		{
+			vkFreeMemory(_device, meshDrawInfo.stagingBufferMemory, _pAllocator);
+			vkDestroyBuffer(_device, meshDrawInfo.stagingBuffer, _pAllocator);
+		}
 
-			VkShaderModule fragmentShaderModule;
+		meshDrawInfo = MeshDrawInfo{};
+	}
+
+	void RenderSystemBackendVk::evictMeshDrawInfos()
+	{
+		for (MeshDrawInfo& meshDrawInfo : _meshDrawInfos)
+		{
+			if (meshDrawInfo.vertexBuffer != VK_NULL_HANDLE && !MeshRegistry::getInstance().isValid(meshDrawInfo.mesh))
 			{
-				ui32 codeSize = 0;
-				ui32* pCode = nullptr;
-				readShader(entity.getMesh().getFragmentShaderName(), &codeSize, &pCode);
-				fragmentShaderModule = createShaderModule(codeSize, pCode, _device, _pAllocator);
+				destroyMeshDrawInfo(meshDrawInfo);
 			}
+		}
 
-			VkVertexInputBindingDescription vertexBindingDescription = {};
-			vertexBindingDescription.binding = 0;
-			vertexBindingDescription.stride = sizeof(Mesh::Vertex);
-			vertexBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-			VkVertexInputAttributeDescription positionAttributeDescription = {};
-			positionAttributeDescription.binding = 0;
-			positionAttributeDescription.format = VK_FORMAT_R32G32B32_SFLOAT;
-			positionAttributeDescription.location = 0;
-			positionAttributeDescription.offset = 0;
-
-			VkVertexInputAttributeDescription normalAttributeDescription = {};
-			normalAttributeDescription.binding = 0;
-			normalAttributeDescription.format = VK_FORMAT_R32G32B32_SFLOAT;
-			normalAttributeDescription.location = 1;
-			normalAttributeDescription.offset = offsetof(Mesh::Vertex, normal);
-
-			VkVertexInputAttributeDescription vertexAttributeDescriptions[] = {
-				positionAttributeDescription,
-				normalAttributeDescription
-			};
+		for (ui32 reloadingIndex = 0; reloadingIndex < _reloadingMeshDrawInfos.size(); )
+		{
+			if (!MeshRegistry::getInstance().isValid(_reloadingMeshDrawInfos[reloadingIndex].mesh))
+			{
+				destroyMeshDrawInfo(_reloadingMeshDrawInfos[reloadingIndex]);
+				_reloadingMeshDrawInfos.erase(_reloadingMeshDrawInfos.begin() + reloadingIndex);
+			}
+			else
+			{
+				++reloadingIndex;
+			}
+		}
+	}
 
-			VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {};
-			vertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-			vertexInputStateCreateInfo.pNext = nullptr;
-			vertexInputStateCreateInfo.flags = 0;
-			vertexInputStateCreateInfo.vertexBindingDescriptionCount = 1;
-			vertexInputStateCreateInfo.pVertexBindingDescriptions = &vertexBindingDescription;
-			vertexInputStateCreateInfo.vertexAttributeDescriptionCount = sizeof(vertexAttributeDescriptions) / sizeof(vertexAttributeDescriptions[0]);
-			vertexInputStateCreateInfo.pVertexAttributeDescriptions = vertexAttributeDescriptions;
-
-			entityDrawInfo.graphicsPipeline = createGraphicsPipeline(
-				vertexShaderModule, 
-				fragmentShaderModule, 
-				vertexInputStateCreateInfo, 
-				_swapchainFormat, 
-				VK_FORMAT_D32_SFLOAT, 
-				_renderArea.extent.width, 
-				_renderArea.extent.height, 
-				true, 
-				entityDrawInfo.graphicsPipelineLayout, 
-				_device, 
-				_pAllocator);
-
-			vkDestroyShaderModule(_device, vertexShaderModule, _pAllocator);
-			vkDestroyShaderModule(_device, fragmentShaderModule, _pAllocator);
-
-			entityDrawInfo.vertexBuffer = createBuffer(sizeof(Mesh::Vertex) * entity.getMesh().getVertices().size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, _queueFamilyIndex, _device, _pAllocator);
-			entityDrawInfo.vertexBufferMemory = allocateDeviceMemoryForBuffer(_device, entityDrawInfo.vertexBuffer, _physicalDevice, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, _pAllocator);
-			vkBindBufferMemory(_device, entityDrawInfo.vertexBuffer, entityDrawInfo.vertexBufferMemory, 0);
-
-			void* pVertexData = nullptr;
-			vkMapMemory(_device, entityDrawInfo.vertexBufferMemory, 0, sizeof(Mesh::Vertex) * entity.getMesh().getVertices().size(), 0, &pVertexData);
-			std::memcpy(pVertexData, entity.getMesh().getVertices().data(), sizeof(Mesh::Vertex) * entity.getMesh().getVertices().size());
-			vkUnmapMemory(_device, entityDrawInfo.vertexBufferMemory);
-			
-			entityDrawInfo.indexCount = entity.getMesh().getIndices().size();
-			entityDrawInfo.indexBuffer = createBuffer(sizeof(ui32) * entityDrawInfo.indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, _queueFamilyIndex, _device, _pAllocator);
-			entityDrawInfo.indexBufferMemory = allocateDeviceMemoryForBuffer(_device, entityDrawInfo.indexBuffer, _physicalDevice, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, _pAllocator);
-			vkBindBufferMemory(_device, entityDrawInfo.indexBuffer, entityDrawInfo.indexBufferMemory, 0);
-
-			void* pIndexData = nullptr;
-			vkMapMemory(_device, entityDrawInfo.indexBufferMemory, 0, sizeof(ui32) * entityDrawInfo.indexCount, 0, &pIndexData);
-			std::memcpy(pIndexData, entity.getMesh().getIndices().data(), sizeof(ui32) * entityDrawInfo.indexCount);
-			vkUnmapMemory(_device, entityDrawInfo.indexBufferMemory);
-
-			entityDrawInfo.uniformBuffer = createBuffer(sizeof(EntityUniformBuffer), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, _queueFamilyIndex, _device, _pAllocator);
-			entityDrawInfo.uniformBufferMemory = allocateDeviceMemoryForBuffer(_device, entityDrawInfo.uniformBuffer, _physicalDevice, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, _pAllocator);
-			vkBindBufferMemory(_device, entityDrawInfo.uniformBuffer, entityDrawInfo.uniformBufferMemory, 0);
-			
-			VkDescriptorBufferInfo entityUniformBufferInfo = {};
-			entityUniformBufferInfo.buffer = entityDrawInfo.uniformBuffer;
-			entityUniformBufferInfo.offset = 0;
-			entityUniformBufferInfo.range = VK_WHOLE_SIZE;
-
-			VkWriteDescriptorSet entityUniformBufferDescriptorWrite = {};
-			entityUniformBufferDescriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			entityUniformBufferDescriptorWrite.pNext = nullptr;
-			entityUniformBufferDescriptorWrite.dstSet = entityDrawInfo.entityDescriptorSet;
-			entityUniformBufferDescriptorWrite.dstBinding = 0;
-			entityUniformBufferDescriptorWrite.dstArrayElement = 0;
-			entityUniformBufferDescriptorWrite.descriptorCount = 1;
-			entityUniformBufferDescriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			entityUniformBufferDescriptorWrite.pImageInfo = nullptr;
-			entityUniformBufferDescriptorWrite.pBufferInfo = &entityUniformBufferInfo;
-
-			vkUpdateDescriptorSets(_device, 1, &entityUniformBufferDescriptorWrite, 0, nullptr);
-
-			EntityUniformBuffer entityUniformBuffer = {};
-			entityUniformBuffer.transformationMatrix = 
-				Matrix4<f32>::getTranslation(entity.position) * 
-				Matrix4<f32>::getRotation(entity.yaw, entity.pitch, entity.roll) * 
-				Matrix4<f32>::getScaling(entity.scaleX, entity.scaleY, entity.scaleZ);
-
-			entityUniformBuffer.transformationMatrix.transpose();
-
-			void* pEntityUniformData = nullptr;
-			vkMapMemory(_device, entityDrawInfo.uniformBufferMemory, 0, sizeof(EntityUniformBuffer), 0, &pEntityUniformData);
-			std::memcpy(pEntityUniformData, &entityUniformBuffer, sizeof(EntityUniformBuffer));
-			vkUnmapMemory(_device, entityDrawInfo.uniformBufferMemory);
-
-			_entityDrawInfos.push_back(entityDrawInfo);
+	void RenderSystemBackendVk::recordMeshUploads()
+	{
+		// reloaded revisions fully copied during a previous frame replace the current ones, no frame uses those anymore
+		for (ui32 reloadingIndex = 0; reloadingIndex < _reloadingMeshDrawInfos.size(); )
+		{
+			MeshDrawInfo& reloadingMeshDrawInfo = _reloadingMeshDrawInfos[reloadingIndex];
+			if (reloadingMeshDrawInfo.uploadedByteCount == reloadingMeshDrawInfo.totalByteCount)
+			{
+				destroyMeshDrawInfo(_meshDrawInfos[reloadingMeshDrawInfo.mesh.index]);
+				_meshDrawInfos[reloadingMeshDrawInfo.mesh.index] = reloadingMeshDrawInfo;
+				_reloadingMeshDrawInfos.erase(_reloadingMeshDrawInfos.begin() + reloadingIndex);
+			}
+			else
+			{
+				++reloadingIndex;
+			}
+		}
+
+		ui32 remainingBudget = MeshUploadBudget;
+		b8 copyRecorded = false;
+
+		for (MeshDrawInfo& meshDrawInfo : _meshDrawInfos)
+		{
+			copyRecorded = recordMeshUpload(meshDrawInfo, remainingBudget) || copyRecorded;
+		}
+
+		for (MeshDrawInfo& meshDrawInfo : _reloadingMeshDrawInfos)
+		{
+			copyRecorded = recordMeshUpload(meshDrawInfo, remainingBudget) || copyRecorded;
+		}
+
+		if (copyRecorded)
+		{
+			VkMemoryBarrier memoryBarrier = {};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.pNext = nullptr;
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+
+			vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
 		}
 	}
 
-	void RenderSystemBackendVk::destroyEntityDrawInfos()
+	b8 RenderSystemBackendVk::recordMeshUpload(MeshDrawInfo& meshDrawInfo, ui32& remainingBudget)
 	{
-		for(EntityDrawInfo& entityDrawInfo : _entityDrawInfos)
+		if (meshDrawInfo.stagingBuffer == VK_NULL_HANDLE)
+		{
+			return false;
+		}
+
+		// fully copied during a previous frame, which is done executing now
+		if (meshDrawInfo.uploadedByteCount == meshDrawInfo.totalByteCount)
+		{
+			vkFreeMemory(_device, meshDrawInfo.stagingBufferMemory, _pAllocator);
+			vkDestroyBuffer(_device, meshDrawInfo.stagingBuffer, _pAllocator);
+			meshDrawInfo.stagingBuffer = VK_NULL_HANDLE;
+			meshDrawInfo.stagingBufferMemory = VK_NULL_HANDLE;
+			return false;
+		}
+
+		if (remainingBudget == 0)
+		{
+			return false;
+		}
+
+		const ui32 begin = meshDrawInfo.uploadedByteCount;
+		const ui32 end = begin + std::min(remainingBudget, meshDrawInfo.totalByteCount - begin);
+
+		if (begin < meshDrawInfo.vertexByteCount)
 		{
-			vkDestroyDescriptorSetLayout(_device, entityDrawInfo.entityDescriptorSetLayout, _pAllocator);
-			vkFreeDescriptorSets(_device, _descriptorPool, 1, &entityDrawInfo.entityDescriptorSet);
-			vkDestroyPipelineLayout(_device, entityDrawInfo.graphicsPipelineLayout, _pAllocator);
-			vkDestroyPipeline(_device, entityDrawInfo.graphicsPipeline, _pAllocator);
-			vkFreeMemory(_device, entityDrawInfo.vertexBufferMemory, _pAllocator);
-			vkDestroyBuffer(_device, entityDrawInfo.vertexBuffer, _pAllocator);
-			vkFreeMemory(_device, entityDrawInfo.indexBufferMemory, _pAllocator);
-			vkDestroyBuffer(_device, entityDrawInfo.indexBuffer, _pAllocator);
-			vkFreeMemory(_device, entityDrawInfo.uniformBufferMemory, _pAllocator);
-			vkDestroyBuffer(_device, entityDrawInfo.uniformBuffer, _pAllocator);
+			VkBufferCopy bufferCopy = {};
+			bufferCopy.srcOffset = begin;
+			bufferCopy.dstOffset = begin;
+			bufferCopy.size = std::min(end, meshDrawInfo.vertexByteCount) - begin;
+			vkCmdCopyBuffer(_commandBuffer, meshDrawInfo.stagingBuffer, meshDrawInfo.vertexBuffer, 1, &bufferCopy);
 		}
 
-		_entityDrawInfos.clear();
+		if (end > meshDrawInfo.vertexByteCount)
+		{
+			const ui32 indexBegin = std::max(begin, meshDrawInfo.vertexByteCount);
+
+			VkBufferCopy bufferCopy = {};
+			bufferCopy.srcOffset = indexBegin;
+			bufferCopy.dstOffset = indexBegin - meshDrawInfo.vertexByteCount;
+			bufferCopy.size = end - indexBegin;
+			vkCmdCopyBuffer(_commandBuffer, meshDrawInfo.stagingBuffer, meshDrawInfo.indexBuffer, 1, &bufferCopy);
+		}
+
+		meshDrawInfo.uploadedByteCount = end;
+		remainingBudget -= end - begin;
+
+		return true;
+	}
+
+	void RenderSystemBackendVk::reloadChangedPipelines()
+	{
+		for (const std::string& shaderName : AssetSystem::getInstance().getChangedShaderNames())
+		{
+			for (PipelineInfo& pipelineInfo : _pipelineInfos)
+			{
+				if (pipelineInfo.vertexShaderName == shaderName || pipelineInfo.fragmentShaderName == shaderName)
+				{
+					vkDestroyPipeline(_device, pipelineInfo.graphicsPipeline, _pAllocator);
+					pipelineInfo.graphicsPipeline = createPipeline(pipelineInfo.vertexShaderName, pipelineInfo.fragmentShaderName);
+				}
+			}
+		}
+	}
+
+	b8 RenderSystemBackendVk::isMeshResident(MeshHandle mesh) const
+	{
+		if (mesh.index >= _meshDrawInfos.size())
+		{
+			return false;
+		}
+
+		const MeshDrawInfo& meshDrawInfo = _meshDrawInfos[mesh.index];
+		return meshDrawInfo.vertexBuffer != VK_NULL_HANDLE && meshDrawInfo.mesh == mesh && meshDrawInfo.uploadedByteCount == meshDrawInfo.totalByteCount;
+	}
+
+	b8 RenderSystemBackendVk::getResidency(MeshHandle mesh, ui32& indexCount, b8& isCurrentRevision) const
+	{
+		if (!isMeshResident(mesh))
+		{
+			return false;
+		}
+
+		// a hot reloaded revision still streaming leaves the previous one in the draw info
+		const MeshDrawInfo& meshDrawInfo = _meshDrawInfos[mesh.index];
+		indexCount = meshDrawInfo.indexCount;
+		isCurrentRevision = meshDrawInfo.revision == MeshRegistry::getInstance().getRevision(mesh);
+		return true;
+	}
+
+	ui32 RenderSystemBackendVk::getPipelineIndex(const std::string& vertexShaderName, const std::string& fragmentShaderName)
+	{
+		// pipelines only depend on the shaders, meshes using the same ones share them
+		for (ui32 pipelineIndex = 0; pipelineIndex < _pipelineInfos.size(); ++pipelineIndex)
+		{
+			if (_pipelineInfos[pipelineIndex].vertexShaderName == vertexShaderName && _pipelineInfos[pipelineIndex].fragmentShaderName == fragmentShaderName)
+			{
+				return pipelineIndex;
+			}
+		}
+
+		PipelineInfo pipelineInfo = {};
+		pipelineInfo.vertexShaderName = vertexShaderName;
+		pipelineInfo.fragmentShaderName = fragmentShaderName;
+		pipelineInfo.graphicsPipeline = createPipeline(vertexShaderName, fragmentShaderName);
+		_pipelineInfos.push_back(pipelineInfo);
+
+		return (ui32)_pipelineInfos.size() - 1;
+	}
+
+	VkPipeline RenderSystemBackendVk::createPipeline(const std::string& vertexShaderName, const std::string& fragmentShaderName)
+	{
+		VkShaderModule vertexShaderModule;
+		{
+			ui32 codeSize = 0;
+			ui32* pCode = nullptr;
+			readShader(vertexShaderName, &codeSize, &pCode);
+			vertexShaderModule = createShaderModule(codeSize, pCode, _device, _pAllocator);
+		}
+
+		VkShaderModule fragmentShaderModule;
+		{
+			ui32 codeSize = 0;
+			ui32* pCode = nullptr;
+			readShader(fragmentShaderName, &codeSize, &pCode);
+			fragmentShaderModule = createShaderModule(codeSize, pCode, _device, _pAllocator);
+		}
+
+		VkVertexInputBindingDescription vertexBindingDescription = {};
+		vertexBindingDescription.binding = 0;
+		vertexBindingDescription.stride = sizeof(Mesh::Vertex);
+		vertexBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		VkVertexInputAttributeDescription positionAttributeDescription = {};
+		positionAttributeDescription.binding = 0;
+		positionAttributeDescription.format = VK_FORMAT_R32G32B32_SFLOAT;
+		positionAttributeDescription.location = 0;
+		positionAttributeDescription.offset = 0;
+
+		VkVertexInputAttributeDescription normalAttributeDescription = {};
+		normalAttributeDescription.binding = 0;
+		normalAttributeDescription.format = VK_FORMAT_R32G32B32_SFLOAT;
+		normalAttributeDescription.location = 1;
+		normalAttributeDescription.offset = offsetof(Mesh::Vertex, normal);
+
+		VkVertexInputAttributeDescription vertexAttributeDescriptions[] = {
+			positionAttributeDescription,
+			normalAttributeDescription
+		};
+
+		VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {};
+		vertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		vertexInputStateCreateInfo.pNext = nullptr;
+		vertexInputStateCreateInfo.flags = 0;
+		vertexInputStateCreateInfo.vertexBindingDescriptionCount = 1;
+		vertexInputStateCreateInfo.pVertexBindingDescriptions = &vertexBindingDescription;
+		vertexInputStateCreateInfo.vertexAttributeDescriptionCount = sizeof(vertexAttributeDescriptions) / sizeof(vertexAttributeDescriptions[0]);
+		vertexInputStateCreateInfo.pVertexAttributeDescriptions = vertexAttributeDescriptions;
+
+		VkPipeline graphicsPipeline = createGraphicsPipeline(
+			vertexShaderModule, 
+			fragmentShaderModule, 
+			vertexInputStateCreateInfo, 
+			_swapchainFormat, 
+			VK_FORMAT_D32_SFLOAT, 
+			_renderArea.extent.width, 
+			_renderArea.extent.height, 
+			true, 
+			_graphicsPipelineLayout, 
+			_device, 
+			_pAllocator);
+
+		vkDestroyShaderModule(_device, vertexShaderModule, _pAllocator);
+		vkDestroyShaderModule(_device, fragmentShaderModule, _pAllocator);
+
+		return graphicsPipeline;
 	}
 
 	void RenderSystemBackendVk::destroyFrameObjects()
 	{
-		destroyEntityDrawInfos();
+		destroyTransformBuffers();
+		vkFreeDescriptorSets(_device, _descriptorPool, 1, &_transformDescriptorSet);
+
+		for (MeshDrawInfo& meshDrawInfo : _meshDrawInfos)
+		{
+			if (meshDrawInfo.vertexBuffer != VK_NULL_HANDLE)
+			{
+				destroyMeshDrawInfo(meshDrawInfo);
+			}
+		}
+		_meshDrawInfos.clear();
+
+		for (MeshDrawInfo& meshDrawInfo : _reloadingMeshDrawInfos)
+		{
+			destroyMeshDrawInfo(meshDrawInfo);
+		}
+		_reloadingMeshDrawInfos.clear();
+
+		for (PipelineInfo& pipelineInfo : _pipelineInfos)
+		{
+			vkDestroyPipeline(_device, pipelineInfo.graphicsPipeline, _pAllocator);
+		}
+		_pipelineInfos.clear();
+
+		vkDestroyPipelineLayout(_device, _graphicsPipelineLayout, _pAllocator);
+		vkDestroyDescriptorSetLayout(_device, _entityDescriptorSetLayout, _pAllocator);
 
 		vkFreeMemory(_device, _globalUniformBufferMemory, _pAllocator);
 		vkDestroyBuffer(_device, _globalUniformBuffer, _pAllocator);
@@ -1303,4 +1672,6 @@ namespace Visor
 
 		fclose(pFile);
 	}
-}
\ No newline at end of file
+}
+
+#endif
@@ -2,8 +2,11 @@
 
 #include "types.h"
 #include "camera.h"
-#include "entity.h"
+#include "draw_list.h"
+#include "frame_packet.h"
 #include "maths.h"
+#include "meshlet.h"
+#include "mesh_registry.h"
 
 #include "volk.h"
 
@@ -15,26 +18,40 @@ namespace Visor
 	class RenderSystemBackendVk
 	{
 	public:
-		void render(const Camera& camera, const std::vector<Entity>& entities);
+		// only the entities of the draw list are drawn
+		void render(const FramePacket& packet);
+		const MeshletCullingStatistics& getMeshletCullingStatistics() const;
 
 		static void start();
 		static void terminate();
 		static RenderSystemBackendVk& getInstance();
 
 	private:
-		struct EntityDrawInfo
+		struct PipelineInfo
 		{
-			VkDescriptorSetLayout entityDescriptorSetLayout;
-			VkDescriptorSet entityDescriptorSet;
-			VkPipelineLayout graphicsPipelineLayout;
+			std::string vertexShaderName;
+			std::string fragmentShaderName;
 			VkPipeline graphicsPipeline;
+		};
+
+		// geometry, shared by every entity using the same mesh
+		struct MeshDrawInfo
+		{
+			MeshHandle mesh;
+			ui32 revision;
+			ui32 pipelineIndex;
 			VkBuffer vertexBuffer;
 			VkDeviceMemory vertexBufferMemory;
+			ui32 vertexByteCount;
 			ui32 indexCount;
 			VkBuffer indexBuffer;
 			VkDeviceMemory indexBufferMemory;
-			VkBuffer uniformBuffer;
-			VkDeviceMemory uniformBufferMemory;
+
+			// geometry is streamed from the staging buffer to the device local buffers over as many frames as needed
+			VkBuffer stagingBuffer;
+			VkDeviceMemory stagingBufferMemory;
+			ui32 uploadedByteCount;
+			ui32 totalByteCount;
 		};
 
 		struct GlobalUniformBuffer
@@ -42,9 +59,10 @@ namespace Visor
 			Matrix4<f32> viewProjectionMatrix;
 		};
 
+		// the last row of the matrices is implicit, the shader reads the three rows as the columns of a mat3x4
 		struct EntityUniformBuffer
 		{
-			Matrix4<f32> transformationMatrix;
+			Matrix3x4<f32> transformationMatrix;
 		};
 
 	private:
@@ -52,9 +70,21 @@ namespace Visor
 		~RenderSystemBackendVk();
 
 		void updateGlobalUniformBuffer(const Camera& camera);
-		void updateEntityDrawInfos(const std::vector<Entity>& entities);
-		void createEntityDrawInfos(const std::vector<Entity>& entities);
-		void destroyEntityDrawInfos();
+		void updateEntityDrawInfos(const FramePacket& packet);
+		void recordTransformUploads(const FramePacket& packet);
+		void createTransformBuffers(ui32 capacity);
+		void destroyTransformBuffers();
+		void prepareMeshDrawInfo(MeshHandle mesh);
+		void createMeshDrawInfo(MeshHandle mesh, MeshDrawInfo& meshDrawInfo);
+		void destroyMeshDrawInfo(MeshDrawInfo& meshDrawInfo);
+		void evictMeshDrawInfos();
+		void recordMeshUploads();
+		b8 recordMeshUpload(MeshDrawInfo& meshDrawInfo, ui32& remainingBudget);
+		void reloadChangedPipelines();
+		b8 isMeshResident(MeshHandle mesh) const;
+		b8 getResidency(MeshHandle mesh, ui32& indexCount, b8& isCurrentRevision) const;
+		ui32 getPipelineIndex(const std::string& vertexShaderName, const std::string& fragmentShaderName);
+		VkPipeline createPipeline(const std::string& vertexShaderName, const std::string& fragmentShaderName);
 		void destroyFrameObjects();
 
 		static VkInstance createInstance(
@@ -173,6 +203,24 @@ namespace Visor
 		VkDescriptorSetLayout _globalDescriptorSetLayout;
 		VkBuffer _globalUniformBuffer;
 		VkDeviceMemory _globalUniformBufferMemory;
-		std::vector<EntityDrawInfo> _entityDrawInfos;
+		VkDescriptorSetLayout _entityDescriptorSetLayout;
+		VkPipelineLayout _graphicsPipelineLayout;
+		std::vector<PipelineInfo> _pipelineInfos;
+		std::vector<MeshDrawInfo> _meshDrawInfos; // indexed by mesh handle index
+		std::vector<MeshDrawInfo> _reloadingMeshDrawInfos; // new revisions of hot reloaded meshes, still streaming
+		// mesh draw infos are indexed like the mesh handles of the draws
+		DrawList _drawList;
+
+		// entity transforms live in one device local buffer, each entity reads its slot through a dynamic offset.
+		// slots past the entities hold the placeholder transforms of the current frame
+		VkDescriptorSet _transformDescriptorSet;
+		VkBuffer _transformBuffer;
+		VkDeviceMemory _transformBufferMemory;
+		VkBuffer _transformStagingBuffer;
+		VkDeviceMemory _transformStagingBufferMemory;
+		void* _pTransformStagingData;
+		ui32 _transformStride;
+		ui32 _transformCapacity;
+		Matrix4<f32> _viewProjectionMatrix;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "simulation_clock.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace Visor
+{
+	SimulationClock::SimulationClock(f64 stepDuration, ui32 maximumStepCount)
+		: _stepDuration(stepDuration)
+		, _maximumStepCount(std::max(maximumStepCount, 1u))
+		, _accumulatedSeconds(0.0)
+		, _stepCount(0)
+	{
+		assert(stepDuration > 0.0);
+	}
+
+	ui32 SimulationClock::advance(f64 elapsedSeconds)
+	{
+		// a clock going backward (or a NaN) adds nothing
+		_accumulatedSeconds += elapsedSeconds > 0.0 ? elapsedSeconds : 0.0;
+
+		ui32 stepCount = 0;
+		while (_accumulatedSeconds >= _stepDuration && stepCount < _maximumStepCount)
+		{
+			_accumulatedSeconds -= _stepDuration;
+			stepCount += 1;
+		}
+
+		// behind by more than the steps allowed, the whole steps left are never simulated
+		if (_accumulatedSeconds >= _stepDuration)
+		{
+			_accumulatedSeconds = std::fmod(_accumulatedSeconds, _stepDuration);
+		}
+
+		_stepCount += stepCount;
+		return stepCount;
+	}
+
+	f64 SimulationClock::getStepDuration() const
+	{
+		return _stepDuration;
+	}
+
+	ui64 SimulationClock::getStepCount() const
+	{
+		return _stepCount;
+	}
+
+	f32 SimulationClock::getInterpolationFactor() const
+	{
+		return (f32)(_accumulatedSeconds / _stepDuration);
+	}
+}
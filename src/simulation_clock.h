@@ -0,0 +1,34 @@
+#pragma once
+
+#include "types.h"
+
+namespace Visor
+{
+	/*
+	fixed step simulation driven by the real time : the time elapsed between frames is accumulated and consumed in steps
+	of a constant duration, so the simulation advances the same whatever the frame rate, and replays exactly given the
+	same inputs at every step. the time left in the accumulator tells how far the frame is between the last two steps.
+	when the steps cost more than the time they simulate, at most maximumStepCount run per frame and the time left over
+	is dropped : the simulation slows down instead of falling further and further behind
+	*/
+	class SimulationClock
+	{
+	public:
+		SimulationClock(f64 stepDuration, ui32 maximumStepCount);
+
+		// adds the real time elapsed since the previous frame, returns the number of steps to run for this frame
+		ui32 advance(f64 elapsedSeconds);
+
+		f64 getStepDuration() const;
+		// steps run since the clock started
+		ui64 getStepCount() const;
+		// from 0 (the frame is at the last step) to 1 excluded (the next step is almost due), to interpolate what is drawn
+		f32 getInterpolationFactor() const;
+
+	private:
+		f64 _stepDuration;
+		ui32 _maximumStepCount;
+		f64 _accumulatedSeconds;
+		ui64 _stepCount;
+	};
+}
@@ -0,0 +1,145 @@
+#include "transform_history.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Visor
+{
+	void TransformHistory::capture(EntityStore& entities)
+	{
+		// the store still holds interpolated transforms, the step just run started from them
+		assert(_movedIndices.empty());
+
+		// entities restored since the previous step are among them, they compare equal in apply
+		entities.takeMovedIndices(_steppedIndices);
+
+		const ui32 entityCount = entities.getEntityCount();
+		const ui32 previousEntityCount = (ui32)_currentIds.size();
+		const ui32 steppedCount = (ui32)_steppedIndices.size();
+		resize(_currentTransforms, entityCount);
+		_currentIds.resize(entityCount);
+		resize(_previousTransforms, steppedCount);
+		_previousIds.resize(steppedCount);
+
+		const EntityTransforms& transforms = entities.getTransforms();
+		for (ui32 steppedIndex = 0; steppedIndex < steppedCount; ++steppedIndex)
+		{
+			const ui32 entityIndex = _steppedIndices[steppedIndex];
+
+			// an index past the previous step has no transform before this one, it is shown where it was simulated
+			if (entityIndex < previousEntityCount)
+			{
+				copy(_currentTransforms, entityIndex, _previousTransforms, steppedIndex);
+				_previousIds[steppedIndex] = _currentIds[entityIndex];
+			}
+			else
+			{
+				copy(transforms, entityIndex, _previousTransforms, steppedIndex);
+				_previousIds[steppedIndex] = entities.getId(entityIndex);
+			}
+
+			copy(transforms, entityIndex, _currentTransforms, entityIndex);
+			_currentIds[entityIndex] = entities.getId(entityIndex);
+		}
+	}
+
+	void TransformHistory::apply(EntityStore& entities, f32 factor)
+	{
+		assert(_movedIndices.empty());
+
+		const EntityTransforms& previous = _previousTransforms;
+		const EntityTransforms& current = _currentTransforms;
+
+		// sized for every stepped entity, setTransforms only reads as many as there are moved indices
+		resize(_movedTransforms, (ui32)_steppedIndices.size());
+
+		const ui32 entityCount = std::min((ui32)_currentIds.size(), entities.getEntityCount());
+		for (ui32 steppedIndex = 0; steppedIndex < _steppedIndices.size(); ++steppedIndex)
+		{
+			const ui32 entityIndex = _steppedIndices[steppedIndex];
+			if (entityIndex >= entityCount || _previousIds[steppedIndex] != _currentIds[entityIndex] || entities.getId(entityIndex) != _currentIds[entityIndex])
+			{
+				continue;
+			}
+
+			if (previous.positionsX[steppedIndex] == current.positionsX[entityIndex] &&
+				previous.positionsY[steppedIndex] == current.positionsY[entityIndex] &&
+				previous.positionsZ[steppedIndex] == current.positionsZ[entityIndex] &&
+				previous.orientationsX[steppedIndex] == current.orientationsX[entityIndex] &&
+				previous.orientationsY[steppedIndex] == current.orientationsY[entityIndex] &&
+				previous.orientationsZ[steppedIndex] == current.orientationsZ[entityIndex] &&
+				previous.orientationsW[steppedIndex] == current.orientationsW[entityIndex] &&
+				previous.scalesX[steppedIndex] == current.scalesX[entityIndex] &&
+				previous.scalesY[steppedIndex] == current.scalesY[entityIndex] &&
+				previous.scalesZ[steppedIndex] == current.scalesZ[entityIndex])
+			{
+				continue;
+			}
+
+			const ui32 movedIndex = (ui32)_movedIndices.size();
+			_movedIndices.push_back(entityIndex);
+
+			_movedTransforms.positionsX[movedIndex] = previous.positionsX[steppedIndex] + (current.positionsX[entityIndex] - previous.positionsX[steppedIndex]) * factor;
+			_movedTransforms.positionsY[movedIndex] = previous.positionsY[steppedIndex] + (current.positionsY[entityIndex] - previous.positionsY[steppedIndex]) * factor;
+			_movedTransforms.positionsZ[movedIndex] = previous.positionsZ[steppedIndex] + (current.positionsZ[entityIndex] - previous.positionsZ[steppedIndex]) * factor;
+
+			const Quaternion<f32> previousOrientation = {
+				previous.orientationsX[steppedIndex], previous.orientationsY[steppedIndex], previous.orientationsZ[steppedIndex], previous.orientationsW[steppedIndex]};
+			const Quaternion<f32> currentOrientation = {
+				current.orientationsX[entityIndex], current.orientationsY[entityIndex], current.orientationsZ[entityIndex], current.orientationsW[entityIndex]};
+			const Quaternion<f32> orientation = Quaternion<f32>::nlerp(previousOrientation, currentOrientation, factor);
+			_movedTransforms.orientationsX[movedIndex] = orientation.x;
+			_movedTransforms.orientationsY[movedIndex] = orientation.y;
+			_movedTransforms.orientationsZ[movedIndex] = orientation.z;
+			_movedTransforms.orientationsW[movedIndex] = orientation.w;
+
+			_movedTransforms.scalesX[movedIndex] = previous.scalesX[steppedIndex] + (current.scalesX[entityIndex] - previous.scalesX[steppedIndex]) * factor;
+			_movedTransforms.scalesY[movedIndex] = previous.scalesY[steppedIndex] + (current.scalesY[entityIndex] - previous.scalesY[steppedIndex]) * factor;
+			_movedTransforms.scalesZ[movedIndex] = previous.scalesZ[steppedIndex] + (current.scalesZ[entityIndex] - previous.scalesZ[steppedIndex]) * factor;
+		}
+
+		entities.setTransforms(_movedIndices, _movedTransforms);
+	}
+
+	void TransformHistory::restore(EntityStore& entities)
+	{
+		for (ui32 movedIndex = 0; movedIndex < _movedIndices.size(); ++movedIndex)
+		{
+			const ui32 entityIndex = _movedIndices[movedIndex];
+			assert(entities.getId(entityIndex) == _currentIds[entityIndex]);
+
+			copy(_currentTransforms, entityIndex, _movedTransforms, movedIndex);
+		}
+
+		entities.setTransforms(_movedIndices, _movedTransforms);
+		_movedIndices.clear();
+	}
+
+	void TransformHistory::resize(EntityTransforms& transforms, ui32 count)
+	{
+		transforms.positionsX.resize(count);
+		transforms.positionsY.resize(count);
+		transforms.positionsZ.resize(count);
+		transforms.orientationsX.resize(count);
+		transforms.orientationsY.resize(count);
+		transforms.orientationsZ.resize(count);
+		transforms.orientationsW.resize(count);
+		transforms.scalesX.resize(count);
+		transforms.scalesY.resize(count);
+		transforms.scalesZ.resize(count);
+	}
+
+	void TransformHistory::copy(const EntityTransforms& source, ui32 sourceIndex, EntityTransforms& destination, ui32 destinationIndex)
+	{
+		destination.positionsX[destinationIndex] = source.positionsX[sourceIndex];
+		destination.positionsY[destinationIndex] = source.positionsY[sourceIndex];
+		destination.positionsZ[destinationIndex] = source.positionsZ[sourceIndex];
+		destination.orientationsX[destinationIndex] = source.orientationsX[sourceIndex];
+		destination.orientationsY[destinationIndex] = source.orientationsY[sourceIndex];
+		destination.orientationsZ[destinationIndex] = source.orientationsZ[sourceIndex];
+		destination.orientationsW[destinationIndex] = source.orientationsW[sourceIndex];
+		destination.scalesX[destinationIndex] = source.scalesX[sourceIndex];
+		destination.scalesY[destinationIndex] = source.scalesY[sourceIndex];
+		destination.scalesZ[destinationIndex] = source.scalesZ[sourceIndex];
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "types.h"
+#include "entity.h"
+
+#include <vector>
+
+namespace Visor
+{
+	/*
+	local transforms of the entities after the last two simulation steps, so a frame drawn between two steps shows the
+	entities where they are at that time : positions and scales are interpolated linearly, orientations with nlerp.
+	apply writes the interpolated transforms into the store before rendering, restore puts the simulated ones back
+	before the next step. only the entities which moved between the two steps are written.
+	the entities written by a step come from the moved indices of the store, the transforms of the others are not copied
+	nor compared : the history owns the moved indices of the store.
+	an entity created or destroyed in between (its dense index holding another id) is shown where it was simulated
+	*/
+	class TransformHistory
+	{
+	public:
+		// after every simulation step
+		void capture(EntityStore& entities);
+		// factor from 0 (the previous step) to 1 (the last one)
+		void apply(EntityStore& entities, f32 factor);
+		void restore(EntityStore& entities);
+
+	private:
+		static void resize(EntityTransforms& transforms, ui32 count);
+		static void copy(const EntityTransforms& source, ui32 sourceIndex, EntityTransforms& destination, ui32 destinationIndex);
+
+	private:
+		// the transforms and ids of the store after the last step, by dense index
+		EntityTransforms _currentTransforms;
+		std::vector<EntityId> _currentIds;
+		// dense indices written by the last step, then their transforms and ids before it in the same order
+		std::vector<ui32> _steppedIndices;
+		EntityTransforms _previousTransforms;
+		std::vector<EntityId> _previousIds;
+
+		// dense indices written by apply, then their interpolated or simulated transforms in the same order
+		std::vector<ui32> _movedIndices;
+		EntityTransforms _movedTransforms;
+	};
+}
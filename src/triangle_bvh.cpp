@@ -0,0 +1,533 @@
+#include "triangle_bvh.h"
+#include "mesh.h"
+#include "job_system.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace Visor
+{
+	static const ui32 BinCount = 12;
+	// cost of visiting a node relative to the cost of intersecting a triangle
+	static const f32 TraversalCost = 1.0f;
+	static const ui32 MaxLeafTriangleCount = 16;
+	// subtrees with more triangles than this are built by their own jobs
+	static const ui32 ParallelTriangleCount = 16384;
+	// deeper nodes are split at their median triangle instead, which halves them : triangles of very different sizes
+	// can chain surface area splits one triangle at a time, the median bounds the depth to 32 + 28 levels for 2^32 triangles
+	static const ui32 MaxSahDepth = 32;
+	// a traversal holds at most one node per level of the tree plus one
+	static const ui32 MaxStackSize = 64;
+
+	// bounds of a triangle during the build, partitioned in place along with the triangles so every node reads a contiguous range
+	struct BuildTriangle
+	{
+	public:
+		Vector3<f32> minimum;
+		ui32 triangleIndex;
+		Vector3<f32> maximum;
+	};
+
+	// shared by the jobs of a build, every node is written by a single job
+	struct BuildContext
+	{
+	public:
+		std::vector<BuildTriangle> triangles;
+		std::vector<TriangleBVH::Node>* pNodes;
+		std::atomic<ui32> nodeCount;
+		std::atomic<ui32> depth;
+	};
+
+	struct Bin
+	{
+	public:
+		Vector3<f32> minimum;
+		Vector3<f32> maximum;
+		ui32 triangleCount;
+	};
+
+	static Vector3<f32> getMinimum(const Vector3<f32>& a, const Vector3<f32>& b)
+	{
+		return Vector3<f32>{std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z)};
+	}
+
+	static Vector3<f32> getMaximum(const Vector3<f32>& a, const Vector3<f32>& b)
+	{
+		return Vector3<f32>{std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z)};
+	}
+
+	// the switch of Vector3::operator[] is too slow for the inner loops
+	static f32 getComponent(const Vector3<f32>& vector, ui32 axis)
+	{
+		return axis == 0 ? vector.x : (axis == 1 ? vector.y : vector.z);
+	}
+
+	// doubled, only compared to other doubled centers
+	static f32 getCenter(const BuildTriangle& triangle, ui32 axis)
+	{
+		return getComponent(triangle.minimum, axis) + getComponent(triangle.maximum, axis);
+	}
+
+	static f32 getHalfSurfaceArea(const Vector3<f32>& minimum, const Vector3<f32>& maximum)
+	{
+		const Vector3<f32> size = maximum - minimum;
+		return size.x * size.y + size.y * size.z + size.z * size.x;
+	}
+
+	static void setBounds(const BuildContext& context, TriangleBVH::Node& node)
+	{
+		Vector3<f32> minimum = {std::numeric_limits<f32>::max(), std::numeric_limits<f32>::max(), std::numeric_limits<f32>::max()};
+		Vector3<f32> maximum = minimum * -1.0f;
+		for (ui32 index = node.firstIndex; index < node.firstIndex + node.triangleCount; ++index)
+		{
+			minimum = getMinimum(minimum, context.triangles[index].minimum);
+			maximum = getMaximum(maximum, context.triangles[index].maximum);
+		}
+
+		node.minimum = minimum;
+		node.maximum = maximum;
+	}
+
+	// best split of the node over the bins of each axis, false if keeping it a leaf is cheaper
+	static b8 findSplit(const BuildContext& context, const TriangleBVH::Node& node, ui32& splitAxis, f32& splitPosition)
+	{
+		const BuildTriangle* pBegin = context.triangles.data() + node.firstIndex;
+		const BuildTriangle* pEnd = pBegin + node.triangleCount;
+
+		Vector3<f32> centerMinimum = {std::numeric_limits<f32>::max(), std::numeric_limits<f32>::max(), std::numeric_limits<f32>::max()};
+		Vector3<f32> centerMaximum = centerMinimum * -1.0f;
+		for (const BuildTriangle* pTriangle = pBegin; pTriangle != pEnd; ++pTriangle)
+		{
+			const Vector3<f32> center = pTriangle->minimum + pTriangle->maximum;
+			centerMinimum = getMinimum(centerMinimum, center);
+			centerMaximum = getMaximum(centerMaximum, center);
+		}
+
+		// cost of intersecting every triangle of the node, splits must do better than it, counting the visit of the children.
+		// big nodes are split anyway so leaves stay short
+		const f32 nodeArea = getHalfSurfaceArea(node.minimum, node.maximum);
+		f32 bestCost = node.triangleCount > MaxLeafTriangleCount ? std::numeric_limits<f32>::max() : (node.triangleCount - TraversalCost) * nodeArea;
+		b8 found = false;
+
+		for (ui32 axis = 0; axis < 3; ++axis)
+		{
+			const f32 axisMinimum = getComponent(centerMinimum, axis);
+			const f32 axisMaximum = getComponent(centerMaximum, axis);
+			if (axisMaximum <= axisMinimum)
+			{
+				continue;
+			}
+
+			Bin bins[BinCount];
+			for (Bin& bin : bins)
+			{
+				bin.minimum = Vector3<f32>{std::numeric_limits<f32>::max(), std::numeric_limits<f32>::max(), std::numeric_limits<f32>::max()};
+				bin.maximum = bin.minimum * -1.0f;
+				bin.triangleCount = 0;
+			}
+
+			const f32 scale = BinCount / (axisMaximum - axisMinimum);
+			for (const BuildTriangle* pTriangle = pBegin; pTriangle != pEnd; ++pTriangle)
+			{
+				Bin& bin = bins[std::min(BinCount - 1, (ui32)((getCenter(*pTriangle, axis) - axisMinimum) * scale))];
+				bin.minimum = getMinimum(bin.minimum, pTriangle->minimum);
+				bin.maximum = getMaximum(bin.maximum, pTriangle->maximum);
+				bin.triangleCount += 1;
+			}
+
+			// areas and counts on the left of each plane between bins, then on the right while sweeping back
+			f32 leftAreas[BinCount - 1];
+			ui32 leftCounts[BinCount - 1];
+			Vector3<f32> leftMinimum = bins[0].minimum;
+			Vector3<f32> leftMaximum = bins[0].maximum;
+			ui32 leftCount = 0;
+			for (ui32 planeIndex = 0; planeIndex < BinCount - 1; ++planeIndex)
+			{
+				leftMinimum = getMinimum(leftMinimum, bins[planeIndex].minimum);
+				leftMaximum = getMaximum(leftMaximum, bins[planeIndex].maximum);
+				leftCount += bins[planeIndex].triangleCount;
+				leftAreas[planeIndex] = leftCount > 0 ? getHalfSurfaceArea(leftMinimum, leftMaximum) : 0.0f;
+				leftCounts[planeIndex] = leftCount;
+			}
+
+			Vector3<f32> rightMinimum = bins[BinCount - 1].minimum;
+			Vector3<f32> rightMaximum = bins[BinCount - 1].maximum;
+			ui32 rightCount = 0;
+			for (ui32 planeIndex = BinCount - 1; planeIndex > 0; --planeIndex)
+			{
+				rightMinimum = getMinimum(rightMinimum, bins[planeIndex].minimum);
+				rightMaximum = getMaximum(rightMaximum, bins[planeIndex].maximum);
+				rightCount += bins[planeIndex].triangleCount;
+				if (leftCounts[planeIndex - 1] == 0 || rightCount == 0)
+				{
+					continue;
+				}
+
+				const f32 cost = leftCounts[planeIndex - 1] * leftAreas[planeIndex - 1] + rightCount * getHalfSurfaceArea(rightMinimum, rightMaximum);
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					splitAxis = axis;
+					splitPosition = axisMinimum + planeIndex / scale;
+					found = true;
+				}
+			}
+		}
+
+		return found;
+	}
+
+	static ui32 getLongestAxis(const TriangleBVH::Node& node)
+	{
+		const Vector3<f32> size = node.maximum - node.minimum;
+		return size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+	}
+
+	static void subdivide(BuildContext& context, ui32 nodeIndex, ui32 depth)
+	{
+		TriangleBVH::Node& node = (*context.pNodes)[nodeIndex];
+
+		ui32 treeDepth = context.depth.load();
+		while (depth > treeDepth && !context.depth.compare_exchange_weak(treeDepth, depth))
+		{
+		}
+
+		BuildTriangle* pBegin = context.triangles.data() + node.firstIndex;
+		BuildTriangle* pEnd = pBegin + node.triangleCount;
+		BuildTriangle* pMiddle = nullptr;
+		if (depth < MaxSahDepth)
+		{
+			ui32 splitAxis = 0;
+			f32 splitPosition = 0.0f;
+			if (node.triangleCount <= 1 || !findSplit(context, node, splitAxis, splitPosition))
+			{
+				return;
+			}
+
+			pMiddle = std::partition(pBegin, pEnd, [splitAxis, splitPosition](const BuildTriangle& triangle)
+			{
+				return getCenter(triangle, splitAxis) < splitPosition;
+			});
+		}
+		else
+		{
+			if (node.triangleCount <= MaxLeafTriangleCount)
+			{
+				return;
+			}
+
+			const ui32 splitAxis = getLongestAxis(node);
+			pMiddle = pBegin + node.triangleCount / 2;
+			std::nth_element(pBegin, pMiddle, pEnd, [splitAxis](const BuildTriangle& a, const BuildTriangle& b)
+			{
+				return getCenter(a, splitAxis) < getCenter(b, splitAxis);
+			});
+		}
+
+		// float rounding may put every triangle on one side
+		const ui32 leftCount = (ui32)(pMiddle - pBegin);
+		if (leftCount == 0 || leftCount == node.triangleCount)
+		{
+			return;
+		}
+
+		const ui32 leftIndex = context.nodeCount.fetch_add(2);
+		TriangleBVH::Node& left = (*context.pNodes)[leftIndex];
+		TriangleBVH::Node& right = (*context.pNodes)[leftIndex + 1];
+		left.firstIndex = node.firstIndex;
+		left.triangleCount = leftCount;
+		right.firstIndex = node.firstIndex + leftCount;
+		right.triangleCount = node.triangleCount - leftCount;
+		setBounds(context, left);
+		setBounds(context, right);
+
+		const b8 parallel = node.triangleCount > ParallelTriangleCount;
+		node.firstIndex = leftIndex;
+		node.triangleCount = 0;
+
+		if (parallel)
+		{
+			JobCounter counter;
+			JobSystem::getInstance().run([&context, leftIndex, depth]() { subdivide(context, leftIndex, depth + 1); }, counter);
+			subdivide(context, leftIndex + 1, depth + 1);
+			JobSystem::getInstance().wait(counter);
+		}
+		else
+		{
+			subdivide(context, leftIndex, depth + 1);
+			subdivide(context, leftIndex + 1, depth + 1);
+		}
+	}
+
+	// distance where the ray enters the box, false if it misses it before maxDistance
+	static b8 intersectBox(const Vector3<f32>& position, const Vector3<f32>& inverseDirection, f32 maxDistance, const TriangleBVH::Node& node, f32& distance)
+	{
+		const f32 x0 = (node.minimum.x - position.x) * inverseDirection.x;
+		const f32 x1 = (node.maximum.x - position.x) * inverseDirection.x;
+		const f32 y0 = (node.minimum.y - position.y) * inverseDirection.y;
+		const f32 y1 = (node.maximum.y - position.y) * inverseDirection.y;
+		const f32 z0 = (node.minimum.z - position.z) * inverseDirection.z;
+		const f32 z1 = (node.maximum.z - position.z) * inverseDirection.z;
+
+		const f32 entry = std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::max(std::min(z0, z1), 0.0f));
+		// the exit is pushed by a few ulps so rounding never culls a box the watertight triangle test would hit (Ize 2013)
+		const f32 exit = std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::min(std::max(z0, z1), maxDistance)) * 1.00000024f;
+
+		distance = entry;
+		return entry <= exit;
+	}
+
+	// watertight ray triangle intersection (Woop, Benthin, Wald 2013) : the ray is turned into the z axis by a permutation
+	// and a shear, so the edge tests of two triangles sharing an edge see exactly the same numbers
+	struct ShearedRay
+	{
+	public:
+		Vector3<f32> position;
+		ui32 kx;
+		ui32 ky;
+		ui32 kz;
+		f32 shearX;
+		f32 shearY;
+		f32 shearZ;
+	};
+
+	static ShearedRay getShearedRay(const Ray& ray)
+	{
+		ShearedRay shearedRay = {};
+		shearedRay.position = ray.position;
+
+		const Vector3<f32>& direction = ray.getDirection();
+		const Vector3<f32> absoluteDirection = {std::abs(direction.x), std::abs(direction.y), std::abs(direction.z)};
+		shearedRay.kz = absoluteDirection.x > absoluteDirection.y ?
+			(absoluteDirection.x > absoluteDirection.z ? 0 : 2) :
+			(absoluteDirection.y > absoluteDirection.z ? 1 : 2);
+		shearedRay.kx = (shearedRay.kz + 1) % 3;
+		shearedRay.ky = (shearedRay.kx + 1) % 3;
+
+		// keeps the winding of the triangles
+		if (getComponent(direction, shearedRay.kz) < 0.0f)
+		{
+			std::swap(shearedRay.kx, shearedRay.ky);
+		}
+
+		shearedRay.shearX = getComponent(direction, shearedRay.kx) / getComponent(direction, shearedRay.kz);
+		shearedRay.shearY = getComponent(direction, shearedRay.ky) / getComponent(direction, shearedRay.kz);
+		shearedRay.shearZ = 1.0f / getComponent(direction, shearedRay.kz);
+
+		return shearedRay;
+	}
+
+	static b8 intersectTriangle(const ShearedRay& ray, const Vector3<f32>& p0, const Vector3<f32>& p1, const Vector3<f32>& p2, f32 maxDistance, f32& distance, f32& u, f32& v)
+	{
+		const Vector3<f32> a = p0 - ray.position;
+		const Vector3<f32> b = p1 - ray.position;
+		const Vector3<f32> c = p2 - ray.position;
+
+		const f32 ax = getComponent(a, ray.kx) - ray.shearX * getComponent(a, ray.kz);
+		const f32 ay = getComponent(a, ray.ky) - ray.shearY * getComponent(a, ray.kz);
+		const f32 bx = getComponent(b, ray.kx) - ray.shearX * getComponent(b, ray.kz);
+		const f32 by = getComponent(b, ray.ky) - ray.shearY * getComponent(b, ray.kz);
+		const f32 cx = getComponent(c, ray.kx) - ray.shearX * getComponent(c, ray.kz);
+		const f32 cy = getComponent(c, ray.ky) - ray.shearY * getComponent(c, ray.kz);
+
+		// scaled barycentrics, each is the edge function of the edge opposite to its vertex
+		f32 edge0 = cx * by - cy * bx;
+		f32 edge1 = ax * cy - ay * cx;
+		f32 edge2 = bx * ay - by * ax;
+
+		// exactly on an edge, settled in double precision
+		if (edge0 == 0.0f || edge1 == 0.0f || edge2 == 0.0f)
+		{
+			edge0 = (f32)((f64)cx * (f64)by - (f64)cy * (f64)bx);
+			edge1 = (f32)((f64)ax * (f64)cy - (f64)ay * (f64)cx);
+			edge2 = (f32)((f64)bx * (f64)ay - (f64)by * (f64)ax);
+		}
+
+		if ((edge0 < 0.0f || edge1 < 0.0f || edge2 < 0.0f) && (edge0 > 0.0f || edge1 > 0.0f || edge2 > 0.0f))
+		{
+			return false;
+		}
+
+		const f32 determinant = edge0 + edge1 + edge2;
+		if (determinant == 0.0f)
+		{
+			return false;
+		}
+
+		// distance scaled by the determinant, compared before the division
+		const f32 scaledDistance = edge0 * ray.shearZ * getComponent(a, ray.kz) + edge1 * ray.shearZ * getComponent(b, ray.kz) + edge2 * ray.shearZ * getComponent(c, ray.kz);
+		if (determinant < 0.0f ? (scaledDistance > 0.0f || scaledDistance < maxDistance * determinant) : (scaledDistance < 0.0f || scaledDistance > maxDistance * determinant))
+		{
+			return false;
+		}
+
+		const f32 inverseDeterminant = 1.0f / determinant;
+		distance = scaledDistance * inverseDeterminant;
+		u = edge1 * inverseDeterminant;
+		v = edge2 * inverseDeterminant;
+		return true;
+	}
+
+	TriangleBVH::TriangleBVH()
+		: _depth(0)
+	{
+	}
+
+	void TriangleBVH::build(const Mesh& mesh)
+	{
+		const std::vector<Mesh::Vertex>& vertices = mesh.getVertices();
+		const std::vector<ui32>& indices = mesh.getIndices();
+		const ui32 triangleCount = (ui32)indices.size() / 3;
+
+		_nodes.clear();
+		_depth = 0;
+		_triangleIndices.resize(triangleCount);
+		if (triangleCount == 0)
+		{
+			return;
+		}
+
+		BuildContext context;
+		context.triangles.resize(triangleCount);
+		for (ui32 triangleIndex = 0; triangleIndex < triangleCount; ++triangleIndex)
+		{
+			const Vector3<f32>& p0 = vertices[indices[triangleIndex * 3 + 0]].position;
+			const Vector3<f32>& p1 = vertices[indices[triangleIndex * 3 + 1]].position;
+			const Vector3<f32>& p2 = vertices[indices[triangleIndex * 3 + 2]].position;
+			context.triangles[triangleIndex].minimum = getMinimum(getMinimum(p0, p1), p2);
+			context.triangles[triangleIndex].triangleIndex = triangleIndex;
+			context.triangles[triangleIndex].maximum = getMaximum(getMaximum(p0, p1), p2);
+		}
+
+		// a binary tree over n leaves has at most 2n - 1 nodes, allocated up front so jobs never resize the array
+		_nodes.resize(triangleCount * 2 - 1);
+		context.pNodes = &_nodes;
+		context.nodeCount = 1;
+		context.depth = 0;
+
+		_nodes[0].firstIndex = 0;
+		_nodes[0].triangleCount = triangleCount;
+		setBounds(context, _nodes[0]);
+		subdivide(context, 0, 0);
+		_depth = context.depth.load();
+		assert(_depth < MaxStackSize);
+
+		for (ui32 index = 0; index < triangleCount; ++index)
+		{
+			_triangleIndices[index] = context.triangles[index].triangleIndex;
+		}
+
+		_nodes.resize(context.nodeCount.load());
+		_nodes.shrink_to_fit();
+	}
+
+	b8 TriangleBVH::isBuilt() const
+	{
+		return !_nodes.empty();
+	}
+
+	b8 TriangleBVH::intersect(const Mesh& mesh, const Ray& ray, f32 maxDistance, RayHit& hit) const
+	{
+		if (_nodes.empty())
+		{
+			return false;
+		}
+
+		const std::vector<Mesh::Vertex>& vertices = mesh.getVertices();
+		const std::vector<ui32>& indices = mesh.getIndices();
+
+		const Vector3<f32>& inverseDirection = ray.inverseDirection;
+		const ShearedRay shearedRay = getShearedRay(ray);
+
+		b8 found = false;
+		f32 closestDistance = maxDistance;
+
+		ui32 stackNodes[MaxStackSize];
+		f32 stackDistances[MaxStackSize];
+		ui32 stackSize = 0;
+
+		f32 rootDistance = 0.0f;
+		if (intersectBox(ray.position, inverseDirection, closestDistance, _nodes[0], rootDistance))
+		{
+			stackNodes[stackSize] = 0;
+			stackDistances[stackSize] = rootDistance;
+			stackSize += 1;
+		}
+
+		while (stackSize > 0)
+		{
+			stackSize -= 1;
+			if (stackDistances[stackSize] > closestDistance)
+			{
+				continue;
+			}
+
+			const Node& node = _nodes[stackNodes[stackSize]];
+			if (node.triangleCount > 0)
+			{
+				for (ui32 index = node.firstIndex; index < node.firstIndex + node.triangleCount; ++index)
+				{
+					const ui32 triangleIndex = _triangleIndices[index];
+					f32 distance = 0.0f;
+					f32 u = 0.0f;
+					f32 v = 0.0f;
+					if (intersectTriangle(shearedRay,
+						vertices[indices[triangleIndex * 3 + 0]].position,
+						vertices[indices[triangleIndex * 3 + 1]].position,
+						vertices[indices[triangleIndex * 3 + 2]].position,
+						closestDistance, distance, u, v))
+					{
+						found = true;
+						closestDistance = distance;
+						hit.triangleIndex = triangleIndex;
+						hit.distance = distance;
+						hit.u = u;
+						hit.v = v;
+					}
+				}
+				continue;
+			}
+
+			// near child on top of the stack
+			f32 childDistances[2];
+			b8 childHits[2];
+			for (ui32 childIndex = 0; childIndex < 2; ++childIndex)
+			{
+				childHits[childIndex] = intersectBox(ray.position, inverseDirection, closestDistance, _nodes[node.firstIndex + childIndex], childDistances[childIndex]);
+			}
+
+			const ui32 farIndex = (childHits[0] && childHits[1] && childDistances[1] < childDistances[0]) ? 0 : 1;
+			for (ui32 order = 0; order < 2; ++order)
+			{
+				const ui32 childIndex = order == 0 ? farIndex : 1 - farIndex;
+				if (childHits[childIndex])
+				{
+					assert(stackSize < MaxStackSize);
+					stackNodes[stackSize] = node.firstIndex + childIndex;
+					stackDistances[stackSize] = childDistances[childIndex];
+					stackSize += 1;
+				}
+			}
+		}
+
+		return found;
+	}
+
+	const std::vector<TriangleBVH::Node>& TriangleBVH::getNodes() const
+	{
+		return _nodes;
+	}
+
+	ui32 TriangleBVH::getDepth() const
+	{
+		return _depth;
+	}
+
+	const std::vector<ui32>& TriangleBVH::getTriangleIndices() const
+	{
+		return _triangleIndices;
+	}
+}
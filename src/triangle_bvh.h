@@ -0,0 +1,65 @@
+#pragma once
+
+#include "types.h"
+#include "maths.h"
+#include "ray.h"
+
+#include <vector>
+
+namespace Visor
+{
+	class Mesh;
+
+	struct RayHit
+	{
+	public:
+		// the triangle made of the indices 3 * triangleIndex to 3 * triangleIndex + 2 of the mesh
+		ui32 triangleIndex;
+		f32 distance;
+		// the hit point is (1 - u - v) * p0 + u * p1 + v * p2
+		f32 u;
+		f32 v;
+	};
+
+	/*
+	bounding volume hierarchy over the triangles of a mesh, in its local space.
+	built top down, each node split where the surface area heuristic says (evaluated over a few bins per axis)
+	or at its median triangle past a depth, which keeps the tree shallow enough for the fixed traversal stack.
+	the biggest subtrees of big meshes being built in parallel on the job threads.
+	nodes are flattened in a single array, the two children of a node being next to each other
+	*/
+	class TriangleBVH
+	{
+	public:
+		struct Node
+		{
+		public:
+			Vector3<f32> minimum;
+			// first triangle of a leaf, first child of an internal node (the second one follows it)
+			ui32 firstIndex;
+			Vector3<f32> maximum;
+			// 0 for internal nodes
+			ui32 triangleCount;
+		};
+
+		TriangleBVH();
+
+		void build(const Mesh& mesh);
+		b8 isBuilt() const;
+
+		// closest triangle hit within maxDistance, the mesh must be the one the hierarchy was built from.
+		// triangles are hit from both sides, hits are watertight : rays never slip between two triangles sharing an edge
+		b8 intersect(const Mesh& mesh, const Ray& ray, f32 maxDistance, RayHit& hit) const;
+
+		const std::vector<Node>& getNodes() const;
+		const std::vector<ui32>& getTriangleIndices() const;
+		// levels below the root
+		ui32 getDepth() const;
+
+	private:
+		std::vector<Node> _nodes;
+		// triangles of the mesh ordered so every leaf references a contiguous range
+		std::vector<ui32> _triangleIndices;
+		ui32 _depth;
+	};
+}
@@ -87,6 +87,13 @@ namespace Visor
 	{
 		InputSystem::getInstance().setMousePosition((f32)x, (f32)y);
 	}
+
+#if defined(VSR_GRAPHICS_API_SOFTWARE)
+	static void framebufferSizeCallback(GLFWwindow* pWindow, i32 width, i32 height)
+	{
+		((WindowSystem::Window*)glfwGetWindowUserPointer(pWindow))->setFramebufferSize((ui32)width, (ui32)height);
+	}
+#endif
 	
 	WindowSystem::Window::Window(ui32 width, ui32 height, const std::string& title)
 		: _width(width)
@@ -94,7 +101,12 @@ namespace Visor
 		, _title(title)
 		, _pNativeHandle(nullptr)
 	{
-		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		// the software renderer presents through a legacy OpenGL context, the other APIs bring their own
+		#if defined(VSR_GRAPHICS_API_SOFTWARE)
+			glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
+		#else
+			glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		#endif
 		_pNativeHandle = (void*)glfwCreateWindow(_width, _height, "ghoust", NULL, NULL);
 		if (_pNativeHandle == NULL)
 		{
@@ -102,6 +114,20 @@ namespace Visor
 			std::exit(EXIT_FAILURE);
 		}
 
+		// the context is released, presentPixels makes it current on the thread rendering
+		#if defined(VSR_GRAPHICS_API_SOFTWARE)
+			glfwMakeContextCurrent((GLFWwindow*)_pNativeHandle);
+			glfwSwapInterval(0);
+			glfwMakeContextCurrent(NULL);
+
+			i32 framebufferWidth = 0;
+			i32 framebufferHeight = 0;
+			glfwGetFramebufferSize((GLFWwindow*)_pNativeHandle, &framebufferWidth, &framebufferHeight);
+			setFramebufferSize((ui32)framebufferWidth, (ui32)framebufferHeight);
+			glfwSetWindowUserPointer((GLFWwindow*)_pNativeHandle, this);
+			glfwSetFramebufferSizeCallback((GLFWwindow*)_pNativeHandle, framebufferSizeCallback);
+		#endif
+
 		glfwSetKeyCallback((GLFWwindow*)_pNativeHandle, keyCallback);
 		glfwSetCursorPosCallback((GLFWwindow*)_pNativeHandle, mousePositionCallback);
 	}
@@ -138,6 +164,44 @@ namespace Visor
 	}
 #endif
 
+#if defined(VSR_GRAPHICS_API_SOFTWARE)
+	void WindowSystem::Window::presentPixels(const ui32* pPixels, ui32 width, ui32 height, ui32 stride)
+	{
+		if (glfwGetCurrentContext() != (GLFWwindow*)_pNativeHandle)
+		{
+			glfwMakeContextCurrent((GLFWwindow*)_pNativeHandle);
+		}
+
+		// high density displays have more framebuffer pixels than window pixels, the image is scaled to fill them
+		const ui32 framebufferWidth = _framebufferWidth.load(std::memory_order_relaxed);
+		const ui32 framebufferHeight = _framebufferHeight.load(std::memory_order_relaxed);
+		glViewport(0, 0, (GLsizei)framebufferWidth, (GLsizei)framebufferHeight);
+
+		// OpenGL rows go up, the raster position is the top left corner and the rows are drawn downwards
+		glRasterPos2f(-1.0f, 1.0f);
+		glPixelZoom(framebufferWidth / (f32)width, -(f32)framebufferHeight / (f32)height);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)stride);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glDrawPixels((GLsizei)width, (GLsizei)height, GL_RGBA, GL_UNSIGNED_BYTE, pPixels);
+
+		glfwSwapBuffers((GLFWwindow*)_pNativeHandle);
+	}
+
+	void WindowSystem::Window::releaseContext()
+	{
+		if (glfwGetCurrentContext() == (GLFWwindow*)_pNativeHandle)
+		{
+			glfwMakeContextCurrent(NULL);
+		}
+	}
+
+	void WindowSystem::Window::setFramebufferSize(ui32 width, ui32 height)
+	{
+		_framebufferWidth.store(width, std::memory_order_relaxed);
+		_framebufferHeight.store(height, std::memory_order_relaxed);
+	}
+#endif
+
 	ui32 WindowSystem::Window::getWidth() const
 	{
 		return _width;
@@ -6,6 +6,7 @@
 #include <vulkan/vulkan.h>
 #endif
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -31,6 +32,15 @@ namespace Visor
 				VkSurfaceKHR createVkSurface(VkInstance instance, VkAllocationCallbacks* pAllocator);
 				std::vector<const c8*> getRequiredVkInstanceExtensions();
 			#endif
+			#if defined(VSR_GRAPHICS_API_SOFTWARE)
+				// draws rgba8 rows of stride pixels, the first one at the top, then swaps the buffers.
+				// the OpenGL context is current on the thread presenting, which may not be the main thread
+				void presentPixels(const ui32* pPixels, ui32 width, ui32 height, ui32 stride);
+				// on the thread which presented last, before the window is destroyed
+				void releaseContext();
+				// from the resize callback, on the main thread
+				void setFramebufferSize(ui32 width, ui32 height);
+			#endif
 			
 			ui32 getWidth() const;
 			ui32 getHeight() const;
@@ -41,6 +51,11 @@ namespace Visor
 			ui32 _height;
 			std::string _title;
 			void* _pNativeHandle;
+			#if defined(VSR_GRAPHICS_API_SOFTWARE)
+				// glfw only gives the framebuffer size on the main thread
+				std::atomic<ui32> _framebufferWidth;
+				std::atomic<ui32> _framebufferHeight;
+			#endif
 		};
 		
 	public: